@@ -0,0 +1,1906 @@
+/*
+ * Copyright (c) 2026 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "libbfs/bfs_file.h"
+#include "libbfs/bfs_util.h"
+
+#define LOG_TAG "bfs"
+#include "libcc/cc_log.h"
+#include "libcc/cc_memory.h"
+
+// default workload parameters
+#define BENCH_BLOBS 10000
+#define BENCH_SIZE  (16*1024)
+#define BENCH_GETS  100000
+
+// the sizes workload sets up to BENCH_SIZES_BYTES bytes
+// and gets up to 4*BENCH_SIZES_BYTES bytes for each size
+#define BENCH_SIZES_BYTES (64*1024*1024)
+
+// seq: reads blobs in insertion order rather than randomly
+// read_pct: percentage of operations which are gets
+// data: blob data for sets
+typedef struct
+{
+	bfs_file_t* bfs;
+	int         tid;
+	int         blobs;
+	int         gets;
+	int         ret;
+	size_t      bytes;
+	int         seq;
+	int         read_pct;
+	int         sets;
+	size_t      size;
+	const void* data;
+} bfs_bench_t;
+
+typedef struct
+{
+	bfs_file_t* bfs;
+	int         ms;
+	int         stop;
+	int         ret;
+	int         writes;
+} bfs_benchWriter_t;
+
+// results are reported as CSV rows with a header or as
+// JSON lines (see bfs_bench_report)
+static int         bfs_bench_json = 0;
+static const char* bfs_bench_name = "";
+static char        bfs_bench_header[1024];
+
+/***********************************************************
+* private                                                  *
+***********************************************************/
+
+static void usage(const char* argv0)
+{
+	ASSERT(argv0);
+
+	LOGE("BFS Benchmark");
+	LOGE("Usage: %s [--format csv|json] FILE COMMAND", argv0);
+	LOGE("COMMAND:");
+	LOGE("   blobGet NTH [BLOBS] [SIZE] [GETS]");
+	LOGE("   blobGetSeq NTH [BLOBS] [SIZE] [GETS]");
+	LOGE("   blobGetMany COUNT [BLOBS] [SIZE] [GETS]");
+	LOGE("   contention NTH [GETS] [WRITE_MS]");
+	LOGE("   blobSet [BLOBS] [SIZE]");
+	LOGE("   mixed NTH [GETS] [BLOBS] [SIZE]");
+	LOGE("   sizes [MAX_SIZE]");
+	LOGE("   blobList [BLOBS] [LISTS]");
+	LOGE("   openClose [COUNT]");
+	LOGE("   files [BLOBS] [SIZE] [GETS]");
+	LOGE("   suite NTH");
+	LOGE("FILE and FILE.files are overwritten by the benchmark");
+}
+
+static double bfs_bench_timestamp(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double) ts.tv_sec + ((double) ts.tv_nsec)/1.0e9;
+}
+
+static int bfs_bench_isNumber(const char* val)
+{
+	ASSERT(val);
+
+	char* end = NULL;
+	strtod(val, &end);
+	return (val[0] != '\0') && (end != NULL) && (*end == '\0');
+}
+
+static void bfs_bench_report(const char* fmt, ...)
+{
+	ASSERT(fmt);
+
+	// the row is formatted as space separated key=val
+	// tokens where the keys and values have no spaces
+	char    row[1024];
+	va_list ap;
+	va_start(ap, fmt);
+	vsnprintf(row, sizeof(row), fmt, ap);
+	va_end(ap);
+
+	char* keys[32];
+	char* vals[32];
+	int   count = 0;
+	char* save  = NULL;
+	char* tok   = strtok_r(row, " ", &save);
+	while(tok && (count < 32))
+	{
+		char* eq = strchr(tok, '=');
+		if(eq)
+		{
+			*eq          = '\0';
+			keys[count]  = tok;
+			vals[count]  = eq + 1;
+			++count;
+		}
+		tok = strtok_r(NULL, " ", &save);
+	}
+
+	int i;
+	if(bfs_bench_json)
+	{
+		printf("{\"bench\":\"%s\"", bfs_bench_name);
+		for(i = 0; i < count; ++i)
+		{
+			if(bfs_bench_isNumber(vals[i]))
+			{
+				printf(",\"%s\":%s", keys[i], vals[i]);
+			}
+			else
+			{
+				printf(",\"%s\":\"%s\"", keys[i], vals[i]);
+			}
+		}
+		printf("}\n");
+		fflush(stdout);
+		return;
+	}
+
+	// print the header when the columns change
+	char header[1024];
+	int  len = snprintf(header, sizeof(header), "bench");
+	for(i = 0; i < count; ++i)
+	{
+		if((len > 0) && (len < (int) sizeof(header)))
+		{
+			len += snprintf(header + len, sizeof(header) - len,
+			                ", %s", keys[i]);
+		}
+	}
+
+	if(strcmp(header, bfs_bench_header) != 0)
+	{
+		snprintf(bfs_bench_header, sizeof(bfs_bench_header),
+		         "%s", header);
+		printf("%s\n", header);
+	}
+
+	printf("%s", bfs_bench_name);
+	for(i = 0; i < count; ++i)
+	{
+		printf(", %s", vals[i]);
+	}
+	printf("\n");
+	fflush(stdout);
+}
+
+static int
+bfs_bench_run(bfs_bench_t* bench, pthread_t* threads,
+              int n, void* (*fn)(void*))
+{
+	ASSERT(bench);
+	ASSERT(threads);
+	ASSERT(fn);
+
+	int t;
+	for(t = 0; t < n; ++t)
+	{
+		if(pthread_create(&threads[t], NULL, fn,
+		                  (void*) &bench[t]) != 0)
+		{
+			LOGE("pthread_create failed");
+			break;
+		}
+	}
+
+	int ret   = (t == n);
+	int count = t;
+	for(t = 0; t < count; ++t)
+	{
+		pthread_join(threads[t], NULL);
+		ret &= bench[t].ret;
+	}
+
+	return ret;
+}
+
+static int
+bfs_bench_init(const char* fname, int blobs, size_t size)
+{
+	ASSERT(fname);
+
+	unlink(fname);
+
+	bfs_file_t* bfs;
+	bfs = bfs_file_open(fname, 1, BFS_MODE_STREAM);
+	if(bfs == NULL)
+	{
+		return 0;
+	}
+
+	void* data = CALLOC(1, size);
+	if(data == NULL)
+	{
+		LOGE("CALLOC failed");
+		goto fail_data;
+	}
+
+	int  i;
+	char name[256];
+	for(i = 0; i < blobs; ++i)
+	{
+		// tag each blob so the contents differ
+		memcpy(data, &i, size < sizeof(int) ? size : sizeof(int));
+
+		snprintf(name, 256, "blob/%i", i);
+		if(bfs_file_blobSet(bfs, name, size, data) == 0)
+		{
+			goto fail_set;
+		}
+	}
+
+	FREE(data);
+	bfs_file_close(&bfs);
+
+	// success
+	return 1;
+
+	// failure
+	fail_set:
+		FREE(data);
+	fail_data:
+		bfs_file_close(&bfs);
+	return 0;
+}
+
+static void* bfs_bench_blobGetThread(void* arg)
+{
+	ASSERT(arg);
+
+	bfs_bench_t* self = (bfs_bench_t*) arg;
+
+	unsigned int seed = (unsigned int) self->tid;
+
+	int    i;
+	char   name[256];
+	size_t size = 0;
+	void*  data = NULL;
+	for(i = 0; i < self->gets; ++i)
+	{
+		// sequential readers start at different offsets
+		int idx;
+		if(self->seq)
+		{
+			idx = (self->tid*self->gets + i)%self->blobs;
+		}
+		else
+		{
+			idx = rand_r(&seed)%self->blobs;
+		}
+
+		snprintf(name, 256, "blob/%i", idx);
+		if(bfs_file_blobGet(self->bfs, self->tid, name,
+		                    &size, &data) == 0)
+		{
+			self->ret = 0;
+			break;
+		}
+		self->bytes += size;
+	}
+	FREE(data);
+
+	return NULL;
+}
+
+static int
+bfs_bench_blobGet(const char* fname, int nth, int blobs,
+                  size_t size, int gets, int seq)
+{
+	ASSERT(fname);
+
+	if(bfs_bench_init(fname, blobs, size) == 0)
+	{
+		return 0;
+	}
+
+	bfs_bench_t* bench;
+	bench = (bfs_bench_t*) CALLOC(nth, sizeof(bfs_bench_t));
+	if(bench == NULL)
+	{
+		LOGE("CALLOC failed");
+		return 0;
+	}
+
+	pthread_t* threads;
+	threads = (pthread_t*) CALLOC(nth, sizeof(pthread_t));
+	if(threads == NULL)
+	{
+		LOGE("CALLOC failed");
+		goto fail_threads;
+	}
+
+	// measure the scaling from 1 to nth readers
+	int    n;
+	double base = 0.0;
+	for(n = 1; n <= nth; ++n)
+	{
+		bfs_file_t* bfs;
+		bfs = bfs_file_open(fname, n, BFS_MODE_RDONLY);
+		if(bfs == NULL)
+		{
+			goto fail_open;
+		}
+
+		int t;
+		for(t = 0; t < n; ++t)
+		{
+			bench[t].bfs   = bfs;
+			bench[t].tid   = t;
+			bench[t].blobs = blobs;
+			bench[t].gets  = gets;
+			bench[t].ret   = 1;
+			bench[t].bytes = 0;
+			bench[t].seq   = seq;
+		}
+
+		double t0  = bfs_bench_timestamp();
+		int    ret = bfs_bench_run(bench, threads, n,
+		                           bfs_bench_blobGetThread);
+		double dt  = bfs_bench_timestamp() - t0;
+
+		bfs_file_close(&bfs);
+
+		if(ret == 0)
+		{
+			goto fail_run;
+		}
+
+		size_t bytes = 0;
+		for(t = 0; t < n; ++t)
+		{
+			bytes += bench[t].bytes;
+		}
+
+		double ops = ((double) (n*gets))/dt;
+		if(n == 1)
+		{
+			base = ops;
+		}
+
+		bfs_bench_report("threads=%i size=%" PRIu64
+		                 " gets/s=%0.0lf MB/s=%0.1lf"
+		                 " speedup=%0.2lf",
+		                 n, (uint64_t) size, ops,
+		                 ((double) bytes)/(1024.0*1024.0*dt),
+		                 ops/base);
+	}
+
+	FREE(threads);
+	FREE(bench);
+
+	// success
+	return 1;
+
+	// failure
+	fail_run:
+	fail_open:
+		FREE(threads);
+	fail_threads:
+		FREE(bench);
+	return 0;
+}
+
+static int
+bfs_bench_blobGetMany(const char* fname, int count, int blobs,
+                      size_t size, int gets)
+{
+	ASSERT(fname);
+
+	if(bfs_bench_init(fname, blobs, size) == 0)
+	{
+		return 0;
+	}
+
+	// names are stored in a single buffer
+	char*   buf;
+	char**  names;
+	size_t* sizes;
+	void**  datas;
+	buf   = (char*)   CALLOC(count, 256);
+	names = (char**)  CALLOC(count, sizeof(char*));
+	sizes = (size_t*) CALLOC(count, sizeof(size_t));
+	datas = (void**)  CALLOC(count, sizeof(void*));
+	if((buf == NULL) || (names == NULL) ||
+	   (sizes == NULL) || (datas == NULL))
+	{
+		LOGE("CALLOC failed");
+		goto fail_alloc;
+	}
+
+	bfs_file_t* bfs;
+	bfs = bfs_file_open(fname, 1, BFS_MODE_RDONLY);
+	if(bfs == NULL)
+	{
+		goto fail_open;
+	}
+
+	// compare a loop of single gets with batched gets
+	// using the same sequence of names
+	int    m;
+	double base = 0.0;
+	for(m = 0; m < 2; ++m)
+	{
+		unsigned int seed  = 0;
+		size_t       bytes = 0;
+		int          total = 0;
+		double       t0    = bfs_bench_timestamp();
+		while(total < gets)
+		{
+			int i;
+			for(i = 0; i < count; ++i)
+			{
+				names[i] = &buf[256*i];
+				snprintf(names[i], 256, "blob/%i",
+				         rand_r(&seed)%blobs);
+			}
+
+			if(m == 0)
+			{
+				for(i = 0; i < count; ++i)
+				{
+					if(bfs_file_blobGet(bfs, 0, names[i],
+					                    &sizes[i],
+					                    &datas[i]) == 0)
+					{
+						goto fail_get;
+					}
+				}
+			}
+			else if(bfs_file_blobGetMany(bfs, 0, count,
+			                             (const char**) names,
+			                             sizes, datas) == 0)
+			{
+				goto fail_get;
+			}
+
+			for(i = 0; i < count; ++i)
+			{
+				bytes += sizes[i];
+			}
+			total += count;
+		}
+		double dt = bfs_bench_timestamp() - t0;
+
+		double ops = ((double) total)/dt;
+		if(m == 0)
+		{
+			base = ops;
+		}
+
+		bfs_bench_report("method=%s count=%i gets/s=%0.0lf"
+		                 " MB/s=%0.1lf speedup=%0.2lf",
+		                 (m == 0) ? "blobGet" : "blobGetMany",
+		                 count, ops,
+		                 ((double) bytes)/(1024.0*1024.0*dt),
+		                 ops/base);
+	}
+
+	bfs_file_close(&bfs);
+
+	int i;
+	for(i = 0; i < count; ++i)
+	{
+		FREE(datas[i]);
+	}
+	FREE(datas);
+	FREE(sizes);
+	FREE(names);
+	FREE(buf);
+
+	// success
+	return 1;
+
+	// failure
+	fail_get:
+		bfs_file_close(&bfs);
+	fail_open:
+	fail_alloc:
+	{
+		if(datas)
+		{
+			for(i = 0; i < count; ++i)
+			{
+				FREE(datas[i]);
+			}
+		}
+		FREE(datas);
+		FREE(sizes);
+		FREE(names);
+		FREE(buf);
+	}
+	return 0;
+}
+
+static void* bfs_bench_writerThread(void* arg)
+{
+	ASSERT(arg);
+
+	bfs_benchWriter_t* self = (bfs_benchWriter_t*) arg;
+
+	// rewrite one of the blobs to force commits which
+	// exclude the readers
+	char data[16];
+	memset(data, 0, sizeof(data));
+	while(__atomic_load_n(&self->stop, __ATOMIC_ACQUIRE) == 0)
+	{
+		if(bfs_file_blobSet(self->bfs, "blob/0",
+		                    sizeof(data), data) == 0)
+		{
+			self->ret = 0;
+			break;
+		}
+		++self->writes;
+		usleep(1000*self->ms);
+	}
+
+	return NULL;
+}
+
+static int
+bfs_bench_contention(const char* fname, int nth, int gets,
+                     int write_ms)
+{
+	ASSERT(fname);
+
+	// tiny blobs which fit in the page cache so that the
+	// lock is a significant fraction of each get
+	int    blobs = 64;
+	size_t size  = 16;
+	if(bfs_bench_init(fname, blobs, size) == 0)
+	{
+		return 0;
+	}
+
+	bfs_bench_t* bench;
+	bench = (bfs_bench_t*) CALLOC(nth, sizeof(bfs_bench_t));
+	if(bench == NULL)
+	{
+		LOGE("CALLOC failed");
+		return 0;
+	}
+
+	pthread_t* threads;
+	threads = (pthread_t*) CALLOC(nth, sizeof(pthread_t));
+	if(threads == NULL)
+	{
+		LOGE("CALLOC failed");
+		goto fail_threads;
+	}
+
+	// readers are lock-free in the read-only mode and the
+	// WAL journal while the delete journal excludes
+	// readers during commits
+	const char* names[] =
+	{
+		"rdonly",
+		"rdwr-delete",
+		"rdwr-wal",
+	};
+	bfs_mode_e modes[] =
+	{
+		BFS_MODE_RDONLY,
+		BFS_MODE_RDWR,
+		BFS_MODE_RDWR,
+	};
+	bfs_journal_e journals[] =
+	{
+		BFS_JOURNAL_DEFAULT,
+		BFS_JOURNAL_DELETE,
+		BFS_JOURNAL_WAL,
+	};
+
+	int m;
+	for(m = 0; m < 3; ++m)
+	{
+		int    n;
+		double base = 0.0;
+		for(n = 1; n <= nth; ++n)
+		{
+			bfs_options_t opts =
+			{
+				.nth          = n,
+				.mode         = modes[m],
+				.journal_mode = journals[m],
+			};
+
+			bfs_file_t* bfs;
+			bfs = bfs_file_openEx(fname, &opts);
+			if(bfs == NULL)
+			{
+				goto fail_open;
+			}
+
+			bfs_benchWriter_t writer =
+			{
+				.bfs = bfs,
+				.ms  = write_ms,
+				.ret = 1,
+			};
+
+			pthread_t writer_thread;
+			int       writer_active = 0;
+			if((modes[m] == BFS_MODE_RDWR) && (write_ms > 0))
+			{
+				if(pthread_create(&writer_thread, NULL,
+				                  bfs_bench_writerThread,
+				                  (void*) &writer) != 0)
+				{
+					LOGE("pthread_create failed");
+					bfs_file_close(&bfs);
+					goto fail_open;
+				}
+				writer_active = 1;
+			}
+
+			int t;
+			for(t = 0; t < n; ++t)
+			{
+				bench[t].bfs   = bfs;
+				bench[t].tid   = t;
+				bench[t].blobs = blobs;
+				bench[t].gets  = gets;
+				bench[t].ret   = 1;
+				bench[t].bytes = 0;
+			}
+
+			double t0 = bfs_bench_timestamp();
+			for(t = 0; t < n; ++t)
+			{
+				if(pthread_create(&threads[t], NULL,
+				                  bfs_bench_blobGetThread,
+				                  (void*) &bench[t]) != 0)
+				{
+					LOGE("pthread_create failed");
+					bench[t].ret = 0;
+					break;
+				}
+			}
+
+			int ret   = 1;
+			int count = t;
+			for(t = 0; t < count; ++t)
+			{
+				pthread_join(threads[t], NULL);
+				ret &= bench[t].ret;
+			}
+			double dt = bfs_bench_timestamp() - t0;
+
+			if(writer_active)
+			{
+				__atomic_store_n(&writer.stop, 1,
+				                 __ATOMIC_RELEASE);
+				pthread_join(writer_thread, NULL);
+				ret &= writer.ret;
+			}
+
+			bfs_file_close(&bfs);
+
+			if((ret == 0) || (count != n))
+			{
+				goto fail_run;
+			}
+
+			double ops = ((double) (n*gets))/dt;
+			if(n == 1)
+			{
+				base = ops;
+			}
+
+			bfs_bench_report("mode=%s threads=%i gets/s=%0.0lf"
+			                 " writes/s=%0.0lf speedup=%0.2lf",
+			                 names[m], n, ops,
+			                 ((double) writer.writes)/dt,
+			                 ops/base);
+		}
+	}
+
+	FREE(threads);
+	FREE(bench);
+
+	// success
+	return 1;
+
+	// failure
+	fail_run:
+	fail_open:
+		FREE(threads);
+	fail_threads:
+		FREE(bench);
+	return 0;
+}
+
+static int
+bfs_bench_blobSet(const char* fname, int blobs, size_t size)
+{
+	ASSERT(fname);
+
+	void* data = CALLOC(1, size);
+	if(data == NULL)
+	{
+		LOGE("CALLOC failed");
+		return 0;
+	}
+
+	// the read-write mode commits each set while the
+	// stream mode commits in batches
+	const char* names[] =
+	{
+		"rdwr",
+		"stream",
+	};
+	bfs_mode_e modes[] =
+	{
+		BFS_MODE_RDWR,
+		BFS_MODE_STREAM,
+	};
+
+	int m;
+	for(m = 0; m < 2; ++m)
+	{
+		unlink(fname);
+
+		double t0 = bfs_bench_timestamp();
+
+		bfs_file_t* bfs;
+		bfs = bfs_file_open(fname, 1, modes[m]);
+		if(bfs == NULL)
+		{
+			goto fail_open;
+		}
+
+		int  i;
+		char name[256];
+		for(i = 0; i < blobs; ++i)
+		{
+			memcpy(data, &i, size < sizeof(int) ? size : sizeof(int));
+
+			snprintf(name, 256, "blob/%i", i);
+			if(bfs_file_blobSet(bfs, name, size, data) == 0)
+			{
+				bfs_file_close(&bfs);
+				goto fail_set;
+			}
+		}
+
+		// include the final commit
+		bfs_file_close(&bfs);
+		double dt = bfs_bench_timestamp() - t0;
+
+		bfs_bench_report("mode=%s size=%" PRIu64
+		                 " sets/s=%0.0lf MB/s=%0.1lf",
+		                 names[m], (uint64_t) size,
+		                 ((double) blobs)/dt,
+		                 ((double) blobs*size)/(1024.0*1024.0*dt));
+	}
+
+	FREE(data);
+
+	// success
+	return 1;
+
+	// failure
+	fail_set:
+	fail_open:
+		FREE(data);
+	return 0;
+}
+
+static void* bfs_bench_mixedThread(void* arg)
+{
+	ASSERT(arg);
+
+	bfs_bench_t* self = (bfs_bench_t*) arg;
+
+	unsigned int seed = (unsigned int) self->tid;
+
+	int    i;
+	char   name[256];
+	size_t size = 0;
+	void*  data = NULL;
+	for(i = 0; i < self->gets; ++i)
+	{
+		snprintf(name, 256, "blob/%i",
+		         rand_r(&seed)%self->blobs);
+		if((rand_r(&seed)%100) < self->read_pct)
+		{
+			if(bfs_file_blobGet(self->bfs, self->tid, name,
+			                    &size, &data) == 0)
+			{
+				self->ret = 0;
+				break;
+			}
+			self->bytes += size;
+		}
+		else
+		{
+			if(bfs_file_blobSet(self->bfs, name, self->size,
+			                    self->data) == 0)
+			{
+				self->ret = 0;
+				break;
+			}
+			self->bytes += self->size;
+			++self->sets;
+		}
+	}
+	FREE(data);
+
+	return NULL;
+}
+
+static int
+bfs_bench_mixed(const char* fname, int nth, int gets,
+                int blobs, size_t size)
+{
+	ASSERT(fname);
+
+	if(bfs_bench_init(fname, blobs, size) == 0)
+	{
+		return 0;
+	}
+
+	bfs_bench_t* bench;
+	bench = (bfs_bench_t*) CALLOC(nth, sizeof(bfs_bench_t));
+	if(bench == NULL)
+	{
+		LOGE("CALLOC failed");
+		return 0;
+	}
+
+	pthread_t* threads;
+	threads = (pthread_t*) CALLOC(nth, sizeof(pthread_t));
+	if(threads == NULL)
+	{
+		LOGE("CALLOC failed");
+		goto fail_threads;
+	}
+
+	void* data = CALLOC(1, size);
+	if(data == NULL)
+	{
+		LOGE("CALLOC failed");
+		goto fail_data;
+	}
+
+	int read_pct[] = { 100, 90, 50, 10 };
+
+	int m;
+	for(m = 0; m < 4; ++m)
+	{
+		bfs_file_t* bfs;
+		bfs = bfs_file_open(fname, nth, BFS_MODE_RDWR);
+		if(bfs == NULL)
+		{
+			goto fail_open;
+		}
+
+		int t;
+		for(t = 0; t < nth; ++t)
+		{
+			bench[t].bfs      = bfs;
+			bench[t].tid      = t;
+			bench[t].blobs    = blobs;
+			bench[t].gets     = gets;
+			bench[t].ret      = 1;
+			bench[t].bytes    = 0;
+			bench[t].read_pct = read_pct[m];
+			bench[t].sets     = 0;
+			bench[t].size     = size;
+			bench[t].data     = data;
+		}
+
+		double t0  = bfs_bench_timestamp();
+		int    ret = bfs_bench_run(bench, threads, nth,
+		                           bfs_bench_mixedThread);
+		double dt  = bfs_bench_timestamp() - t0;
+
+		bfs_file_close(&bfs);
+
+		if(ret == 0)
+		{
+			goto fail_run;
+		}
+
+		int    sets  = 0;
+		size_t bytes = 0;
+		for(t = 0; t < nth; ++t)
+		{
+			sets  += bench[t].sets;
+			bytes += bench[t].bytes;
+		}
+
+		int ops = nth*gets;
+		bfs_bench_report("threads=%i read_pct=%i ops/s=%0.0lf"
+		                 " gets/s=%0.0lf sets/s=%0.0lf"
+		                 " MB/s=%0.1lf",
+		                 nth, read_pct[m], ((double) ops)/dt,
+		                 ((double) (ops - sets))/dt,
+		                 ((double) sets)/dt,
+		                 ((double) bytes)/(1024.0*1024.0*dt));
+	}
+
+	FREE(data);
+	FREE(threads);
+	FREE(bench);
+
+	// success
+	return 1;
+
+	// failure
+	fail_run:
+	fail_open:
+		FREE(data);
+	fail_data:
+		FREE(threads);
+	fail_threads:
+		FREE(bench);
+	return 0;
+}
+
+static int bfs_bench_sizes(const char* fname, size_t max_size)
+{
+	ASSERT(fname);
+
+	// sizes from 100 bytes to max_size in powers of 10
+	size_t size;
+	for(size = 100; size <= max_size; size *= 10)
+	{
+		int blobs = (int) (BENCH_SIZES_BYTES/size);
+		if(blobs < 2)
+		{
+			blobs = 2;
+		}
+		else if(blobs > BENCH_BLOBS)
+		{
+			blobs = BENCH_BLOBS;
+		}
+
+		int gets = (int) (4*((size_t) BENCH_SIZES_BYTES)/size);
+		if(gets < 4)
+		{
+			gets = 4;
+		}
+		else if(gets > BENCH_GETS)
+		{
+			gets = BENCH_GETS;
+		}
+
+		double t0 = bfs_bench_timestamp();
+		if(bfs_bench_init(fname, blobs, size) == 0)
+		{
+			return 0;
+		}
+		double dt_set = bfs_bench_timestamp() - t0;
+
+		bfs_file_t* bfs;
+		bfs = bfs_file_open(fname, 1, BFS_MODE_RDONLY);
+		if(bfs == NULL)
+		{
+			return 0;
+		}
+
+		bfs_bench_t bench =
+		{
+			.bfs   = bfs,
+			.blobs = blobs,
+			.gets  = gets,
+			.ret   = 1,
+		};
+
+		t0 = bfs_bench_timestamp();
+		bfs_bench_blobGetThread((void*) &bench);
+		double dt_get = bfs_bench_timestamp() - t0;
+
+		bfs_file_close(&bfs);
+
+		if(bench.ret == 0)
+		{
+			return 0;
+		}
+
+		double mb = 1024.0*1024.0;
+		bfs_bench_report("size=%" PRIu64 " blobs=%i"
+		                 " sets/s=%0.1lf set_MB/s=%0.1lf"
+		                 " gets/s=%0.1lf get_MB/s=%0.1lf",
+		                 (uint64_t) size, blobs,
+		                 ((double) blobs)/dt_set,
+		                 ((double) blobs*size)/(mb*dt_set),
+		                 ((double) gets)/dt_get,
+		                 ((double) bench.bytes)/(mb*dt_get));
+
+		// avoid overflow
+		if(size > max_size/10)
+		{
+			break;
+		}
+	}
+
+	return 1;
+}
+
+static int
+bfs_bench_list(void* priv, const char* name, size_t size)
+{
+	ASSERT(priv);
+	ASSERT(name);
+
+	int* _count = (int*) priv;
+
+	*_count += 1;
+
+	return 1;
+}
+
+static int
+bfs_bench_blobList(const char* fname, int blobs, int lists)
+{
+	ASSERT(fname);
+
+	if(bfs_bench_init(fname, blobs, 16) == 0)
+	{
+		return 0;
+	}
+
+	bfs_file_t* bfs;
+	bfs = bfs_file_open(fname, 1, BFS_MODE_RDONLY);
+	if(bfs == NULL)
+	{
+		return 0;
+	}
+
+	// the pattern, prefix and glob select the same names
+	const char* names[] =
+	{
+		"all",
+		"pattern",
+		"prefix",
+		"glob",
+	};
+
+	int m;
+	for(m = 0; m < 4; ++m)
+	{
+		int    count = 0;
+		double t0    = bfs_bench_timestamp();
+
+		int i;
+		for(i = 0; i < lists; ++i)
+		{
+			int ret;
+			count = 0;
+			if(m == 0)
+			{
+				ret = bfs_file_blobList(bfs, 0, (void*) &count,
+				                        bfs_bench_list, NULL);
+			}
+			else if(m == 1)
+			{
+				ret = bfs_file_blobList(bfs, 0, (void*) &count,
+				                        bfs_bench_list,
+				                        "blob/1%");
+			}
+			else if(m == 2)
+			{
+				ret = bfs_file_blobListPrefix(bfs, 0,
+				                              (void*) &count,
+				                              bfs_bench_list,
+				                              "blob/1");
+			}
+			else
+			{
+				ret = bfs_file_blobListGlob(bfs, 0,
+				                            (void*) &count,
+				                            bfs_bench_list,
+				                            "blob/1*");
+			}
+
+			if(ret == 0)
+			{
+				goto fail_list;
+			}
+		}
+		double dt = bfs_bench_timestamp() - t0;
+
+		bfs_bench_report("method=%s names=%i lists/s=%0.1lf"
+		                 " names/s=%0.0lf",
+		                 names[m], count, ((double) lists)/dt,
+		                 ((double) lists*count)/dt);
+	}
+
+	bfs_file_close(&bfs);
+
+	// success
+	return 1;
+
+	// failure
+	fail_list:
+		bfs_file_close(&bfs);
+	return 0;
+}
+
+static int bfs_bench_openClose(const char* fname, int count)
+{
+	ASSERT(fname);
+
+	if(bfs_bench_init(fname, BENCH_BLOBS, 16) == 0)
+	{
+		return 0;
+	}
+
+	// each reader thread has a connection
+	const char* names[] =
+	{
+		"rdonly",
+		"rdonly",
+		"rdwr",
+		"rdwr",
+	};
+	bfs_mode_e modes[] =
+	{
+		BFS_MODE_RDONLY,
+		BFS_MODE_RDONLY,
+		BFS_MODE_RDWR,
+		BFS_MODE_RDWR,
+	};
+	int nth[] = { 1, 8, 1, 8 };
+
+	int m;
+	for(m = 0; m < 4; ++m)
+	{
+		double t0 = bfs_bench_timestamp();
+
+		int i;
+		for(i = 0; i < count; ++i)
+		{
+			bfs_file_t* bfs;
+			bfs = bfs_file_open(fname, nth[m], modes[m]);
+			if(bfs == NULL)
+			{
+				return 0;
+			}
+			bfs_file_close(&bfs);
+		}
+		double dt = bfs_bench_timestamp() - t0;
+
+		bfs_bench_report("mode=%s threads=%i opens/s=%0.1lf"
+		                 " latency_us=%0.1lf",
+		                 names[m], nth[m],
+		                 ((double) count)/dt,
+		                 1.0e6*dt/((double) count));
+	}
+
+	return 1;
+}
+
+static int
+bfs_bench_fileWrite(const char* path, size_t size,
+                    const void* data)
+{
+	ASSERT(path);
+	ASSERT(data);
+
+	int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC,
+	              S_IRUSR | S_IWUSR);
+	if(fd == -1)
+	{
+		LOGE("open %s failed", path);
+		return 0;
+	}
+
+	size_t offset = 0;
+	while(offset < size)
+	{
+		ssize_t bytes;
+		bytes = write(fd, (const char*) data + offset,
+		              size - offset);
+		if((bytes < 0) && (errno == EINTR))
+		{
+			continue;
+		}
+		else if(bytes <= 0)
+		{
+			LOGE("write %s failed", path);
+			close(fd);
+			return 0;
+		}
+
+		offset += (size_t) bytes;
+	}
+
+	close(fd);
+
+	return 1;
+}
+
+static int
+bfs_bench_fileRead(const char* path, size_t* _capacity,
+                   size_t* _size, void** _data)
+{
+	ASSERT(path);
+	ASSERT(_capacity);
+	ASSERT(_size);
+	ASSERT(_data);
+
+	int fd = open(path, O_RDONLY);
+	if(fd == -1)
+	{
+		LOGE("open %s failed", path);
+		return 0;
+	}
+
+	// read into a reused buffer like bfs_file_blobGet
+	struct stat st;
+	if(fstat(fd, &st) != 0)
+	{
+		LOGE("fstat %s failed", path);
+		goto fail_fstat;
+	}
+
+	// the buffer only grows so the capacity is tracked
+	// separately from the size of the last file
+	size_t size = (size_t) st.st_size;
+	if(size > *_capacity)
+	{
+		void* data = REALLOC(*_data, size);
+		if(data == NULL)
+		{
+			LOGE("REALLOC failed");
+			goto fail_data;
+		}
+		*_data     = data;
+		*_capacity = size;
+	}
+	*_size = size;
+
+	size_t offset = 0;
+	while(offset < size)
+	{
+		ssize_t bytes;
+		bytes = read(fd, (char*) *_data + offset,
+		             size - offset);
+		if((bytes < 0) && (errno == EINTR))
+		{
+			continue;
+		}
+		else if(bytes <= 0)
+		{
+			LOGE("read %s failed", path);
+			goto fail_read;
+		}
+
+		offset += (size_t) bytes;
+	}
+
+	close(fd);
+
+	// success
+	return 1;
+
+	// failure
+	fail_read:
+	fail_data:
+	fail_fstat:
+		close(fd);
+	return 0;
+}
+
+static void
+bfs_bench_fileClean(const char* dir, int blobs)
+{
+	ASSERT(dir);
+
+	int  i;
+	char path[512];
+	for(i = 0; i < blobs; ++i)
+	{
+		snprintf(path, 512, "%s/%i", dir, i);
+		unlink(path);
+	}
+	rmdir(dir);
+}
+
+static int
+bfs_bench_files(const char* fname, int blobs, size_t size,
+                int gets)
+{
+	ASSERT(fname);
+
+	// the plain files are stored in the same filesystem
+	// as the benchmark FILE
+	char dir[256];
+	snprintf(dir, 256, "%s.files", fname);
+	bfs_bench_fileClean(dir, blobs);
+	if(mkdir(dir, S_IRWXU) != 0)
+	{
+		LOGE("mkdir %s failed", dir);
+		return 0;
+	}
+
+	void* data = CALLOC(1, size);
+	if(data == NULL)
+	{
+		LOGE("CALLOC failed");
+		goto fail_data;
+	}
+
+	double mb = 1024.0*1024.0;
+	double t0 = bfs_bench_timestamp();
+
+	int  i;
+	char path[512];
+	for(i = 0; i < blobs; ++i)
+	{
+		memcpy(data, &i, size < sizeof(int) ? size : sizeof(int));
+
+		snprintf(path, 512, "%s/%i", dir, i);
+		if(bfs_bench_fileWrite(path, size, data) == 0)
+		{
+			goto fail_write;
+		}
+	}
+	double dt = bfs_bench_timestamp() - t0;
+
+	bfs_bench_report("method=files op=set size=%" PRIu64
+	                 " ops/s=%0.0lf MB/s=%0.1lf",
+	                 (uint64_t) size, ((double) blobs)/dt,
+	                 ((double) blobs*size)/(mb*dt));
+
+	t0 = bfs_bench_timestamp();
+	if(bfs_bench_init(fname, blobs, size) == 0)
+	{
+		goto fail_init;
+	}
+	dt = bfs_bench_timestamp() - t0;
+
+	bfs_bench_report("method=bfs op=set size=%" PRIu64
+	                 " ops/s=%0.0lf MB/s=%0.1lf",
+	                 (uint64_t) size, ((double) blobs)/dt,
+	                 ((double) blobs*size)/(mb*dt));
+
+	// random gets using the same sequence of names
+	unsigned int seed  = 0;
+	size_t       bytes = 0;
+	size_t       rcap  = 0;
+	size_t       rsize = 0;
+	void*        rdata = NULL;
+	t0 = bfs_bench_timestamp();
+	for(i = 0; i < gets; ++i)
+	{
+		snprintf(path, 512, "%s/%i", dir,
+		         rand_r(&seed)%blobs);
+		if(bfs_bench_fileRead(path, &rcap, &rsize,
+		                      &rdata) == 0)
+		{
+			goto fail_read;
+		}
+		bytes += rsize;
+	}
+	dt = bfs_bench_timestamp() - t0;
+	FREE(rdata);
+	rdata = NULL;
+
+	bfs_bench_report("method=files op=get size=%" PRIu64
+	                 " ops/s=%0.0lf MB/s=%0.1lf",
+	                 (uint64_t) size, ((double) gets)/dt,
+	                 ((double) bytes)/(mb*dt));
+
+	bfs_file_t* bfs;
+	bfs = bfs_file_open(fname, 1, BFS_MODE_RDONLY);
+	if(bfs == NULL)
+	{
+		goto fail_open;
+	}
+
+	bfs_bench_t bench =
+	{
+		.bfs   = bfs,
+		.blobs = blobs,
+		.gets  = gets,
+		.ret   = 1,
+	};
+
+	t0 = bfs_bench_timestamp();
+	bfs_bench_blobGetThread((void*) &bench);
+	dt = bfs_bench_timestamp() - t0;
+
+	bfs_file_close(&bfs);
+
+	if(bench.ret == 0)
+	{
+		goto fail_get;
+	}
+
+	bfs_bench_report("method=bfs op=get size=%" PRIu64
+	                 " ops/s=%0.0lf MB/s=%0.1lf",
+	                 (uint64_t) size, ((double) gets)/dt,
+	                 ((double) bench.bytes)/(mb*dt));
+
+	FREE(data);
+	bfs_bench_fileClean(dir, blobs);
+
+	// success
+	return 1;
+
+	// failure
+	fail_get:
+	fail_open:
+	fail_read:
+		FREE(rdata);
+	fail_init:
+	fail_write:
+		FREE(data);
+	fail_data:
+		bfs_bench_fileClean(dir, blobs);
+	return 0;
+}
+
+static int bfs_bench_suite(const char* fname, int nth)
+{
+	ASSERT(fname);
+
+	// the default parameters of each workload
+	bfs_bench_name = "blobGet";
+	if(bfs_bench_blobGet(fname, nth, BENCH_BLOBS, BENCH_SIZE,
+	                     BENCH_GETS, 0) == 0)
+	{
+		return 0;
+	}
+
+	bfs_bench_name = "blobGetSeq";
+	if(bfs_bench_blobGet(fname, nth, BENCH_BLOBS, BENCH_SIZE,
+	                     BENCH_GETS, 1) == 0)
+	{
+		return 0;
+	}
+
+	bfs_bench_name = "blobGetMany";
+	if(bfs_bench_blobGetMany(fname, 16, BENCH_BLOBS,
+	                         BENCH_SIZE, BENCH_GETS) == 0)
+	{
+		return 0;
+	}
+
+	bfs_bench_name = "contention";
+	if(bfs_bench_contention(fname, nth, BENCH_GETS, 1) == 0)
+	{
+		return 0;
+	}
+
+	bfs_bench_name = "blobSet";
+	if(bfs_bench_blobSet(fname, BENCH_BLOBS, BENCH_SIZE) == 0)
+	{
+		return 0;
+	}
+
+	bfs_bench_name = "mixed";
+	if(bfs_bench_mixed(fname, nth, BENCH_GETS/10, BENCH_BLOBS,
+	                   BENCH_SIZE) == 0)
+	{
+		return 0;
+	}
+
+	bfs_bench_name = "sizes";
+	if(bfs_bench_sizes(fname, 100*1000*1000) == 0)
+	{
+		return 0;
+	}
+
+	bfs_bench_name = "blobList";
+	if(bfs_bench_blobList(fname, BENCH_BLOBS, 100) == 0)
+	{
+		return 0;
+	}
+
+	bfs_bench_name = "openClose";
+	if(bfs_bench_openClose(fname, 100) == 0)
+	{
+		return 0;
+	}
+
+	bfs_bench_name = "files";
+	return bfs_bench_files(fname, BENCH_BLOBS, BENCH_SIZE,
+	                       BENCH_GETS);
+}
+
+/***********************************************************
+* public                                                   *
+***********************************************************/
+
+int main(int argc, char** argv)
+{
+	const char* arg0 = argv[0];
+
+	// the format option precedes the FILE argument
+	if((argc >= 3) && (strcmp(argv[1], "--format") == 0))
+	{
+		if(strcmp(argv[2], "json") == 0)
+		{
+			bfs_bench_json = 1;
+		}
+		else if(strcmp(argv[2], "csv") != 0)
+		{
+			usage(arg0);
+			return EXIT_FAILURE;
+		}
+		argc -= 2;
+		argv += 2;
+	}
+
+	if(argc < 3)
+	{
+		usage(arg0);
+		return EXIT_FAILURE;
+	}
+
+	if(bfs_util_initialize() == 0)
+	{
+		return EXIT_FAILURE;
+	}
+
+	const char* fname = argv[1];
+	const char* cmd   = argv[2];
+	bfs_bench_name    = cmd;
+	if((strcmp(cmd, "blobGet")    == 0) ||
+	   (strcmp(cmd, "blobGetSeq") == 0))
+	{
+		if((argc < 4) || (argc > 7))
+		{
+			usage(arg0);
+			goto fail_cmd;
+		}
+
+		int    nth   = (int) strtol(argv[3], NULL, 0);
+		int    blobs = BENCH_BLOBS;
+		size_t size  = BENCH_SIZE;
+		int    gets  = BENCH_GETS;
+		if(argc >= 5)
+		{
+			blobs = (int) strtol(argv[4], NULL, 0);
+		}
+		if(argc >= 6)
+		{
+			size = (size_t) strtoll(argv[5], NULL, 0);
+		}
+		if(argc >= 7)
+		{
+			gets = (int) strtol(argv[6], NULL, 0);
+		}
+
+		if((nth < 1) || (blobs < 1) || (size < 1) || (gets < 1))
+		{
+			usage(arg0);
+			goto fail_cmd;
+		}
+
+		int seq = (strcmp(cmd, "blobGetSeq") == 0);
+		if(bfs_bench_blobGet(fname, nth, blobs, size,
+		                     gets, seq) == 0)
+		{
+			goto fail_cmd;
+		}
+	}
+	else if(strcmp(cmd, "blobGetMany") == 0)
+	{
+		if((argc < 4) || (argc > 7))
+		{
+			usage(arg0);
+			goto fail_cmd;
+		}
+
+		int    count = (int) strtol(argv[3], NULL, 0);
+		int    blobs = BENCH_BLOBS;
+		size_t size  = BENCH_SIZE;
+		int    gets  = BENCH_GETS;
+		if(argc >= 5)
+		{
+			blobs = (int) strtol(argv[4], NULL, 0);
+		}
+		if(argc >= 6)
+		{
+			size = (size_t) strtoll(argv[5], NULL, 0);
+		}
+		if(argc >= 7)
+		{
+			gets = (int) strtol(argv[6], NULL, 0);
+		}
+
+		if((count < 1) || (blobs < 1) || (size < 1) || (gets < 1))
+		{
+			usage(arg0);
+			goto fail_cmd;
+		}
+
+		if(bfs_bench_blobGetMany(fname, count, blobs, size,
+		                         gets) == 0)
+		{
+			goto fail_cmd;
+		}
+	}
+	else if(strcmp(cmd, "contention") == 0)
+	{
+		if((argc < 4) || (argc > 6))
+		{
+			usage(arg0);
+			goto fail_cmd;
+		}
+
+		int nth      = (int) strtol(argv[3], NULL, 0);
+		int gets     = BENCH_GETS;
+		int write_ms = 1;
+		if(argc >= 5)
+		{
+			gets = (int) strtol(argv[4], NULL, 0);
+		}
+		if(argc >= 6)
+		{
+			write_ms = (int) strtol(argv[5], NULL, 0);
+		}
+
+		if((nth < 1) || (gets < 1) || (write_ms < 0))
+		{
+			usage(arg0);
+			goto fail_cmd;
+		}
+
+		if(bfs_bench_contention(fname, nth, gets,
+		                        write_ms) == 0)
+		{
+			goto fail_cmd;
+		}
+	}
+	else if(strcmp(cmd, "blobSet") == 0)
+	{
+		if(argc > 5)
+		{
+			usage(arg0);
+			goto fail_cmd;
+		}
+
+		int    blobs = BENCH_BLOBS;
+		size_t size  = BENCH_SIZE;
+		if(argc >= 4)
+		{
+			blobs = (int) strtol(argv[3], NULL, 0);
+		}
+		if(argc >= 5)
+		{
+			size = (size_t) strtoll(argv[4], NULL, 0);
+		}
+
+		if((blobs < 1) || (size < 1))
+		{
+			usage(arg0);
+			goto fail_cmd;
+		}
+
+		if(bfs_bench_blobSet(fname, blobs, size) == 0)
+		{
+			goto fail_cmd;
+		}
+	}
+	else if(strcmp(cmd, "mixed") == 0)
+	{
+		if((argc < 4) || (argc > 7))
+		{
+			usage(arg0);
+			goto fail_cmd;
+		}
+
+		int    nth   = (int) strtol(argv[3], NULL, 0);
+		int    gets  = BENCH_GETS/10;
+		int    blobs = BENCH_BLOBS;
+		size_t size  = BENCH_SIZE;
+		if(argc >= 5)
+		{
+			gets = (int) strtol(argv[4], NULL, 0);
+		}
+		if(argc >= 6)
+		{
+			blobs = (int) strtol(argv[5], NULL, 0);
+		}
+		if(argc >= 7)
+		{
+			size = (size_t) strtoll(argv[6], NULL, 0);
+		}
+
+		if((nth < 1) || (gets < 1) || (blobs < 1) || (size < 1))
+		{
+			usage(arg0);
+			goto fail_cmd;
+		}
+
+		if(bfs_bench_mixed(fname, nth, gets, blobs,
+		                   size) == 0)
+		{
+			goto fail_cmd;
+		}
+	}
+	else if(strcmp(cmd, "sizes") == 0)
+	{
+		if(argc > 4)
+		{
+			usage(arg0);
+			goto fail_cmd;
+		}
+
+		size_t max_size = 100*1000*1000;
+		if(argc >= 4)
+		{
+			max_size = (size_t) strtoll(argv[3], NULL, 0);
+		}
+
+		if(max_size < 100)
+		{
+			usage(arg0);
+			goto fail_cmd;
+		}
+
+		if(bfs_bench_sizes(fname, max_size) == 0)
+		{
+			goto fail_cmd;
+		}
+	}
+	else if(strcmp(cmd, "blobList") == 0)
+	{
+		if(argc > 5)
+		{
+			usage(arg0);
+			goto fail_cmd;
+		}
+
+		int blobs = BENCH_BLOBS;
+		int lists = 100;
+		if(argc >= 4)
+		{
+			blobs = (int) strtol(argv[3], NULL, 0);
+		}
+		if(argc >= 5)
+		{
+			lists = (int) strtol(argv[4], NULL, 0);
+		}
+
+		if((blobs < 1) || (lists < 1))
+		{
+			usage(arg0);
+			goto fail_cmd;
+		}
+
+		if(bfs_bench_blobList(fname, blobs, lists) == 0)
+		{
+			goto fail_cmd;
+		}
+	}
+	else if(strcmp(cmd, "openClose") == 0)
+	{
+		if(argc > 4)
+		{
+			usage(arg0);
+			goto fail_cmd;
+		}
+
+		int count = 100;
+		if(argc >= 4)
+		{
+			count = (int) strtol(argv[3], NULL, 0);
+		}
+
+		if(count < 1)
+		{
+			usage(arg0);
+			goto fail_cmd;
+		}
+
+		if(bfs_bench_openClose(fname, count) == 0)
+		{
+			goto fail_cmd;
+		}
+	}
+	else if(strcmp(cmd, "files") == 0)
+	{
+		if(argc > 6)
+		{
+			usage(arg0);
+			goto fail_cmd;
+		}
+
+		int    blobs = BENCH_BLOBS;
+		size_t size  = BENCH_SIZE;
+		int    gets  = BENCH_GETS;
+		if(argc >= 4)
+		{
+			blobs = (int) strtol(argv[3], NULL, 0);
+		}
+		if(argc >= 5)
+		{
+			size = (size_t) strtoll(argv[4], NULL, 0);
+		}
+		if(argc >= 6)
+		{
+			gets = (int) strtol(argv[5], NULL, 0);
+		}
+
+		if((blobs < 1) || (size < 1) || (gets < 1))
+		{
+			usage(arg0);
+			goto fail_cmd;
+		}
+
+		if(bfs_bench_files(fname, blobs, size, gets) == 0)
+		{
+			goto fail_cmd;
+		}
+	}
+	else if(strcmp(cmd, "suite") == 0)
+	{
+		if(argc != 4)
+		{
+			usage(arg0);
+			goto fail_cmd;
+		}
+
+		int nth = (int) strtol(argv[3], NULL, 0);
+		if(nth < 1)
+		{
+			usage(arg0);
+			goto fail_cmd;
+		}
+
+		if(bfs_bench_suite(fname, nth) == 0)
+		{
+			goto fail_cmd;
+		}
+	}
+	else
+	{
+		usage(arg0);
+		goto fail_cmd;
+	}
+
+	bfs_util_shutdown();
+
+	// success
+	return EXIT_SUCCESS;
+
+	// failure
+	fail_cmd:
+		bfs_util_shutdown();
+	return EXIT_FAILURE;
+}
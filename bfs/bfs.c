@@ -25,11 +25,14 @@
 #include <sys/types.h>
 #include <dirent.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <inttypes.h>
+#include <limits.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 #include "libbfs/bfs_file.h"
 #include "libbfs/bfs_util.h"
@@ -37,6 +40,14 @@
 #define LOG_TAG "bfs"
 #include "libcc/cc_log.h"
 #include "libcc/cc_memory.h"
+#include "bfs_export.h"
+#include "bfs_import.h"
+
+typedef struct
+{
+	const char* fname;
+	int         found;
+} bfs_output_t;
 
 /***********************************************************
 * private                                                  *
@@ -49,20 +60,47 @@ static void usage(const char* argv0)
 	// a single percent is required on the command line
 	// a double percent is required for logging
 	LOGE("BFS (Blob File System)");
-	LOGE("Usage: %s FILE COMMAND", argv0);
+	LOGE("Usage: %s [OPTIONS] FILE COMMAND", argv0);
+	LOGE("OPTIONS:");
+	LOGE("   --journal delete|truncate|persist|memory|wal|off");
+	LOGE("   --page-size BYTES (new files only)");
+	LOGE("   --cache-size PAGES (or -KiB)");
+	LOGE("   --mmap-size BYTES");
+	LOGE("   --sync off|normal|full|extra");
+	LOGE("   --temp-store file|memory");
+	LOGE("   --chunk-size BYTES");
+	LOGE("   --batch-count N (import)");
+	LOGE("   --batch-bytes BYTES (import)");
+	LOGE("   --batch-ms MS (import)");
+	LOGE("   --codec none|lz");
+	LOGE("   --dedup off|on");
+	LOGE("   --verify off|on");
+	LOGE("   --threads N (import/export/verify)");
+	LOGE("   --stats off|on (print stats after COMMAND)");
 	LOGE("COMMAND:");
 	LOGE("   attrList");
 	LOGE("   attrGet KEY");
 	LOGE("   attrSet KEY VAL");
 	LOGE("   attrClr KEY");
 	LOGE("   blobList [PATTERN]");
+	LOGE("   blobPrefix PREFIX");
+	LOGE("   blobGlob GLOB");
+	LOGE("   blobCount");
 	LOGE("   blobGet NAME [OUTPUT]");
 	LOGE("   blobSet NAME [INPUT]");
 	LOGE("   blobClr NAME");
+	LOGE("   import DIR");
+	LOGE("   export DIR [PATTERN]");
+	LOGE("   verify");
+	LOGE("   scan PREFIX (reads every matching blob)");
 	LOGE("PATTERN:");
 	LOGE("   %% matches any sequence of zero or more characters");
 	LOGE("   _ matches any single character");
 	LOGE("   image/%%.jpg matches all images with '.jpg' extension");
+	LOGE("GLOB:");
+	LOGE("   * matches any sequence of zero or more characters");
+	LOGE("   ? matches any single character");
+	LOGE("   image/*.jpg matches all images with '.jpg' extension");
 }
 
 static int bfs_mkdir(const char* fname)
@@ -104,6 +142,259 @@ static int bfs_mkdir(const char* fname)
 	return 1;
 }
 
+static int
+bfs_parseEnum(const char* arg, const char** names,
+              int* _val)
+{
+	ASSERT(arg);
+	ASSERT(names);
+	ASSERT(_val);
+
+	// names[0] is reserved for the default value
+	int i = 1;
+	while(names[i])
+	{
+		if(strcmp(arg, names[i]) == 0)
+		{
+			*_val = i;
+			return 1;
+		}
+		++i;
+	}
+
+	LOGE("invalid %s", arg);
+	return 0;
+}
+
+static int
+bfs_parseInt(const char* arg, int64_t min, int64_t max,
+             int64_t* _val)
+{
+	ASSERT(arg);
+	ASSERT(_val);
+
+	// reject empty, trailing or out of range values
+	char* end = NULL;
+	errno = 0;
+	long long val = strtoll(arg, &end, 0);
+	if((end == arg) || (*end != '\0') || (errno != 0) ||
+	   (val < min) || (val > max))
+	{
+		LOGE("invalid %s", arg);
+		return 0;
+	}
+
+	*_val = (int64_t) val;
+	return 1;
+}
+
+static int
+bfs_parseOptions(int* _argc, char** argv,
+                 bfs_options_t* opts, int* _stats)
+{
+	ASSERT(_argc);
+	ASSERT(argv);
+	ASSERT(opts);
+	ASSERT(_stats);
+
+	const char* journal[] =
+	{
+		"default", "delete", "truncate", "persist",
+		"memory", "wal", "off", NULL
+	};
+
+	const char* synchronous[] =
+	{
+		"default", "off", "normal", "full", "extra", NULL
+	};
+
+	const char* temp_store[] =
+	{
+		"default", "file", "memory", NULL
+	};
+
+	const char* onoff[] =
+	{
+		"off", "on", NULL
+	};
+
+	// remove options from the command line arguments
+	int     argc = 1;
+	int     i    = 1;
+	int     val;
+	int64_t ival;
+	while(i < *_argc)
+	{
+		const char* arg = argv[i];
+		if(strncmp(arg, "--", 2) != 0)
+		{
+			argv[argc++] = argv[i++];
+			continue;
+		}
+		else if(i + 1 >= *_argc)
+		{
+			LOGE("invalid %s", arg);
+			return 0;
+		}
+
+		const char* param = argv[i + 1];
+		if(strcmp(arg, "--journal") == 0)
+		{
+			if(bfs_parseEnum(param, journal, &val) == 0)
+			{
+				return 0;
+			}
+			opts->journal_mode = (bfs_journal_e) val;
+		}
+		else if(strcmp(arg, "--page-size") == 0)
+		{
+			if(bfs_parseInt(param, 0, 65536, &ival) == 0)
+			{
+				return 0;
+			}
+			opts->page_size = (int) ival;
+		}
+		else if(strcmp(arg, "--cache-size") == 0)
+		{
+			if(bfs_parseInt(param, INT_MIN, INT_MAX, &ival) == 0)
+			{
+				return 0;
+			}
+			opts->cache_size = (int) ival;
+		}
+		else if(strcmp(arg, "--mmap-size") == 0)
+		{
+			if(bfs_parseInt(param, 0, INT64_MAX, &ival) == 0)
+			{
+				return 0;
+			}
+			opts->mmap_size = (size_t) ival;
+		}
+		else if(strcmp(arg, "--sync") == 0)
+		{
+			if(bfs_parseEnum(param, synchronous, &val) == 0)
+			{
+				return 0;
+			}
+			opts->synchronous = (bfs_sync_e) val;
+		}
+		else if(strcmp(arg, "--temp-store") == 0)
+		{
+			if(bfs_parseEnum(param, temp_store, &val) == 0)
+			{
+				return 0;
+			}
+			opts->temp_store = (bfs_temp_e) val;
+		}
+		else if(strcmp(arg, "--chunk-size") == 0)
+		{
+			if(bfs_parseInt(param, 0, INT64_MAX, &ival) == 0)
+			{
+				return 0;
+			}
+			opts->chunk_size = (size_t) ival;
+		}
+		else if(strcmp(arg, "--batch-count") == 0)
+		{
+			if(bfs_parseInt(param, 0, INT_MAX, &ival) == 0)
+			{
+				return 0;
+			}
+			opts->batch_count = (int) ival;
+		}
+		else if(strcmp(arg, "--batch-bytes") == 0)
+		{
+			if(bfs_parseInt(param, 0, INT64_MAX, &ival) == 0)
+			{
+				return 0;
+			}
+			opts->batch_bytes = (size_t) ival;
+		}
+		else if(strcmp(arg, "--batch-ms") == 0)
+		{
+			if(bfs_parseInt(param, 0, INT_MAX, &ival) == 0)
+			{
+				return 0;
+			}
+			opts->batch_ms = (int) ival;
+		}
+		else if(strcmp(arg, "--codec") == 0)
+		{
+			const bfs_codec_t* codec = NULL;
+			if(strcmp(param, "none") == 0)
+			{
+				opts->codec = BFS_CODEC_NONE;
+			}
+			else if((codec = bfs_codec_findName(param)) != NULL)
+			{
+				opts->codec = codec->id;
+			}
+			else
+			{
+				LOGE("invalid %s", param);
+				return 0;
+			}
+		}
+		else if(strcmp(arg, "--dedup") == 0)
+		{
+			if(bfs_parseEnum(param, onoff, &opts->dedup) == 0)
+			{
+				return 0;
+			}
+		}
+		else if(strcmp(arg, "--verify") == 0)
+		{
+			if(bfs_parseEnum(param, onoff, &opts->verify) == 0)
+			{
+				return 0;
+			}
+		}
+		else if(strcmp(arg, "--stats") == 0)
+		{
+			if(bfs_parseEnum(param, onoff, _stats) == 0)
+			{
+				return 0;
+			}
+		}
+		else if(strcmp(arg, "--threads") == 0)
+		{
+			if(bfs_parseInt(param, 1, INT_MAX, &ival) == 0)
+			{
+				return 0;
+			}
+			opts->nth = (int) ival;
+		}
+		else
+		{
+			LOGE("invalid %s", arg);
+			return 0;
+		}
+
+		i += 2;
+	}
+	argv[argc] = NULL;
+	*_argc     = argc;
+
+	return 1;
+}
+
+static bfs_file_t*
+bfs_open(const char* fname, bfs_options_t* opts,
+         bfs_mode_e mode)
+{
+	ASSERT(fname);
+	ASSERT(opts);
+
+	// the reader threads are only used by export and verify
+	if(opts->nth <= 0)
+	{
+		opts->nth = 1;
+	}
+	opts->mode = mode;
+
+	return bfs_file_openEx(fname, opts);
+}
+
 static int
 bfs_attr_list(void* priv, const char* key, const char* val)
 {
@@ -127,6 +418,60 @@ bfs_attr_list(void* priv, const char* key, const char* val)
 	return 1;
 }
 
+static int
+bfs_blob_output(void* priv, const char* name,
+                size_t size, const void* data)
+{
+	ASSERT(priv);
+	ASSERT(name);
+	ASSERT(data);
+
+	bfs_output_t* out = (bfs_output_t*) priv;
+
+	out->found = 1;
+
+	if(bfs_mkdir(out->fname) == 0)
+	{
+		return 0;
+	}
+
+	FILE* f = fopen(out->fname, "w");
+	if(f == NULL)
+	{
+		LOGE("fopen %s failed", out->fname);
+		return 0;
+	}
+
+	if(fwrite(data, size, 1, f) != 1)
+	{
+		LOGE("fwrite failed");
+		fclose(f);
+		return 0;
+	}
+
+	fclose(f);
+
+	return 1;
+}
+
+static double bfs_timestamp(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double) ts.tv_sec + ((double) ts.tv_nsec)/1.0e9;
+}
+
+static int
+bfs_blob_corrupt(void* priv, const char* name, size_t size)
+{
+	// priv may be NULL
+	ASSERT(name);
+
+	printf("corrupt %s\n", name);
+
+	return 1;
+}
+
 static int
 bfs_blob_list(void* priv, const char* name, size_t size)
 {
@@ -142,6 +487,133 @@ bfs_blob_list(void* priv, const char* name, size_t size)
 	return 1;
 }
 
+static int
+bfs_blob_discard(void* priv, const char* name,
+                 size_t size, const void* data)
+{
+	ASSERT(priv);
+	ASSERT(name);
+	ASSERT(data);
+
+	uint64_t* _bytes = (uint64_t*) priv;
+
+	*_bytes += size;
+
+	return 1;
+}
+
+static int
+bfs_blob_scan(bfs_file_t* bfs, const char* prefix,
+              uint64_t* _count, uint64_t* _bytes)
+{
+	ASSERT(bfs);
+	ASSERT(prefix);
+	ASSERT(_count);
+	ASSERT(_bytes);
+
+	bfs_blobPage_t* page = bfs_blobPage_new();
+	if(page == NULL)
+	{
+		return 0;
+	}
+
+	// the next page resumes after a copy of the last name
+	// since the page is reused
+	char* after = NULL;
+	while(1)
+	{
+		if(bfs_file_blobListPage(bfs, 0, prefix, after,
+		                         1000, page) == 0)
+		{
+			goto fail_page;
+		}
+
+		int i;
+		int count = bfs_blobPage_count(page);
+		for(i = 0; i < count; ++i)
+		{
+			const char* name = bfs_blobPage_name(page, i);
+			if(bfs_file_blobGetFn(bfs, 0, name,
+			                      (void*) _bytes,
+			                      bfs_blob_discard) == 0)
+			{
+				goto fail_get;
+			}
+		}
+		*_count += (uint64_t) count;
+
+		const char* next = bfs_blobPage_next(page);
+		if(next == NULL)
+		{
+			break;
+		}
+
+		size_t len = strlen(next) + 1;
+		FREE(after);
+		after = (char*) MALLOC(len);
+		if(after == NULL)
+		{
+			LOGE("MALLOC failed");
+			goto fail_after;
+		}
+		memcpy(after, next, len);
+	}
+
+	FREE(after);
+	bfs_blobPage_delete(&page);
+
+	// success
+	return 1;
+
+	// failure
+	fail_after:
+	fail_get:
+	fail_page:
+		FREE(after);
+		bfs_blobPage_delete(&page);
+	return 0;
+}
+
+static void bfs_printStats(bfs_file_t* bfs)
+{
+	ASSERT(bfs);
+
+	bfs_stats_t stats;
+	if(bfs_file_stats(bfs, &stats) == 0)
+	{
+		return;
+	}
+
+	// latencies are printed in microseconds
+	printf("%-14s %10s %8s %12s %12s %10s %10s %10s %10s %10s\n",
+	       "op", "count", "errors", "bytes_in", "bytes_out",
+	       "mean_us", "p50_us", "p90_us", "p99_us", "max_us");
+
+	int i;
+	for(i = 0; i < BFS_STATS_COUNT; ++i)
+	{
+		bfs_statsOp_t* op = &stats.op[i];
+		if(op->count == 0)
+		{
+			continue;
+		}
+
+		double mean = ((double) op->time_ns)/
+		              ((double) op->count);
+		printf("%-14s %10" PRIu64 " %8" PRIu64
+		       " %12" PRIu64 " %12" PRIu64
+		       " %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+		       bfs_stats_name((bfs_statsOp_e) i),
+		       op->count, op->errors,
+		       op->bytes_in, op->bytes_out,
+		       mean/1000.0,
+		       ((double) bfs_stats_percentile(op, 0.5))/1000.0,
+		       ((double) bfs_stats_percentile(op, 0.9))/1000.0,
+		       ((double) bfs_stats_percentile(op, 0.99))/1000.0,
+		       ((double) op->max_ns)/1000.0);
+	}
+}
+
 /***********************************************************
 * public                                                   *
 ***********************************************************/
@@ -149,6 +621,15 @@ bfs_blob_list(void* priv, const char* name, size_t size)
 int main(int argc, char** argv)
 {
 	const char* arg0 = argv[0];
+
+	bfs_options_t opts  = { .nth = 0 };
+	int           stats = 0;
+	if(bfs_parseOptions(&argc, argv, &opts, &stats) == 0)
+	{
+		usage(arg0);
+		return EXIT_FAILURE;
+	}
+
 	if(argc < 3)
 	{
 		usage(arg0);
@@ -165,7 +646,7 @@ int main(int argc, char** argv)
 	const char* cmd   = argv[2];
 	if(strcmp(cmd, "attrList") == 0)
 	{
-		bfs = bfs_file_open(fname, 1, BFS_MODE_RDONLY);
+		bfs = bfs_open(fname, &opts, BFS_MODE_RDONLY);
 		if(bfs == NULL)
 		{
 			goto fail_shutdown;
@@ -174,7 +655,7 @@ int main(int argc, char** argv)
 		// output keyval pairs using JSON
 		uint32_t count = 0;
 		printf("{");
-		if(bfs_file_attrList(bfs, (void*) &count,
+		if(bfs_file_attrList(bfs, 0, (void*) &count,
 		                     bfs_attr_list) == 0)
 		{
 			goto fail_cmd;
@@ -195,7 +676,7 @@ int main(int argc, char** argv)
 		}
 		char* key = argv[3];
 
-		bfs = bfs_file_open(fname, 1, BFS_MODE_RDONLY);
+		bfs = bfs_open(fname, &opts, BFS_MODE_RDONLY);
 		if(bfs == NULL)
 		{
 			goto fail_shutdown;
@@ -219,7 +700,7 @@ int main(int argc, char** argv)
 		char* key = argv[3];
 		char* val = argv[4];
 
-		bfs = bfs_file_open(fname, 1, BFS_MODE_RDWR);
+		bfs = bfs_open(fname, &opts, BFS_MODE_RDWR);
 		if(bfs == NULL)
 		{
 			goto fail_shutdown;
@@ -239,7 +720,7 @@ int main(int argc, char** argv)
 		}
 		char* key = argv[3];
 
-		bfs = bfs_file_open(fname, 1, BFS_MODE_RDWR);
+		bfs = bfs_open(fname, &opts, BFS_MODE_RDWR);
 		if(bfs == NULL)
 		{
 			goto fail_shutdown;
@@ -263,20 +744,78 @@ int main(int argc, char** argv)
 			goto fail_shutdown;
 		}
 
-		bfs = bfs_file_open(fname, 1, BFS_MODE_RDONLY);
+		bfs = bfs_open(fname, &opts, BFS_MODE_RDONLY);
 		if(bfs == NULL)
 		{
 			goto fail_shutdown;
 		}
 
 		size_t total = 0;
-		if(bfs_file_blobList(bfs, (void*) &total, bfs_blob_list,
-		                     pattern) == 0)
+		if(bfs_file_blobList(bfs, 0, (void*) &total,
+		                     bfs_blob_list, pattern) == 0)
 		{
 			goto fail_cmd;
 		}
 		printf("%10" PRIu64 " bytes\n", (uint64_t) total);
 	}
+	else if((strcmp(cmd, "blobPrefix") == 0) ||
+	        (strcmp(cmd, "blobGlob")   == 0))
+	{
+		if(argc != 4)
+		{
+			usage(arg0);
+			goto fail_shutdown;
+		}
+
+		bfs = bfs_open(fname, &opts, BFS_MODE_RDONLY);
+		if(bfs == NULL)
+		{
+			goto fail_shutdown;
+		}
+
+		int    ret;
+		size_t total = 0;
+		if(strcmp(cmd, "blobPrefix") == 0)
+		{
+			ret = bfs_file_blobListPrefix(bfs, 0, (void*) &total,
+			                              bfs_blob_list, argv[3]);
+		}
+		else
+		{
+			ret = bfs_file_blobListGlob(bfs, 0, (void*) &total,
+			                            bfs_blob_list, argv[3]);
+		}
+
+		if(ret == 0)
+		{
+			goto fail_cmd;
+		}
+		printf("%10" PRIu64 " bytes\n", (uint64_t) total);
+	}
+	else if(strcmp(cmd, "blobCount") == 0)
+	{
+		if(argc != 3)
+		{
+			usage(arg0);
+			goto fail_shutdown;
+		}
+
+		bfs = bfs_open(fname, &opts, BFS_MODE_RDONLY);
+		if(bfs == NULL)
+		{
+			goto fail_shutdown;
+		}
+
+		uint64_t count = 0;
+		uint64_t bytes = 0;
+		if((bfs_file_blobCount(bfs, 0, &count) == 0) ||
+		   (bfs_file_totalBytes(bfs, 0, &bytes) == 0))
+		{
+			goto fail_cmd;
+		}
+		printf("%10" PRIu64 " blobs\n", count);
+		printf("%10" PRIu64 " bytes\n", bytes);
+	}
 	else if(strcmp(cmd, "blobGet") == 0)
 	{
 		char* name   = NULL;
@@ -297,44 +836,23 @@ int main(int argc, char** argv)
 			goto fail_shutdown;
 		}
 
-		bfs = bfs_file_open(fname, 1, BFS_MODE_RDONLY);
+		bfs = bfs_open(fname, &opts, BFS_MODE_RDONLY);
 		if(bfs == NULL)
 		{
 			goto fail_shutdown;
 		}
 
-		size_t size = 0;
-		void*  data = NULL;
-		if((bfs_file_blobGet(bfs, 0, name, &size, &data) == 0) ||
-		   (data == NULL))
-		{
-			goto fail_cmd;
-		}
-
-		if(bfs_mkdir(output) == 0)
-		{
-			FREE(data);
-			goto fail_cmd;
-		}
-
-		FILE* f = fopen(output, "w");
-		if(f == NULL)
+		// write the blob directly from the sqlite3 row buffer
+		bfs_output_t out =
 		{
-			LOGE("fopen %s failed", output);
-			FREE(data);
-			goto fail_cmd;
-		}
-
-		if(fwrite(data, size, 1, f) != 1)
+			.fname = output,
+		};
+		if((bfs_file_blobGetFn(bfs, 0, name, (void*) &out,
+		                       bfs_blob_output) == 0) ||
+		   (out.found == 0))
 		{
-			LOGE("fwrite failed");
-			fclose(f);
-			FREE(data);
 			goto fail_cmd;
 		}
-
-		fclose(f);
-		FREE(data);
 	}
 	else if(strcmp(cmd, "blobSet") == 0)
 	{
@@ -356,83 +874,184 @@ int main(int argc, char** argv)
 			goto fail_shutdown;
 		}
 
-		bfs = bfs_file_open(fname, 1, BFS_MODE_RDWR);
+		bfs = bfs_open(fname, &opts, BFS_MODE_RDWR);
 		if(bfs == NULL)
 		{
 			goto fail_shutdown;
 		}
 
-		FILE* f = fopen(input, "r");
-		if(f == NULL)
+		// stream the input file in fixed size chunks
+		int fd = open(input, O_RDONLY);
+		if(fd == -1)
 		{
-			LOGE("fopen %s failed", input);
+			LOGE("open %s failed", input);
 			goto fail_cmd;
 		}
 
-		// get file size
-		if(fseek(f, (long) 0, SEEK_END) == -1)
+		if(bfs_file_blobSetFd(bfs, name, fd) == 0)
 		{
-			LOGE("fseek failed");
-			fclose(f);
+			close(fd);
 			goto fail_cmd;
 		}
-		size_t size = ftell(f);
 
-		// rewind to start
-		if(fseek(f, 0, SEEK_SET) == -1)
+		close(fd);
+	}
+	else if(strcmp(cmd, "blobClr") == 0)
+	{
+		if(argc != 4)
+		{
+			usage(arg0);
+			goto fail_shutdown;
+		}
+		char* name = argv[3];
+
+		bfs = bfs_open(fname, &opts, BFS_MODE_RDWR);
+		if(bfs == NULL)
+		{
+			goto fail_shutdown;
+		}
+
+		if(bfs_file_blobClr(bfs, name) == 0)
 		{
-			LOGE("fseek failed");
-			fclose(f);
 			goto fail_cmd;
 		}
+	}
+	else if(strcmp(cmd, "import") == 0)
+	{
+		if(argc != 4)
+		{
+			usage(arg0);
+			goto fail_shutdown;
+		}
+		char* dir = argv[3];
 
-		// allocate buffer
-		void* data = CALLOC(1, size);
-		if(data == NULL)
+		// read with one thread per CPU by default
+		int nth = opts.nth;
+		if(nth <= 0)
+		{
+			nth = (int) sysconf(_SC_NPROCESSORS_ONLN);
+		}
+
+		// the readers feed a single stream mode writer
+		opts.nth = 0;
+		bfs = bfs_open(fname, &opts, BFS_MODE_STREAM);
+		if(bfs == NULL)
+		{
+			goto fail_shutdown;
+		}
+
+		if(bfs_import(bfs, dir, nth) == 0)
 		{
-			LOGE("CALLOC failed");
-			fclose(f);
 			goto fail_cmd;
 		}
+	}
+	else if(strcmp(cmd, "export") == 0)
+	{
+		char* dir     = NULL;
+		char* pattern = NULL;
+		if(argc == 5)
+		{
+			dir     = argv[3];
+			pattern = argv[4];
+		}
+		else if(argc == 4)
+		{
+			dir = argv[3];
+		}
+		else
+		{
+			usage(arg0);
+			goto fail_shutdown;
+		}
 
-		// read data
-		if(fread(data, size, 1, f) != 1)
+		// export with one reader thread per CPU by default
+		if(opts.nth <= 0)
+		{
+			opts.nth = (int) sysconf(_SC_NPROCESSORS_ONLN);
+		}
+
+		bfs = bfs_open(fname, &opts, BFS_MODE_RDONLY);
+		if(bfs == NULL)
+		{
+			goto fail_shutdown;
+		}
+
+		if(bfs_export(bfs, dir, pattern, opts.nth) == 0)
 		{
-			LOGE("fread failed");
-			FREE(data);
-			fclose(f);
 			goto fail_cmd;
 		}
+	}
+	else if(strcmp(cmd, "verify") == 0)
+	{
+		if(argc != 3)
+		{
+			usage(arg0);
+			goto fail_shutdown;
+		}
+
+		// verify with one reader thread per CPU by default
+		if(opts.nth <= 0)
+		{
+			opts.nth = (int) sysconf(_SC_NPROCESSORS_ONLN);
+		}
 
-		if(bfs_file_blobSet(bfs, name, size, data) == 0)
+		bfs = bfs_open(fname, &opts, BFS_MODE_RDONLY);
+		if(bfs == NULL)
+		{
+			goto fail_shutdown;
+		}
+
+		bfs_verify_t verify;
+		double       t0 = bfs_timestamp();
+		if(bfs_file_verify(bfs, NULL, bfs_blob_corrupt,
+		                   &verify) == 0)
 		{
-			FREE(data);
-			fclose(f);
 			goto fail_cmd;
 		}
 
-		FREE(data);
-		fclose(f);
+		double dt = bfs_timestamp() - t0;
+		double gb = ((double) verify.bytes)/1.0e9;
+		printf("%10" PRIu64 " blobs\n",   verify.count);
+		printf("%10" PRIu64 " bytes\n",   verify.bytes);
+		printf("%10" PRIu64 " skipped\n", verify.skipped);
+		printf("%10" PRIu64 " corrupt\n", verify.corrupt);
+		printf("%10.3f GB/s (%i threads)\n",
+		       (dt > 0.0) ? gb/dt : 0.0, opts.nth);
+
+		if(verify.corrupt)
+		{
+			goto fail_cmd;
+		}
 	}
-	else if(strcmp(cmd, "blobClr") == 0)
+	else if(strcmp(cmd, "scan") == 0)
 	{
 		if(argc != 4)
 		{
 			usage(arg0);
 			goto fail_shutdown;
 		}
-		char* name = argv[3];
 
-		bfs = bfs_file_open(fname, 1, BFS_MODE_RDWR);
+		bfs = bfs_open(fname, &opts, BFS_MODE_RDONLY);
 		if(bfs == NULL)
 		{
 			goto fail_shutdown;
 		}
 
-		if(bfs_file_blobClr(bfs, name) == 0)
+		// read the blobs (e.g. to measure the read path
+		// with --stats on)
+		uint64_t count = 0;
+		uint64_t bytes = 0;
+		double   t0    = bfs_timestamp();
+		if(bfs_blob_scan(bfs, argv[3], &count, &bytes) == 0)
 		{
 			goto fail_cmd;
 		}
+
+		double dt = bfs_timestamp() - t0;
+		double mb = ((double) bytes)/(1024.0*1024.0);
+		printf("%10" PRIu64 " blobs\n", count);
+		printf("%10" PRIu64 " bytes\n", bytes);
+		printf("%10.1f MB/s\n", (dt > 0.0) ? mb/dt : 0.0);
 	}
 	else
 	{
@@ -440,6 +1059,11 @@ int main(int argc, char** argv)
 		goto fail_shutdown;
 	}
 
+	if(stats)
+	{
+		bfs_printStats(bfs);
+	}
+
 	bfs_file_close(&bfs);
 	bfs_util_shutdown();
 
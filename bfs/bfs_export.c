@@ -0,0 +1,601 @@
+/*
+ * Copyright (c) 2026 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define LOG_TAG "bfs"
+#include "libcc/cc_log.h"
+#include "libcc/cc_memory.h"
+#include "bfs_export.h"
+
+// blobs larger than EXPORT_READ_MAX are streamed by a blob
+// reader in EXPORT_BUFFER pieces rather than assembled
+#define EXPORT_READ_MAX (16*1024*1024)
+#define EXPORT_BUFFER   (4*1024*1024)
+
+// the readers claim EXPORT_BATCH consecutive names so
+// blobs in the same directory are exported by one reader
+#define EXPORT_BATCH 64
+
+// blob name which is stored at offset in the names buffer
+typedef struct
+{
+	size_t offset;
+	size_t size;
+} bfs_exportName_t;
+
+// the names are sorted by the blob list and the readers
+// claim batches with the next counter
+typedef struct
+{
+	bfs_file_t* bfs;
+	const char* dir;
+
+	char*             names;
+	size_t            names_size;
+	size_t            names_max;
+	bfs_exportName_t* list;
+	size_t            count;
+	size_t            max;
+
+	size_t   next;
+	int      stop;
+	int      running;
+	uint64_t files;
+	uint64_t bytes;
+	uint64_t skipped;
+	uint64_t errors;
+} bfs_exporter_t;
+
+// per-tid state
+// dir: the last directory created by the tid
+// buf: blob reader buffer which is allocated on demand
+typedef struct
+{
+	bfs_exporter_t* exporter;
+	int             tid;
+	int             status;
+	pthread_t       thread;
+	char            dir[4096];
+	void*           buf;
+} bfs_exportTask_t;
+
+/***********************************************************
+* private                                                  *
+***********************************************************/
+
+static double bfs_export_timestamp(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double) ts.tv_sec + ((double) ts.tv_nsec)/1.0e9;
+}
+
+static int
+bfs_export_list(void* priv, const char* name, size_t size)
+{
+	ASSERT(priv);
+	ASSERT(name);
+
+	bfs_exporter_t* self = (bfs_exporter_t*) priv;
+
+	size_t len = strlen(name) + 1;
+	if(self->names_size + len > self->names_max)
+	{
+		size_t max = 2*self->names_max;
+		if(max < self->names_size + len)
+		{
+			max = self->names_size + len + 4096;
+		}
+
+		char* names = (char*) REALLOC(self->names, max);
+		if(names == NULL)
+		{
+			LOGE("REALLOC failed");
+			return 0;
+		}
+		self->names     = names;
+		self->names_max = max;
+	}
+
+	if(self->count == self->max)
+	{
+		size_t max = self->max ? 2*self->max : 1024;
+
+		bfs_exportName_t* list;
+		list = (bfs_exportName_t*)
+		       REALLOC(self->list,
+		               max*sizeof(bfs_exportName_t));
+		if(list == NULL)
+		{
+			LOGE("REALLOC failed");
+			return 0;
+		}
+		self->list = list;
+		self->max  = max;
+	}
+
+	memcpy(self->names + self->names_size, name, len);
+	self->list[self->count].offset = self->names_size;
+	self->list[self->count].size   = size;
+	self->names_size += len;
+	self->count      += 1;
+
+	return 1;
+}
+
+static int bfs_export_validName(const char* name)
+{
+	ASSERT(name);
+
+	if(name[0] == '/')
+	{
+		return 0;
+	}
+
+	// reject empty, "." and ".." components
+	const char* p = name;
+	while(1)
+	{
+		const char* s   = strchr(p, '/');
+		size_t      len = s ? (size_t) (s - p) : strlen(p);
+		if((len == 0) ||
+		   ((len == 1) && (p[0] == '.')) ||
+		   ((len == 2) && (p[0] == '.') && (p[1] == '.')))
+		{
+			return 0;
+		}
+
+		if(s == NULL)
+		{
+			break;
+		}
+		p = s + 1;
+	}
+
+	return 1;
+}
+
+static int bfs_export_mkdir(char* dir)
+{
+	ASSERT(dir);
+
+	mode_t mode = S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH;
+	if((mkdir(dir, mode) == 0) || (errno == EEXIST))
+	{
+		return 1;
+	}
+	else if(errno != ENOENT)
+	{
+		LOGE("mkdir %s failed", dir);
+		return 0;
+	}
+
+	// create the parent directory and retry
+	char* slash = strrchr(dir, '/');
+	if((slash == NULL) || (slash == dir))
+	{
+		LOGE("mkdir %s failed", dir);
+		return 0;
+	}
+
+	*slash  = '\0';
+	int ret = bfs_export_mkdir(dir);
+	*slash  = '/';
+	if(ret == 0)
+	{
+		return 0;
+	}
+
+	if((mkdir(dir, mode) == 0) || (errno == EEXIST))
+	{
+		return 1;
+	}
+
+	LOGE("mkdir %s failed", dir);
+	return 0;
+}
+
+static int
+bfs_export_write(int fd, size_t size, const void* data)
+{
+	// data may be NULL
+	ASSERT(fd >= 0);
+
+	size_t offset = 0;
+	while(offset < size)
+	{
+		ssize_t bytes;
+		bytes = write(fd, (const char*) data + offset,
+		              size - offset);
+		if((bytes < 0) && (errno == EINTR))
+		{
+			continue;
+		}
+		else if(bytes <= 0)
+		{
+			LOGE("write failed");
+			return 0;
+		}
+
+		offset += (size_t) bytes;
+	}
+
+	return 1;
+}
+
+static int
+bfs_export_data(void* priv, const char* name,
+                size_t size, const void* data)
+{
+	// data may be NULL
+	ASSERT(priv);
+	ASSERT(name);
+
+	int* fd = (int*) priv;
+
+	return bfs_export_write(*fd, size, data);
+}
+
+static int
+bfs_export_stream(bfs_exportTask_t* task,
+                  const char* name, int fd)
+{
+	ASSERT(task);
+	ASSERT(name);
+
+	bfs_exporter_t* exporter = task->exporter;
+
+	if(task->buf == NULL)
+	{
+		task->buf = MALLOC(EXPORT_BUFFER);
+		if(task->buf == NULL)
+		{
+			LOGE("MALLOC failed");
+			return 0;
+		}
+	}
+
+	bfs_blobReader_t* reader;
+	reader = bfs_blobReader_open(exporter->bfs, task->tid,
+	                             name);
+	if(reader == NULL)
+	{
+		return 0;
+	}
+
+	size_t size   = bfs_blobReader_size(reader);
+	size_t offset = 0;
+	while(offset < size)
+	{
+		size_t count = size - offset;
+		if(count > EXPORT_BUFFER)
+		{
+			count = EXPORT_BUFFER;
+		}
+
+		if((bfs_blobReader_read(reader, offset, count,
+		                        task->buf) == 0) ||
+		   (bfs_export_write(fd, count, task->buf) == 0))
+		{
+			bfs_blobReader_close(&reader);
+			return 0;
+		}
+
+		offset += count;
+	}
+
+	bfs_blobReader_close(&reader);
+
+	return 1;
+}
+
+static int
+bfs_export_blob(bfs_exportTask_t* task, const char* name,
+                size_t size)
+{
+	ASSERT(task);
+	ASSERT(name);
+
+	bfs_exporter_t* exporter = task->exporter;
+
+	if(bfs_export_validName(name) == 0)
+	{
+		LOGW("skip name=%s", name);
+		__atomic_fetch_add(&exporter->skipped, 1,
+		                   __ATOMIC_RELAXED);
+		return 1;
+	}
+
+	char path[4096];
+	int  len = snprintf(path, 4096, "%s/%s",
+	                    exporter->dir, name);
+	if((len < 0) || (len >= 4096))
+	{
+		LOGE("invalid name=%s", name);
+		return 0;
+	}
+
+	// consecutive names usually share a directory so only
+	// create the directory when it changes
+	char* slash = strrchr(path, '/');
+	*slash = '\0';
+	if(strcmp(path, task->dir) != 0)
+	{
+		if(bfs_export_mkdir(path) == 0)
+		{
+			task->dir[0] = '\0';
+			return 0;
+		}
+		snprintf(task->dir, 4096, "%s", path);
+	}
+	*slash = '/';
+
+	int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC,
+	              S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+	if(fd == -1)
+	{
+		LOGE("open %s failed", path);
+		return 0;
+	}
+
+	// write small blobs directly from the sqlite3 row
+	// buffer and stream large blobs
+	int ret;
+	if(size <= EXPORT_READ_MAX)
+	{
+		ret = bfs_file_blobGetFn(exporter->bfs, task->tid,
+		                         name, (void*) &fd,
+		                         bfs_export_data);
+	}
+	else
+	{
+		ret = bfs_export_stream(task, name, fd);
+	}
+
+	if(close(fd) != 0)
+	{
+		LOGE("close %s failed", path);
+		ret = 0;
+	}
+
+	if(ret == 0)
+	{
+		LOGE("export %s failed", name);
+		return 0;
+	}
+
+	__atomic_fetch_add(&exporter->files, 1, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&exporter->bytes, (uint64_t) size,
+	                   __ATOMIC_RELAXED);
+
+	return 1;
+}
+
+static void* bfs_export_thread(void* arg)
+{
+	ASSERT(arg);
+
+	bfs_exportTask_t* task     = (bfs_exportTask_t*) arg;
+	bfs_exporter_t*   exporter = task->exporter;
+
+	task->status = 1;
+	while(__atomic_load_n(&exporter->stop,
+	                      __ATOMIC_RELAXED) == 0)
+	{
+		size_t lo;
+		lo = __atomic_fetch_add(&exporter->next, EXPORT_BATCH,
+		                        __ATOMIC_RELAXED);
+		if(lo >= exporter->count)
+		{
+			break;
+		}
+
+		size_t hi = lo + EXPORT_BATCH;
+		if(hi > exporter->count)
+		{
+			hi = exporter->count;
+		}
+
+		size_t i;
+		for(i = lo; i < hi; ++i)
+		{
+			bfs_exportName_t* n = &exporter->list[i];
+			if(bfs_export_blob(task, exporter->names + n->offset,
+			                   n->size) == 0)
+			{
+				// stop the other readers on failure
+				__atomic_fetch_add(&exporter->errors, 1,
+				                   __ATOMIC_RELAXED);
+				__atomic_store_n(&exporter->stop, 1,
+				                 __ATOMIC_RELAXED);
+				task->status = 0;
+				break;
+			}
+		}
+	}
+
+	__atomic_fetch_sub(&exporter->running, 1, __ATOMIC_SEQ_CST);
+
+	return NULL;
+}
+
+static void
+bfs_export_progress(double dt, uint64_t files,
+                    uint64_t bytes)
+{
+	double mb = ((double) bytes)/(1024.0*1024.0);
+	if(dt <= 0.0)
+	{
+		dt = 1.0e-9;
+	}
+
+	printf("\r%10" PRIu64 " files %10.1f MB "
+	       "%10.0f files/s %8.1f MB/s",
+	       files, mb, ((double) files)/dt, mb/dt);
+	fflush(stdout);
+}
+
+/***********************************************************
+* public                                                   *
+***********************************************************/
+
+int bfs_export(bfs_file_t* bfs, const char* dir,
+               const char* pattern, int nth)
+{
+	// pattern may be NULL
+	ASSERT(bfs);
+	ASSERT(dir);
+
+	if(nth <= 0)
+	{
+		LOGE("invalid nth=%i", nth);
+		return 0;
+	}
+
+	bfs_exporter_t self =
+	{
+		.bfs = bfs,
+		.dir = dir,
+	};
+
+	// the name list is sorted so that the batches claimed
+	// by each reader share directories
+	double t0 = bfs_export_timestamp();
+	if(bfs_file_blobList(bfs, 0, (void*) &self,
+	                     bfs_export_list, pattern) == 0)
+	{
+		goto fail_list;
+	}
+
+	char root[4096];
+	snprintf(root, 4096, "%s", dir);
+	if(bfs_export_mkdir(root) == 0)
+	{
+		goto fail_root;
+	}
+
+	bfs_exportTask_t* tasks;
+	tasks = (bfs_exportTask_t*)
+	        CALLOC(nth, sizeof(bfs_exportTask_t));
+	if(tasks == NULL)
+	{
+		LOGE("CALLOC failed");
+		goto fail_tasks;
+	}
+
+	int i;
+	int started = 0;
+	self.running = nth;
+	for(i = 0; i < nth; ++i)
+	{
+		tasks[i].exporter = &self;
+		tasks[i].tid      = i;
+		if(pthread_create(&tasks[i].thread, NULL,
+		                  bfs_export_thread,
+		                  (void*) &tasks[i]) != 0)
+		{
+			LOGE("pthread_create failed");
+			__atomic_store_n(&self.stop, 1, __ATOMIC_RELAXED);
+			__atomic_fetch_sub(&self.running, nth - i,
+			                   __ATOMIC_SEQ_CST);
+			break;
+		}
+		++started;
+	}
+
+	// report the progress until the readers are done
+	double t1 = t0;
+	while(__atomic_load_n(&self.running, __ATOMIC_SEQ_CST) > 0)
+	{
+		struct timespec ts =
+		{
+			.tv_sec  = 0,
+			.tv_nsec = 100000000,
+		};
+		nanosleep(&ts, NULL);
+
+		double t = bfs_export_timestamp();
+		if(t - t1 >= 1.0)
+		{
+			bfs_export_progress(t - t0,
+			                    __atomic_load_n(&self.files,
+			                                    __ATOMIC_RELAXED),
+			                    __atomic_load_n(&self.bytes,
+			                                    __ATOMIC_RELAXED));
+			t1 = t;
+		}
+	}
+
+	int ret = (started == nth);
+	for(i = 0; i < started; ++i)
+	{
+		pthread_join(tasks[i].thread, NULL);
+		ret &= tasks[i].status;
+		FREE(tasks[i].buf);
+	}
+
+	double dt = bfs_export_timestamp() - t0;
+	if(t1 > t0)
+	{
+		printf("\n");
+	}
+
+	double mb = ((double) self.bytes)/(1024.0*1024.0);
+	if(dt <= 0.0)
+	{
+		dt = 1.0e-9;
+	}
+	printf("%10" PRIu64 " files\n",   self.files);
+	printf("%10" PRIu64 " bytes\n",   self.bytes);
+	printf("%10" PRIu64 " skipped\n", self.skipped);
+	printf("%10" PRIu64 " errors\n",  self.errors);
+	printf("%10.0f files/s\n", ((double) self.files)/dt);
+	printf("%10.1f MB/s (%i threads)\n", mb/dt, nth);
+
+	FREE(tasks);
+	FREE(self.list);
+	FREE(self.names);
+
+	// success
+	return ret;
+
+	// failure
+	fail_tasks:
+	fail_root:
+	fail_list:
+		FREE(self.list);
+		FREE(self.names);
+	return 0;
+}
@@ -0,0 +1,771 @@
+/*
+ * Copyright (c) 2026 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define LOG_TAG "bfs"
+#include "libcc/cc_log.h"
+#include "libcc/cc_memory.h"
+#include "bfs_import.h"
+
+// files larger than IMPORT_READ_MAX are opened and streamed
+// by the writer rather than read by the readers so that the
+// queue does not hold a file descriptor per large file
+#define IMPORT_READ_MAX (16*1024*1024)
+
+// the queue is bounded so that the readers do not get
+// ahead of the writer
+#define IMPORT_QUEUE_COUNT 4096
+#define IMPORT_QUEUE_BYTES (64*1024*1024)
+
+// directory or file which has not been read
+// the name is stored after the struct
+typedef struct bfs_importJob_s
+{
+	int   dir;
+	char* name;
+
+	struct bfs_importJob_s* next;
+} bfs_importJob_t;
+
+// file which has been read but not stored
+// the name and data are stored after the struct
+// data is NULL when the file is streamed by the writer
+// from fd which is only opened by the writer
+typedef struct bfs_importBlob_s
+{
+	char*  name;
+	size_t size;
+	void*  data;
+	int    stream;
+	int    fd;
+
+	struct bfs_importBlob_s* next;
+} bfs_importBlob_t;
+
+// the mutex protects the job stack and blob queue
+// active: readers which are processing a job
+// readers: readers which have not exited
+typedef struct
+{
+	bfs_file_t* bfs;
+	const char* dir;
+
+	pthread_mutex_t mutex;
+	pthread_cond_t  cond_job;
+	pthread_cond_t  cond_put;
+	pthread_cond_t  cond_get;
+
+	int      stop;
+	int      active;
+	int      readers;
+	uint64_t errors;
+	uint64_t skipped;
+
+	bfs_importJob_t* jobs;
+
+	bfs_importBlob_t* head;
+	bfs_importBlob_t* tail;
+	int               count;
+	size_t            bytes;
+} bfs_import_t;
+
+/***********************************************************
+* private                                                  *
+***********************************************************/
+
+static double bfs_import_timestamp(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double) ts.tv_sec + ((double) ts.tv_nsec)/1.0e9;
+}
+
+static int
+bfs_import_path(bfs_import_t* self, const char* name,
+                char* path)
+{
+	ASSERT(self);
+	ASSERT(name);
+	ASSERT(path);
+
+	int len;
+	if(name[0] == '\0')
+	{
+		len = snprintf(path, 4096, "%s", self->dir);
+	}
+	else
+	{
+		len = snprintf(path, 4096, "%s/%s", self->dir, name);
+	}
+
+	if((len < 0) || (len >= 4096))
+	{
+		LOGE("invalid name=%s", name);
+		return 0;
+	}
+
+	return 1;
+}
+
+static int
+bfs_import_jobPut(bfs_import_t* self, int dir,
+                  const char* prefix, const char* name)
+{
+	ASSERT(self);
+	ASSERT(prefix);
+	ASSERT(name);
+
+	size_t len1 = strlen(prefix);
+	size_t len2 = strlen(name) + 1;
+
+	bfs_importJob_t* job;
+	job = (bfs_importJob_t*)
+	      MALLOC(sizeof(bfs_importJob_t) + len1 + len2 + 1);
+	if(job == NULL)
+	{
+		LOGE("MALLOC failed");
+		return 0;
+	}
+
+	job->dir  = dir;
+	job->name = (char*) &job[1];
+	if(len1)
+	{
+		memcpy(job->name, prefix, len1);
+		job->name[len1++] = '/';
+	}
+	memcpy(job->name + len1, name, len2);
+
+	pthread_mutex_lock(&self->mutex);
+	job->next  = self->jobs;
+	self->jobs = job;
+	pthread_cond_signal(&self->cond_job);
+	pthread_mutex_unlock(&self->mutex);
+
+	return 1;
+}
+
+static bfs_importJob_t* bfs_import_jobGet(bfs_import_t* self)
+{
+	ASSERT(self);
+
+	pthread_mutex_lock(&self->mutex);
+
+	// the walk is complete when the stack is empty and no
+	// reader is processing a directory
+	while((self->stop == 0) && (self->jobs == NULL) &&
+	      (self->active > 0))
+	{
+		pthread_cond_wait(&self->cond_job, &self->mutex);
+	}
+
+	bfs_importJob_t* job = self->jobs;
+	if(self->stop || (job == NULL))
+	{
+		pthread_cond_broadcast(&self->cond_job);
+		pthread_mutex_unlock(&self->mutex);
+		return NULL;
+	}
+
+	self->jobs = job->next;
+	++self->active;
+
+	pthread_mutex_unlock(&self->mutex);
+
+	return job;
+}
+
+static void
+bfs_import_jobDone(bfs_import_t* self, int ret)
+{
+	ASSERT(self);
+
+	pthread_mutex_lock(&self->mutex);
+	if(ret == 0)
+	{
+		++self->errors;
+	}
+
+	--self->active;
+	if((self->active == 0) && (self->jobs == NULL))
+	{
+		pthread_cond_broadcast(&self->cond_job);
+	}
+	pthread_mutex_unlock(&self->mutex);
+}
+
+static void
+bfs_import_blobPut(bfs_import_t* self,
+                   bfs_importBlob_t* blob)
+{
+	ASSERT(self);
+	ASSERT(blob);
+
+	size_t bytes = blob->data ? blob->size : 0;
+
+	pthread_mutex_lock(&self->mutex);
+
+	while((self->stop == 0) && (self->count > 0) &&
+	      ((self->count >= IMPORT_QUEUE_COUNT) ||
+	       (self->bytes + bytes > IMPORT_QUEUE_BYTES)))
+	{
+		pthread_cond_wait(&self->cond_get, &self->mutex);
+	}
+
+	// discard the blob when the writer failed
+	if(self->stop)
+	{
+		pthread_mutex_unlock(&self->mutex);
+		if(blob->fd >= 0)
+		{
+			close(blob->fd);
+		}
+		FREE(blob);
+		return;
+	}
+
+	blob->next = NULL;
+	if(self->tail)
+	{
+		self->tail->next = blob;
+	}
+	else
+	{
+		self->head = blob;
+	}
+	self->tail   = blob;
+	self->count += 1;
+	self->bytes += bytes;
+
+	pthread_cond_signal(&self->cond_put);
+	pthread_mutex_unlock(&self->mutex);
+}
+
+static bfs_importBlob_t* bfs_import_blobGet(bfs_import_t* self)
+{
+	ASSERT(self);
+
+	pthread_mutex_lock(&self->mutex);
+
+	while((self->head == NULL) && (self->readers > 0))
+	{
+		pthread_cond_wait(&self->cond_put, &self->mutex);
+	}
+
+	bfs_importBlob_t* blob = self->head;
+	if(blob)
+	{
+		self->head = blob->next;
+		if(self->head == NULL)
+		{
+			self->tail = NULL;
+		}
+		self->count -= 1;
+		self->bytes -= blob->data ? blob->size : 0;
+
+		pthread_cond_broadcast(&self->cond_get);
+	}
+
+	pthread_mutex_unlock(&self->mutex);
+
+	return blob;
+}
+
+static void bfs_import_stop(bfs_import_t* self)
+{
+	ASSERT(self);
+
+	pthread_mutex_lock(&self->mutex);
+	self->stop = 1;
+	pthread_cond_broadcast(&self->cond_job);
+	pthread_cond_broadcast(&self->cond_get);
+	pthread_mutex_unlock(&self->mutex);
+}
+
+static int
+bfs_import_readDir(bfs_import_t* self, const char* name)
+{
+	ASSERT(self);
+	ASSERT(name);
+
+	char path[4096];
+	if(bfs_import_path(self, name, path) == 0)
+	{
+		return 0;
+	}
+
+	DIR* dir = opendir(path);
+	if(dir == NULL)
+	{
+		LOGE("opendir %s failed", path);
+		return 0;
+	}
+
+	int ret = 1;
+	struct dirent* de;
+	while((de = readdir(dir)) != NULL)
+	{
+		if((strcmp(de->d_name, ".")  == 0) ||
+		   (strcmp(de->d_name, "..") == 0))
+		{
+			continue;
+		}
+
+		// some filesystems do not report the type
+		int type = de->d_type;
+		if(type == DT_UNKNOWN)
+		{
+			char        fname[4096];
+			struct stat st;
+			int         len;
+			len = snprintf(fname, 4096, "%s/%s",
+			               path, de->d_name);
+			if((len < 0) || (len >= 4096) ||
+			   (lstat(fname, &st) != 0))
+			{
+				LOGE("lstat %s/%s failed", path, de->d_name);
+				ret = 0;
+				continue;
+			}
+
+			if(S_ISDIR(st.st_mode))
+			{
+				type = DT_DIR;
+			}
+			else if(S_ISREG(st.st_mode))
+			{
+				type = DT_REG;
+			}
+		}
+
+		if((type != DT_DIR) && (type != DT_REG))
+		{
+			continue;
+		}
+
+		if(bfs_import_jobPut(self, type == DT_DIR,
+		                     name, de->d_name) == 0)
+		{
+			ret = 0;
+			break;
+		}
+	}
+
+	closedir(dir);
+
+	return ret;
+}
+
+static int
+bfs_import_readFile(bfs_import_t* self, const char* name)
+{
+	ASSERT(self);
+	ASSERT(name);
+
+	char path[4096];
+	if(bfs_import_path(self, name, path) == 0)
+	{
+		return 0;
+	}
+
+	int fd = open(path, O_RDONLY);
+	if(fd == -1)
+	{
+		LOGE("open %s failed", path);
+		return 0;
+	}
+
+	struct stat st;
+	if(fstat(fd, &st) != 0)
+	{
+		LOGE("fstat %s failed", path);
+		goto fail_fstat;
+	}
+
+	// empty files are skipped since setting an empty blob
+	// would clear an existing blob with the same name
+	if(st.st_size == 0)
+	{
+		__atomic_fetch_add(&self->skipped, 1, __ATOMIC_RELAXED);
+		close(fd);
+		return 1;
+	}
+
+	size_t len   = strlen(name) + 1;
+	size_t size  = (size_t) st.st_size;
+	int    whole = (size <= IMPORT_READ_MAX);
+
+	bfs_importBlob_t* blob;
+	blob = (bfs_importBlob_t*)
+	       MALLOC(sizeof(bfs_importBlob_t) + len +
+	              (whole ? size : 0));
+	if(blob == NULL)
+	{
+		LOGE("MALLOC failed");
+		goto fail_blob;
+	}
+
+	blob->name = (char*) &blob[1];
+	blob->size = size;
+	blob->data   = NULL;
+	blob->stream = 0;
+	blob->fd     = -1;
+	blob->next   = NULL;
+	memcpy(blob->name, name, len);
+
+	// large files are reopened by the writer
+	if(whole == 0)
+	{
+		close(fd);
+		blob->stream = 1;
+		bfs_import_blobPut(self, blob);
+		return 1;
+	}
+
+	blob->data = (void*) (blob->name + len);
+
+	size_t offset = 0;
+	while(offset < size)
+	{
+		ssize_t bytes;
+		bytes = read(fd, (char*) blob->data + offset,
+		             size - offset);
+		if((bytes < 0) && (errno == EINTR))
+		{
+			continue;
+		}
+		else if(bytes <= 0)
+		{
+			LOGE("read %s failed", path);
+			goto fail_read;
+		}
+
+		offset += (size_t) bytes;
+	}
+
+	close(fd);
+
+	bfs_import_blobPut(self, blob);
+
+	// success
+	return 1;
+
+	// failure
+	fail_read:
+		FREE(blob);
+	fail_blob:
+	fail_fstat:
+		close(fd);
+	return 0;
+}
+
+static void* bfs_import_thread(void* arg)
+{
+	ASSERT(arg);
+
+	bfs_import_t* self = (bfs_import_t*) arg;
+
+	bfs_importJob_t* job;
+	while((job = bfs_import_jobGet(self)) != NULL)
+	{
+		int ret;
+		if(job->dir)
+		{
+			ret = bfs_import_readDir(self, job->name);
+		}
+		else
+		{
+			ret = bfs_import_readFile(self, job->name);
+		}
+		FREE(job);
+
+		bfs_import_jobDone(self, ret);
+	}
+
+	// wake the writer when the last reader exits
+	pthread_mutex_lock(&self->mutex);
+	--self->readers;
+	pthread_cond_signal(&self->cond_put);
+	pthread_mutex_unlock(&self->mutex);
+
+	return NULL;
+}
+
+static int
+bfs_import_open(bfs_import_t* self, bfs_importBlob_t* blob)
+{
+	ASSERT(self);
+	ASSERT(blob);
+
+	char path[4096];
+	if(bfs_import_path(self, blob->name, path) == 0)
+	{
+		return 0;
+	}
+
+	blob->fd = open(path, O_RDONLY);
+	if(blob->fd == -1)
+	{
+		LOGE("open %s failed", path);
+		return 0;
+	}
+
+	return 1;
+}
+
+static int
+bfs_import_write(bfs_import_t* self, bfs_importBlob_t* blob)
+{
+	ASSERT(self);
+	ASSERT(blob);
+
+	if(blob->fd >= 0)
+	{
+		int ret = bfs_file_blobSetFd(self->bfs, blob->name,
+		                             blob->fd);
+		close(blob->fd);
+		blob->fd = -1;
+		return ret;
+	}
+
+	return bfs_file_blobSet(self->bfs, blob->name,
+	                        blob->size, blob->data);
+}
+
+static void
+bfs_import_progress(double dt, uint64_t files,
+                    uint64_t bytes)
+{
+	double mb = ((double) bytes)/(1024.0*1024.0);
+	if(dt <= 0.0)
+	{
+		dt = 1.0e-9;
+	}
+
+	printf("\r%10" PRIu64 " files %10.1f MB "
+	       "%10.0f files/s %8.1f MB/s",
+	       files, mb, ((double) files)/dt, mb/dt);
+	fflush(stdout);
+}
+
+/***********************************************************
+* public                                                   *
+***********************************************************/
+
+int bfs_import(bfs_file_t* bfs, const char* dir, int nth)
+{
+	ASSERT(bfs);
+	ASSERT(dir);
+
+	if(nth <= 0)
+	{
+		LOGE("invalid nth=%i", nth);
+		return 0;
+	}
+
+	bfs_import_t self =
+	{
+		.bfs = bfs,
+		.dir = dir,
+	};
+
+	if(pthread_mutex_init(&self.mutex, NULL) != 0)
+	{
+		LOGE("pthread_mutex_init failed");
+		return 0;
+	}
+
+	if(pthread_cond_init(&self.cond_job, NULL) != 0)
+	{
+		LOGE("pthread_cond_init failed");
+		goto fail_cond_job;
+	}
+
+	if(pthread_cond_init(&self.cond_put, NULL) != 0)
+	{
+		LOGE("pthread_cond_init failed");
+		goto fail_cond_put;
+	}
+
+	if(pthread_cond_init(&self.cond_get, NULL) != 0)
+	{
+		LOGE("pthread_cond_init failed");
+		goto fail_cond_get;
+	}
+
+	if(bfs_import_jobPut(&self, 1, "", "") == 0)
+	{
+		goto fail_root;
+	}
+
+	pthread_t* threads;
+	threads = (pthread_t*) CALLOC(nth, sizeof(pthread_t));
+	if(threads == NULL)
+	{
+		LOGE("CALLOC failed");
+		goto fail_threads;
+	}
+
+	int i;
+	for(i = 0; i < nth; ++i)
+	{
+		pthread_mutex_lock(&self.mutex);
+		++self.readers;
+		pthread_mutex_unlock(&self.mutex);
+
+		if(pthread_create(&threads[i], NULL,
+		                  bfs_import_thread,
+		                  (void*) &self) != 0)
+		{
+			LOGE("pthread_create failed");
+
+			pthread_mutex_lock(&self.mutex);
+			--self.readers;
+			pthread_mutex_unlock(&self.mutex);
+			break;
+		}
+	}
+	int started = i;
+
+	// store the files as they are read
+	int      ret   = (started == nth);
+	uint64_t files = 0;
+	uint64_t bytes = 0;
+	double   t0    = bfs_import_timestamp();
+	double   t1    = t0;
+	if(ret == 0)
+	{
+		bfs_import_stop(&self);
+	}
+
+	bfs_importBlob_t* blob;
+	while((blob = bfs_import_blobGet(&self)) != NULL)
+	{
+		// discard the remaining blobs on failure and
+		// report the files which cannot be reopened like
+		// the files which cannot be read
+		if(ret && blob->stream &&
+		   (bfs_import_open(&self, blob) == 0))
+		{
+			pthread_mutex_lock(&self.mutex);
+			++self.errors;
+			pthread_mutex_unlock(&self.mutex);
+		}
+		else if(ret)
+		{
+			if(bfs_import_write(&self, blob))
+			{
+				files += 1;
+				bytes += blob->size;
+			}
+			else
+			{
+				LOGE("import %s failed", blob->name);
+				bfs_import_stop(&self);
+				ret = 0;
+			}
+		}
+
+		if(blob->fd >= 0)
+		{
+			close(blob->fd);
+		}
+		FREE(blob);
+
+		double t = bfs_import_timestamp();
+		if(t - t1 >= 1.0)
+		{
+			bfs_import_progress(t - t0, files, bytes);
+			t1 = t;
+		}
+	}
+
+	for(i = 0; i < started; ++i)
+	{
+		pthread_join(threads[i], NULL);
+	}
+
+	// the readers did not finish the walk on failure
+	while(self.jobs)
+	{
+		bfs_importJob_t* job = self.jobs;
+		self.jobs = job->next;
+		FREE(job);
+	}
+
+	double dt = bfs_import_timestamp() - t0;
+	if(t1 > t0)
+	{
+		printf("\n");
+	}
+
+	double mb = ((double) bytes)/(1024.0*1024.0);
+	if(dt <= 0.0)
+	{
+		dt = 1.0e-9;
+	}
+	printf("%10" PRIu64 " files\n",   files);
+	printf("%10" PRIu64 " bytes\n",   bytes);
+	printf("%10" PRIu64 " skipped\n", self.skipped);
+	printf("%10" PRIu64 " errors\n",  self.errors);
+	printf("%10.0f files/s\n", ((double) files)/dt);
+	printf("%10.1f MB/s (%i threads)\n", mb/dt, nth);
+
+	FREE(threads);
+	pthread_cond_destroy(&self.cond_get);
+	pthread_cond_destroy(&self.cond_put);
+	pthread_cond_destroy(&self.cond_job);
+	pthread_mutex_destroy(&self.mutex);
+
+	// success
+	return ret && (self.errors == 0);
+
+	// failure
+	fail_threads:
+	{
+		bfs_importJob_t* job = self.jobs;
+		FREE(job);
+	}
+	fail_root:
+		pthread_cond_destroy(&self.cond_get);
+	fail_cond_get:
+		pthread_cond_destroy(&self.cond_put);
+	fail_cond_put:
+		pthread_cond_destroy(&self.cond_job);
+	fail_cond_job:
+		pthread_mutex_destroy(&self.mutex);
+	return 0;
+}
@@ -0,0 +1,229 @@
+/*
+ * Copyright (c) 2026 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LOG_TAG "bfs"
+#include "../libcc/cc_log.h"
+#include "../libcc/cc_memory.h"
+#include "bfs_attrs.h"
+
+// open addressing slot where key is NULL for empty slots
+typedef struct
+{
+	uint64_t    hash;
+	const char* key;
+	const char* val;
+	size_t      len;
+} bfs_attrSlot_t;
+
+// the slots and strings are stored after the struct
+typedef struct bfs_attrs_s
+{
+	int             count;
+	uint32_t        mask;
+	bfs_attrSlot_t* slots;
+} bfs_attrs_t;
+
+/***********************************************************
+* private                                                  *
+***********************************************************/
+
+static uint64_t bfs_attrs_hash(const char* key)
+{
+	ASSERT(key);
+
+	// FNV-1a
+	uint64_t hash = 14695981039346656037ULL;
+	while(*key)
+	{
+		hash ^= (uint64_t) ((unsigned char) *key);
+		hash *= 1099511628211ULL;
+		++key;
+	}
+
+	return hash;
+}
+
+static bfs_attrSlot_t*
+bfs_attrs_slot(const bfs_attrs_t* self, uint64_t hash,
+               const char* key)
+{
+	ASSERT(self);
+	ASSERT(key);
+
+	// the load factor is at most 1/2 so the probe
+	// sequence always reaches an empty slot
+	uint32_t i = (uint32_t) hash & self->mask;
+	while(self->slots[i].key)
+	{
+		bfs_attrSlot_t* slot = &self->slots[i];
+		if((slot->hash == hash) &&
+		   (strcmp(slot->key, key) == 0))
+		{
+			break;
+		}
+		i = (i + 1) & self->mask;
+	}
+
+	return &self->slots[i];
+}
+
+/***********************************************************
+* public                                                   *
+***********************************************************/
+
+bfs_attrs_t* bfs_attrs_new(int count,
+                           const char** keys,
+                           const char** vals)
+{
+	// keys and vals may be NULL when count is zero
+	ASSERT(count >= 0);
+
+	uint32_t slots = 16;
+	while(slots < 2*((uint32_t) count))
+	{
+		slots *= 2;
+	}
+
+	size_t bytes = sizeof(bfs_attrs_t) +
+	               slots*sizeof(bfs_attrSlot_t);
+	int    i;
+	for(i = 0; i < count; ++i)
+	{
+		bytes += strlen(keys[i]) + strlen(vals[i]) + 2;
+	}
+
+	bfs_attrs_t* self = (bfs_attrs_t*) CALLOC(1, bytes);
+	if(self == NULL)
+	{
+		LOGE("CALLOC failed");
+		return NULL;
+	}
+
+	self->mask  = slots - 1;
+	self->slots = (bfs_attrSlot_t*) &self[1];
+
+	// later keys replace earlier keys
+	char* str = (char*) &self->slots[slots];
+	for(i = 0; i < count; ++i)
+	{
+		uint64_t        hash = bfs_attrs_hash(keys[i]);
+		bfs_attrSlot_t* slot;
+		slot = bfs_attrs_slot(self, hash, keys[i]);
+		if(slot->key == NULL)
+		{
+			size_t klen = strlen(keys[i]) + 1;
+			memcpy(str, keys[i], klen);
+			slot->hash = hash;
+			slot->key  = str;
+			str += klen;
+			++self->count;
+		}
+
+		slot->len = strlen(vals[i]);
+		memcpy(str, vals[i], slot->len + 1);
+		slot->val = str;
+		str += slot->len + 1;
+	}
+
+	return self;
+}
+
+bfs_attrs_t* bfs_attrs_set(const bfs_attrs_t* base,
+                           const char* key,
+                           const char* val)
+{
+	// base and val may be NULL
+	ASSERT(key);
+
+	int count = base ? base->count : 0;
+
+	const char** keys;
+	keys = (const char**)
+	       CALLOC(2*(count + 1), sizeof(const char*));
+	if(keys == NULL)
+	{
+		LOGE("CALLOC failed");
+		return NULL;
+	}
+
+	// copy the base entries except for the key
+	const char** vals = &keys[count + 1];
+	int          n    = 0;
+	if(base)
+	{
+		uint32_t i;
+		for(i = 0; i <= base->mask; ++i)
+		{
+			bfs_attrSlot_t* slot = &base->slots[i];
+			if(slot->key && (strcmp(slot->key, key) != 0))
+			{
+				keys[n] = slot->key;
+				vals[n] = slot->val;
+				++n;
+			}
+		}
+	}
+
+	if(val)
+	{
+		keys[n] = key;
+		vals[n] = val;
+		++n;
+	}
+
+	bfs_attrs_t* self = bfs_attrs_new(n, keys, vals);
+	FREE(keys);
+
+	return self;
+}
+
+void bfs_attrs_delete(bfs_attrs_t** _self)
+{
+	ASSERT(_self);
+
+	bfs_attrs_t* self = *_self;
+	if(self)
+	{
+		FREE(self);
+		*_self = NULL;
+	}
+}
+
+const char* bfs_attrs_get(const bfs_attrs_t* self,
+                          const char* key,
+                          size_t* _len)
+{
+	ASSERT(self);
+	ASSERT(key);
+	ASSERT(_len);
+
+	bfs_attrSlot_t* slot;
+	slot = bfs_attrs_slot(self, bfs_attrs_hash(key), key);
+
+	*_len = slot->len;
+	return slot->val;
+}
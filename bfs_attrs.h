@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2026 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef bfs_attrs_H
+#define bfs_attrs_H
+
+#include <stddef.h>
+
+/*
+ * attrs API
+ *
+ * immutable hash table of attributes which is shared with
+ * reader threads without locking
+ *
+ * set returns a copy of base with key replaced by val or
+ * removed when val is NULL where base may be NULL
+ */
+
+typedef struct bfs_attrs_s bfs_attrs_t;
+
+bfs_attrs_t* bfs_attrs_new(int count,
+                           const char** keys,
+                           const char** vals);
+bfs_attrs_t* bfs_attrs_set(const bfs_attrs_t* base,
+                           const char* key,
+                           const char* val);
+void         bfs_attrs_delete(bfs_attrs_t** _self);
+const char*  bfs_attrs_get(const bfs_attrs_t* self,
+                           const char* key,
+                           size_t* _len);
+
+#endif
@@ -0,0 +1,604 @@
+/*
+ * Copyright (c) 2026 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LOG_TAG "bfs"
+#include "../libcc/cc_log.h"
+#include "../libcc/cc_memory.h"
+#include "bfs_cache.h"
+
+#define CACHE_BUCKETS    64
+#define CACHE_MAX_SHARDS 64
+
+typedef struct bfs_buffer_s
+{
+	int    refcount;
+	size_t size;
+	void*  data;
+} bfs_buffer_t;
+
+// the name is stored after the struct
+typedef struct bfs_entry_s
+{
+	uint64_t      hash;
+	char*         name;
+	size_t        bytes;
+	bfs_buffer_t* buffer;
+
+	// LRU and hash chain links
+	struct bfs_entry_s* prev;
+	struct bfs_entry_s* next;
+	struct bfs_entry_s* chain;
+} bfs_entry_t;
+
+// the shard is padded to avoid false sharing between
+// threads which access neighboring shards
+#define CACHE_PAD 64
+typedef struct
+{
+	pthread_mutex_t mutex;
+
+	// seq is incremented by each invalidate and commit
+	// while dirty blocks adds until the write is committed
+	uint64_t seq;
+	int      dirty;
+
+	// LRU list where head is the most recently used
+	bfs_entry_t* head;
+	bfs_entry_t* tail;
+
+	// chained hash index
+	uint32_t      buckets;
+	uint32_t      count;
+	bfs_entry_t** index;
+
+	size_t   bytes;
+	size_t   max_bytes;
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t evictions;
+
+	char pad[CACHE_PAD];
+} bfs_shard_t;
+
+typedef struct bfs_cache_s
+{
+	size_t       max_bytes;
+	uint32_t     mask;
+	int          dirty;
+	bfs_shard_t* shards;
+} bfs_cache_t;
+
+/***********************************************************
+* private                                                  *
+***********************************************************/
+
+static uint64_t bfs_cache_hash(const char* name)
+{
+	ASSERT(name);
+
+	// FNV-1a
+	uint64_t hash = 14695981039346656037ULL;
+	while(*name)
+	{
+		hash ^= (uint64_t) ((unsigned char) *name);
+		hash *= 1099511628211ULL;
+		++name;
+	}
+
+	return hash;
+}
+
+static bfs_shard_t*
+bfs_cache_shard(bfs_cache_t* self, uint64_t hash)
+{
+	ASSERT(self);
+
+	// the high bits select the shard since the low bits
+	// select the bucket
+	return &self->shards[(hash >> 32) & self->mask];
+}
+
+static bfs_entry_t**
+bfs_shard_bucket(bfs_shard_t* self, uint64_t hash)
+{
+	ASSERT(self);
+
+	return &self->index[hash & (self->buckets - 1)];
+}
+
+static bfs_entry_t*
+bfs_shard_find(bfs_shard_t* self, uint64_t hash,
+               const char* name)
+{
+	ASSERT(self);
+	ASSERT(name);
+
+	bfs_entry_t* entry = *bfs_shard_bucket(self, hash);
+	while(entry)
+	{
+		if((entry->hash == hash) &&
+		   (strcmp(entry->name, name) == 0))
+		{
+			return entry;
+		}
+		entry = entry->chain;
+	}
+
+	return NULL;
+}
+
+static void
+bfs_shard_unlink(bfs_shard_t* self, bfs_entry_t* entry)
+{
+	ASSERT(self);
+	ASSERT(entry);
+
+	if(entry->prev)
+	{
+		entry->prev->next = entry->next;
+	}
+	else
+	{
+		self->head = entry->next;
+	}
+
+	if(entry->next)
+	{
+		entry->next->prev = entry->prev;
+	}
+	else
+	{
+		self->tail = entry->prev;
+	}
+
+	entry->prev = NULL;
+	entry->next = NULL;
+}
+
+static void
+bfs_shard_link(bfs_shard_t* self, bfs_entry_t* entry)
+{
+	ASSERT(self);
+	ASSERT(entry);
+
+	entry->prev = NULL;
+	entry->next = self->head;
+	if(self->head)
+	{
+		self->head->prev = entry;
+	}
+	else
+	{
+		self->tail = entry;
+	}
+	self->head = entry;
+}
+
+static void
+bfs_shard_remove(bfs_shard_t* self, bfs_entry_t* entry)
+{
+	ASSERT(self);
+	ASSERT(entry);
+
+	bfs_entry_t** _link = bfs_shard_bucket(self, entry->hash);
+	while(*_link != entry)
+	{
+		_link = &(*_link)->chain;
+	}
+	*_link = entry->chain;
+
+	bfs_shard_unlink(self, entry);
+
+	self->bytes -= entry->bytes;
+	--self->count;
+
+	bfs_buffer_unref(&entry->buffer);
+	FREE(entry);
+}
+
+static void bfs_shard_grow(bfs_shard_t* self)
+{
+	ASSERT(self);
+
+	// the index is unchanged on failure which only
+	// increases the chain length
+	uint32_t      buckets = 2*self->buckets;
+	bfs_entry_t** index;
+	index = (bfs_entry_t**)
+	        CALLOC(buckets, sizeof(bfs_entry_t*));
+	if(index == NULL)
+	{
+		LOGW("CALLOC failed");
+		return;
+	}
+
+	uint32_t i;
+	for(i = 0; i < self->buckets; ++i)
+	{
+		bfs_entry_t* entry = self->index[i];
+		while(entry)
+		{
+			bfs_entry_t*  chain = entry->chain;
+			bfs_entry_t** _link;
+			_link        = &index[entry->hash & (buckets - 1)];
+			entry->chain = *_link;
+			*_link       = entry;
+			entry        = chain;
+		}
+	}
+
+	FREE(self->index);
+	self->index   = index;
+	self->buckets = buckets;
+}
+
+static void bfs_shard_clear(bfs_shard_t* self)
+{
+	ASSERT(self);
+
+	while(self->tail)
+	{
+		bfs_shard_remove(self, self->tail);
+	}
+}
+
+/***********************************************************
+* public                                                   *
+***********************************************************/
+
+bfs_buffer_t* bfs_buffer_new(size_t size, void** _data)
+{
+	ASSERT(_data);
+
+	// the data is stored after the struct
+	bfs_buffer_t* self;
+	self = (bfs_buffer_t*)
+	       MALLOC(sizeof(bfs_buffer_t) + size);
+	if(self == NULL)
+	{
+		LOGE("MALLOC failed");
+		return NULL;
+	}
+
+	self->refcount = 1;
+	self->size     = size;
+	self->data     = (void*) &self[1];
+
+	*_data = self->data;
+
+	return self;
+}
+
+bfs_buffer_t* bfs_buffer_ref(bfs_buffer_t* self)
+{
+	ASSERT(self);
+
+	__atomic_add_fetch(&self->refcount, 1, __ATOMIC_RELAXED);
+
+	return self;
+}
+
+void bfs_buffer_unref(bfs_buffer_t** _self)
+{
+	ASSERT(_self);
+
+	bfs_buffer_t* self = *_self;
+	if(self)
+	{
+		if(__atomic_sub_fetch(&self->refcount, 1,
+		                      __ATOMIC_ACQ_REL) == 0)
+		{
+			FREE(self);
+		}
+		*_self = NULL;
+	}
+}
+
+size_t bfs_buffer_size(const bfs_buffer_t* self)
+{
+	ASSERT(self);
+
+	return self->size;
+}
+
+const void* bfs_buffer_data(const bfs_buffer_t* self)
+{
+	ASSERT(self);
+
+	return self->data;
+}
+
+bfs_cache_t* bfs_cache_new(size_t max_bytes, int nth)
+{
+	ASSERT(max_bytes > 0);
+
+	// use enough shards so that reader threads rarely
+	// contend for the same shard
+	uint32_t shards = 4;
+	while((shards < 4*((uint32_t) nth)) &&
+	      (shards < CACHE_MAX_SHARDS))
+	{
+		shards *= 2;
+	}
+
+	bfs_cache_t* self;
+	self = (bfs_cache_t*) CALLOC(1, sizeof(bfs_cache_t));
+	if(self == NULL)
+	{
+		LOGE("CALLOC failed");
+		return NULL;
+	}
+
+	self->max_bytes = max_bytes;
+	self->mask      = shards - 1;
+
+	self->shards = (bfs_shard_t*)
+	               CALLOC(shards, sizeof(bfs_shard_t));
+	if(self->shards == NULL)
+	{
+		LOGE("CALLOC failed");
+		goto fail_shards;
+	}
+
+	uint32_t i;
+	for(i = 0; i < shards; ++i)
+	{
+		bfs_shard_t* shard = &self->shards[i];
+		shard->max_bytes   = max_bytes/shards;
+		shard->buckets     = CACHE_BUCKETS;
+		shard->index       = (bfs_entry_t**)
+		                     CALLOC(CACHE_BUCKETS,
+		                            sizeof(bfs_entry_t*));
+		if(shard->index == NULL)
+		{
+			LOGE("CALLOC failed");
+			goto fail_index;
+		}
+
+		if(pthread_mutex_init(&shard->mutex, NULL) != 0)
+		{
+			LOGE("pthread_mutex_init failed");
+			FREE(shard->index);
+			goto fail_index;
+		}
+	}
+
+	// success
+	return self;
+
+	// failure
+	fail_index:
+	{
+		while(i > 0)
+		{
+			--i;
+			pthread_mutex_destroy(&self->shards[i].mutex);
+			FREE(self->shards[i].index);
+		}
+		FREE(self->shards);
+	}
+	fail_shards:
+		FREE(self);
+	return NULL;
+}
+
+void bfs_cache_delete(bfs_cache_t** _self)
+{
+	ASSERT(_self);
+
+	bfs_cache_t* self = *_self;
+	if(self)
+	{
+		uint32_t i;
+		for(i = 0; i <= self->mask; ++i)
+		{
+			bfs_shard_t* shard = &self->shards[i];
+			bfs_shard_clear(shard);
+			pthread_mutex_destroy(&shard->mutex);
+			FREE(shard->index);
+		}
+		FREE(self->shards);
+		FREE(self);
+		*_self = NULL;
+	}
+}
+
+bfs_buffer_t* bfs_cache_find(bfs_cache_t* self,
+                             const char* name,
+                             uint64_t* _seq)
+{
+	ASSERT(self);
+	ASSERT(name);
+	ASSERT(_seq);
+
+	uint64_t     hash  = bfs_cache_hash(name);
+	bfs_shard_t* shard = bfs_cache_shard(self, hash);
+
+	bfs_buffer_t* buffer = NULL;
+	pthread_mutex_lock(&shard->mutex);
+	bfs_entry_t* entry = bfs_shard_find(shard, hash, name);
+	if(entry)
+	{
+		// move to the head of the LRU list
+		if(entry != shard->head)
+		{
+			bfs_shard_unlink(shard, entry);
+			bfs_shard_link(shard, entry);
+		}
+		buffer = bfs_buffer_ref(entry->buffer);
+		++shard->hits;
+	}
+	else
+	{
+		++shard->misses;
+	}
+	*_seq = shard->seq;
+	pthread_mutex_unlock(&shard->mutex);
+
+	return buffer;
+}
+
+void bfs_cache_add(bfs_cache_t* self, const char* name,
+                   uint64_t seq, bfs_buffer_t* buffer)
+{
+	ASSERT(self);
+	ASSERT(name);
+	ASSERT(buffer);
+
+	uint64_t     hash  = bfs_cache_hash(name);
+	bfs_shard_t* shard = bfs_cache_shard(self, hash);
+	size_t       len   = strlen(name) + 1;
+	size_t       bytes = sizeof(bfs_entry_t) + len +
+	                     buffer->size;
+
+	// entries which exceed the shard budget are not cached
+	if(bytes > shard->max_bytes)
+	{
+		return;
+	}
+
+	bfs_entry_t* entry;
+	entry = (bfs_entry_t*) MALLOC(sizeof(bfs_entry_t) + len);
+	if(entry == NULL)
+	{
+		LOGW("MALLOC failed");
+		return;
+	}
+	memset(entry, 0, sizeof(bfs_entry_t));
+	entry->hash  = hash;
+	entry->name  = (char*) &entry[1];
+	entry->bytes = bytes;
+	memcpy(entry->name, name, len);
+
+	pthread_mutex_lock(&shard->mutex);
+
+	// discard the buffer if the shard was invalidated
+	// after the find or if another thread added the name
+	if(shard->dirty || (shard->seq != seq) ||
+	   bfs_shard_find(shard, hash, name))
+	{
+		pthread_mutex_unlock(&shard->mutex);
+		FREE(entry);
+		return;
+	}
+
+	// evict the least recently used entries
+	while(shard->tail &&
+	      (shard->bytes + bytes > shard->max_bytes))
+	{
+		bfs_shard_remove(shard, shard->tail);
+		++shard->evictions;
+	}
+
+	if(shard->count >= shard->buckets)
+	{
+		bfs_shard_grow(shard);
+	}
+
+	bfs_entry_t** _link = bfs_shard_bucket(shard, hash);
+	entry->buffer = bfs_buffer_ref(buffer);
+	entry->chain  = *_link;
+	*_link        = entry;
+	bfs_shard_link(shard, entry);
+	shard->bytes += bytes;
+	++shard->count;
+
+	pthread_mutex_unlock(&shard->mutex);
+}
+
+void bfs_cache_invalidate(bfs_cache_t* self,
+                          const char* name)
+{
+	ASSERT(self);
+	ASSERT(name);
+
+	uint64_t     hash  = bfs_cache_hash(name);
+	bfs_shard_t* shard = bfs_cache_shard(self, hash);
+
+	pthread_mutex_lock(&shard->mutex);
+	bfs_entry_t* entry = bfs_shard_find(shard, hash, name);
+	if(entry)
+	{
+		bfs_shard_remove(shard, entry);
+	}
+	++shard->seq;
+	shard->dirty = 1;
+	pthread_mutex_unlock(&shard->mutex);
+
+	self->dirty = 1;
+}
+
+void bfs_cache_commit(bfs_cache_t* self)
+{
+	ASSERT(self);
+
+	if(self->dirty == 0)
+	{
+		return;
+	}
+
+	// readers which started before the commit may have
+	// observed the previous value so the sequence number
+	// is incremented again to discard their adds
+	uint32_t i;
+	for(i = 0; i <= self->mask; ++i)
+	{
+		bfs_shard_t* shard = &self->shards[i];
+		pthread_mutex_lock(&shard->mutex);
+		if(shard->dirty)
+		{
+			++shard->seq;
+			shard->dirty = 0;
+		}
+		pthread_mutex_unlock(&shard->mutex);
+	}
+
+	self->dirty = 0;
+}
+
+void bfs_cache_stats(bfs_cache_t* self,
+                     bfs_cacheStats_t* stats)
+{
+	ASSERT(self);
+	ASSERT(stats);
+
+	memset(stats, 0, sizeof(bfs_cacheStats_t));
+	stats->max_bytes = self->max_bytes;
+
+	uint32_t i;
+	for(i = 0; i <= self->mask; ++i)
+	{
+		bfs_shard_t* shard = &self->shards[i];
+		pthread_mutex_lock(&shard->mutex);
+		stats->hits      += shard->hits;
+		stats->misses    += shard->misses;
+		stats->evictions += shard->evictions;
+		stats->count     += shard->count;
+		stats->bytes     += shard->bytes;
+		pthread_mutex_unlock(&shard->mutex);
+	}
+}
@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2026 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef bfs_cache_H
+#define bfs_cache_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * cache statistics
+ *
+ * hits/misses: lookups
+ * evictions: entries removed to satisfy the byte budget
+ * count/bytes: entries currently in the cache
+ * max_bytes: byte budget
+ */
+
+typedef struct
+{
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t evictions;
+	uint64_t count;
+	size_t   bytes;
+	size_t   max_bytes;
+} bfs_cacheStats_t;
+
+/*
+ * opaque types
+ */
+
+typedef struct bfs_buffer_s bfs_buffer_t;
+typedef struct bfs_cache_s  bfs_cache_t;
+
+/*
+ * buffer API
+ *
+ * buffers are immutable once shared and are released when
+ * the last reference is removed
+ */
+
+bfs_buffer_t* bfs_buffer_new(size_t size, void** _data);
+bfs_buffer_t* bfs_buffer_ref(bfs_buffer_t* self);
+void          bfs_buffer_unref(bfs_buffer_t** _self);
+size_t        bfs_buffer_size(const bfs_buffer_t* self);
+const void*   bfs_buffer_data(const bfs_buffer_t* self);
+
+/*
+ * cache API
+ *
+ * the cache is sharded by the name hash and each shard is
+ * an LRU list with an equal share of the byte budget
+ *
+ * find returns a reference on a hit or the shard sequence
+ * number on a miss which must be passed to add so that
+ * buffers read before an invalidate are discarded
+ *
+ * invalidate and commit are called by the writer where
+ * invalidate removes the name and blocks adds to the shard
+ * until the write is committed
+ */
+
+bfs_cache_t*  bfs_cache_new(size_t max_bytes, int nth);
+void          bfs_cache_delete(bfs_cache_t** _self);
+bfs_buffer_t* bfs_cache_find(bfs_cache_t* self,
+                             const char* name,
+                             uint64_t* _seq);
+void          bfs_cache_add(bfs_cache_t* self,
+                            const char* name,
+                            uint64_t seq,
+                            bfs_buffer_t* buffer);
+void          bfs_cache_invalidate(bfs_cache_t* self,
+                                   const char* name);
+void          bfs_cache_commit(bfs_cache_t* self);
+void          bfs_cache_stats(bfs_cache_t* self,
+                              bfs_cacheStats_t* stats);
+
+#endif
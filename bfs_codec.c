@@ -0,0 +1,450 @@
+/*
+ * Copyright (c) 2026 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LOG_TAG "bfs"
+#include "../libcc/cc_log.h"
+#include "bfs_codec.h"
+
+// the LZ codec uses the LZ4 block format
+// a sequence is a token (literal length and match length
+// nibbles), the extended literal length, the literals,
+// the 16-bit little-endian match offset and the extended
+// match length while the last sequence only contains
+// literals
+#define LZ_MINMATCH     4
+#define LZ_LASTLITERALS 5
+#define LZ_MFLIMIT      12
+#define LZ_MAX_OFFSET   65535
+#define LZ_HASH_BITS    12
+#define LZ_HASH_MIN     8
+#define LZ_SKIP_TRIGGER 6
+
+/***********************************************************
+* private                                                  *
+***********************************************************/
+
+static uint32_t bfs_lz_read32(const uint8_t* p)
+{
+	ASSERT(p);
+
+	uint32_t v;
+	memcpy(&v, p, sizeof(uint32_t));
+	return v;
+}
+
+static uint64_t bfs_lz_read64(const uint8_t* p)
+{
+	ASSERT(p);
+
+	uint64_t v;
+	memcpy(&v, p, sizeof(uint64_t));
+	return v;
+}
+
+static uint32_t bfs_lz_hash(uint32_t v, int bits)
+{
+	return (v*2654435761U) >> (32 - bits);
+}
+
+static uint8_t*
+bfs_lz_length(uint8_t* op, const uint8_t* oend, size_t len)
+{
+	ASSERT(op);
+	ASSERT(oend);
+
+	// the nibble holds lengths below 15
+	len -= 15;
+	while(len >= 255)
+	{
+		if(op >= oend)
+		{
+			return NULL;
+		}
+		*op++ = 255;
+		len  -= 255;
+	}
+
+	if(op >= oend)
+	{
+		return NULL;
+	}
+	*op++ = (uint8_t) len;
+
+	return op;
+}
+
+static uint8_t*
+bfs_lz_sequence(uint8_t* op, const uint8_t* oend,
+                const uint8_t* lit, size_t lit_len,
+                size_t offset, size_t match_len)
+{
+	ASSERT(op);
+	ASSERT(oend);
+	ASSERT(lit);
+
+	// offset is zero for the last sequence
+	if(op >= oend)
+	{
+		return NULL;
+	}
+
+	uint8_t* token = op++;
+	*token = (uint8_t) (((lit_len >= 15) ? 15 : lit_len) << 4);
+	if(lit_len >= 15)
+	{
+		op = bfs_lz_length(op, oend, lit_len);
+		if(op == NULL)
+		{
+			return NULL;
+		}
+	}
+
+	if(lit_len > (size_t) (oend - op))
+	{
+		return NULL;
+	}
+	memcpy(op, lit, lit_len);
+	op += lit_len;
+
+	if(offset == 0)
+	{
+		return op;
+	}
+
+	if(2 > oend - op)
+	{
+		return NULL;
+	}
+	*op++ = (uint8_t) (offset & 0xFF);
+	*op++ = (uint8_t) (offset >> 8);
+
+	match_len -= LZ_MINMATCH;
+	*token |= (uint8_t) ((match_len >= 15) ? 15 : match_len);
+	if(match_len >= 15)
+	{
+		op = bfs_lz_length(op, oend, match_len);
+	}
+
+	return op;
+}
+
+static size_t
+bfs_lz_encode(const void* src, size_t src_size,
+              void* dst, size_t dst_size)
+{
+	ASSERT(src);
+	ASSERT(dst);
+
+	const uint8_t* base   = (const uint8_t*) src;
+	const uint8_t* ip     = base;
+	const uint8_t* anchor = base;
+	const uint8_t* iend   = base + src_size;
+	uint8_t*       op     = (uint8_t*) dst;
+	uint8_t*       oend   = op + dst_size;
+
+	// the positions are relative to base and the stale
+	// entries are rejected by the match test while small
+	// inputs only clear part of the table
+	int bits = LZ_HASH_MIN;
+	while((bits < LZ_HASH_BITS) &&
+	      (((size_t) 1 << bits) < src_size))
+	{
+		++bits;
+	}
+
+	uint32_t table[1 << LZ_HASH_BITS];
+	memset(table, 0, sizeof(uint32_t) << bits);
+
+	if(src_size > LZ_MFLIMIT)
+	{
+		const uint8_t* mflimit    = iend - LZ_MFLIMIT;
+		const uint8_t* matchlimit = iend - LZ_LASTLITERALS;
+
+		++ip;
+		while(ip < mflimit)
+		{
+			// the step increases while no matches are found
+			// so incompressible data is skipped quickly
+			const uint8_t* ref;
+			uint32_t       attempts = 1 << LZ_SKIP_TRIGGER;
+			while(1)
+			{
+				uint32_t seq = bfs_lz_read32(ip);
+				uint32_t h   = bfs_lz_hash(seq, bits);
+				ref      = base + table[h];
+				table[h] = (uint32_t) (ip - base);
+				if((ref < ip) &&
+				   (ip - ref <= LZ_MAX_OFFSET) &&
+				   (bfs_lz_read32(ref) == seq))
+				{
+					break;
+				}
+
+				ip += attempts++ >> LZ_SKIP_TRIGGER;
+				if(ip >= mflimit)
+				{
+					goto last_literals;
+				}
+			}
+
+			// extend the match backwards
+			while((ip > anchor) && (ref > base) &&
+			      (ip[-1] == ref[-1]))
+			{
+				--ip;
+				--ref;
+			}
+
+			// extend the match forwards
+			const uint8_t* mp = ip + LZ_MINMATCH;
+			const uint8_t* rp = ref + LZ_MINMATCH;
+			while((mp + 8 <= matchlimit) &&
+			      (bfs_lz_read64(mp) == bfs_lz_read64(rp)))
+			{
+				mp += 8;
+				rp += 8;
+			}
+
+			while((mp < matchlimit) && (*mp == *rp))
+			{
+				++mp;
+				++rp;
+			}
+
+			op = bfs_lz_sequence(op, oend, anchor,
+			                     (size_t) (ip - anchor),
+			                     (size_t) (ip - ref),
+			                     (size_t) (mp - ip));
+			if(op == NULL)
+			{
+				return 0;
+			}
+
+			ip     = mp;
+			anchor = ip;
+
+			// index the end of the match
+			if(ip < mflimit)
+			{
+				table[bfs_lz_hash(bfs_lz_read32(ip - 2), bits)] =
+					(uint32_t) (ip - 2 - base);
+			}
+		}
+	}
+
+	last_literals:
+	op = bfs_lz_sequence(op, oend, anchor,
+	                     (size_t) (iend - anchor), 0, 0);
+	if(op == NULL)
+	{
+		return 0;
+	}
+
+	return (size_t) (op - (uint8_t*) dst);
+}
+
+static int
+bfs_lz_decode(const void* src, size_t src_size,
+              void* dst, size_t dst_size)
+{
+	ASSERT(src);
+	ASSERT(dst);
+
+	const uint8_t* ip   = (const uint8_t*) src;
+	const uint8_t* iend = ip + src_size;
+	uint8_t*       op   = (uint8_t*) dst;
+	uint8_t*       oend = op + dst_size;
+
+	// the input is validated since the file may be corrupt
+	while(ip < iend)
+	{
+		uint8_t token = *ip++;
+		size_t  len   = token >> 4;
+		uint8_t b;
+		if(len == 15)
+		{
+			do
+			{
+				if(ip >= iend)
+				{
+					return 0;
+				}
+				b    = *ip++;
+				len += b;
+			} while(b == 255);
+		}
+
+		if((len > (size_t) (iend - ip)) ||
+		   (len > (size_t) (oend - op)))
+		{
+			return 0;
+		}
+		memcpy(op, ip, len);
+		op += len;
+		ip += len;
+
+		// the last sequence only contains literals
+		if(ip == iend)
+		{
+			break;
+		}
+		else if(iend - ip < 2)
+		{
+			return 0;
+		}
+
+		size_t offset = (size_t) ip[0] | ((size_t) ip[1] << 8);
+		ip += 2;
+		if((offset == 0) ||
+		   (offset > (size_t) (op - (uint8_t*) dst)))
+		{
+			return 0;
+		}
+
+		len = token & 15;
+		if(len == 15)
+		{
+			do
+			{
+				if(ip >= iend)
+				{
+					return 0;
+				}
+				b    = *ip++;
+				len += b;
+			} while(b == 255);
+		}
+		len += LZ_MINMATCH;
+
+		if(len > (size_t) (oend - op))
+		{
+			return 0;
+		}
+
+		// matches may overlap the output
+		const uint8_t* ref = op - offset;
+		if(offset >= len)
+		{
+			memcpy(op, ref, len);
+			op += len;
+		}
+		else
+		{
+			while(len--)
+			{
+				*op++ = *ref++;
+			}
+		}
+	}
+
+	return (op == oend) ? 1 : 0;
+}
+
+static const bfs_codec_t BFS_CODEC_LZ_DEFAULT =
+{
+	.id     = BFS_CODEC_LZ,
+	.name   = "lz",
+	.encode = bfs_lz_encode,
+	.decode = bfs_lz_decode,
+};
+
+static pthread_mutex_t bfs_codec_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static const bfs_codec_t* bfs_codec_table[BFS_CODEC_COUNT] =
+{
+	NULL,
+	&BFS_CODEC_LZ_DEFAULT,
+};
+
+/***********************************************************
+* public                                                   *
+***********************************************************/
+
+int bfs_codec_register(const bfs_codec_t* codec)
+{
+	ASSERT(codec);
+
+	if((codec->id <= BFS_CODEC_NONE) ||
+	   (codec->id >= BFS_CODEC_COUNT) ||
+	   (codec->name   == NULL) ||
+	   (codec->encode == NULL) ||
+	   (codec->decode == NULL))
+	{
+		LOGE("invalid id=%i", codec->id);
+		return 0;
+	}
+
+	pthread_mutex_lock(&bfs_codec_mutex);
+
+	int i;
+	for(i = 0; i < BFS_CODEC_COUNT; ++i)
+	{
+		const bfs_codec_t* iter = bfs_codec_table[i];
+		if(iter && ((iter->id == codec->id) ||
+		            (strcmp(iter->name, codec->name) == 0)))
+		{
+			LOGE("invalid id=%i, name=%s",
+			     codec->id, codec->name);
+			pthread_mutex_unlock(&bfs_codec_mutex);
+			return 0;
+		}
+	}
+
+	bfs_codec_table[codec->id] = codec;
+
+	pthread_mutex_unlock(&bfs_codec_mutex);
+
+	return 1;
+}
+
+const bfs_codec_t* bfs_codec_find(int id)
+{
+	if((id <= BFS_CODEC_NONE) || (id >= BFS_CODEC_COUNT))
+	{
+		return NULL;
+	}
+
+	return bfs_codec_table[id];
+}
+
+const bfs_codec_t* bfs_codec_findName(const char* name)
+{
+	ASSERT(name);
+
+	int i;
+	for(i = 0; i < BFS_CODEC_COUNT; ++i)
+	{
+		const bfs_codec_t* codec = bfs_codec_table[i];
+		if(codec && (strcmp(codec->name, name) == 0))
+		{
+			return codec;
+		}
+	}
+
+	return NULL;
+}
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2026 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef bfs_codec_H
+#define bfs_codec_H
+
+#include <stddef.h>
+
+/*
+ * codec ids
+ *
+ * the id is stored with each compressed blob so the ids
+ * of registered codecs must never be reused
+ */
+
+#define BFS_CODEC_NONE  0
+#define BFS_CODEC_LZ    1
+#define BFS_CODEC_COUNT 256
+
+/*
+ * codec callbacks
+ *
+ * encode returns the compressed size or 0 when the output
+ * would exceed dst_size (e.g. incompressible data) and
+ * decode returns 1 when src expands to exactly dst_size
+ * bytes or 0 when src is invalid
+ */
+
+typedef size_t (*bfs_encode_fn)(const void* src,
+                                size_t src_size,
+                                void* dst,
+                                size_t dst_size);
+typedef int    (*bfs_decode_fn)(const void* src,
+                                size_t src_size,
+                                void* dst,
+                                size_t dst_size);
+
+typedef struct
+{
+	int           id;
+	const char*   name;
+	bfs_encode_fn encode;
+	bfs_decode_fn decode;
+} bfs_codec_t;
+
+/*
+ * codec API
+ *
+ * the LZ codec is registered by default and additional
+ * codecs must be registered before the files which use
+ * them are opened and remain valid until shutdown
+ */
+
+int                bfs_codec_register(const bfs_codec_t* codec);
+const bfs_codec_t* bfs_codec_find(int id);
+const bfs_codec_t* bfs_codec_findName(const char* name);
+
+#endif
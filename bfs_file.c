@@ -21,40 +21,246 @@
  *
  */
 
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <errno.h>
+#include <inttypes.h>
 #include <pthread.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
+#include <time.h>
 #include <unistd.h>
 
 #define LOG_TAG "bfs"
 #include "../libcc/cc_log.h"
 #include "../libcc/cc_memory.h"
 #include "../libsqlite3/sqlite3.h"
+#include "bfs_attrs.h"
 #include "bfs_file.h"
+#include "bfs_hash.h"
+
+#define BATCH_SIZE   10000
+#define BATCH_BYTES  (256*1024*1024)
+#define BATCH_MS     5000
+#define BUSY_TIMEOUT 10000
+#define BLOB_CHUNK   (1024*1024)
+#define CHUNK_SIZE   (16*1024*1024)
+#define QUEUE_BYTES  (16*1024*1024)
+#define QUEUE_MS     100
+#define CODEC_MIN    64
+#define DEDUP_MIN    64
+#define VERIFY_BATCH 64
+
+// schema version stored in PRAGMA user_version
+// 0: tbl_attr and tbl_blob
+// 1: tbl_chunk for the chunked blob layout
+// 2: trg_blob_update
+// 3: tbl_meta and tbl_total
+// 4: tbl_blob codec and raw_size
+// 5: tbl_content
+// 6: tbl_blob crc
+#define BFS_VERSION 6
+
+// chunked blobs are stored with a NULL tbl_blob.blob and
+// the data is split into tbl_chunk rows where bid is the
+// tbl_blob rowid and pos is the byte offset of the chunk
+#define SQL_CHUNK_FIND \
+	"SELECT rowid, pos, length(data) FROM tbl_chunk" \
+	"   WHERE bid=@arg_bid AND pos<=@arg_pos" \
+	"   ORDER BY pos DESC LIMIT 1;"
+#define SQL_BLOB_SIZE \
+	"ifnull(length(blob), ifnull((SELECT pos + length(data)" \
+	"   FROM tbl_chunk WHERE bid=tbl_blob.rowid" \
+	"   ORDER BY pos DESC LIMIT 1), 0))"
+
+// compressed blobs store the codec id and the raw_size of
+// the uncompressed data while both are NULL otherwise
+#define SQL_BLOB_RAW_SIZE \
+	"ifnull(raw_size, " SQL_BLOB_SIZE ")"
+#define SQL_CHUNK_SIZE \
+	"SELECT pos + length(data) FROM tbl_chunk" \
+	"   WHERE bid=@arg_bid ORDER BY pos DESC LIMIT 1;"
+
+// tbl_meta stores the size and mtime (milliseconds since
+// the epoch) of each blob apart from the blob data so that
+// the blob names and sizes may be listed from idx_blob_name
+// and tbl_meta
+#define SQL_BLOB_LIST \
+	"SELECT name, size FROM tbl_blob" \
+	"   JOIN tbl_meta ON bid=tbl_blob.rowid"
+#define SQL_META_MTIME \
+	"CAST((julianday('now') - 2440587.5)*86400000.0 AS INTEGER)"
+
+// deduplicated blobs store a NULL blob with the codec
+// (which is 0 for uncompressed content) and raw_size of the
+// tbl_content row referenced by the tbl_meta cid while the
+// chunked blobs store a NULL blob and NULL codec so the
+// content is only selected for the NULL blobs
+#define SQL_BLOB_CID \
+	"(SELECT cid FROM tbl_meta WHERE bid=tbl_blob.rowid)"
+#define SQL_BLOB_CONTENT \
+	"(SELECT data FROM tbl_content WHERE cid=" SQL_BLOB_CID ")"
+
+// per-thread reader connection
+typedef struct
+{
+	sqlite3* db;
+
+	// sqlite3 statements
+	sqlite3_stmt* stmt_begin;
+	sqlite3_stmt* stmt_end;
+	sqlite3_stmt* stmt_attr_list;
+	sqlite3_stmt* stmt_attr_get;
+	sqlite3_stmt* stmt_blob_list;
+	sqlite3_stmt* stmt_blob_like;
+	sqlite3_stmt* stmt_blob_range;
+	sqlite3_stmt* stmt_blob_glob;
+	sqlite3_stmt* stmt_blob_page;
+	sqlite3_stmt* stmt_blob_next;
+	sqlite3_stmt* stmt_blob_get;
+	sqlite3_stmt* stmt_blob_rowid;
+	sqlite3_stmt* stmt_blob_byid;
+	sqlite3_stmt* stmt_blob_verify;
+	sqlite3_stmt* stmt_blob_total;
+	sqlite3_stmt* stmt_chunk_list;
+	sqlite3_stmt* stmt_chunk_find;
+	sqlite3_stmt* stmt_chunk_size;
+} bfs_conn_t;
+
+// write-behind queue operations
+typedef enum
+{
+	BFS_OP_ATTR_SET = 0,
+	BFS_OP_ATTR_CLR = 1,
+	BFS_OP_BLOB_SET = 2,
+	BFS_OP_BLOB_CLR = 3,
+} bfs_op_e;
+
+// queued operation which is also the completion ticket
+// the name and data are stored after the struct and are
+// immutable once queued so readers may reference them
+// without holding the queue mutex
+typedef struct bfs_ticket_s
+{
+	bfs_op_e type;
+	int      refcount;
+	int      done;
+	int      status;
+	uint64_t seq;
+	double   ts;
+	char*    name;
+	size_t   size;
+	void*    data;
+
+	// queue and index links
+	struct bfs_ticket_s* next;
+	struct bfs_ticket_s* chain;
+} bfs_ticket_t;
+
+// per-tid state which is padded to avoid false sharing
+// attrs: hazard pointer for the attribute snapshot
+// readers: read locks held by the tid
+typedef struct
+{
+	bfs_attrs_t* attrs;
+	int          readers;
+	char         pad[64 - sizeof(bfs_attrs_t*) - sizeof(int)];
+} bfs_slot_t;
+
+// blob location for bfs_file_blobGetMany
+typedef struct
+{
+	sqlite3_int64 rowid;
+	int           chunked;
+	int           codec;
+	size_t        raw_size;
+	sqlite3_int64 cid;
+	int64_t       crc;
+	int           index;
+} bfs_fetch_t;
+
+// blob handle for the chunk containing [pos, pos + len)
+typedef struct
+{
+	sqlite3_blob* blob;
+	size_t        pos;
+	size_t        len;
+} bfs_chunk_t;
 
-#define BATCH_SIZE 10000
+// changes to tbl_total which are applied on commit
+typedef struct
+{
+	int64_t count;
+	int64_t bytes;
+} bfs_total_t;
 
 typedef struct bfs_file_s
 {
 	int        nth;
 	bfs_mode_e mode;
-
-	sqlite3* db;
+	int        version;
+	size_t     chunk_size;
+	int        wal;
+
+	// optional compression of the inline blobs
+	const bfs_codec_t* codec;
+
+	// optional deduplication of the inline blobs
+	int dedup;
+
+	// db is the writer connection and
+	// conn[tid].db are the reader connections
+	sqlite3*    db;
+	bfs_conn_t* conn;
+
+	// streaming mode batch
+	// the batch is committed before an operation which
+	// would exceed batch_max_count operations or
+	// batch_max_bytes bytes or when the batch is older
+	// than batch_max_time
+	int    batch_size;
+	size_t batch_bytes;
+	double batch_ts;
+	int    batch_max_count;
+	size_t batch_max_bytes;
+	double batch_max_time;
 
 	// sqlite3 statements
-	int            batch_size;
 	sqlite3_stmt*  stmt_begin;
 	sqlite3_stmt*  stmt_end;
-	sqlite3_stmt*  stmt_attr_list;
-	sqlite3_stmt** stmt_attr_get;
+	sqlite3_stmt*  stmt_savepoint;
+	sqlite3_stmt*  stmt_release;
+	sqlite3_stmt*  stmt_rollback;
 	sqlite3_stmt*  stmt_attr_set;
 	sqlite3_stmt*  stmt_attr_clr;
-	sqlite3_stmt*  stmt_blob_list;
-	sqlite3_stmt*  stmt_blob_like;
-	sqlite3_stmt** stmt_blob_get;
 	sqlite3_stmt*  stmt_blob_set;
 	sqlite3_stmt*  stmt_blob_clr;
+	sqlite3_stmt*  stmt_blob_reserve;
+	sqlite3_stmt*  stmt_blob_find;
+	sqlite3_stmt*  stmt_blob_update;
+	sqlite3_stmt*  stmt_blob_crc;
+	sqlite3_stmt*  stmt_blob_name;
+	sqlite3_stmt*  stmt_blob_delete;
+	sqlite3_stmt*  stmt_chunk_detach;
+	sqlite3_stmt*  stmt_chunk_set;
+	sqlite3_stmt*  stmt_chunk_find;
+	sqlite3_stmt*  stmt_chunk_size;
+	sqlite3_stmt*  stmt_meta_get;
+	sqlite3_stmt*  stmt_meta_set;
+	sqlite3_stmt*  stmt_total_add;
+	sqlite3_stmt*  stmt_meta_batch;
+	sqlite3_stmt*  stmt_meta_sum;
+	sqlite3_stmt*  stmt_content_find;
+	sqlite3_stmt*  stmt_content_add;
+
+	// blob totals
+	// the stream mode adds the metadata of the blobs after
+	// meta_bid once per batch (see bfs_file_metaBatch)
+	bfs_total_t   total;
+	sqlite3_int64 meta_bid;
 
 	// sqlite3 indices
 	int idx_attr_get_key;
@@ -62,976 +268,8794 @@ typedef struct bfs_file_s
 	int idx_attr_set_val;
 	int idx_attr_clr_key;
 	int idx_blob_like_pat;
+	int idx_blob_range_lo;
+	int idx_blob_range_hi;
+	int idx_blob_glob_lo;
+	int idx_blob_glob_hi;
+	int idx_blob_glob_pat;
+	int idx_blob_page_lo;
+	int idx_blob_page_hi;
+	int idx_blob_page_limit;
+	int idx_blob_next_lo;
+	int idx_blob_next_hi;
+	int idx_blob_next_limit;
 	int idx_blob_get_name;
+	int idx_blob_rowid_name;
 	int idx_blob_set_name;
 	int idx_blob_set_blob;
+	int idx_blob_set_codec;
+	int idx_blob_set_raw_size;
+	int idx_blob_set_crc;
 	int idx_blob_clr_name;
+	int idx_blob_reserve_name;
+	int idx_blob_reserve_size;
+	int idx_blob_find_name;
+	int idx_blob_update_bid;
+	int idx_blob_update_blob;
+	int idx_blob_update_codec;
+	int idx_blob_update_raw_size;
+	int idx_blob_update_crc;
+	int idx_blob_crc_bid;
+	int idx_blob_crc_crc;
+	int idx_blob_name_bid;
+	int idx_blob_delete_bid;
+	int idx_blob_byid_bid;
+	int idx_blob_verify_lo;
+	int idx_blob_verify_hi;
+	int idx_chunk_detach_bid;
+	int idx_chunk_set_bid;
+	int idx_chunk_set_pos;
+	int idx_chunk_set_data;
+	int idx_chunk_list_bid;
+	int idx_chunk_find_bid;
+	int idx_chunk_find_pos;
+	int idx_chunk_size_bid;
+	int idx_meta_get_bid;
+	int idx_meta_set_bid;
+	int idx_meta_set_size;
+	int idx_meta_set_mtime;
+	int idx_meta_set_cid;
+	int idx_total_add_count;
+	int idx_total_add_bytes;
+	int idx_meta_batch_bid;
+	int idx_meta_batch_mtime;
+	int idx_meta_sum_bid;
+	int idx_content_find_hash;
+	int idx_content_add_hash;
+	int idx_content_add_data;
+	int idx_content_add_codec;
+	int idx_content_add_raw_size;
 
 	// locking
+	// writer is a recursive mutex which serializes the
+	// writer connection and is held by the thread which
+	// owns an explicit transaction (see bfs_file_txnBegin)
+	// while exclusive and the per-tid slot readers exclude
+	// readers from commits and mutex/cond are only used to
+	// wait for the exclusion to complete
+	pthread_mutex_t writer;
 	pthread_mutex_t mutex;
 	pthread_cond_t  cond;
-	int             readers;
+	bfs_slot_t*     slot;
 	int             exclusive;
+	int             txn;
+
+	// explicit transaction statements
+	sqlite3_stmt* stmt_txn_begin;
+	sqlite3_stmt* stmt_txn_rollback;
+
+	// write-behind queue
+	// count and bytes include the group being committed
+	// while pending_count and pending_bytes only include
+	// the operations which are waiting for a group and
+	// the index maps names to the latest operation
+	int             queue;
+	int             queue_stop;
+	int             queue_max_count;
+	size_t          queue_max_bytes;
+	double          queue_max_time;
+	int             queue_count;
+	size_t          queue_bytes;
+	int             queue_pending_count;
+	size_t          queue_pending_bytes;
+	uint64_t        queue_seq;
+	uint64_t        queue_done;
+	uint64_t        queue_flush;
+	bfs_ticket_t*   queue_head;
+	bfs_ticket_t*   queue_tail;
+	uint32_t        queue_buckets;
+	bfs_ticket_t**  queue_index;
+	pthread_t       queue_thread;
+	pthread_mutex_t queue_mutex;
+	pthread_cond_t  queue_cond_put;
+	pthread_cond_t  queue_cond_done;
+
+	// optional blob cache
+	bfs_cache_t* cache;
+
+	// optional attribute snapshot
+	// attrs is published to readers without locking while
+	// pending holds the uncommitted writes and retired
+	// holds the replaced snapshots which may still be
+	// referenced by slot[tid].attrs
+	bfs_attrs_t*  attrs;
+	bfs_attrs_t*  attrs_pending;
+	bfs_attrs_t** attrs_retired;
+	int           attrs_retired_count;
+
+	#if BFS_STATS
+	// stats[tid] are updated by the readers and
+	// stats[nth] is updated by the writer
+	bfs_stats_t* stats;
+	#endif
 } bfs_file_t;
 
+typedef struct bfs_blobReader_s
+{
+	bfs_file_t*   file;
+	int           tid;
+	sqlite3_blob* blob;
+	size_t        size;
+
+	// chunked layout
+	int           chunked;
+	sqlite3_int64 bid;
+	bfs_chunk_t   chunk;
+
+	// compressed blobs are decompressed by reopen
+	int           codec;
+	void*         data;
+
+	// deduplicated blobs are read from tbl_content
+	int           content;
+} bfs_blobReader_t;
+
+typedef struct bfs_blobPage_s
+{
+	int     count;
+	int     more;
+	int     entries;
+	size_t* sizes;
+	size_t* offsets;
+	char*   names;
+	size_t  names_len;
+	size_t  names_size;
+} bfs_blobPage_t;
+
+typedef struct bfs_blobWriter_s
+{
+	bfs_file_t*   file;
+	sqlite3_blob* blob;
+	size_t        size;
+	int           active;
+
+	// chunked layout
+	int           chunked;
+	sqlite3_int64 bid;
+	bfs_chunk_t   chunk;
+
+	// totals restored on rollback
+	bfs_total_t   total;
+
+	// the crc is only stored when the blob is written
+	// sequentially where crc_size is the checksummed prefix
+	uint32_t      crc;
+	size_t        crc_size;
+} bfs_blobWriter_t;
+
+// shared state of the verify threads which claim batches
+// of VERIFY_BATCH rowids from next until last is reached
+// and the mutex serializes the corrupt_fn callback
+typedef struct
+{
+	bfs_file_t*     file;
+	void*           priv;
+	bfs_blob_fn     corrupt_fn;
+	sqlite3_int64   next;
+	sqlite3_int64   last;
+	int             stop;
+	pthread_mutex_t mutex;
+} bfs_verifier_t;
+
+// per-tid verify thread
+typedef struct
+{
+	bfs_verifier_t* verifier;
+	int             tid;
+	int             status;
+	pthread_t       thread;
+	bfs_verify_t    verify;
+} bfs_verifyTask_t;
+
+#if BFS_STATS
+// counts the bytes passed to the data_fn of
+// bfs_file_blobGetFn
+typedef struct
+{
+	void*       priv;
+	bfs_data_fn data_fn;
+	size_t      bytes;
+} bfs_statsData_t;
+#endif
+
 /***********************************************************
 * private                                                  *
 ***********************************************************/
 
-static void bfs_file_lockRead(bfs_file_t* self)
-{
-	ASSERT(self);
-	ASSERT(self->mode != BFS_MODE_STREAM);
+#if BFS_STATS
+// the public functions may call other public functions
+// (e.g. bfs_file_blobGet calls bfs_file_blobGetBuffer)
+// so only the outermost call is recorded
+static __thread int bfs_file_statsDepth;
+#endif
 
-	pthread_mutex_lock(&self->mutex);
-	while(self->exclusive)
-	{
-		pthread_cond_wait(&self->cond, &self->mutex);
-	}
-	++self->readers;
-	pthread_mutex_unlock(&self->mutex);
+static uint64_t bfs_file_statsTimestamp(void)
+{
+	#if BFS_STATS
+	return bfs_stats_timestamp();
+	#else
+	return 0;
+	#endif
 }
 
-static void bfs_file_unlockRead(bfs_file_t* self)
+static uint64_t bfs_file_statsBegin(void)
 {
-	ASSERT(self);
-	ASSERT(self->mode != BFS_MODE_STREAM);
+	#if BFS_STATS
+	if(bfs_file_statsDepth++ == 0)
+	{
+		return bfs_file_statsTimestamp();
+	}
+	#endif
 
-	pthread_mutex_lock(&self->mutex);
-	--self->readers;
-	pthread_cond_broadcast(&self->cond);
-	pthread_mutex_unlock(&self->mutex);
+	return 0;
 }
 
-static void bfs_file_lockExclusive(bfs_file_t* self)
+static void
+bfs_file_statsAdd(bfs_file_t* self, int tid,
+                  bfs_statsOp_e op, uint64_t t0, int ret,
+                  size_t bytes_in, size_t bytes_out)
 {
 	ASSERT(self);
 
-	if(self->mode == BFS_MODE_STREAM)
+	#if BFS_STATS
+	// the writer uses tid -1
+	if((tid < 0) || (tid >= self->nth))
 	{
-		// ignore
-		return;
+		tid = self->nth;
 	}
 
-	pthread_mutex_lock(&self->mutex);
-	++self->exclusive;
-	while(self->readers)
-	{
-		pthread_cond_wait(&self->cond, &self->mutex);
-	}
+	bfs_stats_add(&self->stats[tid], op,
+	              bfs_file_statsTimestamp() - t0, ret,
+	              bytes_in, bytes_out);
+	#endif
 }
 
-static void bfs_file_unlockExclusive(bfs_file_t* self)
+static int
+bfs_file_statsEnd(bfs_file_t* self, int tid,
+                  bfs_statsOp_e op, uint64_t t0, int ret,
+                  size_t bytes_in, size_t bytes_out)
 {
 	ASSERT(self);
 
-	if(self->mode == BFS_MODE_STREAM)
+	#if BFS_STATS
+	if(--bfs_file_statsDepth == 0)
 	{
-		// ignore
-		return;
+		bfs_file_statsAdd(self, tid, op, t0, ret,
+		                  bytes_in, bytes_out);
 	}
+	#endif
 
-	--self->exclusive;
-	pthread_cond_broadcast(&self->cond);
-	pthread_mutex_unlock(&self->mutex);
+	return ret;
 }
 
+#if BFS_STATS
 static int
-bfs_file_createIndices(bfs_file_t* self)
+bfs_file_statsData(void* priv, const char* name,
+                   size_t size, const void* data)
 {
-	ASSERT(self);
+	ASSERT(priv);
 
-	const char* sql_init[] =
-	{
-		"CREATE UNIQUE INDEX idx_attr_key"
-		"   ON tbl_attr (key);",
-		"CREATE UNIQUE INDEX idx_blob_name"
-		"   ON tbl_blob (name);",
-		NULL
-	};
+	bfs_statsData_t* sd = (bfs_statsData_t*) priv;
 
-	// init sqlite3
-	int i = 0;
-	while(sql_init[i])
-	{
-		if(sqlite3_exec(self->db, sql_init[i], NULL, NULL,
-		                NULL) != SQLITE_OK)
-		{
-			LOGE("sqlite3_exec(%i): %s",
-			     i, sqlite3_errmsg(self->db));
-			return 0;
-		}
-		++i;
-	}
+	// the calls made by data_fn are recorded
+	int depth = bfs_file_statsDepth;
+	bfs_file_statsDepth = 0;
 
-	return 1;
+	sd->bytes += size;
+	int ret = (*sd->data_fn)(sd->priv, name, size, data);
+
+	bfs_file_statsDepth = depth;
+
+	return ret;
 }
+#endif
 
-static int
-bfs_file_createTables(bfs_file_t* self)
+static int bfs_file_readers(bfs_file_t* self)
 {
 	ASSERT(self);
 
-	const char* sql_init[] =
-	{
-		"CREATE TABLE tbl_attr"
-		"("
-		"   key TEXT NOT NULL,"
-		"   val TEXT"
-		");",
-		"CREATE TABLE tbl_blob"
-		"("
-		"   name TEXT NOT NULL,"
-		"   blob BLOB"
-		");",
-		NULL
-	};
-
-	// init sqlite3
-	int i = 0;
-	while(sql_init[i])
+	int tid;
+	for(tid = 0; tid < self->nth; ++tid)
 	{
-		if(sqlite3_exec(self->db, sql_init[i], NULL, NULL,
-		                NULL) != SQLITE_OK)
+		if(__atomic_load_n(&self->slot[tid].readers,
+		                   __ATOMIC_SEQ_CST))
 		{
-			LOGE("sqlite3_exec(%i): %s",
-			     i, sqlite3_errmsg(self->db));
-			return 0;
+			return 1;
 		}
-		++i;
 	}
 
-	return 1;
+	return 0;
 }
 
-static int
-bfs_file_endTransaction(bfs_file_t* self)
+static void bfs_file_lockRead(bfs_file_t* self, int tid)
 {
 	ASSERT(self);
+	ASSERT(self->mode != BFS_MODE_STREAM);
 
-	if((self->mode != BFS_MODE_STREAM) ||
-	   (self->batch_size == 0))
+	// readers are only excluded by commits in the
+	// read-write mode without the WAL journal
+	if((self->mode == BFS_MODE_RDONLY) || self->wal)
 	{
-		return 1;
+		return;
 	}
 
-	sqlite3_stmt* stmt = self->stmt_end;
-	if(sqlite3_step(stmt) == SQLITE_DONE)
+	// nested read locks cannot be excluded
+	bfs_slot_t* slot = &self->slot[tid];
+	if(slot->readers)
 	{
-		self->batch_size = 0;
+		++slot->readers;
+		return;
 	}
-	else
+
+	while(1)
 	{
-		LOGE("sqlite3_step: %s", sqlite3_errmsg(self->db));
-		goto fail_step;
+		// the slot must be published before exclusive is
+		// checked (see bfs_file_excludeReaders)
+		__atomic_store_n(&slot->readers, 1, __ATOMIC_SEQ_CST);
+		if(__atomic_load_n(&self->exclusive,
+		                   __ATOMIC_SEQ_CST) == 0)
+		{
+			return;
+		}
+
+		// back off until the commit completes
+		uint64_t t0 = bfs_file_statsTimestamp();
+		pthread_mutex_lock(&self->mutex);
+		__atomic_store_n(&slot->readers, 0, __ATOMIC_SEQ_CST);
+		pthread_cond_broadcast(&self->cond);
+		while(self->exclusive)
+		{
+			pthread_cond_wait(&self->cond, &self->mutex);
+		}
+		pthread_mutex_unlock(&self->mutex);
+		bfs_file_statsAdd(self, tid, BFS_STATS_LOCK_READ,
+		                  t0, 1, 0, 0);
 	}
+}
 
-	if(sqlite3_reset(stmt) != SQLITE_OK)
+static void bfs_file_unlockRead(bfs_file_t* self, int tid)
+{
+	ASSERT(self);
+	ASSERT(self->mode != BFS_MODE_STREAM);
+
+	if((self->mode == BFS_MODE_RDONLY) || self->wal)
 	{
-		LOGW("sqlite3_reset failed");
+		return;
 	}
 
-	// success
-	return 1;
+	bfs_slot_t* slot = &self->slot[tid];
+	__atomic_store_n(&slot->readers, slot->readers - 1,
+	                 __ATOMIC_SEQ_CST);
 
-	// failure
-	fail_step:
+	// wake the writer which waits for the readers
+	if(__atomic_load_n(&self->exclusive, __ATOMIC_SEQ_CST))
 	{
-		if(sqlite3_reset(stmt) != SQLITE_OK)
-		{
-			LOGW("sqlite3_reset failed");
-		}
+		pthread_mutex_lock(&self->mutex);
+		pthread_cond_broadcast(&self->cond);
+		pthread_mutex_unlock(&self->mutex);
 	}
-	return 0;
 }
 
-static int
-bfs_file_beginTransaction(bfs_file_t* self)
+static void bfs_file_excludeReaders(bfs_file_t* self)
 {
 	ASSERT(self);
 
-	if(self->mode != BFS_MODE_STREAM)
+	// new readers back off while exclusive is set which
+	// gives the writer preference
+	pthread_mutex_lock(&self->mutex);
+	__atomic_store_n(&self->exclusive, self->exclusive + 1,
+	                 __ATOMIC_SEQ_CST);
+	while(bfs_file_readers(self))
 	{
-		return 1;
+		pthread_cond_wait(&self->cond, &self->mutex);
 	}
-	else if(self->batch_size >= BATCH_SIZE)
+	pthread_mutex_unlock(&self->mutex);
+}
+
+static void bfs_file_includeReaders(bfs_file_t* self)
+{
+	ASSERT(self);
+
+	pthread_mutex_lock(&self->mutex);
+	__atomic_store_n(&self->exclusive, self->exclusive - 1,
+	                 __ATOMIC_SEQ_CST);
+	pthread_cond_broadcast(&self->cond);
+	pthread_mutex_unlock(&self->mutex);
+}
+
+static int bfs_file_alloc(void** _data, size_t size)
+{
+	ASSERT(_data);
+
+	void* data = *_data;
+	if(data == NULL)
 	{
-		if(bfs_file_endTransaction(self) == 0)
+		data = CALLOC(1, size);
+		if(data == NULL)
 		{
+			LOGE("CALLOC failed");
 			return 0;
 		}
 	}
-	else if(self->batch_size > 0)
+	else if(MEMSIZEPTR(data) < size)
 	{
-		++self->batch_size;
-		return 1;
+		data = REALLOC(data, size);
+		if(data == NULL)
+		{
+			LOGE("REALLOC failed");
+			return 0;
+		}
 	}
 
-	sqlite3_stmt* stmt = self->stmt_begin;
-	if(sqlite3_step(stmt) == SQLITE_DONE)
+	*_data = data;
+
+	return 1;
+}
+
+static double bfs_file_timestamp(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double) ts.tv_sec + ((double) ts.tv_nsec)/1.0e9;
+}
+
+static int
+bfs_file_encode(bfs_file_t* self, size_t size,
+                const void* data, int* _codec,
+                size_t* _bytes, void** _enc)
+{
+	ASSERT(self);
+	ASSERT(data);
+	ASSERT(_codec);
+	ASSERT(_bytes);
+	ASSERT(_enc);
+
+	*_codec = BFS_CODEC_NONE;
+	*_bytes = size;
+	*_enc   = NULL;
+
+	// only the inline blobs are compressed
+	const bfs_codec_t* codec = self->codec;
+	if((codec == NULL) || (size < CODEC_MIN) ||
+	   (size > self->chunk_size))
 	{
-		++self->batch_size;
+		return 1;
 	}
-	else
+
+	// the blob is stored uncompressed unless the codec
+	// saves at least 1/8 of the size which also allows
+	// the codec to skip incompressible data early
+	size_t dst_size = size - size/8;
+	void*  enc      = MALLOC(dst_size);
+	if(enc == NULL)
 	{
-		LOGE("sqlite3_step: %s", sqlite3_errmsg(self->db));
-		goto fail_step;
+		LOGE("MALLOC failed");
+		return 0;
 	}
 
-	if(sqlite3_reset(stmt) != SQLITE_OK)
+	size_t bytes = (*codec->encode)(data, size, enc, dst_size);
+	if(bytes == 0)
 	{
-		LOGW("sqlite3_reset failed");
+		FREE(enc);
+		return 1;
 	}
 
-	// success
-	return 1;
+	*_codec = codec->id;
+	*_bytes = bytes;
+	*_enc   = enc;
 
-	// failure
-	fail_step:
-	{
-		if(sqlite3_reset(stmt) != SQLITE_OK)
-		{
-			LOGW("sqlite3_reset failed");
-		}
-	}
-	return 0;
+	return 1;
 }
 
-static int bfs_fileExists(const char* fname)
+static int
+bfs_file_decode(int id, size_t bytes, const void* src,
+                size_t size, void* dst)
 {
-	ASSERT(fname);
+	ASSERT(src);
+	ASSERT(dst);
 
-	if(access(fname, F_OK) != 0)
+	const bfs_codec_t* codec = bfs_codec_find(id);
+	if(codec == NULL)
+	{
+		LOGE("invalid codec=%i", id);
+		return 0;
+	}
+
+	if((*codec->decode)(src, bytes, dst, size) == 0)
 	{
+		LOGE("invalid codec=%i, bytes=%" PRIu64
+		     ", size=%" PRIu64, id,
+		     (uint64_t) bytes, (uint64_t) size);
 		return 0;
 	}
+
 	return 1;
 }
 
-/***********************************************************
-* public                                                   *
-***********************************************************/
-
-bfs_file_t*
-bfs_file_open(const char* fname, int nth, bfs_mode_e mode)
+static int
+bfs_file_blobDecode(sqlite3* db, sqlite3_blob* blob,
+                    int codec, size_t size, void** _tmp,
+                    void* data)
 {
-	ASSERT(fname);
-
-	int flags  = SQLITE_OPEN_READWRITE;
-	int exists = bfs_fileExists(fname);
-	if(mode == BFS_MODE_RDONLY)
+	ASSERT(db);
+	ASSERT(blob);
+	ASSERT(_tmp);
+	ASSERT(data);
+
+	// the compressed blob is read into the temporary
+	// buffer which may be reused by the caller
+	size_t bytes = (size_t) sqlite3_blob_bytes(blob);
+	if(bfs_file_alloc(_tmp, bytes) == 0)
 	{
-		// database must exist in read-only mode
-		if(exists == 0)
-		{
-			LOGE("invalid %s", fname);
-			return NULL;
-		}
-
-		flags = SQLITE_OPEN_READONLY;
+		return 0;
 	}
-	else if(mode == BFS_MODE_STREAM)
+
+	if(sqlite3_blob_read(blob, *_tmp, (int) bytes,
+	                     0) != SQLITE_OK)
 	{
-		if(nth != 1)
-		{
-			LOGE("invalid nth=%i", nth);
-			return NULL;
-		}
+		LOGE("sqlite3_blob_read: msg=%s",
+		     sqlite3_errmsg(db));
+		return 0;
 	}
 
-	// create database if needed
-	if(exists == 0)
+	return bfs_file_decode(codec, bytes, *_tmp, size, data);
+}
+
+static int
+bfs_file_bindCodec(sqlite3_stmt* stmt, int idx_codec,
+                   int idx_raw_size, int codec,
+                   size_t raw_size)
+{
+	ASSERT(stmt);
+
+	if(codec == BFS_CODEC_NONE)
 	{
-		flags |= SQLITE_OPEN_CREATE;
+		return (sqlite3_bind_null(stmt, idx_codec) == SQLITE_OK) &&
+		       (sqlite3_bind_null(stmt, idx_raw_size) == SQLITE_OK);
 	}
 
-	bfs_file_t* self;
-	self = (bfs_file_t*)
+	return (sqlite3_bind_int(stmt, idx_codec,
+	                         codec) == SQLITE_OK) &&
+	       (sqlite3_bind_int64(stmt, idx_raw_size,
+	                           (sqlite3_int64) raw_size) == SQLITE_OK);
+}
+
+static int
+bfs_file_bindContent(sqlite3_stmt* stmt, int idx_codec,
+                     int idx_raw_size, int codec,
+                     size_t raw_size)
+{
+	ASSERT(stmt);
+
+	// deduplicated blobs store the codec even when the
+	// content is uncompressed (see SQL_BLOB_CID)
+	return (sqlite3_bind_int(stmt, idx_codec,
+	                         codec) == SQLITE_OK) &&
+	       (sqlite3_bind_int64(stmt, idx_raw_size,
+	                           (sqlite3_int64) raw_size) == SQLITE_OK);
+}
+
+static int64_t
+bfs_file_columnCrc(sqlite3_stmt* stmt, int col)
+{
+	ASSERT(stmt);
+
+	// the crc is NULL for blobs which are not checksummed
+	// or when the verification is disabled
+	if(sqlite3_column_type(stmt, col) == SQLITE_NULL)
+	{
+		return -1;
+	}
+
+	return sqlite3_column_int64(stmt, col);
+}
+
+static int
+bfs_file_checkCrc(int64_t crc, size_t size,
+                  const void* data)
+{
+	// data may be NULL when size is zero
+
+	if(crc < 0)
+	{
+		return 1;
+	}
+
+	uint32_t sum = bfs_crc32c(0, data, size);
+	if(sum != (uint32_t) crc)
+	{
+		LOGE("invalid crc=0x%08X, expected=0x%08X, size=%" PRIu64,
+		     sum, (uint32_t) crc, (uint64_t) size);
+		return 0;
+	}
+
+	return 1;
+}
+
+static int
+bfs_file_bindCrc(sqlite3_stmt* stmt, int idx_crc,
+                 int64_t crc)
+{
+	ASSERT(stmt);
+
+	// the crc is negative when the blob is not checksummed
+	if(crc < 0)
+	{
+		return sqlite3_bind_null(stmt, idx_crc) == SQLITE_OK;
+	}
+
+	return sqlite3_bind_int64(stmt, idx_crc,
+	                          (sqlite3_int64) crc) == SQLITE_OK;
+}
+
+static uint32_t
+bfs_ticket_hash(bfs_op_e type, const char* name)
+{
+	ASSERT(name);
+
+	// FNV-1a where attributes and blobs use separate
+	// namespaces
+	uint32_t hash = 2166136261u;
+	hash ^= (type >= BFS_OP_BLOB_SET) ? 1 : 0;
+	hash *= 16777619u;
+	while(*name)
+	{
+		hash ^= (uint32_t) ((unsigned char) *name);
+		hash *= 16777619u;
+		++name;
+	}
+	return hash;
+}
+
+static int
+bfs_ticket_match(bfs_ticket_t* self, bfs_op_e type,
+                 const char* name)
+{
+	ASSERT(self);
+	ASSERT(name);
+
+	int ns1 = (self->type >= BFS_OP_BLOB_SET);
+	int ns2 = (type >= BFS_OP_BLOB_SET);
+	return (ns1 == ns2) && (strcmp(self->name, name) == 0);
+}
+
+static void
+bfs_file_queueRelease(bfs_file_t* self,
+                      bfs_ticket_t* ticket)
+{
+	ASSERT(self);
+	ASSERT(ticket);
+
+	// queue_mutex must be locked
+	--ticket->refcount;
+	if(ticket->refcount == 0)
+	{
+		FREE(ticket);
+	}
+}
+
+static void
+bfs_file_queueUnindex(bfs_file_t* self, bfs_ticket_t* ticket)
+{
+	ASSERT(self);
+	ASSERT(ticket);
+
+	// queue_mutex must be locked
+	uint32_t       b    = bfs_ticket_hash(ticket->type,
+	                                      ticket->name);
+	bfs_ticket_t** iter = &self->queue_index[b & (self->queue_buckets - 1)];
+	while(*iter)
+	{
+		if(*iter == ticket)
+		{
+			*iter = ticket->chain;
+			ticket->chain = NULL;
+			return;
+		}
+		iter = &(*iter)->chain;
+	}
+}
+
+static void
+bfs_file_queueIndex(bfs_file_t* self, bfs_ticket_t* ticket)
+{
+	ASSERT(self);
+	ASSERT(ticket);
+
+	// queue_mutex must be locked
+	// replace the previous operation for the name
+	uint32_t       b    = bfs_ticket_hash(ticket->type,
+	                                      ticket->name);
+	bfs_ticket_t** head = &self->queue_index[b & (self->queue_buckets - 1)];
+	bfs_ticket_t** iter = head;
+	while(*iter)
+	{
+		if(bfs_ticket_match(*iter, ticket->type, ticket->name))
+		{
+			bfs_ticket_t* prev = *iter;
+			*iter       = prev->chain;
+			prev->chain = NULL;
+			break;
+		}
+		iter = &(*iter)->chain;
+	}
+
+	ticket->chain = *head;
+	*head         = ticket;
+}
+
+static bfs_ticket_t*
+bfs_file_queueFind(bfs_file_t* self, bfs_op_e type,
+                   const char* name)
+{
+	ASSERT(self);
+	ASSERT(name);
+
+	if(self->queue == 0)
+	{
+		return NULL;
+	}
+
+	pthread_mutex_lock(&self->queue_mutex);
+
+	uint32_t      b    = bfs_ticket_hash(type, name);
+	bfs_ticket_t* iter = self->queue_index[b & (self->queue_buckets - 1)];
+	while(iter)
+	{
+		if(bfs_ticket_match(iter, type, name))
+		{
+			// the caller must release the reference
+			++iter->refcount;
+			break;
+		}
+		iter = iter->chain;
+	}
+
+	pthread_mutex_unlock(&self->queue_mutex);
+
+	return iter;
+}
+
+static void
+bfs_file_queueUnref(bfs_file_t* self, bfs_ticket_t* ticket)
+{
+	ASSERT(self);
+	ASSERT(ticket);
+
+	pthread_mutex_lock(&self->queue_mutex);
+	bfs_file_queueRelease(self, ticket);
+	pthread_mutex_unlock(&self->queue_mutex);
+}
+
+static int
+bfs_file_queueCopy(bfs_ticket_t* ticket,
+                   size_t* _size, void** _data)
+{
+	// _data may be NULL
+	ASSERT(ticket);
+	ASSERT(_size);
+
+	// see bfs_file_blobGet
+	if(_data && ticket->size)
+	{
+		if(bfs_file_alloc(_data, ticket->size) == 0)
+		{
+			return 0;
+		}
+		memcpy(*_data, ticket->data, ticket->size);
+	}
+	*_size = ticket->size;
+
+	return 1;
+}
+
+static int bfs_file_queueBypass(bfs_file_t* self)
+{
+	ASSERT(self);
+
+	if(self->queue == 0)
+	{
+		return 1;
+	}
+	else if(pthread_equal(pthread_self(), self->queue_thread))
+	{
+		return 1;
+	}
+
+	// the thread which owns the explicit transaction
+	// writes directly
+	int owner = 0;
+	if(pthread_mutex_trylock(&self->writer) == 0)
+	{
+		owner = self->txn;
+		pthread_mutex_unlock(&self->writer);
+	}
+	return owner;
+}
+
+static void bfs_file_queueDrain(bfs_file_t* self)
+{
+	ASSERT(self);
+
+	if(bfs_file_queueBypass(self))
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&self->queue_mutex);
+
+	uint64_t seq = self->queue_seq;
+	if(self->queue_flush < seq)
+	{
+		self->queue_flush = seq;
+		pthread_cond_signal(&self->queue_cond_put);
+	}
+
+	while(self->queue_done < seq)
+	{
+		pthread_cond_wait(&self->queue_cond_done,
+		                  &self->queue_mutex);
+	}
+
+	pthread_mutex_unlock(&self->queue_mutex);
+}
+
+static int
+bfs_file_queuePut(bfs_file_t* self, bfs_op_e type,
+                  const char* name, size_t size,
+                  const void* data, bfs_ticket_t** _ticket)
+{
+	// data and _ticket may be NULL
+	ASSERT(self);
+	ASSERT(name);
+
+	if((type == BFS_OP_ATTR_CLR) ||
+	   (type == BFS_OP_BLOB_CLR))
+	{
+		size = 0;
+	}
+
+	size_t len = strlen(name) + 1;
+
+	bfs_ticket_t* ticket;
+	ticket = (bfs_ticket_t*)
+	         MALLOC(sizeof(bfs_ticket_t) + len + size);
+	if(ticket == NULL)
+	{
+		LOGE("MALLOC failed");
+		return 0;
+	}
+
+	ticket->type     = type;
+	ticket->refcount = _ticket ? 2 : 1;
+	ticket->done     = 0;
+	ticket->status   = 0;
+	ticket->seq      = 0;
+	ticket->ts       = 0.0;
+	ticket->name     = (char*) &ticket[1];
+	ticket->size     = size;
+	ticket->data     = NULL;
+	ticket->next     = NULL;
+	ticket->chain    = NULL;
+	memcpy(ticket->name, name, len);
+	if(size)
+	{
+		ticket->data = (void*) (ticket->name + len);
+		memcpy(ticket->data, data, size);
+	}
+
+	size_t bytes = len + size;
+
+	pthread_mutex_lock(&self->queue_mutex);
+
+	// the queue is bounded by twice the group size so the
+	// next group may be queued while a group is committed
+	while((self->queue_stop == 0) &&
+	      (self->queue_count > 0) &&
+	      ((self->queue_count >= 2*self->queue_max_count) ||
+	       (self->queue_bytes + bytes > 2*self->queue_max_bytes)))
+	{
+		pthread_cond_wait(&self->queue_cond_done,
+		                  &self->queue_mutex);
+	}
+
+	if(self->queue_stop)
+	{
+		LOGE("invalid queue");
+		pthread_mutex_unlock(&self->queue_mutex);
+		FREE(ticket);
+		return 0;
+	}
+
+	ticket->seq = ++self->queue_seq;
+	ticket->ts  = bfs_file_timestamp();
+	if(self->queue_tail)
+	{
+		self->queue_tail->next = ticket;
+	}
+	else
+	{
+		self->queue_head = ticket;
+	}
+	self->queue_tail = ticket;
+	bfs_file_queueIndex(self, ticket);
+
+	self->queue_count         += 1;
+	self->queue_bytes         += bytes;
+	self->queue_pending_count += 1;
+	self->queue_pending_bytes += bytes;
+
+	// wake the queue thread to start the timer or to
+	// commit a full group
+	if((self->queue_pending_count == 1) ||
+	   (self->queue_pending_count >= self->queue_max_count) ||
+	   (self->queue_pending_bytes >= self->queue_max_bytes))
+	{
+		pthread_cond_signal(&self->queue_cond_put);
+	}
+
+	pthread_mutex_unlock(&self->queue_mutex);
+
+	if(_ticket)
+	{
+		*_ticket = ticket;
+	}
+
+	return 1;
+}
+
+static int
+bfs_file_queueApply(bfs_file_t* self, bfs_ticket_t* ticket)
+{
+	ASSERT(self);
+	ASSERT(ticket);
+
+	// the writes were recorded when they were queued
+	#if BFS_STATS
+	++bfs_file_statsDepth;
+	#endif
+
+	// the queue thread owns the explicit transaction so
+	// these functions bypass the queue
+	int ret;
+	if(ticket->type == BFS_OP_ATTR_SET)
+	{
+		ret = bfs_file_attrSet(self, ticket->name,
+		                       (const char*) ticket->data);
+	}
+	else if(ticket->type == BFS_OP_ATTR_CLR)
+	{
+		ret = bfs_file_attrClr(self, ticket->name);
+	}
+	else if(ticket->type == BFS_OP_BLOB_SET)
+	{
+		ret = bfs_file_blobSet(self, ticket->name,
+		                       ticket->size, ticket->data);
+	}
+	else
+	{
+		ret = bfs_file_blobClr(self, ticket->name);
+	}
+
+	#if BFS_STATS
+	--bfs_file_statsDepth;
+	#endif
+
+	return ret;
+}
+
+static void
+bfs_file_queueCommit(bfs_file_t* self, bfs_ticket_t* group)
+{
+	ASSERT(self);
+	ASSERT(group);
+
+	// an operation which fails does not prevent the rest
+	// of the group from being committed
+	int           ret  = bfs_file_txnBegin(self);
+	bfs_ticket_t* iter = group;
+	while(iter)
+	{
+		iter->status = ret ? bfs_file_queueApply(self, iter) : 0;
+		iter = iter->next;
+	}
+
+	if(ret && (bfs_file_txnCommit(self) == 0))
+	{
+		ret = 0;
+	}
+
+	if(ret == 0)
+	{
+		iter = group;
+		while(iter)
+		{
+			iter->status = 0;
+			iter = iter->next;
+		}
+	}
+}
+
+static int bfs_file_queueReady(bfs_file_t* self)
+{
+	ASSERT(self);
+
+	// queue_mutex must be locked
+	if(self->queue_head == NULL)
+	{
+		return 0;
+	}
+
+	return self->queue_stop ||
+	       (self->queue_flush > self->queue_done) ||
+	       (self->queue_pending_count >= self->queue_max_count) ||
+	       (self->queue_pending_bytes >= self->queue_max_bytes) ||
+	       (bfs_file_timestamp() >=
+	        self->queue_head->ts + self->queue_max_time);
+}
+
+static void* bfs_file_queueThread(void* arg)
+{
+	ASSERT(arg);
+
+	bfs_file_t* self = (bfs_file_t*) arg;
+
+	pthread_mutex_lock(&self->queue_mutex);
+	while(1)
+	{
+		// wait for a full group, the time limit, a flush
+		// or the queue to stop
+		while(bfs_file_queueReady(self) == 0)
+		{
+			if(self->queue_head == NULL)
+			{
+				if(self->queue_stop)
+				{
+					pthread_mutex_unlock(&self->queue_mutex);
+					return NULL;
+				}
+
+				pthread_cond_wait(&self->queue_cond_put,
+				                  &self->queue_mutex);
+				continue;
+			}
+
+			double t = self->queue_head->ts +
+			           self->queue_max_time;
+
+			struct timespec ts;
+			ts.tv_sec  = (time_t) t;
+			ts.tv_nsec = (long) ((t - (double) ts.tv_sec)*1.0e9);
+			pthread_cond_timedwait(&self->queue_cond_put,
+			                       &self->queue_mutex, &ts);
+		}
+
+		// take the group from the queue
+		bfs_ticket_t* group = self->queue_head;
+		bfs_ticket_t* last  = group;
+		int           count = 1;
+		size_t        bytes = strlen(last->name) + 1 + last->size;
+		while(last->next &&
+		      (count < self->queue_max_count) &&
+		      (bytes < self->queue_max_bytes))
+		{
+			last   = last->next;
+			count += 1;
+			bytes += strlen(last->name) + 1 + last->size;
+		}
+
+		self->queue_head = last->next;
+		if(self->queue_head == NULL)
+		{
+			self->queue_tail = NULL;
+		}
+		last->next = NULL;
+
+		self->queue_pending_count -= count;
+		self->queue_pending_bytes -= bytes;
+
+		pthread_mutex_unlock(&self->queue_mutex);
+		bfs_file_queueCommit(self, group);
+		pthread_mutex_lock(&self->queue_mutex);
+
+		// complete the group after the commit so readers
+		// find the operations in the index or the database
+		while(group)
+		{
+			bfs_ticket_t* next = group->next;
+
+			bfs_file_queueUnindex(self, group);
+			group->done       = 1;
+			group->next       = NULL;
+			self->queue_done  = group->seq;
+			self->queue_count -= 1;
+			self->queue_bytes -= strlen(group->name) + 1 +
+			                     group->size;
+			bfs_file_queueRelease(self, group);
+
+			group = next;
+		}
+		pthread_cond_broadcast(&self->queue_cond_done);
+	}
+
+	return NULL;
+}
+
+static int
+bfs_file_queueStart(bfs_file_t* self,
+                    const bfs_options_t* opts)
+{
+	ASSERT(self);
+	ASSERT(opts);
+
+	self->queue_max_count = opts->queue_count;
+	self->queue_max_bytes = opts->queue_bytes;
+	self->queue_max_time  = ((double) opts->queue_ms)/1000.0;
+	if(self->queue_max_bytes == 0)
+	{
+		self->queue_max_bytes = QUEUE_BYTES;
+	}
+	if(opts->queue_ms <= 0)
+	{
+		self->queue_max_time = ((double) QUEUE_MS)/1000.0;
+	}
+
+	// the index has at least one bucket per queued
+	// operation
+	self->queue_buckets = 1;
+	while(self->queue_buckets <
+	      (uint32_t) (2*self->queue_max_count))
+	{
+		self->queue_buckets *= 2;
+	}
+
+	self->queue_index = (bfs_ticket_t**)
+	                    CALLOC(self->queue_buckets,
+	                           sizeof(bfs_ticket_t*));
+	if(self->queue_index == NULL)
+	{
+		LOGE("CALLOC failed");
+		return 0;
+	}
+
+	if(pthread_mutex_init(&self->queue_mutex, NULL) != 0)
+	{
+		LOGE("pthread_mutex_init failed");
+		goto fail_mutex;
+	}
+
+	// the timed wait uses the monotonic clock
+	pthread_condattr_t attr;
+	if(pthread_condattr_init(&attr) != 0)
+	{
+		LOGE("pthread_condattr_init failed");
+		goto fail_attr;
+	}
+
+	if((pthread_condattr_setclock(&attr,
+	                              CLOCK_MONOTONIC) != 0) ||
+	   (pthread_cond_init(&self->queue_cond_put,
+	                      &attr) != 0))
+	{
+		LOGE("pthread_cond_init failed");
+		goto fail_cond_put;
+	}
+
+	if(pthread_cond_init(&self->queue_cond_done, NULL) != 0)
+	{
+		LOGE("pthread_cond_init failed");
+		goto fail_cond_done;
+	}
+
+	self->queue = 1;
+	if(pthread_create(&self->queue_thread, NULL,
+	                  bfs_file_queueThread,
+	                  (void*) self) != 0)
+	{
+		LOGE("pthread_create failed");
+		goto fail_thread;
+	}
+
+	pthread_condattr_destroy(&attr);
+
+	// success
+	return 1;
+
+	// failure
+	fail_thread:
+	{
+		self->queue = 0;
+		pthread_cond_destroy(&self->queue_cond_done);
+	}
+	fail_cond_done:
+		pthread_cond_destroy(&self->queue_cond_put);
+	fail_cond_put:
+		pthread_condattr_destroy(&attr);
+	fail_attr:
+		pthread_mutex_destroy(&self->queue_mutex);
+	fail_mutex:
+		FREE(self->queue_index);
+	return 0;
+}
+
+static void bfs_file_queueStop(bfs_file_t* self)
+{
+	ASSERT(self);
+
+	if(self->queue == 0)
+	{
+		return;
+	}
+
+	// the queue thread commits the remaining operations
+	// before exiting
+	pthread_mutex_lock(&self->queue_mutex);
+	self->queue_stop = 1;
+	pthread_cond_signal(&self->queue_cond_put);
+	pthread_cond_broadcast(&self->queue_cond_done);
+	pthread_mutex_unlock(&self->queue_mutex);
+
+	pthread_join(self->queue_thread, NULL);
+	self->queue = 0;
+
+	pthread_cond_destroy(&self->queue_cond_done);
+	pthread_cond_destroy(&self->queue_cond_put);
+	pthread_mutex_destroy(&self->queue_mutex);
+	FREE(self->queue_index);
+}
+
+static bfs_attrs_t*
+bfs_file_attrsAcquire(bfs_file_t* self, int tid)
+{
+	ASSERT(self);
+
+	// the hazard pointer must be published before the
+	// snapshot is confirmed to be current and it remains
+	// published until the next acquire by the same tid
+	bfs_slot_t*  slot = &self->slot[tid];
+	bfs_attrs_t* attrs;
+	do
+	{
+		attrs = __atomic_load_n(&self->attrs,
+		                        __ATOMIC_SEQ_CST);
+		__atomic_store_n(&slot->attrs, attrs,
+		                 __ATOMIC_SEQ_CST);
+	} while(attrs != __atomic_load_n(&self->attrs,
+	                                 __ATOMIC_SEQ_CST));
+
+	return attrs;
+}
+
+static int
+bfs_file_attrsPinned(bfs_file_t* self, bfs_attrs_t* attrs)
+{
+	ASSERT(self);
+	ASSERT(attrs);
+
+	int tid;
+	for(tid = 0; tid < self->nth; ++tid)
+	{
+		bfs_slot_t* slot = &self->slot[tid];
+		if(__atomic_load_n(&slot->attrs,
+		                   __ATOMIC_SEQ_CST) == attrs)
+		{
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+static bfs_attrs_t*
+bfs_file_attrsPrepare(bfs_file_t* self, const char* key,
+                      const char* val)
+{
+	// val may be NULL
+	ASSERT(self);
+	ASSERT(key);
+
+	// the snapshot is prepared before the write so that an
+	// allocation failure does not diverge from the file
+	bfs_attrs_t* base = self->attrs_pending;
+	if(base == NULL)
+	{
+		base = self->attrs;
+	}
+
+	return bfs_attrs_set(base, key, val);
+}
+
+static void
+bfs_file_attrsStage(bfs_file_t* self, bfs_attrs_t* attrs)
+{
+	ASSERT(self);
+	ASSERT(attrs);
+
+	// the pending snapshot is private to the writer
+	bfs_attrs_delete(&self->attrs_pending);
+	self->attrs_pending = attrs;
+}
+
+static void bfs_file_attrsCommit(bfs_file_t* self)
+{
+	ASSERT(self);
+
+	if(self->attrs_pending == NULL)
+	{
+		return;
+	}
+
+	bfs_attrs_t* prev = self->attrs;
+	__atomic_store_n(&self->attrs, self->attrs_pending,
+	                 __ATOMIC_SEQ_CST);
+	self->attrs_pending = NULL;
+
+	// each reader pins at most one snapshot so the retired
+	// array requires at most nth + 1 elements
+	self->attrs_retired[self->attrs_retired_count] = prev;
+	++self->attrs_retired_count;
+
+	int i = 0;
+	while(i < self->attrs_retired_count)
+	{
+		bfs_attrs_t* attrs = self->attrs_retired[i];
+		if(bfs_file_attrsPinned(self, attrs))
+		{
+			++i;
+			continue;
+		}
+
+		bfs_attrs_delete(&attrs);
+		--self->attrs_retired_count;
+		self->attrs_retired[i] =
+			self->attrs_retired[self->attrs_retired_count];
+	}
+}
+
+static void bfs_file_attrsDiscard(bfs_file_t* self)
+{
+	ASSERT(self);
+
+	bfs_attrs_delete(&self->attrs_pending);
+}
+
+static void
+bfs_file_cacheInvalidate(bfs_file_t* self, const char* name)
+{
+	ASSERT(self);
+	ASSERT(name);
+
+	// the cache is committed by bfs_file_unlockExclusive or
+	// by bfs_file_txnCommit
+	if(self->cache)
+	{
+		bfs_cache_invalidate(self->cache, name);
+	}
+}
+
+static void bfs_file_lockExclusive(bfs_file_t* self)
+{
+	ASSERT(self);
+
+	if(self->mode == BFS_MODE_STREAM)
+	{
+		// ignore
+		return;
+	}
+
+	// direct writes must follow the queued writes
+	bfs_file_queueDrain(self);
+
+	// writes by the transaction owner are committed by
+	// bfs_file_txnCommit so readers are not excluded
+	uint64_t t0 = bfs_file_statsTimestamp();
+	pthread_mutex_lock(&self->writer);
+	if((self->txn == 0) && (self->wal == 0))
+	{
+		bfs_file_excludeReaders(self);
+	}
+	bfs_file_statsAdd(self, -1, BFS_STATS_LOCK_EXCLUSIVE,
+	                  t0, 1, 0, 0);
+}
+
+static void bfs_file_unlockExclusive(bfs_file_t* self)
+{
+	ASSERT(self);
+
+	if(self->mode == BFS_MODE_STREAM)
+	{
+		// ignore
+		return;
+	}
+
+	// writes by the transaction owner are committed by
+	// bfs_file_txnCommit
+	if(self->txn == 0)
+	{
+		if(self->cache)
+		{
+			bfs_cache_commit(self->cache);
+		}
+		bfs_file_attrsCommit(self);
+	}
+
+	if((self->txn == 0) && (self->wal == 0))
+	{
+		bfs_file_includeReaders(self);
+	}
+	pthread_mutex_unlock(&self->writer);
+}
+
+static int
+bfs_file_createIndices(bfs_file_t* self)
+{
+	ASSERT(self);
+
+	const char* sql_init[] =
+	{
+		"CREATE UNIQUE INDEX idx_attr_key"
+		"   ON tbl_attr (key);",
+		"CREATE UNIQUE INDEX idx_blob_name"
+		"   ON tbl_blob (name);",
+		NULL
+	};
+
+	// init sqlite3
+	int i = 0;
+	while(sql_init[i])
+	{
+		if(sqlite3_exec(self->db, sql_init[i], NULL, NULL,
+		                NULL) != SQLITE_OK)
+		{
+			LOGE("sqlite3_exec(%i): %s",
+			     i, sqlite3_errmsg(self->db));
+			return 0;
+		}
+		++i;
+	}
+
+	return 1;
+}
+
+static int
+bfs_file_createTables(bfs_file_t* self)
+{
+	ASSERT(self);
+
+	const char* sql_init[] =
+	{
+		"CREATE TABLE tbl_attr"
+		"("
+		"   key TEXT NOT NULL,"
+		"   val TEXT"
+		");",
+		"CREATE TABLE tbl_blob"
+		"("
+		"   name TEXT NOT NULL,"
+		"   blob BLOB"
+		");",
+		NULL
+	};
+
+	// init sqlite3
+	int i = 0;
+	while(sql_init[i])
+	{
+		if(sqlite3_exec(self->db, sql_init[i], NULL, NULL,
+		                NULL) != SQLITE_OK)
+		{
+			LOGE("sqlite3_exec(%i): %s",
+			     i, sqlite3_errmsg(self->db));
+			return 0;
+		}
+		++i;
+	}
+
+	return 1;
+}
+
+static int
+bfs_file_step(bfs_file_t* self, sqlite3_stmt* stmt)
+{
+	ASSERT(self);
+	ASSERT(stmt);
+
+	int ret = 1;
+	if(sqlite3_step(stmt) != SQLITE_DONE)
+	{
+		LOGE("sqlite3_step: sql=%s, msg=%s",
+		     sqlite3_sql(stmt), sqlite3_errmsg(self->db));
+		ret = 0;
+	}
+
+	if(sqlite3_reset(stmt) != SQLITE_OK)
+	{
+		LOGW("sqlite3_reset failed");
+	}
+
+	return ret;
+}
+
+static int
+bfs_file_totalFlush(bfs_file_t* self)
+{
+	ASSERT(self);
+
+	bfs_total_t* total = &self->total;
+	if((total->count == 0) && (total->bytes == 0))
+	{
+		return 1;
+	}
+
+	sqlite3_stmt* stmt = self->stmt_total_add;
+	if((sqlite3_bind_int64(stmt, self->idx_total_add_count,
+	                       (sqlite3_int64) total->count) != SQLITE_OK) ||
+	   (sqlite3_bind_int64(stmt, self->idx_total_add_bytes,
+	                       (sqlite3_int64) total->bytes) != SQLITE_OK))
+	{
+		LOGE("sqlite3_bind_int64: count=%" PRId64
+		     ", bytes=%" PRId64, total->count, total->bytes);
+		return 0;
+	}
+
+	if(bfs_file_step(self, stmt) == 0)
+	{
+		return 0;
+	}
+
+	total->count = 0;
+	total->bytes = 0;
+
+	return 1;
+}
+
+static int64_t bfs_file_mtime(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+
+	return 1000*((int64_t) ts.tv_sec) + ts.tv_nsec/1000000;
+}
+
+static int
+bfs_file_metaBatch(bfs_file_t* self)
+{
+	ASSERT(self);
+
+	if(self->mode != BFS_MODE_STREAM)
+	{
+		return 1;
+	}
+
+	sqlite3_stmt* stmt = self->stmt_meta_batch;
+	if((sqlite3_bind_int64(stmt, self->idx_meta_batch_bid,
+	                       self->meta_bid) != SQLITE_OK) ||
+	   (sqlite3_bind_int64(stmt, self->idx_meta_batch_mtime,
+	                       (sqlite3_int64) bfs_file_mtime()) != SQLITE_OK))
+	{
+		LOGE("sqlite3_bind_int64: bid=%" PRId64,
+		     (int64_t) self->meta_bid);
+		return 0;
+	}
+
+	if(bfs_file_step(self, stmt) == 0)
+	{
+		return 0;
+	}
+
+	stmt = self->stmt_meta_sum;
+	if(sqlite3_bind_int64(stmt, self->idx_meta_sum_bid,
+	                      self->meta_bid) != SQLITE_OK)
+	{
+		LOGE("sqlite3_bind_int64: bid=%" PRId64,
+		     (int64_t) self->meta_bid);
+		return 0;
+	}
+
+	int ret = 1;
+	if(sqlite3_step(stmt) == SQLITE_ROW)
+	{
+		self->total.count += sqlite3_column_int64(stmt, 0);
+		self->total.bytes += sqlite3_column_int64(stmt, 1);
+		self->meta_bid     = sqlite3_column_int64(stmt, 2);
+	}
+	else
+	{
+		LOGE("sqlite3_step: %s", sqlite3_errmsg(self->db));
+		ret = 0;
+	}
+
+	if(sqlite3_reset(stmt) != SQLITE_OK)
+	{
+		LOGW("sqlite3_reset failed");
+	}
+
+	return ret;
+}
+
+static int
+bfs_file_endTransaction(bfs_file_t* self)
+{
+	ASSERT(self);
+
+	if((self->mode != BFS_MODE_STREAM) ||
+	   (self->batch_size == 0))
+	{
+		return 1;
+	}
+
+	// the metadata and totals are updated once per batch
+	if((bfs_file_metaBatch(self) == 0) ||
+	   (bfs_file_totalFlush(self) == 0))
+	{
+		return 0;
+	}
+
+	uint64_t      t0   = bfs_file_statsTimestamp();
+	sqlite3_stmt* stmt = self->stmt_end;
+	if(sqlite3_step(stmt) == SQLITE_DONE)
+	{
+		self->batch_size  = 0;
+		self->batch_bytes = 0;
+	}
+	else
+	{
+		LOGE("sqlite3_step: %s", sqlite3_errmsg(self->db));
+		goto fail_step;
+	}
+
+	if(sqlite3_reset(stmt) != SQLITE_OK)
+	{
+		LOGW("sqlite3_reset failed");
+	}
+
+	bfs_file_statsAdd(self, -1, BFS_STATS_STREAM_COMMIT,
+	                  t0, 1, 0, 0);
+
+	// success
+	return 1;
+
+	// failure
+	fail_step:
+	{
+		if(sqlite3_reset(stmt) != SQLITE_OK)
+		{
+			LOGW("sqlite3_reset failed");
+		}
+		bfs_file_statsAdd(self, -1, BFS_STATS_STREAM_COMMIT,
+		                  t0, 0, 0, 0);
+	}
+	return 0;
+}
+
+static int
+bfs_file_batchFull(bfs_file_t* self, size_t bytes)
+{
+	ASSERT(self);
+
+	// a single operation may exceed batch_max_bytes
+	return (self->batch_size >= self->batch_max_count) ||
+	       (self->batch_bytes + bytes > self->batch_max_bytes) ||
+	       (bfs_file_timestamp() >=
+	        self->batch_ts + self->batch_max_time);
+}
+
+static int
+bfs_file_beginTransaction(bfs_file_t* self, size_t bytes)
+{
+	ASSERT(self);
+
+	if(self->mode != BFS_MODE_STREAM)
+	{
+		return 1;
+	}
+	else if(self->batch_size > 0)
+	{
+		if(bfs_file_batchFull(self, bytes) == 0)
+		{
+			++self->batch_size;
+			self->batch_bytes += bytes;
+			return 1;
+		}
+
+		if(bfs_file_endTransaction(self) == 0)
+		{
+			return 0;
+		}
+	}
+
+	sqlite3_stmt* stmt = self->stmt_begin;
+	if(sqlite3_step(stmt) == SQLITE_DONE)
+	{
+		self->batch_size  = 1;
+		self->batch_bytes = bytes;
+		self->batch_ts    = bfs_file_timestamp();
+	}
+	else
+	{
+		LOGE("sqlite3_step: %s", sqlite3_errmsg(self->db));
+		goto fail_step;
+	}
+
+	if(sqlite3_reset(stmt) != SQLITE_OK)
+	{
+		LOGW("sqlite3_reset failed");
+	}
+
+	// success
+	return 1;
+
+	// failure
+	fail_step:
+	{
+		if(sqlite3_reset(stmt) != SQLITE_OK)
+		{
+			LOGW("sqlite3_reset failed");
+		}
+	}
+	return 0;
+}
+
+static int
+bfs_file_savepoint(bfs_file_t* self, bfs_total_t* save)
+{
+	ASSERT(self);
+	ASSERT(save);
+
+	*save = self->total;
+
+	return bfs_file_step(self, self->stmt_savepoint);
+}
+
+static int
+bfs_file_release(bfs_file_t* self, bfs_total_t* save,
+                 int ret)
+{
+	ASSERT(self);
+	ASSERT(save);
+
+	// the totals are updated by the savepoint unless it is
+	// nested in a transaction which updates them on commit
+	if(ret && (self->mode == BFS_MODE_RDWR) &&
+	   (self->txn == 0))
+	{
+		ret = bfs_file_totalFlush(self);
+	}
+
+	if(ret && bfs_file_step(self, self->stmt_release))
+	{
+		return 1;
+	}
+
+	bfs_file_step(self, self->stmt_rollback);
+	bfs_file_step(self, self->stmt_release);
+	self->total = *save;
+
+	return 0;
+}
+
+static void bfs_chunk_close(bfs_chunk_t* self)
+{
+	ASSERT(self);
+
+	if(self->blob)
+	{
+		sqlite3_blob_close(self->blob);
+		self->blob = NULL;
+	}
+	self->pos = 0;
+	self->len = 0;
+}
+
+static int
+bfs_chunk_seek(bfs_chunk_t* self, bfs_file_t* file,
+               sqlite3* db, sqlite3_stmt* stmt,
+               sqlite3_int64 bid, size_t offset, int flags)
+{
+	ASSERT(self);
+	ASSERT(file);
+	ASSERT(db);
+	ASSERT(stmt);
+
+	// reuse the current chunk
+	if(self->blob && (offset >= self->pos) &&
+	   (offset - self->pos < self->len))
+	{
+		return 1;
+	}
+
+	if((sqlite3_bind_int64(stmt, file->idx_chunk_find_bid,
+	                       bid) != SQLITE_OK) ||
+	   (sqlite3_bind_int64(stmt, file->idx_chunk_find_pos,
+	                       (sqlite3_int64) offset) != SQLITE_OK))
+	{
+		LOGE("sqlite3_bind_int64: bid=%" PRId64, (int64_t) bid);
+		return 0;
+	}
+
+	int           ret   = 1;
+	int           found = 0;
+	sqlite3_int64 rowid = 0;
+	size_t        pos   = 0;
+	size_t        len   = 0;
+	int           step  = sqlite3_step(stmt);
+	if(step == SQLITE_ROW)
+	{
+		rowid = sqlite3_column_int64(stmt, 0);
+		pos   = (size_t) sqlite3_column_int64(stmt, 1);
+		len   = (size_t) sqlite3_column_int64(stmt, 2);
+		found = 1;
+	}
+	else if(step != SQLITE_DONE)
+	{
+		LOGE("sqlite3_step: bid=%" PRId64 ", msg=%s",
+		     (int64_t) bid, sqlite3_errmsg(db));
+		ret = 0;
+	}
+
+	if(sqlite3_reset(stmt) != SQLITE_OK)
+	{
+		LOGW("sqlite3_reset failed");
+	}
+
+	if(ret == 0)
+	{
+		return 0;
+	}
+	else if((found == 0) || (offset - pos >= len))
+	{
+		LOGE("invalid bid=%" PRId64 ", offset=%" PRIu64,
+		     (int64_t) bid, (uint64_t) offset);
+		return 0;
+	}
+
+	// chunk handles always refer to tbl_chunk.data so the
+	// handle may be moved to the new row
+	if(self->blob)
+	{
+		if(sqlite3_blob_reopen(self->blob, rowid) != SQLITE_OK)
+		{
+			LOGE("sqlite3_blob_reopen: msg=%s",
+			     sqlite3_errmsg(db));
+
+			// the blob handle is aborted on error
+			bfs_chunk_close(self);
+			return 0;
+		}
+	}
+	else if(sqlite3_blob_open(db, "main", "tbl_chunk", "data",
+	                          rowid, flags,
+	                          &self->blob) != SQLITE_OK)
+	{
+		LOGE("sqlite3_blob_open: msg=%s", sqlite3_errmsg(db));
+
+		// the blob handle may be allocated on error
+		sqlite3_blob_close(self->blob);
+		self->blob = NULL;
+		return 0;
+	}
+
+	self->pos = pos;
+	self->len = len;
+
+	return 1;
+}
+
+static int
+bfs_chunk_read(bfs_chunk_t* self, bfs_file_t* file,
+               sqlite3* db, sqlite3_stmt* stmt,
+               sqlite3_int64 bid, size_t offset,
+               size_t size, void* data)
+{
+	ASSERT(self);
+	ASSERT(data);
+
+	unsigned char* dst = (unsigned char*) data;
+	while(size)
+	{
+		if(bfs_chunk_seek(self, file, db, stmt, bid,
+		                  offset, 0) == 0)
+		{
+			return 0;
+		}
+
+		size_t skip  = offset - self->pos;
+		size_t count = self->len - skip;
+		if(count > size)
+		{
+			count = size;
+		}
+
+		if(sqlite3_blob_read(self->blob, dst, (int) count,
+		                     (int) skip) != SQLITE_OK)
+		{
+			LOGE("sqlite3_blob_read: msg=%s",
+			     sqlite3_errmsg(db));
+			return 0;
+		}
+
+		dst    += count;
+		offset += count;
+		size   -= count;
+	}
+
+	return 1;
+}
+
+static int
+bfs_chunk_write(bfs_chunk_t* self, bfs_file_t* file,
+                sqlite3_int64 bid, size_t offset,
+                size_t size, const void* data)
+{
+	ASSERT(self);
+	ASSERT(file);
+	ASSERT(data);
+
+	const unsigned char* src = (const unsigned char*) data;
+	while(size)
+	{
+		if(bfs_chunk_seek(self, file, file->db,
+		                  file->stmt_chunk_find,
+		                  bid, offset, 1) == 0)
+		{
+			return 0;
+		}
+
+		size_t skip  = offset - self->pos;
+		size_t count = self->len - skip;
+		if(count > size)
+		{
+			count = size;
+		}
+
+		if(sqlite3_blob_write(self->blob, src, (int) count,
+		                      (int) skip) != SQLITE_OK)
+		{
+			LOGE("sqlite3_blob_write: msg=%s",
+			     sqlite3_errmsg(file->db));
+			return 0;
+		}
+
+		src    += count;
+		offset += count;
+		size   -= count;
+	}
+
+	return 1;
+}
+
+static int
+bfs_file_chunkSize(bfs_file_t* self, sqlite3* db,
+                   sqlite3_stmt* stmt, sqlite3_int64 bid,
+                   size_t* _size)
+{
+	ASSERT(self);
+	ASSERT(db);
+	ASSERT(stmt);
+	ASSERT(_size);
+
+	*_size = 0;
+
+	if(sqlite3_bind_int64(stmt, self->idx_chunk_size_bid,
+	                      bid) != SQLITE_OK)
+	{
+		LOGE("sqlite3_bind_int64: bid=%" PRId64, (int64_t) bid);
+		return 0;
+	}
+
+	// the size is the end of the last chunk
+	int ret  = 1;
+	int step = sqlite3_step(stmt);
+	if(step == SQLITE_ROW)
+	{
+		*_size = (size_t) sqlite3_column_int64(stmt, 0);
+	}
+	else if(step != SQLITE_DONE)
+	{
+		LOGE("sqlite3_step: bid=%" PRId64 ", msg=%s",
+		     (int64_t) bid, sqlite3_errmsg(db));
+		ret = 0;
+	}
+
+	if(sqlite3_reset(stmt) != SQLITE_OK)
+	{
+		LOGW("sqlite3_reset failed");
+	}
+
+	return ret;
+}
+
+static int
+bfs_file_chunkCopy(bfs_file_t* self, bfs_conn_t* conn,
+                   sqlite3_int64 bid, size_t size,
+                   void* data)
+{
+	ASSERT(self);
+	ASSERT(conn);
+	ASSERT(data);
+
+	sqlite3_stmt* stmt = conn->stmt_chunk_list;
+	if(sqlite3_bind_int64(stmt, self->idx_chunk_list_bid,
+	                      bid) != SQLITE_OK)
+	{
+		LOGE("sqlite3_bind_int64: bid=%" PRId64, (int64_t) bid);
+		return 0;
+	}
+
+	int            ret  = 1;
+	unsigned char* dst  = (unsigned char*) data;
+	int            step = sqlite3_step(stmt);
+	while(step == SQLITE_ROW)
+	{
+		size_t      pos   = (size_t) sqlite3_column_int64(stmt, 0);
+		const void* chunk = sqlite3_column_blob(stmt, 1);
+		size_t      len   = (size_t) sqlite3_column_bytes(stmt, 1);
+		if((pos > size) || (len > size - pos))
+		{
+			LOGE("invalid bid=%" PRId64 ", pos=%" PRIu64,
+			     (int64_t) bid, (uint64_t) pos);
+			ret = 0;
+			break;
+		}
+		else if(chunk && len)
+		{
+			memcpy(dst + pos, chunk, len);
+		}
+		step = sqlite3_step(stmt);
+	}
+
+	if(ret && (step != SQLITE_DONE))
+	{
+		LOGE("sqlite3_step: bid=%" PRId64 ", msg=%s",
+		     (int64_t) bid, sqlite3_errmsg(conn->db));
+		ret = 0;
+	}
+
+	if(sqlite3_reset(stmt) != SQLITE_OK)
+	{
+		LOGW("sqlite3_reset failed");
+	}
+
+	return ret;
+}
+
+static int
+bfs_file_chunkSet(bfs_file_t* self, sqlite3_int64 bid,
+                  size_t pos, size_t size, const void* data)
+{
+	// data may be NULL to reserve the chunk
+	ASSERT(self);
+
+	int           idx_data = self->idx_chunk_set_data;
+	sqlite3_stmt* stmt     = self->stmt_chunk_set;
+	if((sqlite3_bind_int64(stmt, self->idx_chunk_set_bid,
+	                       bid) != SQLITE_OK) ||
+	   (sqlite3_bind_int64(stmt, self->idx_chunk_set_pos,
+	                       (sqlite3_int64) pos) != SQLITE_OK))
+	{
+		LOGE("sqlite3_bind_int64: bid=%" PRId64, (int64_t) bid);
+		return 0;
+	}
+
+	int bind;
+	if(data)
+	{
+		bind = sqlite3_bind_blob64(stmt, idx_data, data,
+		                           (sqlite3_uint64) size,
+		                           SQLITE_STATIC);
+	}
+	else
+	{
+		bind = sqlite3_bind_zeroblob64(stmt, idx_data,
+		                               (sqlite3_uint64) size);
+	}
+
+	if(bind != SQLITE_OK)
+	{
+		LOGE("sqlite3_bind_blob64: bid=%" PRId64 ", msg=%s",
+		     (int64_t) bid, sqlite3_errmsg(self->db));
+		return 0;
+	}
+
+	return bfs_file_step(self, stmt);
+}
+
+static int
+bfs_file_chunkAppend(bfs_file_t* self, sqlite3_int64 bid,
+                     size_t pos, size_t size,
+                     const void* data)
+{
+	// data may be NULL to reserve the chunks
+	ASSERT(self);
+
+	const unsigned char* src = (const unsigned char*) data;
+
+	// fill the last chunk before adding new chunks so that
+	// small appends do not fragment the blob
+	if(pos && size)
+	{
+		bfs_chunk_t chunk = { .blob = NULL };
+		if(bfs_chunk_seek(&chunk, self, self->db,
+		                  self->stmt_chunk_find,
+		                  bid, pos - 1, 0) == 0)
+		{
+			return 0;
+		}
+
+		size_t count = 0;
+		if(chunk.len < self->chunk_size)
+		{
+			count = self->chunk_size - chunk.len;
+			if(count > size)
+			{
+				count = size;
+			}
+		}
+
+		if(count)
+		{
+			unsigned char* tmp;
+			tmp = (unsigned char*) CALLOC(1, chunk.len + count);
+			if(tmp == NULL)
+			{
+				LOGE("CALLOC failed");
+				bfs_chunk_close(&chunk);
+				return 0;
+			}
+
+			if(sqlite3_blob_read(chunk.blob, tmp,
+			                     (int) chunk.len,
+			                     0) != SQLITE_OK)
+			{
+				LOGE("sqlite3_blob_read: msg=%s",
+				     sqlite3_errmsg(self->db));
+				bfs_chunk_close(&chunk);
+				FREE(tmp);
+				return 0;
+			}
+
+			if(src)
+			{
+				memcpy(tmp + chunk.len, src, count);
+			}
+
+			// replace the chunk after closing the handle
+			size_t chunk_pos = chunk.pos;
+			size_t chunk_len = chunk.len;
+			bfs_chunk_close(&chunk);
+			if(bfs_file_chunkSet(self, bid, chunk_pos,
+			                     chunk_len + count,
+			                     tmp) == 0)
+			{
+				FREE(tmp);
+				return 0;
+			}
+			FREE(tmp);
+
+			if(src)
+			{
+				src += count;
+			}
+			pos  += count;
+			size -= count;
+		}
+		else
+		{
+			bfs_chunk_close(&chunk);
+		}
+	}
+
+	while(size)
+	{
+		size_t count = self->chunk_size;
+		if(count > size)
+		{
+			count = size;
+		}
+
+		if(bfs_file_chunkSet(self, bid, pos, count, src) == 0)
+		{
+			return 0;
+		}
+
+		if(src)
+		{
+			src += count;
+		}
+		pos  += count;
+		size -= count;
+	}
+
+	return 1;
+}
+
+static int
+bfs_file_blobRowid(bfs_file_t* self, const char* name,
+                   sqlite3_int64 last, sqlite3_int64* _bid,
+                   int* _created)
+{
+	ASSERT(self);
+	ASSERT(name);
+	ASSERT(_bid);
+	ASSERT(_created);
+
+	// last is the last insert rowid prior to the blob set
+	// and the upsert does not update the last insert rowid
+	// when an existing blob is replaced
+	sqlite3_int64 rowid = sqlite3_last_insert_rowid(self->db);
+	if((self->mode == BFS_MODE_STREAM) || (rowid != last))
+	{
+		*_bid     = rowid;
+		*_created = 1;
+		return 1;
+	}
+
+	// the blob may also be created with a reused rowid
+	// (see bfs_file_metaSet)
+	*_created = 0;
+
+	sqlite3_stmt* stmt = self->stmt_blob_find;
+	if(sqlite3_bind_text(stmt, self->idx_blob_find_name,
+	                     name, -1, SQLITE_STATIC) != SQLITE_OK)
+	{
+		LOGE("sqlite3_bind_text: name=%s", name);
+		return 0;
+	}
+
+	int ret = 1;
+	if(sqlite3_step(stmt) == SQLITE_ROW)
+	{
+		*_bid = sqlite3_column_int64(stmt, 0);
+	}
+	else
+	{
+		LOGE("sqlite3_step: name=%s, msg=%s",
+		     name, sqlite3_errmsg(self->db));
+		ret = 0;
+	}
+
+	if(sqlite3_reset(stmt) != SQLITE_OK)
+	{
+		LOGW("sqlite3_reset failed");
+	}
+
+	return ret;
+}
+
+static int
+bfs_file_metaPut(bfs_file_t* self, sqlite3_int64 bid,
+                 size_t size, sqlite3_int64 cid)
+{
+	ASSERT(self);
+
+	// the cid is NULL unless the blob is deduplicated and
+	// the triggers update the content refs
+	sqlite3_stmt* stmt = self->stmt_meta_set;
+	if((sqlite3_bind_int64(stmt, self->idx_meta_set_bid,
+	                       bid) != SQLITE_OK) ||
+	   (sqlite3_bind_int64(stmt, self->idx_meta_set_size,
+	                       (sqlite3_int64) size) != SQLITE_OK) ||
+	   (sqlite3_bind_int64(stmt, self->idx_meta_set_mtime,
+	                       (sqlite3_int64) bfs_file_mtime()) != SQLITE_OK) ||
+	   ((cid == 0) &&
+	    (sqlite3_bind_null(stmt, self->idx_meta_set_cid) != SQLITE_OK)) ||
+	   (cid &&
+	    (sqlite3_bind_int64(stmt, self->idx_meta_set_cid,
+	                        cid) != SQLITE_OK)))
+	{
+		LOGE("sqlite3_bind_int64: bid=%" PRId64,
+		     (int64_t) bid);
+		return 0;
+	}
+
+	return bfs_file_step(self, stmt);
+}
+
+static int
+bfs_file_metaSet(bfs_file_t* self, sqlite3_int64 bid,
+                 int created, size_t size,
+                 sqlite3_int64 cid)
+{
+	ASSERT(self);
+
+	// new blobs in the stream mode are added by the batch
+	// except for the deduplicated blobs which must store
+	// the cid (see bfs_file_metaBatch)
+	if((self->mode == BFS_MODE_STREAM) &&
+	   (bid > self->meta_bid))
+	{
+		return (cid == 0) ||
+		       bfs_file_metaPut(self, bid, size, cid);
+	}
+
+	// the previous size is subtracted from the totals
+	sqlite3_stmt* stmt = self->stmt_meta_get;
+	size_t        old  = 0;
+	if(created == 0)
+	{
+		if(sqlite3_bind_int64(stmt, self->idx_meta_get_bid,
+		                      bid) != SQLITE_OK)
+		{
+			LOGE("sqlite3_bind_int64: bid=%" PRId64,
+			     (int64_t) bid);
+			return 0;
+		}
+
+		int ret  = 1;
+		int step = sqlite3_step(stmt);
+		if(step == SQLITE_ROW)
+		{
+			old = (size_t) sqlite3_column_int64(stmt, 0);
+		}
+		else if(step == SQLITE_DONE)
+		{
+			created = 1;
+		}
+		else
+		{
+			LOGE("sqlite3_step: bid=%" PRId64 ", msg=%s",
+			     (int64_t) bid, sqlite3_errmsg(self->db));
+			ret = 0;
+		}
+
+		if(sqlite3_reset(stmt) != SQLITE_OK)
+		{
+			LOGW("sqlite3_reset failed");
+		}
+
+		if(ret == 0)
+		{
+			return 0;
+		}
+	}
+
+	if(bfs_file_metaPut(self, bid, size, cid) == 0)
+	{
+		return 0;
+	}
+
+	// the totals are updated on commit
+	// (see bfs_file_totalFlush)
+	if(created)
+	{
+		++self->total.count;
+	}
+	self->total.bytes += (int64_t) size - (int64_t) old;
+
+	return 1;
+}
+
+static int
+bfs_file_blobCrc(bfs_file_t* self, sqlite3_int64 bid,
+                 int64_t crc)
+{
+	ASSERT(self);
+
+	sqlite3_stmt* stmt = self->stmt_blob_crc;
+	if((sqlite3_bind_int64(stmt, self->idx_blob_crc_bid,
+	                       bid) != SQLITE_OK) ||
+	   (bfs_file_bindCrc(stmt, self->idx_blob_crc_crc,
+	                     crc) == 0))
+	{
+		LOGE("sqlite3_bind_int64: bid=%" PRId64,
+		     (int64_t) bid);
+		return 0;
+	}
+
+	return bfs_file_step(self, stmt);
+}
+
+static int
+bfs_file_blobInflate(bfs_file_t* self, sqlite3_int64 bid,
+                     sqlite3_int64 cid, int codec,
+                     size_t bytes, size_t size)
+{
+	ASSERT(self);
+
+	// compressed and deduplicated blobs are replaced by
+	// the uncompressed data before they are modified in
+	// place while the cid is cleared by the caller
+	// (see bfs_file_metaSet)
+	sqlite3_blob* blob = NULL;
+	if((cid && (sqlite3_blob_open(self->db, "main",
+	                              "tbl_content", "data",
+	                              cid, 0, &blob) != SQLITE_OK)) ||
+	   ((cid == 0) && (sqlite3_blob_open(self->db, "main",
+	                                     "tbl_blob", "blob",
+	                                     bid, 0, &blob) != SQLITE_OK)))
+	{
+		LOGE("sqlite3_blob_open: bid=%" PRId64 ", msg=%s",
+		     (int64_t) bid, sqlite3_errmsg(self->db));
+		sqlite3_blob_close(blob);
+		return 0;
+	}
+
+	void* tmp  = NULL;
+	void* data = NULL;
+	int   ret  = bfs_file_alloc(&data, size);
+	if(ret && codec)
+	{
+		ret = bfs_file_blobDecode(self->db, blob, codec,
+		                          size, &tmp, data);
+	}
+	else if(ret &&
+	        (sqlite3_blob_read(blob, data, (int) size,
+	                           0) != SQLITE_OK))
+	{
+		LOGE("sqlite3_blob_read: bid=%" PRId64 ", msg=%s",
+		     (int64_t) bid, sqlite3_errmsg(self->db));
+		ret = 0;
+	}
+	sqlite3_blob_close(blob);
+	FREE(tmp);
+	if(ret == 0)
+	{
+		FREE(data);
+		return 0;
+	}
+
+	sqlite3_stmt* stmt = self->stmt_blob_update;
+	if((sqlite3_bind_int64(stmt, self->idx_blob_update_bid,
+	                       bid) != SQLITE_OK) ||
+	   (sqlite3_bind_blob64(stmt, self->idx_blob_update_blob,
+	                        data, (sqlite3_uint64) size,
+	                        SQLITE_STATIC) != SQLITE_OK) ||
+	   (bfs_file_bindCodec(stmt, self->idx_blob_update_codec,
+	                       self->idx_blob_update_raw_size,
+	                       BFS_CODEC_NONE, 0) == 0) ||
+	   (bfs_file_bindCrc(stmt, self->idx_blob_update_crc,
+	                     -1) == 0))
+	{
+		LOGE("sqlite3_bind: bid=%" PRId64, (int64_t) bid);
+		FREE(data);
+		return 0;
+	}
+
+	ret = bfs_file_step(self, stmt);
+	FREE(data);
+
+	return ret;
+}
+
+static int
+bfs_file_contentMatch(sqlite3_stmt* stmt, size_t size,
+                      const void* data, int codec,
+                      size_t bytes, const void* enc)
+{
+	// enc may be NULL
+	ASSERT(stmt);
+	ASSERT(data);
+
+	const void* blob = sqlite3_column_blob(stmt, 1);
+	size_t      len  = (size_t) sqlite3_column_bytes(stmt, 1);
+	int         id   = sqlite3_column_int(stmt, 2);
+	size_t      raw  = id ? (size_t) sqlite3_column_int64(stmt, 3) :
+	                        len;
+	if((blob == NULL) || (raw != size))
+	{
+		return 0;
+	}
+	else if(id == BFS_CODEC_NONE)
+	{
+		return memcmp(blob, data, size) == 0;
+	}
+
+	// identical compressed data expands to identical content
+	if(enc && (id == codec) && (len == bytes) &&
+	   (memcmp(blob, enc, bytes) == 0))
+	{
+		return 1;
+	}
+
+	void* tmp = MALLOC(size);
+	if(tmp == NULL)
+	{
+		LOGE("MALLOC failed");
+		return 0;
+	}
+
+	int match = bfs_file_decode(id, len, blob, size, tmp) &&
+	            (memcmp(tmp, data, size) == 0);
+	FREE(tmp);
+
+	return match;
+}
+
+static int
+bfs_file_contentSet(bfs_file_t* self, const uint8_t* hash,
+                    size_t size, const void* data, int codec,
+                    size_t bytes, const void* enc,
+                    sqlite3_int64* _cid, int* _codec)
+{
+	// enc may be NULL
+	ASSERT(self);
+	ASSERT(hash);
+	ASSERT(data);
+	ASSERT(_cid);
+	ASSERT(_codec);
+
+	// the content is stored once per hash and referenced by
+	// the tbl_meta cid which also maintains the refs
+	// (see bfs_file_upgradeTables) while the codec of the
+	// content may differ from the blob encoding
+	*_cid   = 0;
+	*_codec = codec;
+
+	sqlite3_stmt* stmt = self->stmt_content_find;
+	if(sqlite3_bind_blob(stmt, self->idx_content_find_hash,
+	                     hash, BFS_HASH128_SIZE,
+	                     SQLITE_STATIC) != SQLITE_OK)
+	{
+		LOGE("sqlite3_bind_blob: msg=%s",
+		     sqlite3_errmsg(self->db));
+		return 0;
+	}
+
+	int ret   = 1;
+	int found = 0;
+	int step  = sqlite3_step(stmt);
+	if(step == SQLITE_ROW)
+	{
+		// the hash is not collision resistant so the blob
+		// is stored inline unless the content matches
+		found = 1;
+		if(bfs_file_contentMatch(stmt, size, data, codec,
+		                         bytes, enc))
+		{
+			*_cid   = sqlite3_column_int64(stmt, 0);
+			*_codec = sqlite3_column_int(stmt, 2);
+		}
+	}
+	else if(step != SQLITE_DONE)
+	{
+		LOGE("sqlite3_step: msg=%s", sqlite3_errmsg(self->db));
+		ret = 0;
+	}
+
+	if(sqlite3_reset(stmt) != SQLITE_OK)
+	{
+		LOGW("sqlite3_reset failed");
+	}
+
+	if((ret == 0) || found)
+	{
+		return ret;
+	}
+
+	stmt = self->stmt_content_add;
+	if((sqlite3_bind_blob(stmt, self->idx_content_add_hash,
+	                      hash, BFS_HASH128_SIZE,
+	                      SQLITE_STATIC) != SQLITE_OK) ||
+	   (sqlite3_bind_blob64(stmt, self->idx_content_add_data,
+	                        enc ? enc : data,
+	                        (sqlite3_uint64) bytes,
+	                        SQLITE_STATIC) != SQLITE_OK) ||
+	   (bfs_file_bindCodec(stmt, self->idx_content_add_codec,
+	                       self->idx_content_add_raw_size,
+	                       codec, size) == 0))
+	{
+		LOGE("sqlite3_bind_blob: msg=%s",
+		     sqlite3_errmsg(self->db));
+		return 0;
+	}
+
+	if(bfs_file_step(self, stmt) == 0)
+	{
+		return 0;
+	}
+
+	*_cid = sqlite3_last_insert_rowid(self->db);
+
+	return 1;
+}
+
+static int
+bfs_file_blobSetChunked(bfs_file_t* self, const char* name,
+                        size_t size, const void* data,
+                        int64_t crc, sqlite3_int64* _bid)
+{
+	// data may be NULL to reserve the chunks
+	ASSERT(self);
+	ASSERT(name);
+	ASSERT(_bid);
+
+	// replacing the blob deletes the previous chunks
+	sqlite3_int64 last = sqlite3_last_insert_rowid(self->db);
+	sqlite3_stmt* stmt = self->stmt_blob_set;
+	if((sqlite3_bind_text(stmt, self->idx_blob_set_name,
+	                      name, -1,
+	                      SQLITE_STATIC) != SQLITE_OK) ||
+	   (sqlite3_bind_null(stmt,
+	                      self->idx_blob_set_blob) != SQLITE_OK) ||
+	   (bfs_file_bindCodec(stmt, self->idx_blob_set_codec,
+	                       self->idx_blob_set_raw_size,
+	                       BFS_CODEC_NONE, 0) == 0) ||
+	   (bfs_file_bindCrc(stmt, self->idx_blob_set_crc,
+	                     crc) == 0))
+	{
+		LOGE("sqlite3_bind_text/sqlite3_bind_null: name=%s",
+		     name);
+		return 0;
+	}
+
+	if(bfs_file_step(self, stmt) == 0)
+	{
+		return 0;
+	}
+
+	int created = 0;
+	if((bfs_file_blobRowid(self, name, last, _bid,
+	                       &created) == 0) ||
+	   (bfs_file_metaSet(self, *_bid, created, size, 0) == 0))
+	{
+		return 0;
+	}
+
+	return bfs_file_chunkAppend(self, *_bid, 0, size, data);
+}
+
+static int
+bfs_file_blobWriteAt(bfs_file_t* self, const char* name,
+                     int append, size_t offset,
+                     size_t size, const void* data)
+{
+	ASSERT(self);
+	ASSERT(name);
+	ASSERT(data);
+
+	sqlite3_stmt* stmt = self->stmt_blob_find;
+	if(sqlite3_bind_text(stmt, self->idx_blob_find_name,
+	                     name, -1, SQLITE_STATIC) != SQLITE_OK)
+	{
+		LOGE("sqlite3_bind_text: name=%s", name);
+		return 0;
+	}
+
+	int           ret     = 1;
+	int           found   = 0;
+	int           chunked = 0;
+	int           codec   = BFS_CODEC_NONE;
+	int           crc     = 0;
+	sqlite3_int64 bid     = 0;
+	sqlite3_int64 cid     = 0;
+	size_t        cur     = 0;
+	size_t        bytes   = 0;
+	int           step    = sqlite3_step(stmt);
+	if(step == SQLITE_ROW)
+	{
+		bid     = sqlite3_column_int64(stmt, 0);
+		chunked = sqlite3_column_int(stmt, 1);
+		cur     = (size_t) sqlite3_column_int64(stmt, 2);
+		codec   = sqlite3_column_int(stmt, 3);
+		cid     = sqlite3_column_int64(stmt, 5);
+		crc     = sqlite3_column_int(stmt, 6);
+		found   = 1;
+		if(codec)
+		{
+			bytes = cur;
+			cur   = (size_t) sqlite3_column_int64(stmt, 4);
+		}
+	}
+	else if(step != SQLITE_DONE)
+	{
+		LOGE("sqlite3_step: name=%s, msg=%s",
+		     name, sqlite3_errmsg(self->db));
+		ret = 0;
+	}
+
+	if(sqlite3_reset(stmt) != SQLITE_OK)
+	{
+		LOGW("sqlite3_reset failed");
+	}
+
+	if(ret == 0)
+	{
+		return 0;
+	}
+	else if(chunked &&
+	        (bfs_file_chunkSize(self, self->db,
+	                            self->stmt_chunk_size,
+	                            bid, &cur) == 0))
+	{
+		return 0;
+	}
+	else if((codec || cid) &&
+	        (bfs_file_blobInflate(self, bid, cid, codec,
+	                              bytes, cur) == 0))
+	{
+		return 0;
+	}
+
+	if(append)
+	{
+		offset = cur;
+	}
+	else if(offset > cur)
+	{
+		LOGE("invalid name=%s, offset=%" PRIu64
+		     ", size=%" PRIu64, name,
+		     (uint64_t) offset, (uint64_t) cur);
+		return 0;
+	}
+
+	if(found == 0)
+	{
+		// create the blob which is checksummed like
+		// bfs_file_blobSet since the data is complete
+		int64_t sum = (int64_t) bfs_crc32c(0, data, size);
+		if(size > self->chunk_size)
+		{
+			return bfs_file_blobSetChunked(self, name, size,
+			                               data, sum, &bid);
+		}
+
+		sqlite3_int64 last = sqlite3_last_insert_rowid(self->db);
+		stmt = self->stmt_blob_set;
+		if((sqlite3_bind_text(stmt, self->idx_blob_set_name,
+		                      name, -1,
+		                      SQLITE_STATIC) != SQLITE_OK) ||
+		   (sqlite3_bind_blob64(stmt, self->idx_blob_set_blob,
+		                        data, (sqlite3_uint64) size,
+		                        SQLITE_STATIC) != SQLITE_OK) ||
+		   (bfs_file_bindCodec(stmt, self->idx_blob_set_codec,
+		                       self->idx_blob_set_raw_size,
+		                       BFS_CODEC_NONE, 0) == 0) ||
+		   (bfs_file_bindCrc(stmt, self->idx_blob_set_crc,
+		                     sum) == 0))
+		{
+			LOGE("sqlite3_bind_text/sqlite3_bind_blob64: name=%s",
+			     name);
+			return 0;
+		}
+
+		int created = 0;
+		if((bfs_file_step(self, stmt) == 0) ||
+		   (bfs_file_blobRowid(self, name, last, &bid,
+		                       &created) == 0))
+		{
+			return 0;
+		}
+
+		return bfs_file_metaSet(self, bid, created, size, 0);
+	}
+
+	// update the metadata and clear the crc before the blob
+	// handles are opened since the checksum of the modified
+	// blob is unknown
+	size_t end = offset + size;
+	if(bfs_file_metaSet(self, bid, 0,
+	                    (end > cur) ? end : cur, 0) == 0)
+	{
+		return 0;
+	}
+	else if(crc && (bfs_file_blobCrc(self, bid, -1) == 0))
+	{
+		return 0;
+	}
+
+	if((chunked == 0) && (offset + size <= cur))
+	{
+		// overwrite the inline blob in place
+		sqlite3_blob* blob = NULL;
+		if(sqlite3_blob_open(self->db, "main", "tbl_blob",
+		                     "blob", bid, 1,
+		                     &blob) != SQLITE_OK)
+		{
+			LOGE("sqlite3_blob_open: name=%s, msg=%s",
+			     name, sqlite3_errmsg(self->db));
+			sqlite3_blob_close(blob);
+			return 0;
+		}
+
+		if(sqlite3_blob_write(blob, data, (int) size,
+		                      (int) offset) != SQLITE_OK)
+		{
+			LOGE("sqlite3_blob_write: name=%s, msg=%s",
+			     name, sqlite3_errmsg(self->db));
+			ret = 0;
+		}
+
+		if(sqlite3_blob_close(blob) != SQLITE_OK)
+		{
+			LOGE("sqlite3_blob_close: name=%s, msg=%s",
+			     name, sqlite3_errmsg(self->db));
+			ret = 0;
+		}
+
+		return ret;
+	}
+	else if(chunked == 0)
+	{
+		// move the inline blob into the first chunk
+		stmt = self->stmt_chunk_detach;
+		if(sqlite3_bind_int64(stmt, self->idx_chunk_detach_bid,
+		                      bid) != SQLITE_OK)
+		{
+			LOGE("sqlite3_bind_int64: name=%s", name);
+			return 0;
+		}
+
+		if(bfs_file_step(self, stmt) == 0)
+		{
+			return 0;
+		}
+
+		stmt = self->stmt_blob_update;
+		if((sqlite3_bind_int64(stmt, self->idx_blob_update_bid,
+		                       bid) != SQLITE_OK) ||
+		   (sqlite3_bind_null(stmt,
+		                      self->idx_blob_update_blob) != SQLITE_OK) ||
+		   (bfs_file_bindCodec(stmt, self->idx_blob_update_codec,
+		                       self->idx_blob_update_raw_size,
+		                       BFS_CODEC_NONE, 0) == 0) ||
+		   (bfs_file_bindCrc(stmt, self->idx_blob_update_crc,
+		                     -1) == 0))
+		{
+			LOGE("sqlite3_bind_int64/sqlite3_bind_null: name=%s",
+			     name);
+			return 0;
+		}
+
+		if(bfs_file_step(self, stmt) == 0)
+		{
+			return 0;
+		}
+	}
+
+	// overwrite the existing chunks and append the rest
+	const unsigned char* src   = (const unsigned char*) data;
+	size_t               count = cur - offset;
+	if(count > size)
+	{
+		count = size;
+	}
+
+	if(count)
+	{
+		bfs_chunk_t chunk = { .blob = NULL };
+		ret = bfs_chunk_write(&chunk, self, bid, offset,
+		                      count, src);
+		bfs_chunk_close(&chunk);
+		if(ret == 0)
+		{
+			return 0;
+		}
+	}
+
+	return bfs_file_chunkAppend(self, bid, offset + count,
+	                            size - count, src + count);
+}
+
+static int
+bfs_file_blobModify(bfs_file_t* self, const char* name,
+                    int append, size_t offset,
+                    size_t size, const void* data)
+{
+	// data may be NULL when size is zero
+	ASSERT(self);
+	ASSERT(name);
+
+	if(self->mode == BFS_MODE_RDONLY)
+	{
+		LOGE("invalid mode");
+		return 0;
+	}
+	else if((size == 0) || (data == NULL))
+	{
+		return 1;
+	}
+
+	bfs_file_lockExclusive(self);
+	bfs_file_cacheInvalidate(self, name);
+	if(bfs_file_beginTransaction(self, size) == 0)
+	{
+		bfs_file_unlockExclusive(self);
+		return 0;
+	}
+
+	// the blob and chunks are modified as a unit
+	bfs_total_t save;
+	if(bfs_file_savepoint(self, &save) == 0)
+	{
+		bfs_file_unlockExclusive(self);
+		return 0;
+	}
+
+	int ret = bfs_file_blobWriteAt(self, name, append,
+	                               offset, size, data);
+	ret = bfs_file_release(self, &save, ret);
+
+	bfs_file_unlockExclusive(self);
+
+	return ret;
+}
+
+static int bfs_fetch_compare(const void* a, const void* b)
+{
+	ASSERT(a);
+	ASSERT(b);
+
+	const bfs_fetch_t* fa = (const bfs_fetch_t*) a;
+	const bfs_fetch_t* fb = (const bfs_fetch_t*) b;
+	if(fa->rowid < fb->rowid)
+	{
+		return -1;
+	}
+	else if(fa->rowid > fb->rowid)
+	{
+		return 1;
+	}
+	return 0;
+}
+
+static int
+bfs_conn_step(bfs_conn_t* self, sqlite3_stmt* stmt)
+{
+	ASSERT(self);
+	ASSERT(stmt);
+
+	int ret = 1;
+	if(sqlite3_step(stmt) != SQLITE_DONE)
+	{
+		LOGE("sqlite3_step: sql=%s, msg=%s",
+		     sqlite3_sql(stmt), sqlite3_errmsg(self->db));
+		ret = 0;
+	}
+
+	if(sqlite3_reset(stmt) != SQLITE_OK)
+	{
+		LOGW("sqlite3_reset failed");
+	}
+
+	return ret;
+}
+
+static int
+bfs_conn_blobOpen(bfs_conn_t* self, int content,
+                  sqlite3_int64 rowid, sqlite3_blob** _blob)
+{
+	ASSERT(self);
+	ASSERT(_blob);
+
+	// the blob handle may only be moved between rows of
+	// the table which it was opened for
+	sqlite3_blob* blob = *_blob;
+	if(blob)
+	{
+		if(sqlite3_blob_reopen(blob, rowid) != SQLITE_OK)
+		{
+			LOGE("sqlite3_blob_reopen: msg=%s",
+			     sqlite3_errmsg(self->db));
+
+			// the blob handle is aborted on error
+			sqlite3_blob_close(blob);
+			*_blob = NULL;
+			return 0;
+		}
+		return 1;
+	}
+
+	// deduplicated blobs are stored in tbl_content
+	const char* table  = content ? "tbl_content" : "tbl_blob";
+	const char* column = content ? "data" : "blob";
+	if(sqlite3_blob_open(self->db, "main", table, column,
+	                     rowid, 0, &blob) != SQLITE_OK)
+	{
+		LOGE("sqlite3_blob_open: msg=%s",
+		     sqlite3_errmsg(self->db));
+
+		// the blob handle may be allocated on error
+		sqlite3_blob_close(blob);
+		return 0;
+	}
+
+	*_blob = blob;
+
+	return 1;
+}
+
+static int
+bfs_file_fetchResolve(bfs_file_t* self, bfs_conn_t* conn,
+                      int count, const char** names,
+                      const char* skip, bfs_fetch_t* fetch,
+                      int* _found)
+{
+	// skip may be NULL
+	ASSERT(self);
+	ASSERT(conn);
+	ASSERT(names);
+	ASSERT(fetch);
+	ASSERT(_found);
+
+	int           found = 0;
+	int           idx   = self->idx_blob_rowid_name;
+	sqlite3_stmt* stmt  = conn->stmt_blob_rowid;
+
+	int i;
+	for(i = 0; i < count; ++i)
+	{
+		if(skip && skip[i])
+		{
+			continue;
+		}
+
+		if(sqlite3_bind_text(stmt, idx, names[i], -1,
+		                     SQLITE_STATIC) != SQLITE_OK)
+		{
+			LOGE("sqlite3_bind_text: name=%s", names[i]);
+			return 0;
+		}
+
+		int ret  = 1;
+		int step = sqlite3_step(stmt);
+		if(step == SQLITE_ROW)
+		{
+			bfs_fetch_t* f = &fetch[found++];
+			f->rowid    = sqlite3_column_int64(stmt, 0);
+			f->chunked  = sqlite3_column_int(stmt, 1);
+			f->codec    = sqlite3_column_int(stmt, 2);
+			f->raw_size = (size_t) sqlite3_column_int64(stmt, 3);
+			f->cid      = sqlite3_column_int64(stmt, 4);
+			f->crc      = bfs_file_columnCrc(stmt, 5);
+			f->index    = i;
+		}
+		else if(step != SQLITE_DONE)
+		{
+			LOGE("sqlite3_step: name=%s, msg=%s",
+			     names[i], sqlite3_errmsg(conn->db));
+			ret = 0;
+		}
+
+		if(sqlite3_reset(stmt) != SQLITE_OK)
+		{
+			LOGW("sqlite3_reset failed");
+		}
+
+		if(ret == 0)
+		{
+			return 0;
+		}
+	}
+
+	*_found = found;
+
+	return 1;
+}
+
+static int
+bfs_file_fetchRead(bfs_file_t* self, bfs_conn_t* conn,
+                   int found, bfs_fetch_t* fetch,
+                   size_t* sizes, void** datas)
+{
+	// datas may be NULL
+	ASSERT(self);
+	ASSERT(conn);
+	ASSERT(fetch);
+	ASSERT(sizes);
+
+	// the blob handles are moved between rows to read the
+	// inline blobs directly into the caller buffers while
+	// compressed blobs are read into a temporary buffer
+	int           ret     = 1;
+	sqlite3_blob* blob    = NULL;
+	sqlite3_blob* content = NULL;
+	void*         tmp     = NULL;
+
+	int i;
+	for(i = 0; i < found; ++i)
+	{
+		bfs_fetch_t* f    = &fetch[i];
+		size_t       size = 0;
+		if(f->chunked)
+		{
+			ret = bfs_file_chunkSize(self, conn->db,
+			                         conn->stmt_chunk_size,
+			                         f->rowid, &size);
+			if(ret && datas && size)
+			{
+				ret = bfs_file_alloc(&datas[f->index], size) &&
+				      bfs_file_chunkCopy(self, conn, f->rowid,
+				                         size,
+				                         datas[f->index]);
+			}
+		}
+		else
+		{
+			sqlite3_blob** _blob = f->cid ? &content : &blob;
+			if(bfs_conn_blobOpen(conn, f->cid != 0,
+			                     f->cid ? f->cid : f->rowid,
+			                     _blob) == 0)
+			{
+				ret = 0;
+				break;
+			}
+
+			size = (size_t) sqlite3_blob_bytes(*_blob);
+			if(f->codec)
+			{
+				size = f->raw_size;
+				if(datas && size)
+				{
+					ret = bfs_file_alloc(&datas[f->index], size) &&
+					      bfs_file_blobDecode(conn->db, *_blob,
+					                          f->codec, size, &tmp,
+					                          datas[f->index]);
+				}
+			}
+			else if(datas && size)
+			{
+				ret = bfs_file_alloc(&datas[f->index], size);
+				if(ret &&
+				   (sqlite3_blob_read(*_blob, datas[f->index],
+				                      (int) size,
+				                      0) != SQLITE_OK))
+				{
+					LOGE("sqlite3_blob_read: msg=%s",
+					     sqlite3_errmsg(conn->db));
+					ret = 0;
+				}
+			}
+		}
+
+		if(ret && datas)
+		{
+			ret = bfs_file_checkCrc(f->crc, size,
+			                        datas[f->index]);
+		}
+
+		if(ret == 0)
+		{
+			break;
+		}
+
+		sizes[f->index] = size;
+	}
+
+	if(blob)
+	{
+		sqlite3_blob_close(blob);
+	}
+	if(content)
+	{
+		sqlite3_blob_close(content);
+	}
+	FREE(tmp);
+
+	return ret;
+}
+
+static int
+bfs_file_blobLoad(bfs_file_t* self, int tid,
+                  const char* name, bfs_buffer_t** _buffer)
+{
+	ASSERT(self);
+	ASSERT(name);
+	ASSERT(_buffer);
+
+	// allow return success with empty buffer
+	*_buffer = NULL;
+
+	bfs_file_lockRead(self, tid);
+
+	int           idx  = self->idx_blob_get_name;
+	bfs_conn_t*   conn = &self->conn[tid];
+	sqlite3_stmt* stmt = conn->stmt_blob_get;
+	if(sqlite3_bind_text(stmt, idx, name, -1,
+	                     SQLITE_STATIC) != SQLITE_OK)
+	{
+		LOGE("sqlite3_bind_text: name=%s", name);
+		bfs_file_unlockRead(self, tid);
+		return 0;
+	}
+
+	// the statement is reset after the chunks are copied
+	// so the blob and chunks are read from one snapshot
+	int ret  = 1;
+	int step = sqlite3_step(stmt);
+	if(step == SQLITE_ROW)
+	{
+		bfs_buffer_t* buffer = NULL;
+		void*         data   = NULL;
+		size_t        size   = 0;
+		if(sqlite3_column_type(stmt, 1) == SQLITE_NULL)
+		{
+			// chunked layout
+			sqlite3_int64 bid = sqlite3_column_int64(stmt, 0);
+			ret = bfs_file_chunkSize(self, conn->db,
+			                         conn->stmt_chunk_size,
+			                         bid, &size);
+			if(ret && size)
+			{
+				buffer = bfs_buffer_new(size, &data);
+				if(buffer == NULL)
+				{
+					ret = 0;
+				}
+				else if(bfs_file_chunkCopy(self, conn, bid,
+				                           size, data) == 0)
+				{
+					bfs_buffer_unref(&buffer);
+					ret = 0;
+				}
+			}
+		}
+		else
+		{
+			const void* blob  = sqlite3_column_blob(stmt, 1);
+			size_t      bytes = (size_t) sqlite3_column_bytes(stmt, 1);
+			int         codec = sqlite3_column_int(stmt, 2);
+			size = codec ? (size_t) sqlite3_column_int64(stmt, 3) :
+			               bytes;
+			if(blob && size)
+			{
+				buffer = bfs_buffer_new(size, &data);
+				if(buffer == NULL)
+				{
+					ret = 0;
+				}
+				else if(codec == BFS_CODEC_NONE)
+				{
+					memcpy(data, blob, size);
+				}
+				else if(bfs_file_decode(codec, bytes, blob,
+				                        size, data) == 0)
+				{
+					bfs_buffer_unref(&buffer);
+					ret = 0;
+				}
+			}
+		}
+
+		if(ret &&
+		   (bfs_file_checkCrc(bfs_file_columnCrc(stmt, 4),
+		                      size, data) == 0))
+		{
+			bfs_buffer_unref(&buffer);
+			ret = 0;
+		}
+
+		*_buffer = buffer;
+	}
+	else if(step != SQLITE_DONE)
+	{
+		LOGE("sqlite3_step: name=%s, msg=%s",
+		     name, sqlite3_errmsg(conn->db));
+		ret = 0;
+	}
+
+	if(sqlite3_reset(stmt) != SQLITE_OK)
+	{
+		LOGW("sqlite3_reset failed");
+	}
+
+	bfs_file_unlockRead(self, tid);
+
+	return ret;
+}
+
+static int
+bfs_file_blobFetch(bfs_file_t* self, bfs_conn_t* conn,
+                   sqlite3_stmt* stmt, size_t* _size,
+                   void** _data)
+{
+	// _data may be NULL
+	ASSERT(self);
+	ASSERT(conn);
+	ASSERT(stmt);
+	ASSERT(_size);
+
+	// the statement is reset after the chunks are copied
+	// so the blob and chunks are read from one snapshot
+	int ret  = 1;
+	int step = sqlite3_step(stmt);
+	if(step == SQLITE_ROW)
+	{
+		size_t      size = 0;
+		const void* blob = NULL;
+		if(sqlite3_column_type(stmt, 1) == SQLITE_NULL)
+		{
+			// chunked layout
+			sqlite3_int64 bid = sqlite3_column_int64(stmt, 0);
+			ret = bfs_file_chunkSize(self, conn->db,
+			                         conn->stmt_chunk_size,
+			                         bid, &size);
+			if(ret && _data && size)
+			{
+				ret = bfs_file_alloc(_data, size) &&
+				      bfs_file_chunkCopy(self, conn, bid,
+				                         size, *_data);
+			}
+		}
+		else
+		{
+			blob = sqlite3_column_blob(stmt, 1);
+			size = (size_t) sqlite3_column_bytes(stmt, 1);
+
+			int codec = sqlite3_column_int(stmt, 2);
+			if(codec)
+			{
+				size_t bytes = size;
+				size = (size_t) sqlite3_column_int64(stmt, 3);
+				if(_data && blob && size)
+				{
+					ret = bfs_file_alloc(_data, size) &&
+					      bfs_file_decode(codec, bytes, blob,
+					                      size, *_data);
+				}
+			}
+			else if(_data && blob && size)
+			{
+				ret = bfs_file_alloc(_data, size);
+				if(ret)
+				{
+					memcpy(*_data, blob, size);
+				}
+			}
+		}
+
+		if(ret && _data)
+		{
+			ret = bfs_file_checkCrc(bfs_file_columnCrc(stmt, 4),
+			                        size, *_data);
+		}
+
+		if(ret)
+		{
+			*_size = size;
+		}
+	}
+	else if(step != SQLITE_DONE)
+	{
+		LOGE("sqlite3_step: msg=%s",
+		     sqlite3_errmsg(conn->db));
+		ret = 0;
+	}
+
+	if(sqlite3_reset(stmt) != SQLITE_OK)
+	{
+		LOGW("sqlite3_reset failed");
+	}
+
+	return ret;
+}
+
+static int
+bfs_file_blobTotal(bfs_file_t* self, int tid,
+                   uint64_t* _count, uint64_t* _bytes)
+{
+	// _count and _bytes may be NULL
+	ASSERT(self);
+
+	if(self->mode == BFS_MODE_STREAM)
+	{
+		LOGE("invalid mode");
+		return 0;
+	}
+
+	// the totals only include the committed writes so
+	// the write-behind queue is not drained
+	bfs_file_lockRead(self, tid);
+
+	bfs_conn_t*   conn = &self->conn[tid];
+	sqlite3_stmt* stmt = conn->stmt_blob_total;
+
+	int ret = 1;
+	if(sqlite3_step(stmt) == SQLITE_ROW)
+	{
+		if(_count)
+		{
+			*_count = (uint64_t) sqlite3_column_int64(stmt, 0);
+		}
+
+		if(_bytes)
+		{
+			*_bytes = (uint64_t) sqlite3_column_int64(stmt, 1);
+		}
+	}
+	else
+	{
+		LOGE("sqlite3_step: %s", sqlite3_errmsg(conn->db));
+		ret = 0;
+	}
+
+	if(sqlite3_reset(stmt) != SQLITE_OK)
+	{
+		LOGW("sqlite3_reset failed");
+	}
+
+	bfs_file_unlockRead(self, tid);
+
+	return ret;
+}
+
+static int
+bfs_file_blobListStep(bfs_file_t* self, bfs_conn_t* conn,
+                      sqlite3_stmt* stmt, void* priv,
+                      bfs_blob_fn blob_fn)
+{
+	// priv may be NULL
+	ASSERT(self);
+	ASSERT(conn);
+	ASSERT(stmt);
+	ASSERT(blob_fn);
+
+	int ret  = 1;
+	int step = sqlite3_step(stmt);
+	while(step == SQLITE_ROW)
+	{
+		size_t      size;
+		const char* name;
+		name = (const char*) sqlite3_column_text(stmt, 0);
+		size = (size_t) sqlite3_column_int64(stmt, 1);
+		ret &= (*blob_fn)(priv, name, size);
+		step = sqlite3_step(stmt);
+	}
+
+	if(step != SQLITE_DONE)
+	{
+		LOGE("sqlite3_step: %s", sqlite3_errmsg(conn->db));
+		ret = 0;
+	}
+
+	if(sqlite3_reset(stmt) != SQLITE_OK)
+	{
+		LOGW("sqlite3_reset failed");
+	}
+
+	return ret;
+}
+
+static int
+bfs_file_blobListRange(sqlite3_stmt* stmt,
+                       int idx_lo, int idx_hi,
+                       const char* prefix, size_t len,
+                       const char* after, char** _hi)
+{
+	// after may be NULL
+	ASSERT(stmt);
+	ASSERT(prefix);
+	ASSERT(_hi);
+
+	// names which start with prefix are in the range
+	// [prefix, hi) where hi is the prefix with trailing
+	// 0xFF bytes removed and the last byte incremented
+	// (the comparisons are memcmp for the BINARY collation)
+	char* hi = (char*) MALLOC(len + 1);
+	if(hi == NULL)
+	{
+		LOGE("MALLOC failed");
+		return 0;
+	}
+	memcpy(hi, prefix, len);
+
+	size_t hi_len = len;
+	while(hi_len && (((unsigned char) hi[hi_len - 1]) == 0xFF))
+	{
+		--hi_len;
+	}
+
+	if(hi_len)
+	{
+		hi[hi_len - 1] = (char) (((unsigned char) hi[hi_len - 1]) + 1);
+	}
+	hi[hi_len] = '\0';
+
+	// the names are TEXT which compare less than any BLOB
+	// so an empty BLOB removes the upper bound
+	int ret;
+	if(hi_len)
+	{
+		ret = sqlite3_bind_text(stmt, idx_hi, hi, (int) hi_len,
+		                        SQLITE_STATIC);
+	}
+	else
+	{
+		ret = sqlite3_bind_zeroblob(stmt, idx_hi, 0);
+	}
+
+	// after replaces the prefix as the lower bound when
+	// resuming a listing and is copied since it may be
+	// stored in the page (see bfs_file_blobListPage)
+	if(ret == SQLITE_OK)
+	{
+		if(after)
+		{
+			ret = sqlite3_bind_text(stmt, idx_lo, after, -1,
+			                        SQLITE_TRANSIENT);
+		}
+		else
+		{
+			ret = sqlite3_bind_text(stmt, idx_lo, prefix,
+			                        (int) len, SQLITE_STATIC);
+		}
+	}
+
+	if(ret != SQLITE_OK)
+	{
+		LOGE("sqlite3_bind_text: prefix=%s", prefix);
+		FREE(hi);
+		return 0;
+	}
+
+	// hi must remain valid until the statement is reset
+	*_hi = hi;
+
+	return 1;
+}
+
+static int
+bfs_blobPage_add(bfs_blobPage_t* self, const char* name,
+                 size_t size)
+{
+	ASSERT(self);
+	ASSERT(name);
+
+	if(self->count >= self->entries)
+	{
+		int entries = 2*self->entries;
+		if(entries == 0)
+		{
+			entries = 64;
+		}
+
+		size_t* sizes;
+		sizes = (size_t*)
+		        REALLOC(self->sizes, entries*sizeof(size_t));
+		if(sizes == NULL)
+		{
+			LOGE("REALLOC failed");
+			return 0;
+		}
+		self->sizes = sizes;
+
+		size_t* offsets;
+		offsets = (size_t*)
+		          REALLOC(self->offsets, entries*sizeof(size_t));
+		if(offsets == NULL)
+		{
+			LOGE("REALLOC failed");
+			return 0;
+		}
+		self->offsets = offsets;
+		self->entries = entries;
+	}
+
+	// names are stored by offset since names may move
+	size_t len = strlen(name) + 1;
+	if(self->names_len + len > self->names_size)
+	{
+		size_t names_size = 2*self->names_size;
+		if(names_size == 0)
+		{
+			names_size = 4096;
+		}
+
+		while(self->names_len + len > names_size)
+		{
+			names_size *= 2;
+		}
+
+		char* names;
+		names = (char*) REALLOC(self->names, names_size);
+		if(names == NULL)
+		{
+			LOGE("REALLOC failed");
+			return 0;
+		}
+		self->names      = names;
+		self->names_size = names_size;
+	}
+
+	memcpy(self->names + self->names_len, name, len);
+	self->sizes[self->count]   = size;
+	self->offsets[self->count] = self->names_len;
+	self->names_len += len;
+	++self->count;
+
+	return 1;
+}
+
+static int bfs_fileExists(const char* fname)
+{
+	ASSERT(fname);
+
+	if(access(fname, F_OK) != 0)
+	{
+		return 0;
+	}
+	return 1;
+}
+
+static int
+bfs_file_journalMode(void* priv, int argc, char** argv,
+                     char** cols)
+{
+	ASSERT(priv);
+
+	char* mode = (char*) priv;
+	if((argc == 1) && argv[0])
+	{
+		snprintf(mode, 16, "%s", argv[0]);
+	}
+
+	return 0;
+}
+
+static int
+bfs_file_pragma(sqlite3* db, const char* sql)
+{
+	ASSERT(db);
+	ASSERT(sql);
+
+	if(sqlite3_exec(db, sql, NULL, NULL, NULL) != SQLITE_OK)
+	{
+		LOGE("sqlite3_exec: sql=%s, msg=%s",
+		     sql, sqlite3_errmsg(db));
+		return 0;
+	}
+
+	return 1;
+}
+
+static int
+bfs_conn_pragmas(sqlite3* db, const bfs_options_t* opts)
+{
+	ASSERT(db);
+	ASSERT(opts);
+
+	const char* temp_store[] =
+	{
+		NULL,
+		"FILE",
+		"MEMORY",
+	};
+
+	char sql[256];
+	if(opts->cache_size)
+	{
+		snprintf(sql, 256, "PRAGMA cache_size=%i;",
+		         opts->cache_size);
+		if(bfs_file_pragma(db, sql) == 0)
+		{
+			return 0;
+		}
+	}
+
+	if(opts->mmap_size)
+	{
+		snprintf(sql, 256, "PRAGMA mmap_size=%" PRIu64 ";",
+		         (uint64_t) opts->mmap_size);
+		if(bfs_file_pragma(db, sql) == 0)
+		{
+			return 0;
+		}
+	}
+
+	if(opts->temp_store)
+	{
+		snprintf(sql, 256, "PRAGMA temp_store=%s;",
+		         temp_store[opts->temp_store]);
+		if(bfs_file_pragma(db, sql) == 0)
+		{
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+static int
+bfs_file_pragmas(bfs_file_t* self,
+                 const bfs_options_t* opts,
+                 int create)
+{
+	ASSERT(self);
+	ASSERT(opts);
+
+	const char* journal[] =
+	{
+		NULL,
+		"DELETE",
+		"TRUNCATE",
+		"PERSIST",
+		"MEMORY",
+		"WAL",
+		"OFF",
+	};
+
+	const char* synchronous[] =
+	{
+		NULL,
+		"OFF",
+		"NORMAL",
+		"FULL",
+		"EXTRA",
+	};
+
+	// the page size must be set before the tables are
+	// created and is ignored for existing files
+	char sql[256];
+	if(create && opts->page_size)
+	{
+		snprintf(sql, 256, "PRAGMA page_size=%i;",
+		         opts->page_size);
+		if(bfs_file_pragma(self->db, sql) == 0)
+		{
+			return 0;
+		}
+	}
+
+	if(bfs_conn_pragmas(self->db, opts) == 0)
+	{
+		return 0;
+	}
+
+	// the journal and synchronous modes only affect writes
+	if(opts->mode == BFS_MODE_RDONLY)
+	{
+		return 1;
+	}
+
+	// REPLACE must fire the delete triggers which
+	// remove the chunks of a replaced blob
+	if(bfs_file_pragma(self->db,
+	                   "PRAGMA recursive_triggers=ON;") == 0)
+	{
+		return 0;
+	}
+
+	// WAL is the default for the read-write mode since it
+	// is persistent and readers never block the writer
+	// (or each other) once enabled
+	bfs_journal_e journal_mode = opts->journal_mode;
+	if((journal_mode == BFS_JOURNAL_DEFAULT) &&
+	   (opts->mode == BFS_MODE_RDWR))
+	{
+		journal_mode = BFS_JOURNAL_WAL;
+	}
+
+	// query the journal mode when not specified
+	char mode[16] = "";
+	if(journal_mode)
+	{
+		snprintf(sql, 256, "PRAGMA journal_mode=%s;",
+		         journal[journal_mode]);
+	}
+	else
+	{
+		snprintf(sql, 256, "PRAGMA journal_mode;");
+	}
+
+	if(sqlite3_exec(self->db, sql,
+	                bfs_file_journalMode, mode,
+	                NULL) != SQLITE_OK)
+	{
+		LOGE("sqlite3_exec: sql=%s, msg=%s",
+		     sql, sqlite3_errmsg(self->db));
+		return 0;
+	}
+
+	if(journal_mode &&
+	   (strcasecmp(mode, journal[journal_mode]) != 0))
+	{
+		LOGW("unsupported journal_mode=%s, mode=%s",
+		     journal[journal_mode], mode);
+	}
+
+	// WAL readers are isolated from the writer while the
+	// other journal modes require readers to be excluded
+	// when the writer commits
+	self->wal = (strcasecmp(mode, "WAL") == 0);
+
+	if(opts->synchronous)
+	{
+		snprintf(sql, 256, "PRAGMA synchronous=%s;",
+		         synchronous[opts->synchronous]);
+		if(bfs_file_pragma(self->db, sql) == 0)
+		{
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+static int
+bfs_file_version(sqlite3* db, int* _version)
+{
+	ASSERT(db);
+	ASSERT(_version);
+
+	sqlite3_stmt* stmt;
+	if(sqlite3_prepare_v2(db, "PRAGMA user_version;", -1,
+	                      &stmt, NULL) != SQLITE_OK)
+	{
+		LOGE("sqlite3_prepare_v2: %s", sqlite3_errmsg(db));
+		return 0;
+	}
+
+	int ret = 1;
+	if(sqlite3_step(stmt) == SQLITE_ROW)
+	{
+		*_version = sqlite3_column_int(stmt, 0);
+	}
+	else
+	{
+		LOGE("sqlite3_step: %s", sqlite3_errmsg(db));
+		ret = 0;
+	}
+
+	sqlite3_finalize(stmt);
+
+	return ret;
+}
+
+static int
+bfs_file_metaLast(sqlite3* db, sqlite3_int64* _bid)
+{
+	ASSERT(db);
+	ASSERT(_bid);
+
+	sqlite3_stmt* stmt;
+	if(sqlite3_prepare_v2(db, "SELECT ifnull(max(bid), 0) FROM tbl_meta;",
+	                      -1, &stmt, NULL) != SQLITE_OK)
+	{
+		LOGE("sqlite3_prepare_v2: %s", sqlite3_errmsg(db));
+		return 0;
+	}
+
+	int ret = 1;
+	if(sqlite3_step(stmt) == SQLITE_ROW)
+	{
+		*_bid = sqlite3_column_int64(stmt, 0);
+	}
+	else
+	{
+		LOGE("sqlite3_step: %s", sqlite3_errmsg(db));
+		ret = 0;
+	}
+
+	sqlite3_finalize(stmt);
+
+	return ret;
+}
+
+static int
+bfs_file_upgradeTables(bfs_file_t* self, int version)
+{
+	ASSERT(self);
+
+	// sql_upgrade[v] upgrades from version v to v + 1
+	const char* sql_v1[] =
+	{
+		"CREATE TABLE tbl_chunk"
+		"("
+		"   bid  INTEGER NOT NULL,"
+		"   pos  INTEGER NOT NULL,"
+		"   data BLOB"
+		");",
+		"CREATE UNIQUE INDEX idx_chunk"
+		"   ON tbl_chunk (bid, pos);",
+		"CREATE TRIGGER trg_blob_delete"
+		"   AFTER DELETE ON tbl_blob WHEN old.blob IS NULL"
+		"   BEGIN"
+		"      DELETE FROM tbl_chunk WHERE bid=old.rowid;"
+		"   END;",
+		NULL
+	};
+
+	// blobs are replaced in place to preserve the rowid
+	// (see bfs_file_blobLookup) so updates must also
+	// remove the chunks of a replaced blob
+	const char* sql_v2[] =
+	{
+		"CREATE TRIGGER trg_blob_update"
+		"   AFTER UPDATE OF blob ON tbl_blob WHEN old.blob IS NULL"
+		"   BEGIN"
+		"      DELETE FROM tbl_chunk WHERE bid=old.rowid;"
+		"   END;",
+		NULL
+	};
+
+	// the blob metadata and totals are written by the
+	// writer (see bfs_file_metaSet) while deletes are
+	// handled by triggers which include the blobs replaced
+	// by the stream mode (cid is reserved for content
+	// addressing)
+	const char* sql_v3[] =
+	{
+		"CREATE TABLE tbl_meta"
+		"("
+		"   bid   INTEGER PRIMARY KEY,"
+		"   size  INTEGER NOT NULL,"
+		"   mtime INTEGER NOT NULL,"
+		"   cid   INTEGER"
+		");",
+		"CREATE TABLE tbl_total"
+		"("
+		"   count INTEGER NOT NULL,"
+		"   bytes INTEGER NOT NULL"
+		");",
+		"INSERT INTO tbl_meta (bid, size, mtime)"
+		"   SELECT rowid, " SQL_BLOB_SIZE ", " SQL_META_MTIME
+		"   FROM tbl_blob;",
+		"INSERT INTO tbl_total (count, bytes)"
+		"   SELECT count(*), ifnull(sum(size), 0) FROM tbl_meta;",
+		"CREATE TRIGGER trg_meta_delete"
+		"   AFTER DELETE ON tbl_blob"
+		"   BEGIN"
+		"      DELETE FROM tbl_meta WHERE bid=old.rowid;"
+		"   END;",
+		"CREATE TRIGGER trg_total_delete"
+		"   AFTER DELETE ON tbl_meta"
+		"   BEGIN"
+		"      UPDATE tbl_total SET count=count - 1,"
+		"                           bytes=bytes - old.size;"
+		"   END;",
+		NULL
+	};
+
+	// the codec columns of existing blobs are NULL which
+	// selects the uncompressed data
+	const char* sql_v4[] =
+	{
+		"ALTER TABLE tbl_blob ADD COLUMN codec INTEGER;",
+		"ALTER TABLE tbl_blob ADD COLUMN raw_size INTEGER;",
+		NULL
+	};
+
+	// identical inline blobs may be stored once by
+	// tbl_content which is referenced by the tbl_meta cid
+	// while the triggers count the references and delete
+	// the unreferenced content
+	const char* sql_v5[] =
+	{
+		"CREATE TABLE tbl_content"
+		"("
+		"   cid      INTEGER PRIMARY KEY,"
+		"   hash     BLOB NOT NULL,"
+		"   refs     INTEGER NOT NULL,"
+		"   data     BLOB,"
+		"   codec    INTEGER,"
+		"   raw_size INTEGER"
+		");",
+		"CREATE UNIQUE INDEX idx_content_hash"
+		"   ON tbl_content (hash);",
+		"CREATE TRIGGER trg_content_insert"
+		"   AFTER INSERT ON tbl_meta WHEN new.cid IS NOT NULL"
+		"   BEGIN"
+		"      UPDATE tbl_content SET refs=refs + 1"
+		"         WHERE cid=new.cid;"
+		"   END;",
+		"CREATE TRIGGER trg_content_update"
+		"   AFTER UPDATE OF cid ON tbl_meta"
+		"   WHEN old.cid IS NOT new.cid"
+		"   BEGIN"
+		"      UPDATE tbl_content SET refs=refs + 1"
+		"         WHERE cid=new.cid;"
+		"      UPDATE tbl_content SET refs=refs - 1"
+		"         WHERE cid=old.cid;"
+		"      DELETE FROM tbl_content"
+		"         WHERE cid=old.cid AND refs=0;"
+		"   END;",
+		"CREATE TRIGGER trg_content_delete"
+		"   AFTER DELETE ON tbl_meta WHEN old.cid IS NOT NULL"
+		"   BEGIN"
+		"      UPDATE tbl_content SET refs=refs - 1"
+		"         WHERE cid=old.cid;"
+		"      DELETE FROM tbl_content"
+		"         WHERE cid=old.cid AND refs=0;"
+		"   END;",
+		NULL
+	};
+
+	// the crc of existing blobs is NULL which skips the
+	// verification (see bfs_file_verify)
+	const char* sql_v6[] =
+	{
+		"ALTER TABLE tbl_blob ADD COLUMN crc INTEGER;",
+		NULL
+	};
+
+	const char** sql_upgrade[BFS_VERSION] =
+	{
+		sql_v1,
+		sql_v2,
+		sql_v3,
+		sql_v4,
+		sql_v5,
+		sql_v6,
+	};
+
+	if(bfs_file_pragma(self->db, "BEGIN;") == 0)
+	{
+		return 0;
+	}
+
+	int v;
+	for(v = version; v < BFS_VERSION; ++v)
+	{
+		const char** sql_init = sql_upgrade[v];
+
+		int i = 0;
+		while(sql_init[i])
+		{
+			if(sqlite3_exec(self->db, sql_init[i], NULL, NULL,
+			                NULL) != SQLITE_OK)
+			{
+				LOGE("sqlite3_exec(%i, %i): %s",
+				     v, i, sqlite3_errmsg(self->db));
+				goto fail_exec;
+			}
+			++i;
+		}
+	}
+
+	char sql[256];
+	snprintf(sql, 256, "PRAGMA user_version=%i;", BFS_VERSION);
+	if(bfs_file_pragma(self->db, sql) == 0)
+	{
+		goto fail_exec;
+	}
+
+	if(bfs_file_pragma(self->db, "COMMIT;") == 0)
+	{
+		goto fail_exec;
+	}
+
+	// success
+	return 1;
+
+	// failure
+	fail_exec:
+		bfs_file_pragma(self->db, "ROLLBACK;");
+	return 0;
+}
+
+static int
+bfs_file_shadowTables(sqlite3* db, int version)
+{
+	ASSERT(db);
+
+	// read-only files may not be upgraded so the missing
+	// tables are shadowed by empty temporary tables which
+	// allows the same statements to be prepared
+	const char* sql_v1[] =
+	{
+		"CREATE TEMP TABLE tbl_chunk"
+		"("
+		"   bid  INTEGER NOT NULL,"
+		"   pos  INTEGER NOT NULL,"
+		"   data BLOB"
+		");",
+		NULL
+	};
+
+	// triggers are not required by readers
+	const char* sql_v2[] =
+	{
+		NULL
+	};
+
+	// the metadata and totals are computed by views which
+	// scan the blobs
+	const char* sql_v3[] =
+	{
+		"CREATE TEMP VIEW tbl_meta AS"
+		"   SELECT rowid AS bid, " SQL_BLOB_SIZE " AS size,"
+		"          0 AS mtime, NULL AS cid FROM tbl_blob;",
+		"CREATE TEMP VIEW tbl_total AS"
+		"   SELECT count(*) AS count,"
+		"          ifnull(sum(size), 0) AS bytes FROM tbl_meta;",
+		NULL
+	};
+
+	// columns may not be shadowed so the readers select
+	// NULL codec columns instead (see bfs_conn_open)
+	const char* sql_v4[] =
+	{
+		NULL
+	};
+
+	const char* sql_v5[] =
+	{
+		"CREATE TEMP TABLE tbl_content"
+		"("
+		"   cid      INTEGER PRIMARY KEY,"
+		"   hash     BLOB NOT NULL,"
+		"   refs     INTEGER NOT NULL,"
+		"   data     BLOB,"
+		"   codec    INTEGER,"
+		"   raw_size INTEGER"
+		");",
+		NULL
+	};
+
+	// the readers select a NULL crc instead
+	const char* sql_v6[] =
+	{
+		NULL
+	};
+
+	const char** sql_shadow[BFS_VERSION] =
+	{
+		sql_v1,
+		sql_v2,
+		sql_v3,
+		sql_v4,
+		sql_v5,
+		sql_v6,
+	};
+
+	int v;
+	for(v = version; v < BFS_VERSION; ++v)
+	{
+		const char** sql_init = sql_shadow[v];
+
+		int i = 0;
+		while(sql_init[i])
+		{
+			if(sqlite3_exec(db, sql_init[i], NULL, NULL,
+			                NULL) != SQLITE_OK)
+			{
+				LOGE("sqlite3_exec(%i, %i): %s",
+				     v, i, sqlite3_errmsg(db));
+				return 0;
+			}
+			++i;
+		}
+	}
+
+	return 1;
+}
+
+static int
+bfs_conn_open(bfs_conn_t* self, const char* fname,
+              const bfs_options_t* opts, int version)
+{
+	ASSERT(self);
+	ASSERT(fname);
+	ASSERT(opts);
+
+	// each connection is only used by a single tid so the
+	// sqlite3 connection mutex is not required
+	int flags = SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX;
+	if(sqlite3_open_v2(fname, &self->db, flags,
+	                   NULL) != SQLITE_OK)
+	{
+		LOGE("sqlite3_open_v2 %s failed", fname);
+		goto fail_db_open;
+	}
+
+	sqlite3_busy_timeout(self->db, BUSY_TIMEOUT);
+
+	if(bfs_conn_pragmas(self->db, opts) == 0)
+	{
+		goto fail_pragmas;
+	}
+
+	if((version < BFS_VERSION) &&
+	   (bfs_file_shadowTables(self->db, version) == 0))
+	{
+		goto fail_pragmas;
+	}
+
+	const char* sql_begin = "BEGIN;";
+	if(sqlite3_prepare_v2(self->db, sql_begin, -1,
+	                      &self->stmt_begin,
+	                      NULL) != SQLITE_OK)
+	{
+		LOGE("sqlite3_prepare_v2: %s",
+		     sqlite3_errmsg(self->db));
+		goto fail_prepare_begin;
+	}
+
+	const char* sql_end = "END;";
+	if(sqlite3_prepare_v2(self->db, sql_end, -1,
+	                      &self->stmt_end,
+	                      NULL) != SQLITE_OK)
+	{
+		LOGE("sqlite3_prepare_v2: %s",
+		     sqlite3_errmsg(self->db));
+		goto fail_prepare_end;
+	}
+
+	const char* sql_attr_list;
+	sql_attr_list = "SELECT key, val FROM tbl_attr;";
+	if(sqlite3_prepare_v2(self->db, sql_attr_list, -1,
+	                      &self->stmt_attr_list,
+	                      NULL) != SQLITE_OK)
+	{
+		LOGE("sqlite3_prepare_v2: %s",
+		     sqlite3_errmsg(self->db));
+		goto fail_prepare_attr_list;
+	}
+
+	const char* sql_attr_get;
+	sql_attr_get = "SELECT val FROM tbl_attr"
+	               "   WHERE key=@arg_key;";
+	if(sqlite3_prepare_v2(self->db, sql_attr_get, -1,
+	                      &self->stmt_attr_get,
+	                      NULL) != SQLITE_OK)
+	{
+		LOGE("sqlite3_prepare_v2: %s",
+		     sqlite3_errmsg(self->db));
+		goto fail_prepare_attr_get;
+	}
+
+	const char* sql_blob_list;
+	sql_blob_list = SQL_BLOB_LIST ";";
+	if(sqlite3_prepare_v2(self->db, sql_blob_list, -1,
+	                      &self->stmt_blob_list,
+	                      NULL) != SQLITE_OK)
+	{
+		LOGE("sqlite3_prepare_v2: %s",
+		     sqlite3_errmsg(self->db));
+		goto fail_prepare_blob_list;
+	}
+
+	const char* sql_blob_like;
+	sql_blob_like = SQL_BLOB_LIST
+	                "   WHERE name LIKE @arg_pat;";
+	if(sqlite3_prepare_v2(self->db, sql_blob_like, -1,
+	                      &self->stmt_blob_like,
+	                      NULL) != SQLITE_OK)
+	{
+		LOGE("sqlite3_prepare_v2: %s",
+		     sqlite3_errmsg(self->db));
+		goto fail_prepare_blob_like;
+	}
+
+	// the name range allows the search to use idx_blob_name
+	// (see bfs_file_blobListRange)
+	const char* sql_blob_range;
+	sql_blob_range = SQL_BLOB_LIST
+	                 "   WHERE name>=@arg_lo AND name<@arg_hi"
+	                 "   ORDER BY name;";
+	if(sqlite3_prepare_v2(self->db, sql_blob_range, -1,
+	                      &self->stmt_blob_range,
+	                      NULL) != SQLITE_OK)
+	{
+		LOGE("sqlite3_prepare_v2: %s",
+		     sqlite3_errmsg(self->db));
+		goto fail_prepare_blob_range;
+	}
+
+	const char* sql_blob_glob;
+	sql_blob_glob = SQL_BLOB_LIST
+	                "   WHERE name>=@arg_lo AND name<@arg_hi AND"
+	                "         name GLOB @arg_pat"
+	                "   ORDER BY name;";
+	if(sqlite3_prepare_v2(self->db, sql_blob_glob, -1,
+	                      &self->stmt_blob_glob,
+	                      NULL) != SQLITE_OK)
+	{
+		LOGE("sqlite3_prepare_v2: %s",
+		     sqlite3_errmsg(self->db));
+		goto fail_prepare_blob_glob;
+	}
+
+	// the first page includes the lower bound while the
+	// next page excludes the last name of the prior page
+	const char* sql_blob_page;
+	sql_blob_page = SQL_BLOB_LIST
+	                "   WHERE name>=@arg_lo AND name<@arg_hi"
+	                "   ORDER BY name LIMIT @arg_limit;";
+	if(sqlite3_prepare_v2(self->db, sql_blob_page, -1,
+	                      &self->stmt_blob_page,
+	                      NULL) != SQLITE_OK)
+	{
+		LOGE("sqlite3_prepare_v2: %s",
+		     sqlite3_errmsg(self->db));
+		goto fail_prepare_blob_page;
+	}
+
+	const char* sql_blob_next;
+	sql_blob_next = SQL_BLOB_LIST
+	                "   WHERE name>@arg_lo AND name<@arg_hi"
+	                "   ORDER BY name LIMIT @arg_limit;";
+	if(sqlite3_prepare_v2(self->db, sql_blob_next, -1,
+	                      &self->stmt_blob_next,
+	                      NULL) != SQLITE_OK)
+	{
+		LOGE("sqlite3_prepare_v2: %s",
+		     sqlite3_errmsg(self->db));
+		goto fail_prepare_blob_next;
+	}
+
+	// older files do not have the codec and crc columns
+	// which are only added by the upgrade while tbl_content
+	// may be shadowed (see bfs_file_shadowTables) and the
+	// crc is only selected to verify the blobs
+	int verify = opts->verify && (version >= 6);
+
+	const char* sql_blob_get;
+	if(version < 4)
+	{
+		sql_blob_get = "SELECT rowid, blob, NULL, NULL, NULL"
+		               "   FROM tbl_blob WHERE name=@arg_name;";
+	}
+	else if(verify == 0)
+	{
+		sql_blob_get = "SELECT rowid, ifnull(blob, " SQL_BLOB_CONTENT "),"
+		               "   codec, raw_size, NULL"
+		               "   FROM tbl_blob WHERE name=@arg_name;";
+	}
+	else
+	{
+		sql_blob_get = "SELECT rowid, ifnull(blob, " SQL_BLOB_CONTENT "),"
+		               "   codec, raw_size, crc"
+		               "   FROM tbl_blob WHERE name=@arg_name;";
+	}
+	if(sqlite3_prepare_v2(self->db, sql_blob_get, -1,
+	                      &self->stmt_blob_get,
+	                      NULL) != SQLITE_OK)
+	{
+		LOGE("sqlite3_prepare_v2: %s",
+		     sqlite3_errmsg(self->db));
+		goto fail_prepare_blob_get;
+	}
+
+	const char* sql_blob_rowid;
+	if(version < 4)
+	{
+		sql_blob_rowid = "SELECT rowid, blob IS NULL, NULL, NULL, NULL, NULL"
+		                 "   FROM tbl_blob WHERE name=@arg_name;";
+	}
+	else if(verify == 0)
+	{
+		sql_blob_rowid = "SELECT rowid, blob IS NULL AND codec IS NULL,"
+		                 "   codec, raw_size,"
+		                 "   CASE WHEN blob IS NULL THEN " SQL_BLOB_CID " END,"
+		                 "   NULL"
+		                 "   FROM tbl_blob WHERE name=@arg_name;";
+	}
+	else
+	{
+		sql_blob_rowid = "SELECT rowid, blob IS NULL AND codec IS NULL,"
+		                 "   codec, raw_size,"
+		                 "   CASE WHEN blob IS NULL THEN " SQL_BLOB_CID " END,"
+		                 "   crc"
+		                 "   FROM tbl_blob WHERE name=@arg_name;";
+	}
+	if(sqlite3_prepare_v2(self->db, sql_blob_rowid, -1,
+	                      &self->stmt_blob_rowid,
+	                      NULL) != SQLITE_OK)
+	{
+		LOGE("sqlite3_prepare_v2: %s",
+		     sqlite3_errmsg(self->db));
+		goto fail_prepare_blob_rowid;
+	}
+
+	const char* sql_blob_byid;
+	if(version < 4)
+	{
+		sql_blob_byid = "SELECT rowid, blob, NULL, NULL, NULL"
+		                "   FROM tbl_blob WHERE rowid=@arg_bid;";
+	}
+	else if(verify == 0)
+	{
+		sql_blob_byid = "SELECT rowid, ifnull(blob, " SQL_BLOB_CONTENT "),"
+		                "   codec, raw_size, NULL"
+		                "   FROM tbl_blob WHERE rowid=@arg_bid;";
+	}
+	else
+	{
+		sql_blob_byid = "SELECT rowid, ifnull(blob, " SQL_BLOB_CONTENT "),"
+		                "   codec, raw_size, crc"
+		                "   FROM tbl_blob WHERE rowid=@arg_bid;";
+	}
+	if(sqlite3_prepare_v2(self->db, sql_blob_byid, -1,
+	                      &self->stmt_blob_byid,
+	                      NULL) != SQLITE_OK)
+	{
+		LOGE("sqlite3_prepare_v2: %s",
+		     sqlite3_errmsg(self->db));
+		goto fail_prepare_blob_byid;
+	}
+
+	// the data is only selected for the blobs with a crc
+	// and older files do not have any crc
+	const char* sql_blob_verify;
+	if(version < 6)
+	{
+		sql_blob_verify = "SELECT rowid, name, NULL, 0, NULL, NULL, NULL"
+		                  "   FROM tbl_blob"
+		                  "   WHERE rowid>=@arg_lo AND rowid<@arg_hi;";
+	}
+	else
+	{
+		sql_blob_verify = "SELECT rowid, name, crc,"
+		                  "   blob IS NULL AND codec IS NULL,"
+		                  "   CASE WHEN crc IS NOT NULL THEN"
+		                  "      ifnull(blob, " SQL_BLOB_CONTENT ") END,"
+		                  "   codec, raw_size"
+		                  "   FROM tbl_blob"
+		                  "   WHERE rowid>=@arg_lo AND rowid<@arg_hi;";
+	}
+	if(sqlite3_prepare_v2(self->db, sql_blob_verify, -1,
+	                      &self->stmt_blob_verify,
+	                      NULL) != SQLITE_OK)
+	{
+		LOGE("sqlite3_prepare_v2: %s",
+		     sqlite3_errmsg(self->db));
+		goto fail_prepare_blob_verify;
+	}
+
+	const char* sql_blob_total;
+	sql_blob_total = "SELECT count, bytes FROM tbl_total;";
+	if(sqlite3_prepare_v2(self->db, sql_blob_total, -1,
+	                      &self->stmt_blob_total,
+	                      NULL) != SQLITE_OK)
+	{
+		LOGE("sqlite3_prepare_v2: %s",
+		     sqlite3_errmsg(self->db));
+		goto fail_prepare_blob_total;
+	}
+
+	const char* sql_chunk_list;
+	sql_chunk_list = "SELECT pos, data FROM tbl_chunk"
+	                 "   WHERE bid=@arg_bid ORDER BY pos;";
+	if(sqlite3_prepare_v2(self->db, sql_chunk_list, -1,
+	                      &self->stmt_chunk_list,
+	                      NULL) != SQLITE_OK)
+	{
+		LOGE("sqlite3_prepare_v2: %s",
+		     sqlite3_errmsg(self->db));
+		goto fail_prepare_chunk_list;
+	}
+
+	if(sqlite3_prepare_v2(self->db, SQL_CHUNK_FIND, -1,
+	                      &self->stmt_chunk_find,
+	                      NULL) != SQLITE_OK)
+	{
+		LOGE("sqlite3_prepare_v2: %s",
+		     sqlite3_errmsg(self->db));
+		goto fail_prepare_chunk_find;
+	}
+
+	if(sqlite3_prepare_v2(self->db, SQL_CHUNK_SIZE, -1,
+	                      &self->stmt_chunk_size,
+	                      NULL) != SQLITE_OK)
+	{
+		LOGE("sqlite3_prepare_v2: %s",
+		     sqlite3_errmsg(self->db));
+		goto fail_prepare_chunk_size;
+	}
+
+	// success
+	return 1;
+
+	// failure
+	fail_prepare_chunk_size:
+		sqlite3_finalize(self->stmt_chunk_find);
+	fail_prepare_chunk_find:
+		sqlite3_finalize(self->stmt_chunk_list);
+	fail_prepare_chunk_list:
+		sqlite3_finalize(self->stmt_blob_total);
+	fail_prepare_blob_total:
+		sqlite3_finalize(self->stmt_blob_verify);
+	fail_prepare_blob_verify:
+		sqlite3_finalize(self->stmt_blob_byid);
+	fail_prepare_blob_byid:
+		sqlite3_finalize(self->stmt_blob_rowid);
+	fail_prepare_blob_rowid:
+		sqlite3_finalize(self->stmt_blob_get);
+	fail_prepare_blob_get:
+		sqlite3_finalize(self->stmt_blob_next);
+	fail_prepare_blob_next:
+		sqlite3_finalize(self->stmt_blob_page);
+	fail_prepare_blob_page:
+		sqlite3_finalize(self->stmt_blob_glob);
+	fail_prepare_blob_glob:
+		sqlite3_finalize(self->stmt_blob_range);
+	fail_prepare_blob_range:
+		sqlite3_finalize(self->stmt_blob_like);
+	fail_prepare_blob_like:
+		sqlite3_finalize(self->stmt_blob_list);
+	fail_prepare_blob_list:
+		sqlite3_finalize(self->stmt_attr_get);
+	fail_prepare_attr_get:
+		sqlite3_finalize(self->stmt_attr_list);
+	fail_prepare_attr_list:
+		sqlite3_finalize(self->stmt_end);
+	fail_prepare_end:
+		sqlite3_finalize(self->stmt_begin);
+	fail_prepare_begin:
+	fail_pragmas:
+	fail_db_open:
+	{
+		if(sqlite3_close_v2(self->db) != SQLITE_OK)
+		{
+			LOGW("sqlite3_close_v2 failed");
+		}
+		self->db = NULL;
+	}
+	return 0;
+}
+
+static void bfs_conn_close(bfs_conn_t* self)
+{
+	ASSERT(self);
+
+	sqlite3_finalize(self->stmt_chunk_size);
+	sqlite3_finalize(self->stmt_chunk_find);
+	sqlite3_finalize(self->stmt_chunk_list);
+	sqlite3_finalize(self->stmt_blob_total);
+	sqlite3_finalize(self->stmt_blob_verify);
+	sqlite3_finalize(self->stmt_blob_byid);
+	sqlite3_finalize(self->stmt_blob_rowid);
+	sqlite3_finalize(self->stmt_blob_get);
+	sqlite3_finalize(self->stmt_blob_next);
+	sqlite3_finalize(self->stmt_blob_page);
+	sqlite3_finalize(self->stmt_blob_glob);
+	sqlite3_finalize(self->stmt_blob_range);
+	sqlite3_finalize(self->stmt_blob_like);
+	sqlite3_finalize(self->stmt_blob_list);
+	sqlite3_finalize(self->stmt_attr_get);
+	sqlite3_finalize(self->stmt_attr_list);
+	sqlite3_finalize(self->stmt_end);
+	sqlite3_finalize(self->stmt_begin);
+
+	if(sqlite3_close_v2(self->db) != SQLITE_OK)
+	{
+		LOGW("sqlite3_close_v2 failed");
+	}
+	self->db = NULL;
+}
+
+static int bfs_file_attrsLoad(bfs_file_t* self)
+{
+	ASSERT(self);
+
+	self->attrs_retired = (bfs_attrs_t**)
+	                      CALLOC(self->nth + 1,
+	                             sizeof(bfs_attrs_t*));
+	if(self->attrs_retired == NULL)
+	{
+		LOGE("CALLOC failed");
+		return 0;
+	}
+
+	// the rows reference the statement until it is reset
+	// so the keys and vals are copied into a single buffer
+	int     count = 0;
+	int     max   = 0;
+	size_t  bytes = 0;
+	size_t  size  = 0;
+	char*   buf   = NULL;
+	size_t* offs  = NULL;
+
+	// the file is not modified during open so the reader
+	// connection observes the latest state
+	bfs_conn_t*   conn = &self->conn[0];
+	sqlite3_stmt* stmt = conn->stmt_attr_list;
+	int           step = sqlite3_step(stmt);
+	while(step == SQLITE_ROW)
+	{
+		const char* key;
+		const char* val;
+		key = (const char*) sqlite3_column_text(stmt, 0);
+		val = (const char*) sqlite3_column_text(stmt, 1);
+		if((key == NULL) || (val == NULL))
+		{
+			step = sqlite3_step(stmt);
+			continue;
+		}
+
+		size_t klen = strlen(key) + 1;
+		size_t vlen = strlen(val) + 1;
+		if(bytes + klen + vlen > size)
+		{
+			size_t sz = 2*size + klen + vlen + 256;
+			char*  tmp = (char*) REALLOC(buf, sz);
+			if(tmp == NULL)
+			{
+				LOGE("REALLOC failed");
+				goto fail_row;
+			}
+			buf  = tmp;
+			size = sz;
+		}
+
+		if(count == max)
+		{
+			int     n   = 2*max + 16;
+			size_t* tmp = (size_t*)
+			              REALLOC(offs, 2*n*sizeof(size_t));
+			if(tmp == NULL)
+			{
+				LOGE("REALLOC failed");
+				goto fail_row;
+			}
+			offs = tmp;
+			max  = n;
+		}
+
+		// offsets are converted to pointers after the
+		// buffer is complete
+		offs[2*count]     = bytes;
+		offs[2*count + 1] = bytes + klen;
+		memcpy(&buf[bytes], key, klen);
+		memcpy(&buf[bytes + klen], val, vlen);
+		bytes += klen + vlen;
+		++count;
+
+		step = sqlite3_step(stmt);
+	}
+
+	if(step != SQLITE_DONE)
+	{
+		LOGE("sqlite3_step: %s", sqlite3_errmsg(conn->db));
+		goto fail_step;
+	}
+
+	if(sqlite3_reset(stmt) != SQLITE_OK)
+	{
+		LOGW("sqlite3_reset failed");
+	}
+
+	// convert the offsets to the keys and vals arrays
+	const char** keys = NULL;
+	const char** vals = NULL;
+	if(count)
+	{
+		keys = (const char**)
+		       CALLOC(2*count, sizeof(const char*));
+		if(keys == NULL)
+		{
+			LOGE("CALLOC failed");
+			goto fail_keys;
+		}
+		vals = &keys[count];
+
+		int i;
+		for(i = 0; i < count; ++i)
+		{
+			keys[i] = &buf[offs[2*i]];
+			vals[i] = &buf[offs[2*i + 1]];
+		}
+	}
+
+	self->attrs = bfs_attrs_new(count, keys, vals);
+	if(self->attrs == NULL)
+	{
+		goto fail_attrs;
+	}
+
+	FREE(keys);
+	FREE(offs);
+	FREE(buf);
+
+	// success
+	return 1;
+
+	// failure
+	fail_attrs:
+		FREE(keys);
+	fail_keys:
+	fail_step:
+	fail_row:
+	{
+		sqlite3_reset(stmt);
+		FREE(offs);
+		FREE(buf);
+		FREE(self->attrs_retired);
+	}
+	return 0;
+}
+
+static void bfs_file_attrsUnload(bfs_file_t* self)
+{
+	ASSERT(self);
+
+	int i;
+	for(i = 0; i < self->attrs_retired_count; ++i)
+	{
+		bfs_attrs_delete(&self->attrs_retired[i]);
+	}
+	self->attrs_retired_count = 0;
+
+	bfs_attrs_delete(&self->attrs_pending);
+	bfs_attrs_delete(&self->attrs);
+	FREE(self->attrs_retired);
+}
+
+static int
+bfs_file_blobLast(sqlite3* db, sqlite3_int64* _bid)
+{
+	ASSERT(db);
+	ASSERT(_bid);
+
+	sqlite3_stmt* stmt;
+	if(sqlite3_prepare_v2(db, "SELECT ifnull(max(rowid), 0) FROM tbl_blob;",
+	                      -1, &stmt, NULL) != SQLITE_OK)
+	{
+		LOGE("sqlite3_prepare_v2: %s", sqlite3_errmsg(db));
+		return 0;
+	}
+
+	int ret = 1;
+	if(sqlite3_step(stmt) == SQLITE_ROW)
+	{
+		*_bid = sqlite3_column_int64(stmt, 0);
+	}
+	else
+	{
+		LOGE("sqlite3_step: %s", sqlite3_errmsg(db));
+		ret = 0;
+	}
+
+	sqlite3_finalize(stmt);
+
+	return ret;
+}
+
+static int
+bfs_file_verifyRow(bfs_file_t* self, bfs_conn_t* conn,
+                   sqlite3_stmt* stmt, int64_t crc,
+                   size_t* _size, void** _tmp)
+{
+	ASSERT(self);
+	ASSERT(conn);
+	ASSERT(stmt);
+	ASSERT(_size);
+	ASSERT(_tmp);
+
+	// chunked and compressed blobs are assembled in the
+	// temporary buffer which is reused by the thread
+	size_t      size = 0;
+	const void* data = NULL;
+	if(sqlite3_column_int(stmt, 3))
+	{
+		sqlite3_int64 bid = sqlite3_column_int64(stmt, 0);
+		if(bfs_file_chunkSize(self, conn->db,
+		                      conn->stmt_chunk_size,
+		                      bid, &size) == 0)
+		{
+			return 0;
+		}
+
+		if(size)
+		{
+			if((bfs_file_alloc(_tmp, size) == 0) ||
+			   (bfs_file_chunkCopy(self, conn, bid, size,
+			                       *_tmp) == 0))
+			{
+				return 0;
+			}
+			data = *_tmp;
+		}
+	}
+	else
+	{
+		const void* blob  = sqlite3_column_blob(stmt, 4);
+		size_t      bytes = (size_t) sqlite3_column_bytes(stmt, 4);
+		int         codec = sqlite3_column_int(stmt, 5);
+		if(codec)
+		{
+			size = (size_t) sqlite3_column_int64(stmt, 6);
+			if(size)
+			{
+				if((blob == NULL) ||
+				   (bfs_file_alloc(_tmp, size) == 0) ||
+				   (bfs_file_decode(codec, bytes, blob, size,
+				                    *_tmp) == 0))
+				{
+					return 0;
+				}
+				data = *_tmp;
+			}
+		}
+		else
+		{
+			size = bytes;
+			data = blob;
+		}
+	}
+
+	*_size = size;
+
+	return bfs_file_checkCrc(crc, size, data);
+}
+
+static int
+bfs_file_verifyRange(bfs_file_t* self, bfs_verifyTask_t* task,
+                     sqlite3_int64 lo, sqlite3_int64 hi,
+                     void** _tmp)
+{
+	ASSERT(self);
+	ASSERT(task);
+	ASSERT(_tmp);
+
+	bfs_verifier_t* verifier = task->verifier;
+
+	bfs_file_lockRead(self, task->tid);
+
+	bfs_conn_t*   conn = &self->conn[task->tid];
+	sqlite3_stmt* stmt = conn->stmt_blob_verify;
+	if((sqlite3_bind_int64(stmt, self->idx_blob_verify_lo,
+	                       lo) != SQLITE_OK) ||
+	   (sqlite3_bind_int64(stmt, self->idx_blob_verify_hi,
+	                       hi) != SQLITE_OK))
+	{
+		LOGE("sqlite3_bind_int64: lo=%" PRId64 ", hi=%" PRId64,
+		     (int64_t) lo, (int64_t) hi);
+		bfs_file_unlockRead(self, task->tid);
+		return 0;
+	}
+
+	// blobs which cannot be read are also corrupt
+	int ret = 1;
+	int step;
+	while((step = sqlite3_step(stmt)) == SQLITE_ROW)
+	{
+		int64_t crc = bfs_file_columnCrc(stmt, 2);
+		if(crc < 0)
+		{
+			++task->verify.skipped;
+			continue;
+		}
+
+		size_t size = 0;
+		if(bfs_file_verifyRow(self, conn, stmt, crc, &size,
+		                      _tmp))
+		{
+			++task->verify.count;
+			task->verify.bytes += size;
+			continue;
+		}
+
+		++task->verify.corrupt;
+		if(verifier->corrupt_fn)
+		{
+			const char* name;
+			name = (const char*) sqlite3_column_text(stmt, 1);
+
+			pthread_mutex_lock(&verifier->mutex);
+			ret = (*verifier->corrupt_fn)(verifier->priv,
+			                              name, size);
+			pthread_mutex_unlock(&verifier->mutex);
+			if(ret == 0)
+			{
+				break;
+			}
+		}
+	}
+
+	if(ret && (step != SQLITE_DONE))
+	{
+		LOGE("sqlite3_step: msg=%s",
+		     sqlite3_errmsg(conn->db));
+		ret = 0;
+	}
+
+	if(sqlite3_reset(stmt) != SQLITE_OK)
+	{
+		LOGW("sqlite3_reset failed");
+	}
+
+	bfs_file_unlockRead(self, task->tid);
+
+	return ret;
+}
+
+static void* bfs_file_verifyThread(void* arg)
+{
+	ASSERT(arg);
+
+	bfs_verifyTask_t* task     = (bfs_verifyTask_t*) arg;
+	bfs_verifier_t*   verifier = task->verifier;
+	bfs_file_t*       self     = verifier->file;
+
+	void* tmp = NULL;
+	while(__atomic_load_n(&verifier->stop,
+	                      __ATOMIC_SEQ_CST) == 0)
+	{
+		sqlite3_int64 lo;
+		lo = __atomic_fetch_add(&verifier->next,
+		                        VERIFY_BATCH,
+		                        __ATOMIC_SEQ_CST);
+		if(lo > verifier->last)
+		{
+			break;
+		}
+
+		if(bfs_file_verifyRange(self, task, lo,
+		                        lo + VERIFY_BATCH,
+		                        &tmp) == 0)
+		{
+			// stop the other threads on error
+			__atomic_store_n(&verifier->stop, 1,
+			                 __ATOMIC_SEQ_CST);
+			task->status = 0;
+			break;
+		}
+	}
+	FREE(tmp);
+
+	return NULL;
+}
+
+/***********************************************************
+* public                                                   *
+***********************************************************/
+
+bfs_file_t*
+bfs_file_open(const char* fname, int nth, bfs_mode_e mode)
+{
+	ASSERT(fname);
+
+	bfs_options_t opts =
+	{
+		.nth  = nth,
+		.mode = mode,
+	};
+
+	return bfs_file_openEx(fname, &opts);
+}
+
+bfs_file_t*
+bfs_file_openEx(const char* fname, const bfs_options_t* opts)
+{
+	ASSERT(fname);
+	ASSERT(opts);
+
+	int        nth  = opts->nth;
+	bfs_mode_e mode = opts->mode;
+
+	int flags  = SQLITE_OPEN_READWRITE;
+	int exists = bfs_fileExists(fname);
+	if(mode == BFS_MODE_RDONLY)
+	{
+		// database must exist in read-only mode
+		if(exists == 0)
+		{
+			LOGE("invalid %s", fname);
+			return NULL;
+		}
+
+		flags = SQLITE_OPEN_READONLY;
+	}
+	else if(mode == BFS_MODE_STREAM)
+	{
+		if(nth != 1)
+		{
+			LOGE("invalid nth=%i", nth);
+			return NULL;
+		}
+	}
+
+	// create database if needed
+	if(exists == 0)
+	{
+		flags |= SQLITE_OPEN_CREATE;
+	}
+
+	bfs_file_t* self;
+	self = (bfs_file_t*)
 	       CALLOC(1, sizeof(bfs_file_t));
 	if(self == NULL)
 	{
-		LOGE("CALLOC failed");
-		return NULL;
+		LOGE("CALLOC failed");
+		return NULL;
+	}
+
+	self->nth  = nth;
+	self->mode = mode;
+
+	// sqlite3 must be initialized externally
+	if(sqlite3_open_v2(fname, &self->db, flags,
+	                   NULL) != SQLITE_OK)
+	{
+		LOGE("sqlite3_open_v2 %s failed", fname);
+		goto fail_db_open;
+	}
+
+	sqlite3_busy_timeout(self->db, BUSY_TIMEOUT);
+
+	if(bfs_file_pragmas(self, opts,
+	                    flags & SQLITE_OPEN_CREATE) == 0)
+	{
+		goto fail_initialize;
+	}
+
+	if(flags & SQLITE_OPEN_CREATE)
+	{
+		if(bfs_file_createTables(self) == 0)
+		{
+			goto fail_initialize;
+		}
+
+		if(mode == BFS_MODE_STREAM)
+		{
+			// index creation is faster at close
+		}
+		else if(bfs_file_createIndices(self) == 0)
+		{
+			goto fail_initialize;
+		}
+	}
+
+	if(bfs_file_version(self->db, &self->version) == 0)
+	{
+		goto fail_initialize;
+	}
+	else if(self->version > BFS_VERSION)
+	{
+		LOGE("unsupported version=%i", self->version);
+		goto fail_initialize;
+	}
+	else if(self->version < BFS_VERSION)
+	{
+		if(mode == BFS_MODE_RDONLY)
+		{
+			if(bfs_file_shadowTables(self->db,
+			                         self->version) == 0)
+			{
+				goto fail_initialize;
+			}
+		}
+		else
+		{
+			if(bfs_file_upgradeTables(self,
+			                          self->version) == 0)
+			{
+				goto fail_initialize;
+			}
+			self->version = BFS_VERSION;
+		}
+	}
+
+	if((mode == BFS_MODE_STREAM) &&
+	   (bfs_file_metaLast(self->db, &self->meta_bid) == 0))
+	{
+		goto fail_initialize;
+	}
+
+	// chunks are limited by the maximum blob length
+	self->chunk_size = opts->chunk_size;
+	if(self->chunk_size == 0)
+	{
+		self->chunk_size = CHUNK_SIZE;
+	}
+	else if(self->chunk_size >
+	        (size_t) sqlite3_limit(self->db, SQLITE_LIMIT_LENGTH, -1))
+	{
+		LOGE("invalid chunk_size=%" PRIu64,
+		     (uint64_t) self->chunk_size);
+		goto fail_initialize;
+	}
+
+	// the codec must be registered (see bfs_codec.h)
+	if(opts->codec != BFS_CODEC_NONE)
+	{
+		self->codec = bfs_codec_find(opts->codec);
+		if(self->codec == NULL)
+		{
+			LOGE("invalid codec=%i", opts->codec);
+			goto fail_initialize;
+		}
+	}
+
+	// deduplication is ignored by the read-only mode
+	self->dedup = opts->dedup && (mode != BFS_MODE_RDONLY);
+
+	self->batch_max_count = opts->batch_count;
+	self->batch_max_bytes = opts->batch_bytes;
+	self->batch_max_time  = ((double) opts->batch_ms)/1000.0;
+	if(self->batch_max_count <= 0)
+	{
+		self->batch_max_count = BATCH_SIZE;
+	}
+	if(self->batch_max_bytes == 0)
+	{
+		self->batch_max_bytes = BATCH_BYTES;
+	}
+	if(self->batch_max_time <= 0.0)
+	{
+		self->batch_max_time = ((double) BATCH_MS)/1000.0;
+	}
+
+	const char* sql_begin = "BEGIN;";
+	if(sqlite3_prepare_v2(self->db, sql_begin, -1,
+	                      &self->stmt_begin,
+	                      NULL) != SQLITE_OK)
+	{
+		LOGE("sqlite3_prepare_v2: %s",
+		     sqlite3_errmsg(self->db));
+		goto fail_prepare_begin;
+	}
+
+	const char* sql_end = "END;";
+	if(sqlite3_prepare_v2(self->db, sql_end, -1,
+	                      &self->stmt_end,
+	                      NULL) != SQLITE_OK)
+	{
+		LOGE("sqlite3_prepare_v2: %s",
+		     sqlite3_errmsg(self->db));
+		goto fail_prepare_end;
+	}
+
+	const char* sql_savepoint = "SAVEPOINT sp_blob;";
+	if(sqlite3_prepare_v2(self->db, sql_savepoint, -1,
+	                      &self->stmt_savepoint,
+	                      NULL) != SQLITE_OK)
+	{
+		LOGE("sqlite3_prepare_v2: %s",
+		     sqlite3_errmsg(self->db));
+		goto fail_prepare_savepoint;
+	}
+
+	const char* sql_release = "RELEASE sp_blob;";
+	if(sqlite3_prepare_v2(self->db, sql_release, -1,
+	                      &self->stmt_release,
+	                      NULL) != SQLITE_OK)
+	{
+		LOGE("sqlite3_prepare_v2: %s",
+		     sqlite3_errmsg(self->db));
+		goto fail_prepare_release;
+	}
+
+	const char* sql_rollback = "ROLLBACK TO sp_blob;";
+	if(sqlite3_prepare_v2(self->db, sql_rollback, -1,
+	                      &self->stmt_rollback,
+	                      NULL) != SQLITE_OK)
+	{
+		LOGE("sqlite3_prepare_v2: %s",
+		     sqlite3_errmsg(self->db));
+		goto fail_prepare_rollback;
+	}
+
+	const char* sql_attr_set = "REPLACE INTO tbl_attr (key, val)"
+	                           "   VALUES (@arg_key, @arg_val);";
+	if(sqlite3_prepare_v2(self->db, sql_attr_set, -1,
+	                      &self->stmt_attr_set,
+	                      NULL) != SQLITE_OK)
+	{
+		LOGE("sqlite3_prepare_v2: %s",
+		     sqlite3_errmsg(self->db));
+		goto fail_prepare_attr_set;
+	}
+
+	const char* sql_attr_clr;
+	sql_attr_clr = "DELETE FROM tbl_attr"
+	               "   WHERE key=@arg_key;";
+	if(sqlite3_prepare_v2(self->db, sql_attr_clr, -1,
+	                      &self->stmt_attr_clr,
+	                      NULL) != SQLITE_OK)
+	{
+		LOGE("sqlite3_prepare_v2: %s",
+		     sqlite3_errmsg(self->db));
+		goto fail_prepare_attr_clr;
+	}
+
+	const char* sql_blob_clr;
+	sql_blob_clr = "DELETE FROM tbl_blob"
+	               "   WHERE name=@arg_name;";
+	if(sqlite3_prepare_v2(self->db, sql_blob_clr, -1,
+	                      &self->stmt_blob_clr,
+	                      NULL) != SQLITE_OK)
+	{
+		LOGE("sqlite3_prepare_v2: %s",
+		     sqlite3_errmsg(self->db));
+		goto fail_prepare_blob_clr;
+	}
+
+	// the blobs are not written by the read-only mode and
+	// older files may not have the codec columns
+	if(mode != BFS_MODE_RDONLY)
+	{
+		// blobs are replaced in place to preserve the rowid
+		// except for the stream mode which may not have the
+		// unique name index required by the upsert
+		const char* sql_blob_set;
+		if(mode == BFS_MODE_STREAM)
+		{
+			sql_blob_set = "REPLACE INTO tbl_blob"
+			               "   (name, blob, codec, raw_size, crc)"
+			               "   VALUES (@arg_name, @arg_blob,"
+			               "           @arg_codec, @arg_raw_size, @arg_crc);";
+		}
+		else
+		{
+			sql_blob_set = "INSERT INTO tbl_blob"
+			               "   (name, blob, codec, raw_size, crc)"
+			               "   VALUES (@arg_name, @arg_blob,"
+			               "           @arg_codec, @arg_raw_size, @arg_crc)"
+			               "   ON CONFLICT(name) DO UPDATE"
+			               "   SET blob=excluded.blob,"
+			               "       codec=excluded.codec,"
+			               "       raw_size=excluded.raw_size,"
+			               "       crc=excluded.crc;";
+		}
+		if(sqlite3_prepare_v2(self->db, sql_blob_set, -1,
+		                      &self->stmt_blob_set,
+		                      NULL) != SQLITE_OK)
+		{
+			LOGE("sqlite3_prepare_v2: %s",
+			     sqlite3_errmsg(self->db));
+			goto fail_prepare_blob_set;
+		}
+
+		// reserve space for incremental blob writes
+		const char* sql_blob_reserve;
+		if(mode == BFS_MODE_STREAM)
+		{
+			sql_blob_reserve = "REPLACE INTO tbl_blob (name, blob)"
+			                   "   VALUES (@arg_name, zeroblob(@arg_size));";
+		}
+		else
+		{
+			sql_blob_reserve = "INSERT INTO tbl_blob (name, blob)"
+			                   "   VALUES (@arg_name, zeroblob(@arg_size))"
+			                   "   ON CONFLICT(name) DO UPDATE"
+			                   "   SET blob=excluded.blob,"
+			                   "       codec=NULL, raw_size=NULL, crc=NULL;";
+		}
+		if(sqlite3_prepare_v2(self->db, sql_blob_reserve, -1,
+		                      &self->stmt_blob_reserve,
+		                      NULL) != SQLITE_OK)
+		{
+			LOGE("sqlite3_prepare_v2: %s",
+			     sqlite3_errmsg(self->db));
+			goto fail_prepare_blob_reserve;
+		}
+
+		const char* sql_blob_find;
+		sql_blob_find = "SELECT rowid, blob IS NULL AND codec IS NULL,"
+		                "   ifnull(length(blob), raw_size), codec, raw_size,"
+		                "   CASE WHEN blob IS NULL THEN " SQL_BLOB_CID " END,"
+		                "   crc IS NOT NULL"
+		                "   FROM tbl_blob WHERE name=@arg_name;";
+		if(sqlite3_prepare_v2(self->db, sql_blob_find, -1,
+		                      &self->stmt_blob_find,
+		                      NULL) != SQLITE_OK)
+		{
+			LOGE("sqlite3_prepare_v2: %s",
+			     sqlite3_errmsg(self->db));
+			goto fail_prepare_blob_find;
+		}
+
+		const char* sql_blob_update;
+		sql_blob_update = "UPDATE tbl_blob SET blob=@arg_blob,"
+		                  "   codec=@arg_codec, raw_size=@arg_raw_size,"
+		                  "   crc=@arg_crc"
+		                  "   WHERE rowid=@arg_bid;";
+		if(sqlite3_prepare_v2(self->db, sql_blob_update, -1,
+		                      &self->stmt_blob_update,
+		                      NULL) != SQLITE_OK)
+		{
+			LOGE("sqlite3_prepare_v2: %s",
+			     sqlite3_errmsg(self->db));
+			goto fail_prepare_blob_update;
+		}
+
+		// the crc is cleared when a blob is modified in place
+		// and set when a blob writer completes sequentially
+		const char* sql_blob_crc;
+		sql_blob_crc = "UPDATE tbl_blob SET crc=@arg_crc"
+		               "   WHERE rowid=@arg_bid;";
+		if(sqlite3_prepare_v2(self->db, sql_blob_crc, -1,
+		                      &self->stmt_blob_crc,
+		                      NULL) != SQLITE_OK)
+		{
+			LOGE("sqlite3_prepare_v2: %s",
+			     sqlite3_errmsg(self->db));
+			goto fail_prepare_blob_crc;
+		}
+	}
+
+	const char* sql_blob_name;
+	sql_blob_name = "SELECT name FROM tbl_blob"
+	                "   WHERE rowid=@arg_bid;";
+	if(sqlite3_prepare_v2(self->db, sql_blob_name, -1,
+	                      &self->stmt_blob_name,
+	                      NULL) != SQLITE_OK)
+	{
+		LOGE("sqlite3_prepare_v2: %s",
+		     sqlite3_errmsg(self->db));
+		goto fail_prepare_blob_name;
+	}
+
+	const char* sql_blob_delete;
+	sql_blob_delete = "DELETE FROM tbl_blob"
+	                  "   WHERE rowid=@arg_bid;";
+	if(sqlite3_prepare_v2(self->db, sql_blob_delete, -1,
+	                      &self->stmt_blob_delete,
+	                      NULL) != SQLITE_OK)
+	{
+		LOGE("sqlite3_prepare_v2: %s",
+		     sqlite3_errmsg(self->db));
+		goto fail_prepare_blob_delete;
+	}
+
+	// move an inline blob into its first chunk
+	const char* sql_chunk_detach;
+	sql_chunk_detach = "INSERT INTO tbl_chunk (bid, pos, data)"
+	                   "   SELECT rowid, 0, blob FROM tbl_blob"
+	                   "   WHERE rowid=@arg_bid;";
+	if(sqlite3_prepare_v2(self->db, sql_chunk_detach, -1,
+	                      &self->stmt_chunk_detach,
+	                      NULL) != SQLITE_OK)
+	{
+		LOGE("sqlite3_prepare_v2: %s",
+		     sqlite3_errmsg(self->db));
+		goto fail_prepare_chunk_detach;
+	}
+
+	const char* sql_chunk_set;
+	sql_chunk_set = "REPLACE INTO tbl_chunk (bid, pos, data)"
+	                "   VALUES (@arg_bid, @arg_pos, @arg_data);";
+	if(sqlite3_prepare_v2(self->db, sql_chunk_set, -1,
+	                      &self->stmt_chunk_set,
+	                      NULL) != SQLITE_OK)
+	{
+		LOGE("sqlite3_prepare_v2: %s",
+		     sqlite3_errmsg(self->db));
+		goto fail_prepare_chunk_set;
+	}
+
+	if(sqlite3_prepare_v2(self->db, SQL_CHUNK_FIND, -1,
+	                      &self->stmt_chunk_find,
+	                      NULL) != SQLITE_OK)
+	{
+		LOGE("sqlite3_prepare_v2: %s",
+		     sqlite3_errmsg(self->db));
+		goto fail_prepare_chunk_find;
+	}
+
+	if(sqlite3_prepare_v2(self->db, SQL_CHUNK_SIZE, -1,
+	                      &self->stmt_chunk_size,
+	                      NULL) != SQLITE_OK)
+	{
+		LOGE("sqlite3_prepare_v2: %s",
+		     sqlite3_errmsg(self->db));
+		goto fail_prepare_chunk_size;
+	}
+
+	// the metadata is not written by the read-only mode
+	// which may shadow tbl_meta and tbl_total with views
+	if(mode != BFS_MODE_RDONLY)
+	{
+		const char* sql_meta_get;
+		sql_meta_get = "SELECT size FROM tbl_meta"
+		               "   WHERE bid=@arg_bid;";
+		if(sqlite3_prepare_v2(self->db, sql_meta_get, -1,
+		                      &self->stmt_meta_get,
+		                      NULL) != SQLITE_OK)
+		{
+			LOGE("sqlite3_prepare_v2: %s",
+			     sqlite3_errmsg(self->db));
+			goto fail_prepare_meta_get;
+		}
+
+		// the cid is replaced on every write so that the
+		// triggers release the previous content
+		const char* sql_meta_set;
+		sql_meta_set = "INSERT INTO tbl_meta (bid, size, mtime, cid)"
+		               "   VALUES (@arg_bid, @arg_size, @arg_mtime,"
+		               "           @arg_cid)"
+		               "   ON CONFLICT(bid) DO UPDATE"
+		               "   SET size=excluded.size,"
+		               "       mtime=excluded.mtime,"
+		               "       cid=excluded.cid;";
+		if(sqlite3_prepare_v2(self->db, sql_meta_set, -1,
+		                      &self->stmt_meta_set,
+		                      NULL) != SQLITE_OK)
+		{
+			LOGE("sqlite3_prepare_v2: %s",
+			     sqlite3_errmsg(self->db));
+			goto fail_prepare_meta_set;
+		}
+
+		const char* sql_total_add;
+		sql_total_add = "UPDATE tbl_total"
+		                "   SET count=count + @arg_count,"
+		                "       bytes=bytes + @arg_bytes;";
+		if(sqlite3_prepare_v2(self->db, sql_total_add, -1,
+		                      &self->stmt_total_add,
+		                      NULL) != SQLITE_OK)
+		{
+			LOGE("sqlite3_prepare_v2: %s",
+			     sqlite3_errmsg(self->db));
+			goto fail_prepare_total_add;
+		}
+
+		// the deduplicated blobs are skipped since they were
+		// added by bfs_file_metaSet
+		const char* sql_meta_batch;
+		sql_meta_batch = "INSERT OR IGNORE INTO tbl_meta"
+		                 "   (bid, size, mtime)"
+		                 "   SELECT rowid, " SQL_BLOB_RAW_SIZE ", @arg_mtime"
+		                 "   FROM tbl_blob WHERE rowid>@arg_bid;";
+		if(sqlite3_prepare_v2(self->db, sql_meta_batch, -1,
+		                      &self->stmt_meta_batch,
+		                      NULL) != SQLITE_OK)
+		{
+			LOGE("sqlite3_prepare_v2: %s",
+			     sqlite3_errmsg(self->db));
+			goto fail_prepare_meta_batch;
+		}
+
+		const char* sql_meta_sum;
+		sql_meta_sum = "SELECT count(*), ifnull(sum(size), 0),"
+		               "       ifnull(max(bid), @arg_bid)"
+		               "   FROM tbl_meta WHERE bid>@arg_bid;";
+		if(sqlite3_prepare_v2(self->db, sql_meta_sum, -1,
+		                      &self->stmt_meta_sum,
+		                      NULL) != SQLITE_OK)
+		{
+			LOGE("sqlite3_prepare_v2: %s",
+			     sqlite3_errmsg(self->db));
+			goto fail_prepare_meta_sum;
+		}
+
+		const char* sql_content_find;
+		sql_content_find = "SELECT cid, data, codec, raw_size"
+		                   "   FROM tbl_content WHERE hash=@arg_hash;";
+		if(sqlite3_prepare_v2(self->db, sql_content_find, -1,
+		                      &self->stmt_content_find,
+		                      NULL) != SQLITE_OK)
+		{
+			LOGE("sqlite3_prepare_v2: %s",
+			     sqlite3_errmsg(self->db));
+			goto fail_prepare_content_find;
+		}
+
+		// the refs are counted by the triggers
+		const char* sql_content_add;
+		sql_content_add = "INSERT INTO tbl_content"
+		                  "   (hash, refs, data, codec, raw_size)"
+		                  "   VALUES (@arg_hash, 0, @arg_data,"
+		                  "           @arg_codec, @arg_raw_size);";
+		if(sqlite3_prepare_v2(self->db, sql_content_add, -1,
+		                      &self->stmt_content_add,
+		                      NULL) != SQLITE_OK)
+		{
+			LOGE("sqlite3_prepare_v2: %s",
+			     sqlite3_errmsg(self->db));
+			goto fail_prepare_content_add;
+		}
+	}
+
+	// the reserved lock is acquired immediately so that
+	// explicit transactions fail early
+	const char* sql_txn_begin = "BEGIN IMMEDIATE;";
+	if(sqlite3_prepare_v2(self->db, sql_txn_begin, -1,
+	                      &self->stmt_txn_begin,
+	                      NULL) != SQLITE_OK)
+	{
+		LOGE("sqlite3_prepare_v2: %s",
+		     sqlite3_errmsg(self->db));
+		goto fail_prepare_txn_begin;
+	}
+
+	const char* sql_txn_rollback = "ROLLBACK;";
+	if(sqlite3_prepare_v2(self->db, sql_txn_rollback, -1,
+	                      &self->stmt_txn_rollback,
+	                      NULL) != SQLITE_OK)
+	{
+		LOGE("sqlite3_prepare_v2: %s",
+		     sqlite3_errmsg(self->db));
+		goto fail_prepare_txn_rollback;
+	}
+
+	self->idx_attr_set_key  = sqlite3_bind_parameter_index(self->stmt_attr_set,
+	                                                       "@arg_key");
+	self->idx_attr_set_val  = sqlite3_bind_parameter_index(self->stmt_attr_set,
+	                                                       "@arg_val");
+	self->idx_attr_clr_key  = sqlite3_bind_parameter_index(self->stmt_attr_clr,
+	                                                       "@arg_key");
+	self->idx_blob_clr_name = sqlite3_bind_parameter_index(self->stmt_blob_clr,
+	                                                       "@arg_name");
+	self->idx_blob_name_bid     = sqlite3_bind_parameter_index(self->stmt_blob_name,
+	                                                           "@arg_bid");
+	self->idx_blob_delete_bid   = sqlite3_bind_parameter_index(self->stmt_blob_delete,
+	                                                           "@arg_bid");
+	self->idx_chunk_detach_bid  = sqlite3_bind_parameter_index(self->stmt_chunk_detach,
+	                                                           "@arg_bid");
+	self->idx_chunk_set_bid     = sqlite3_bind_parameter_index(self->stmt_chunk_set,
+	                                                           "@arg_bid");
+	self->idx_chunk_set_pos     = sqlite3_bind_parameter_index(self->stmt_chunk_set,
+	                                                           "@arg_pos");
+	self->idx_chunk_set_data    = sqlite3_bind_parameter_index(self->stmt_chunk_set,
+	                                                           "@arg_data");
+
+	// the reader connections share the chunk find/size
+	// statements and parameter indices
+	self->idx_chunk_find_bid    = sqlite3_bind_parameter_index(self->stmt_chunk_find,
+	                                                           "@arg_bid");
+	self->idx_chunk_find_pos    = sqlite3_bind_parameter_index(self->stmt_chunk_find,
+	                                                           "@arg_pos");
+	self->idx_chunk_size_bid    = sqlite3_bind_parameter_index(self->stmt_chunk_size,
+	                                                           "@arg_bid");
+
+	if(mode != BFS_MODE_RDONLY)
+	{
+		self->idx_blob_set_name        = sqlite3_bind_parameter_index(self->stmt_blob_set,
+		                                                              "@arg_name");
+		self->idx_blob_set_blob        = sqlite3_bind_parameter_index(self->stmt_blob_set,
+		                                                              "@arg_blob");
+		self->idx_blob_set_codec       = sqlite3_bind_parameter_index(self->stmt_blob_set,
+		                                                              "@arg_codec");
+		self->idx_blob_set_raw_size    = sqlite3_bind_parameter_index(self->stmt_blob_set,
+		                                                              "@arg_raw_size");
+		self->idx_blob_set_crc         = sqlite3_bind_parameter_index(self->stmt_blob_set,
+		                                                              "@arg_crc");
+		self->idx_blob_reserve_name    = sqlite3_bind_parameter_index(self->stmt_blob_reserve,
+		                                                              "@arg_name");
+		self->idx_blob_reserve_size    = sqlite3_bind_parameter_index(self->stmt_blob_reserve,
+		                                                              "@arg_size");
+		self->idx_blob_find_name       = sqlite3_bind_parameter_index(self->stmt_blob_find,
+		                                                              "@arg_name");
+		self->idx_blob_update_bid      = sqlite3_bind_parameter_index(self->stmt_blob_update,
+		                                                              "@arg_bid");
+		self->idx_blob_update_blob     = sqlite3_bind_parameter_index(self->stmt_blob_update,
+		                                                              "@arg_blob");
+		self->idx_blob_update_codec    = sqlite3_bind_parameter_index(self->stmt_blob_update,
+		                                                              "@arg_codec");
+		self->idx_blob_update_raw_size = sqlite3_bind_parameter_index(self->stmt_blob_update,
+		                                                              "@arg_raw_size");
+		self->idx_blob_update_crc      = sqlite3_bind_parameter_index(self->stmt_blob_update,
+		                                                              "@arg_crc");
+		self->idx_blob_crc_bid         = sqlite3_bind_parameter_index(self->stmt_blob_crc,
+		                                                              "@arg_bid");
+		self->idx_blob_crc_crc         = sqlite3_bind_parameter_index(self->stmt_blob_crc,
+		                                                              "@arg_crc");
+		self->idx_meta_get_bid     = sqlite3_bind_parameter_index(self->stmt_meta_get,
+		                                                          "@arg_bid");
+		self->idx_meta_set_bid     = sqlite3_bind_parameter_index(self->stmt_meta_set,
+		                                                          "@arg_bid");
+		self->idx_meta_set_size    = sqlite3_bind_parameter_index(self->stmt_meta_set,
+		                                                          "@arg_size");
+		self->idx_meta_set_mtime   = sqlite3_bind_parameter_index(self->stmt_meta_set,
+		                                                          "@arg_mtime");
+		self->idx_meta_set_cid     = sqlite3_bind_parameter_index(self->stmt_meta_set,
+		                                                          "@arg_cid");
+		self->idx_total_add_count  = sqlite3_bind_parameter_index(self->stmt_total_add,
+		                                                          "@arg_count");
+		self->idx_total_add_bytes  = sqlite3_bind_parameter_index(self->stmt_total_add,
+		                                                          "@arg_bytes");
+		self->idx_meta_batch_bid   = sqlite3_bind_parameter_index(self->stmt_meta_batch,
+		                                                          "@arg_bid");
+		self->idx_meta_batch_mtime = sqlite3_bind_parameter_index(self->stmt_meta_batch,
+		                                                          "@arg_mtime");
+		self->idx_meta_sum_bid     = sqlite3_bind_parameter_index(self->stmt_meta_sum,
+		                                                          "@arg_bid");
+		self->idx_content_find_hash    = sqlite3_bind_parameter_index(self->stmt_content_find,
+		                                                              "@arg_hash");
+		self->idx_content_add_hash     = sqlite3_bind_parameter_index(self->stmt_content_add,
+		                                                              "@arg_hash");
+		self->idx_content_add_data     = sqlite3_bind_parameter_index(self->stmt_content_add,
+		                                                              "@arg_data");
+		self->idx_content_add_codec    = sqlite3_bind_parameter_index(self->stmt_content_add,
+		                                                              "@arg_codec");
+		self->idx_content_add_raw_size = sqlite3_bind_parameter_index(self->stmt_content_add,
+		                                                              "@arg_raw_size");
+	}
+
+	// the stream mode is write-only
+	int nconn = (mode == BFS_MODE_STREAM) ? 0 : nth;
+	if(nconn)
+	{
+		self->conn = (bfs_conn_t*)
+		             CALLOC(nconn, sizeof(bfs_conn_t));
+		if(self->conn == NULL)
+		{
+			LOGE("CALLOC failed");
+			goto fail_alloc_conn;
+		}
+	}
+
+	int i;
+	for(i = 0; i < nconn; ++i)
+	{
+		if(bfs_conn_open(&self->conn[i], fname, opts,
+		                 self->version) == 0)
+		{
+			goto fail_conn_open;
+		}
+	}
+
+	if(nconn)
+	{
+		bfs_conn_t* conn = &self->conn[0];
+		self->idx_attr_get_key    = sqlite3_bind_parameter_index(conn->stmt_attr_get,
+		                                                         "@arg_key");
+		self->idx_blob_like_pat   = sqlite3_bind_parameter_index(conn->stmt_blob_like,
+		                                                         "@arg_pat");
+		self->idx_blob_range_lo   = sqlite3_bind_parameter_index(conn->stmt_blob_range,
+		                                                         "@arg_lo");
+		self->idx_blob_range_hi   = sqlite3_bind_parameter_index(conn->stmt_blob_range,
+		                                                         "@arg_hi");
+		self->idx_blob_glob_lo    = sqlite3_bind_parameter_index(conn->stmt_blob_glob,
+		                                                         "@arg_lo");
+		self->idx_blob_glob_hi    = sqlite3_bind_parameter_index(conn->stmt_blob_glob,
+		                                                         "@arg_hi");
+		self->idx_blob_glob_pat   = sqlite3_bind_parameter_index(conn->stmt_blob_glob,
+		                                                         "@arg_pat");
+		self->idx_blob_page_lo    = sqlite3_bind_parameter_index(conn->stmt_blob_page,
+		                                                         "@arg_lo");
+		self->idx_blob_page_hi    = sqlite3_bind_parameter_index(conn->stmt_blob_page,
+		                                                         "@arg_hi");
+		self->idx_blob_page_limit = sqlite3_bind_parameter_index(conn->stmt_blob_page,
+		                                                         "@arg_limit");
+		self->idx_blob_next_lo    = sqlite3_bind_parameter_index(conn->stmt_blob_next,
+		                                                         "@arg_lo");
+		self->idx_blob_next_hi    = sqlite3_bind_parameter_index(conn->stmt_blob_next,
+		                                                         "@arg_hi");
+		self->idx_blob_next_limit = sqlite3_bind_parameter_index(conn->stmt_blob_next,
+		                                                         "@arg_limit");
+		self->idx_blob_get_name   = sqlite3_bind_parameter_index(conn->stmt_blob_get,
+		                                                         "@arg_name");
+		self->idx_blob_rowid_name = sqlite3_bind_parameter_index(conn->stmt_blob_rowid,
+		                                                         "@arg_name");
+		self->idx_blob_byid_bid   = sqlite3_bind_parameter_index(conn->stmt_blob_byid,
+		                                                         "@arg_bid");
+		self->idx_blob_verify_lo  = sqlite3_bind_parameter_index(conn->stmt_blob_verify,
+		                                                         "@arg_lo");
+		self->idx_blob_verify_hi  = sqlite3_bind_parameter_index(conn->stmt_blob_verify,
+		                                                         "@arg_hi");
+		self->idx_chunk_list_bid  = sqlite3_bind_parameter_index(conn->stmt_chunk_list,
+		                                                         "@arg_bid");
+	}
+
+	pthread_mutexattr_t attr;
+	if(pthread_mutexattr_init(&attr) != 0)
+	{
+		LOGE("pthread_mutexattr_init failed");
+		goto fail_writer;
+	}
+
+	if((pthread_mutexattr_settype(&attr,
+	                              PTHREAD_MUTEX_RECURSIVE) != 0) ||
+	   (pthread_mutex_init(&self->writer, &attr) != 0))
+	{
+		LOGE("pthread_mutex_init failed");
+		pthread_mutexattr_destroy(&attr);
+		goto fail_writer;
+	}
+	pthread_mutexattr_destroy(&attr);
+
+	if(pthread_mutex_init(&self->mutex, NULL) != 0)
+	{
+		LOGE("pthread_mutex_init failed");
+		goto fail_mutex;
+	}
+
+	if(pthread_cond_init(&self->cond, NULL) != 0)
+	{
+		LOGE("pthread_cond_init failed");
+		goto fail_cond;
+	}
+
+	self->slot = (bfs_slot_t*)
+	             CALLOC(nth, sizeof(bfs_slot_t));
+	if(self->slot == NULL)
+	{
+		LOGE("CALLOC failed");
+		goto fail_slot;
+	}
+
+	#if BFS_STATS
+	self->stats = (bfs_stats_t*)
+	              CALLOC(nth + 1, sizeof(bfs_stats_t));
+	if(self->stats == NULL)
+	{
+		LOGE("CALLOC failed");
+		goto fail_stats;
+	}
+	#endif
+
+	// the attribute snapshot is optional
+	if((mode != BFS_MODE_STREAM) && opts->attr_snapshot)
+	{
+		if(bfs_file_attrsLoad(self) == 0)
+		{
+			goto fail_attrs;
+		}
+	}
+
+	// the blob cache is optional
+	if((mode != BFS_MODE_STREAM) && (opts->cache_bytes > 0))
+	{
+		self->cache = bfs_cache_new(opts->cache_bytes, nth);
+		if(self->cache == NULL)
+		{
+			goto fail_cache;
+		}
+	}
+
+	// the write-behind queue is optional
+	if((mode == BFS_MODE_RDWR) && (opts->queue_count > 0))
+	{
+		if(bfs_file_queueStart(self, opts) == 0)
+		{
+			goto fail_queue;
+		}
+	}
+
+	// success
+	return self;
+
+	// failure
+	int t;
+	fail_queue:
+		bfs_cache_delete(&self->cache);
+	fail_cache:
+		bfs_file_attrsUnload(self);
+	fail_attrs:
+		#if BFS_STATS
+		FREE(self->stats);
+	fail_stats:
+		#endif
+		FREE(self->slot);
+	fail_slot:
+		pthread_cond_destroy(&self->cond);
+	fail_cond:
+		pthread_mutex_destroy(&self->mutex);
+	fail_mutex:
+		pthread_mutex_destroy(&self->writer);
+	fail_writer:
+	fail_conn_open:
+	{
+		for(t = 0; t < i; ++t)
+		{
+			bfs_conn_close(&self->conn[t]);
+		}
+		FREE(self->conn);
+	}
+	fail_alloc_conn:
+		sqlite3_finalize(self->stmt_txn_rollback);
+	fail_prepare_txn_rollback:
+		sqlite3_finalize(self->stmt_txn_begin);
+	fail_prepare_txn_begin:
+		sqlite3_finalize(self->stmt_content_add);
+	fail_prepare_content_add:
+		sqlite3_finalize(self->stmt_content_find);
+	fail_prepare_content_find:
+		sqlite3_finalize(self->stmt_meta_sum);
+	fail_prepare_meta_sum:
+		sqlite3_finalize(self->stmt_meta_batch);
+	fail_prepare_meta_batch:
+		sqlite3_finalize(self->stmt_total_add);
+	fail_prepare_total_add:
+		sqlite3_finalize(self->stmt_meta_set);
+	fail_prepare_meta_set:
+		sqlite3_finalize(self->stmt_meta_get);
+	fail_prepare_meta_get:
+		sqlite3_finalize(self->stmt_chunk_size);
+	fail_prepare_chunk_size:
+		sqlite3_finalize(self->stmt_chunk_find);
+	fail_prepare_chunk_find:
+		sqlite3_finalize(self->stmt_chunk_set);
+	fail_prepare_chunk_set:
+		sqlite3_finalize(self->stmt_chunk_detach);
+	fail_prepare_chunk_detach:
+		sqlite3_finalize(self->stmt_blob_delete);
+	fail_prepare_blob_delete:
+		sqlite3_finalize(self->stmt_blob_name);
+	fail_prepare_blob_name:
+		sqlite3_finalize(self->stmt_blob_crc);
+	fail_prepare_blob_crc:
+		sqlite3_finalize(self->stmt_blob_update);
+	fail_prepare_blob_update:
+		sqlite3_finalize(self->stmt_blob_find);
+	fail_prepare_blob_find:
+		sqlite3_finalize(self->stmt_blob_reserve);
+	fail_prepare_blob_reserve:
+		sqlite3_finalize(self->stmt_blob_set);
+	fail_prepare_blob_set:
+		sqlite3_finalize(self->stmt_blob_clr);
+	fail_prepare_blob_clr:
+		sqlite3_finalize(self->stmt_attr_clr);
+	fail_prepare_attr_clr:
+		sqlite3_finalize(self->stmt_attr_set);
+	fail_prepare_attr_set:
+		sqlite3_finalize(self->stmt_rollback);
+	fail_prepare_rollback:
+		sqlite3_finalize(self->stmt_release);
+	fail_prepare_release:
+		sqlite3_finalize(self->stmt_savepoint);
+	fail_prepare_savepoint:
+		sqlite3_finalize(self->stmt_end);
+	fail_prepare_end:
+		sqlite3_finalize(self->stmt_begin);
+	fail_prepare_begin:
+	fail_initialize:
+	fail_db_open:
+	{
+		// sqlite3 must be shutdown externally
+		// close db even when open fails
+		if(sqlite3_close_v2(self->db) != SQLITE_OK)
+		{
+			LOGW("sqlite3_close_v2 failed");
+		}
+		FREE(self);
+	}
+	return NULL;
+}
+
+void bfs_file_close(bfs_file_t** _self)
+{
+	ASSERT(_self);
+
+	bfs_file_t* self = *_self;
+	if(self)
+	{
+		bfs_file_queueStop(self);
+
+		if(bfs_file_endTransaction(self) == 0)
+		{
+			// ignore
+		}
+
+		if(self->mode == BFS_MODE_STREAM)
+		{
+			bfs_file_createIndices(self);
+		}
+
+		// uncommitted transactions are discarded
+		if(self->txn)
+		{
+			LOGW("rollback txn");
+			bfs_file_step(self, self->stmt_txn_rollback);
+			self->txn = 0;
+		}
+
+		bfs_cache_delete(&self->cache);
+		bfs_file_attrsUnload(self);
+		#if BFS_STATS
+		FREE(self->stats);
+		#endif
+		FREE(self->slot);
+		pthread_cond_destroy(&self->cond);
+		pthread_mutex_destroy(&self->mutex);
+		pthread_mutex_destroy(&self->writer);
+
+		// close readers before the writer so the writer
+		// may checkpoint the WAL
+		if(self->conn)
+		{
+			int i;
+			for(i = 0; i < self->nth; ++i)
+			{
+				bfs_conn_close(&self->conn[i]);
+			}
+			FREE(self->conn);
+		}
+
+		sqlite3_finalize(self->stmt_txn_rollback);
+		sqlite3_finalize(self->stmt_txn_begin);
+		sqlite3_finalize(self->stmt_content_add);
+		sqlite3_finalize(self->stmt_content_find);
+		sqlite3_finalize(self->stmt_meta_sum);
+		sqlite3_finalize(self->stmt_meta_batch);
+		sqlite3_finalize(self->stmt_total_add);
+		sqlite3_finalize(self->stmt_meta_set);
+		sqlite3_finalize(self->stmt_meta_get);
+		sqlite3_finalize(self->stmt_chunk_size);
+		sqlite3_finalize(self->stmt_chunk_find);
+		sqlite3_finalize(self->stmt_chunk_set);
+		sqlite3_finalize(self->stmt_chunk_detach);
+		sqlite3_finalize(self->stmt_blob_delete);
+		sqlite3_finalize(self->stmt_blob_name);
+		sqlite3_finalize(self->stmt_blob_crc);
+		sqlite3_finalize(self->stmt_blob_update);
+		sqlite3_finalize(self->stmt_blob_find);
+		sqlite3_finalize(self->stmt_blob_reserve);
+		sqlite3_finalize(self->stmt_blob_clr);
+		sqlite3_finalize(self->stmt_blob_set);
+		sqlite3_finalize(self->stmt_attr_clr);
+		sqlite3_finalize(self->stmt_attr_set);
+		sqlite3_finalize(self->stmt_rollback);
+		sqlite3_finalize(self->stmt_release);
+		sqlite3_finalize(self->stmt_savepoint);
+		sqlite3_finalize(self->stmt_end);
+		sqlite3_finalize(self->stmt_begin);
+
+		// sqlite3 must be shutdown externally
+		if(sqlite3_close_v2(self->db) != SQLITE_OK)
+		{
+			LOGW("sqlite3_close_v2 failed");
+		}
+		FREE(self);
+	}
+}
+
+int bfs_file_flush(bfs_file_t* self)
+{
+	ASSERT(self);
+
+	bfs_file_queueDrain(self);
+
+	return bfs_file_endTransaction(self);
+}
+
+void bfs_file_batch(bfs_file_t* self, bfs_batch_t* batch)
+{
+	ASSERT(self);
+	ASSERT(batch);
+
+	memset(batch, 0, sizeof(bfs_batch_t));
+
+	if((self->mode != BFS_MODE_STREAM) ||
+	   (self->batch_size == 0))
+	{
+		return;
+	}
+
+	double dt = bfs_file_timestamp() - self->batch_ts;
+
+	batch->count = self->batch_size;
+	batch->bytes = self->batch_bytes;
+	batch->ms    = (int) (1000.0*dt);
+
+	// the level is the closest limit
+	double level[3] =
+	{
+		((double) self->batch_size)/
+		((double) self->batch_max_count),
+		((double) self->batch_bytes)/
+		((double) self->batch_max_bytes),
+		dt/self->batch_max_time,
+	};
+
+	int i;
+	for(i = 0; i < 3; ++i)
+	{
+		if(level[i] > batch->level)
+		{
+			batch->level = level[i];
+		}
+	}
+
+	if(batch->level > 1.0)
+	{
+		batch->level = 1.0;
+	}
+}
+
+void bfs_file_cacheStats(bfs_file_t* self,
+                         bfs_cacheStats_t* stats)
+{
+	ASSERT(self);
+	ASSERT(stats);
+
+	if(self->cache)
+	{
+		bfs_cache_stats(self->cache, stats);
+	}
+	else
+	{
+		memset(stats, 0, sizeof(bfs_cacheStats_t));
+	}
+}
+
+int bfs_file_stats(bfs_file_t* self, bfs_stats_t* stats)
+{
+	ASSERT(self);
+	ASSERT(stats);
+
+	memset(stats, 0, sizeof(bfs_stats_t));
+
+	#if BFS_STATS
+	int tid;
+	for(tid = 0; tid <= self->nth; ++tid)
+	{
+		bfs_stats_merge(stats, &self->stats[tid]);
+	}
+
+	return 1;
+	#else
+	LOGE("invalid BFS_STATS=0");
+	return 0;
+	#endif
+}
+
+int bfs_file_txnBegin(bfs_file_t* self)
+{
+	ASSERT(self);
+
+	// the stream mode batches writes automatically
+	if(self->mode != BFS_MODE_RDWR)
+	{
+		LOGE("invalid mode");
+		return 0;
+	}
+
+	// the transaction follows the queued writes
+	bfs_file_queueDrain(self);
+
+	// the writer lock is held until the transaction is
+	// committed or rolled back
+	pthread_mutex_lock(&self->writer);
+	if(self->txn)
+	{
+		LOGE("invalid txn");
+		pthread_mutex_unlock(&self->writer);
+		return 0;
+	}
+
+	if(bfs_file_step(self, self->stmt_txn_begin) == 0)
+	{
+		pthread_mutex_unlock(&self->writer);
+		return 0;
+	}
+	self->txn = 1;
+
+	return 1;
+}
+
+int bfs_file_txnCommit(bfs_file_t* self)
+{
+	ASSERT(self);
+
+	if(self->mode != BFS_MODE_RDWR)
+	{
+		LOGE("invalid mode");
+		return 0;
+	}
+
+	// only the owner may acquire the writer lock while the
+	// transaction is active
+	pthread_mutex_lock(&self->writer);
+	if(self->txn == 0)
+	{
+		LOGE("invalid txn");
+		pthread_mutex_unlock(&self->writer);
+		return 0;
+	}
+
+	if(self->wal == 0)
+	{
+		bfs_file_excludeReaders(self);
+	}
+
+	// the transaction is rolled back if the commit fails
+	int ret = bfs_file_totalFlush(self);
+	if(ret)
+	{
+		ret = bfs_file_step(self, self->stmt_end);
+	}
+
+	if(ret == 0)
+	{
+		bfs_file_step(self, self->stmt_txn_rollback);
+		self->total.count = 0;
+		self->total.bytes = 0;
+	}
+
+	if(self->wal == 0)
+	{
+		bfs_file_includeReaders(self);
+	}
+
+	if(self->cache)
+	{
+		bfs_cache_commit(self->cache);
+	}
+
+	if(ret)
+	{
+		bfs_file_attrsCommit(self);
+	}
+	else
+	{
+		bfs_file_attrsDiscard(self);
+	}
+
+	self->txn = 0;
+	pthread_mutex_unlock(&self->writer);
+	pthread_mutex_unlock(&self->writer);
+
+	return ret;
+}
+
+int bfs_file_txnRollback(bfs_file_t* self)
+{
+	ASSERT(self);
+
+	if(self->mode != BFS_MODE_RDWR)
+	{
+		LOGE("invalid mode");
+		return 0;
+	}
+
+	pthread_mutex_lock(&self->writer);
+	if(self->txn == 0)
+	{
+		LOGE("invalid txn");
+		pthread_mutex_unlock(&self->writer);
+		return 0;
+	}
+
+	int ret = bfs_file_step(self, self->stmt_txn_rollback);
+	self->total.count = 0;
+	self->total.bytes = 0;
+
+	if(self->cache)
+	{
+		bfs_cache_commit(self->cache);
+	}
+	bfs_file_attrsDiscard(self);
+
+	self->txn = 0;
+	pthread_mutex_unlock(&self->writer);
+	pthread_mutex_unlock(&self->writer);
+
+	return ret;
+}
+
+int bfs_file_attrList(bfs_file_t* self, int tid,
+                      void* priv, bfs_attr_fn attr_fn)
+{
+	// priv may be NULL
+	ASSERT(self);
+	ASSERT(attr_fn);
+
+	if(self->mode == BFS_MODE_STREAM)
+	{
+		LOGE("invalid mode");
+		return 0;
+	}
+
+	// include the queued writes
+	bfs_file_queueDrain(self);
+
+	bfs_file_lockRead(self, tid);
+
+	const char*   key;
+	const char*   val;
+	int           ret  = 1;
+	bfs_conn_t*   conn = &self->conn[tid];
+	sqlite3_stmt* stmt = conn->stmt_attr_list;
+	int           step = sqlite3_step(stmt);
+	while(step == SQLITE_ROW)
+	{
+		key  = (const char*) sqlite3_column_text(stmt, 0);
+		val  = (const char*) sqlite3_column_text(stmt, 1);
+		ret &= (*attr_fn)(priv, key, val);
+		step = sqlite3_step(stmt);
+	}
+
+	if(step != SQLITE_DONE)
+	{
+		LOGE("sqlite3_step: %s", sqlite3_errmsg(conn->db));
+		ret = 0;
+	}
+
+	if(sqlite3_reset(stmt) != SQLITE_OK)
+	{
+		LOGW("sqlite3_reset failed");
+	}
+
+	bfs_file_unlockRead(self, tid);
+
+	return ret;
+}
+
+static int
+bfs_file_attrGetImpl(bfs_file_t* self, int tid,
+                     const char* key,
+                     size_t size, char* val)
+{
+	ASSERT(self);
+	ASSERT(key);
+	ASSERT(size > 0);
+	ASSERT(val);
+
+	// allow return success with empty data
+	val[0] = '\0';
+
+	if(self->mode == BFS_MODE_STREAM)
+	{
+		LOGE("invalid mode");
+		return 0;
+	}
+
+	// read queued writes
+	bfs_ticket_t* ticket;
+	ticket = bfs_file_queueFind(self, BFS_OP_ATTR_SET, key);
+	if(ticket)
+	{
+		if(ticket->type == BFS_OP_ATTR_SET)
+		{
+			snprintf(val, size, "%s",
+			         (const char*) ticket->data);
+		}
+		bfs_file_queueUnref(self, ticket);
+		return 1;
+	}
+
+	if(self->attrs)
+	{
+		size_t      len;
+		const char* tmp;
+		tmp = bfs_attrs_get(bfs_file_attrsAcquire(self, tid),
+		                    key, &len);
+		if(tmp)
+		{
+			snprintf(val, size, "%s", tmp);
+		}
+		return 1;
+	}
+
+	bfs_file_lockRead(self, tid);
+
+	int           idx  = self->idx_attr_get_key;
+	bfs_conn_t*   conn = &self->conn[tid];
+	sqlite3_stmt* stmt = conn->stmt_attr_get;
+	if(sqlite3_bind_text(stmt, idx, key, -1,
+	                     SQLITE_TRANSIENT) != SQLITE_OK)
+	{
+		LOGE("sqlite3_bind_text: key=%s", key);
+		bfs_file_unlockRead(self, tid);
+		return 0;
+	}
+
+	int ret  = 1;
+	int step = sqlite3_step(stmt);
+	if(step == SQLITE_ROW)
+	{
+		const char* tmp;
+		tmp = (const char*) sqlite3_column_text(stmt, 0);
+		if(tmp)
+		{
+			snprintf(val, size, "%s", tmp);
+		}
+	}
+	else if(step != SQLITE_DONE)
+	{
+		LOGE("sqlite3_step: key=%s, msg=%s",
+		     key, sqlite3_errmsg(conn->db));
+		ret = 0;
+	}
+
+	if(sqlite3_reset(stmt) != SQLITE_OK)
+	{
+		LOGW("sqlite3_reset failed");
+	}
+
+	bfs_file_unlockRead(self, tid);
+
+	return ret;
+}
+
+int bfs_file_attrGet(bfs_file_t* self, int tid,
+                     const char* key,
+                     size_t size, char* val)
+{
+	ASSERT(self);
+	ASSERT(key);
+	ASSERT(size > 0);
+	ASSERT(val);
+
+	uint64_t t0  = bfs_file_statsBegin();
+	int      ret = bfs_file_attrGetImpl(self, tid, key, size, val);
+	return bfs_file_statsEnd(self, tid, BFS_STATS_ATTR_GET, t0,
+	                         ret, 0, strlen(val));
+}
+
+int bfs_file_attrGetPtr(bfs_file_t* self, int tid,
+                        const char* key,
+                        const char** _val, size_t* _len)
+{
+	ASSERT(self);
+	ASSERT(key);
+	ASSERT(_val);
+	ASSERT(_len);
+
+	// allow return success with empty data
+	*_val = NULL;
+	*_len = 0;
+
+	if(self->attrs == NULL)
+	{
+		LOGE("invalid attr_snapshot");
+		return 0;
+	}
+
+	// the value of a queued write is not stable so wait
+	// until it is committed unless the caller owns the
+	// transaction which blocks the queue
+	bfs_ticket_t* ticket;
+	ticket = bfs_file_queueFind(self, BFS_OP_ATTR_SET, key);
+	if(ticket)
+	{
+		if(bfs_file_queueBypass(self))
+		{
+			bfs_file_queueUnref(self, ticket);
+		}
+		else
+		{
+			bfs_file_wait(self, &ticket);
+		}
+	}
+
+	*_val = bfs_attrs_get(bfs_file_attrsAcquire(self, tid),
+	                      key, _len);
+
+	return 1;
+}
+
+static int
+bfs_file_attrSetImpl(bfs_file_t* self, const char* key,
+                     const char* val)
+{
+	// val may be NULL
+	ASSERT(self);
+	ASSERT(key);
+
+	if(val == NULL)
+	{
+		return bfs_file_attrClr(self, key);
+	}
+
+	if(bfs_file_queueBypass(self) == 0)
+	{
+		bfs_ticket_t* ticket = NULL;
+		if(bfs_file_queuePut(self, BFS_OP_ATTR_SET, key,
+		                     strlen(val) + 1, val,
+		                     &ticket) == 0)
+		{
+			return 0;
+		}
+		return bfs_file_wait(self, &ticket);
+	}
+
+	bfs_file_lockExclusive(self);
+	if(bfs_file_beginTransaction(self, strlen(val)) == 0)
+	{
+		bfs_file_unlockExclusive(self);
+		return 0;
+	}
+
+	bfs_attrs_t* attrs = NULL;
+	if(self->attrs)
+	{
+		attrs = bfs_file_attrsPrepare(self, key, val);
+		if(attrs == NULL)
+		{
+			bfs_file_unlockExclusive(self);
+			return 0;
+		}
+	}
+
+	int           idx_key;
+	int           idx_val;
+	sqlite3_stmt* stmt;
+	idx_key = self->idx_attr_set_key;
+	idx_val = self->idx_attr_set_val;
+	stmt    = self->stmt_attr_set;
+	if((sqlite3_bind_text(stmt, idx_key, key, -1,
+	                      SQLITE_TRANSIENT) != SQLITE_OK) ||
+	   (sqlite3_bind_text(stmt, idx_val, val, -1,
+	                      SQLITE_TRANSIENT) != SQLITE_OK))
+	{
+		LOGE("sqlite3_bind_text: key=%s, val=%s", key, val);
+		bfs_attrs_delete(&attrs);
+		bfs_file_unlockExclusive(self);
+		return 0;
+	}
+
+	int ret = 1;
+	if(sqlite3_step(stmt) != SQLITE_DONE)
+	{
+		LOGE("sqlite3_step: key=%s, val=%s, msg=%s",
+		     key, val, sqlite3_errmsg(self->db));
+		ret = 0;
+	}
+
+	if(sqlite3_reset(stmt) != SQLITE_OK)
+	{
+		LOGW("sqlite3_reset failed");
+	}
+
+	// the snapshot is published when the write is committed
+	if(attrs && ret)
+	{
+		bfs_file_attrsStage(self, attrs);
+	}
+	else
+	{
+		bfs_attrs_delete(&attrs);
+	}
+
+	bfs_file_unlockExclusive(self);
+
+	return ret;
+}
+
+int bfs_file_attrSet(bfs_file_t* self, const char* key,
+                     const char* val)
+{
+	// val may be NULL
+	ASSERT(self);
+	ASSERT(key);
+
+	uint64_t t0  = bfs_file_statsBegin();
+	int      ret = bfs_file_attrSetImpl(self, key, val);
+	return bfs_file_statsEnd(self, -1, BFS_STATS_ATTR_SET, t0,
+	                         ret, val ? strlen(val) : 0, 0);
+}
+
+static int
+bfs_file_attrClrImpl(bfs_file_t* self, const char* key)
+{
+	ASSERT(self);
+	ASSERT(key);
+
+	if(bfs_file_queueBypass(self) == 0)
+	{
+		bfs_ticket_t* ticket = NULL;
+		if(bfs_file_queuePut(self, BFS_OP_ATTR_CLR, key,
+		                     0, NULL, &ticket) == 0)
+		{
+			return 0;
+		}
+		return bfs_file_wait(self, &ticket);
+	}
+
+	bfs_file_lockExclusive(self);
+	if(bfs_file_beginTransaction(self, 0) == 0)
+	{
+		bfs_file_unlockExclusive(self);
+		return 0;
+	}
+
+	bfs_attrs_t* attrs = NULL;
+	if(self->attrs)
+	{
+		attrs = bfs_file_attrsPrepare(self, key, NULL);
+		if(attrs == NULL)
+		{
+			bfs_file_unlockExclusive(self);
+			return 0;
+		}
+	}
+
+	int idx_key;
+	sqlite3_stmt* stmt;
+	idx_key = self->idx_attr_clr_key;
+	stmt    = self->stmt_attr_clr;
+	if(sqlite3_bind_text(stmt, idx_key, key, -1,
+	                     SQLITE_TRANSIENT) != SQLITE_OK)
+	{
+		LOGE("sqlite3_bind_text: key=%s", key);
+		bfs_attrs_delete(&attrs);
+		bfs_file_unlockExclusive(self);
+		return 0;
+	}
+
+	int ret = 1;
+	if(sqlite3_step(stmt) != SQLITE_DONE)
+	{
+		LOGE("sqlite3_step: key=%s, msg=%s",
+		     key, sqlite3_errmsg(self->db));
+		ret = 0;
+	}
+
+	if(sqlite3_reset(stmt) != SQLITE_OK)
+	{
+		LOGW("sqlite3_reset failed");
+	}
+
+	// the snapshot is published when the write is committed
+	if(attrs && ret)
+	{
+		bfs_file_attrsStage(self, attrs);
+	}
+	else
+	{
+		bfs_attrs_delete(&attrs);
+	}
+
+	bfs_file_unlockExclusive(self);
+
+	return ret;
+}
+
+int bfs_file_attrClr(bfs_file_t* self, const char* key)
+{
+	ASSERT(self);
+	ASSERT(key);
+
+	uint64_t t0  = bfs_file_statsBegin();
+	int      ret = bfs_file_attrClrImpl(self, key);
+	return bfs_file_statsEnd(self, -1, BFS_STATS_ATTR_CLR, t0,
+	                         ret, 0, 0);
+}
+
+int bfs_file_blobCount(bfs_file_t* self, int tid,
+                       uint64_t* _count)
+{
+	ASSERT(self);
+	ASSERT(_count);
+
+	*_count = 0;
+
+	return bfs_file_blobTotal(self, tid, _count, NULL);
+}
+
+int bfs_file_totalBytes(bfs_file_t* self, int tid,
+                        uint64_t* _bytes)
+{
+	ASSERT(self);
+	ASSERT(_bytes);
+
+	*_bytes = 0;
+
+	return bfs_file_blobTotal(self, tid, NULL, _bytes);
+}
+
+static int
+bfs_file_blobListImpl(bfs_file_t* self, int tid,
+                      void* priv, bfs_blob_fn blob_fn,
+                      const char* pattern)
+{
+	// priv and pattern may be NULL
+	ASSERT(self);
+	ASSERT(blob_fn);
+
+	if(self->mode == BFS_MODE_STREAM)
+	{
+		LOGE("invalid mode");
+		return 0;
+	}
+
+	// include the queued writes
+	bfs_file_queueDrain(self);
+
+	bfs_file_lockRead(self, tid);
+
+	bfs_conn_t*   conn = &self->conn[tid];
+	sqlite3_stmt* stmt = conn->stmt_blob_list;
+	if(pattern)
+	{
+		stmt = conn->stmt_blob_like;
+
+		int idx = self->idx_blob_like_pat;
+		if(sqlite3_bind_text(stmt, idx, pattern, -1,
+		                     SQLITE_TRANSIENT) != SQLITE_OK)
+		{
+			LOGE("sqlite3_bind_text: pattern=%s",
+			     pattern);
+			bfs_file_unlockRead(self, tid);
+			return 0;
+		}
+	}
+
+	int ret = bfs_file_blobListStep(self, conn, stmt,
+	                                priv, blob_fn);
+
+	bfs_file_unlockRead(self, tid);
+
+	return ret;
+}
+
+int bfs_file_blobList(bfs_file_t* self, int tid,
+                      void* priv, bfs_blob_fn blob_fn,
+                      const char* pattern)
+{
+	// priv and pattern may be NULL
+	ASSERT(self);
+	ASSERT(blob_fn);
+
+	uint64_t t0  = bfs_file_statsTimestamp();
+	int      ret = bfs_file_blobListImpl(self, tid, priv,
+	                                     blob_fn, pattern);
+	bfs_file_statsAdd(self, tid, BFS_STATS_BLOB_LIST, t0,
+	                  ret, 0, 0);
+	return ret;
+}
+
+static int
+bfs_file_blobListPrefixImpl(bfs_file_t* self, int tid,
+                            void* priv, bfs_blob_fn blob_fn,
+                            const char* prefix)
+{
+	// priv may be NULL
+	ASSERT(self);
+	ASSERT(blob_fn);
+	ASSERT(prefix);
+
+	if(self->mode == BFS_MODE_STREAM)
+	{
+		LOGE("invalid mode");
+		return 0;
+	}
+
+	// include the queued writes
+	bfs_file_queueDrain(self);
+
+	bfs_file_lockRead(self, tid);
+
+	char*         hi   = NULL;
+	bfs_conn_t*   conn = &self->conn[tid];
+	sqlite3_stmt* stmt = conn->stmt_blob_range;
+	if(bfs_file_blobListRange(stmt, self->idx_blob_range_lo,
+	                          self->idx_blob_range_hi,
+	                          prefix, strlen(prefix),
+	                          NULL, &hi) == 0)
+	{
+		bfs_file_unlockRead(self, tid);
+		return 0;
+	}
+
+	int ret = bfs_file_blobListStep(self, conn, stmt,
+	                                priv, blob_fn);
+	FREE(hi);
+
+	bfs_file_unlockRead(self, tid);
+
+	return ret;
+}
+
+int bfs_file_blobListPrefix(bfs_file_t* self, int tid,
+                            void* priv, bfs_blob_fn blob_fn,
+                            const char* prefix)
+{
+	// priv may be NULL
+	ASSERT(self);
+	ASSERT(blob_fn);
+	ASSERT(prefix);
+
+	uint64_t t0  = bfs_file_statsTimestamp();
+	int      ret = bfs_file_blobListPrefixImpl(self, tid, priv,
+	                                           blob_fn, prefix);
+	bfs_file_statsAdd(self, tid, BFS_STATS_BLOB_LIST, t0,
+	                  ret, 0, 0);
+	return ret;
+}
+
+static int
+bfs_file_blobListGlobImpl(bfs_file_t* self, int tid,
+                          void* priv, bfs_blob_fn blob_fn,
+                          const char* pattern)
+{
+	// priv may be NULL
+	ASSERT(self);
+	ASSERT(blob_fn);
+	ASSERT(pattern);
+
+	if(self->mode == BFS_MODE_STREAM)
+	{
+		LOGE("invalid mode");
+		return 0;
+	}
+
+	// include the queued writes
+	bfs_file_queueDrain(self);
+
+	bfs_file_lockRead(self, tid);
+
+	// the literal prefix of the pattern selects the range
+	// of names which are matched by GLOB
+	char*         hi   = NULL;
+	bfs_conn_t*   conn = &self->conn[tid];
+	sqlite3_stmt* stmt = conn->stmt_blob_glob;
+	if(bfs_file_blobListRange(stmt, self->idx_blob_glob_lo,
+	                          self->idx_blob_glob_hi,
+	                          pattern, strcspn(pattern, "*?["),
+	                          NULL, &hi) == 0)
+	{
+		bfs_file_unlockRead(self, tid);
+		return 0;
+	}
+
+	if(sqlite3_bind_text(stmt, self->idx_blob_glob_pat,
+	                     pattern, -1,
+	                     SQLITE_STATIC) != SQLITE_OK)
+	{
+		LOGE("sqlite3_bind_text: pattern=%s", pattern);
+		sqlite3_reset(stmt);
+		FREE(hi);
+		bfs_file_unlockRead(self, tid);
+		return 0;
+	}
+
+	int ret = bfs_file_blobListStep(self, conn, stmt,
+	                                priv, blob_fn);
+	FREE(hi);
+
+	bfs_file_unlockRead(self, tid);
+
+	return ret;
+}
+
+int bfs_file_blobListGlob(bfs_file_t* self, int tid,
+                          void* priv, bfs_blob_fn blob_fn,
+                          const char* pattern)
+{
+	// priv may be NULL
+	ASSERT(self);
+	ASSERT(blob_fn);
+	ASSERT(pattern);
+
+	uint64_t t0  = bfs_file_statsTimestamp();
+	int      ret = bfs_file_blobListGlobImpl(self, tid, priv,
+	                                         blob_fn, pattern);
+	bfs_file_statsAdd(self, tid, BFS_STATS_BLOB_LIST, t0,
+	                  ret, 0, 0);
+	return ret;
+}
+
+static int
+bfs_file_blobListPageImpl(bfs_file_t* self, int tid,
+                          const char* prefix,
+                          const char* after,
+                          int limit,
+                          bfs_blobPage_t* page)
+{
+	// prefix and after may be NULL
+	ASSERT(self);
+	ASSERT(page);
+
+	page->count     = 0;
+	page->more      = 0;
+	page->names_len = 0;
+
+	if(self->mode == BFS_MODE_STREAM)
+	{
+		LOGE("invalid mode");
+		return 0;
+	}
+
+	if(limit <= 0)
+	{
+		LOGE("invalid limit=%i", limit);
+		return 0;
+	}
+
+	if(prefix == NULL)
+	{
+		prefix = "";
+	}
+
+	// names before the prefix cannot resume the listing
+	if(after && (strcmp(after, prefix) < 0))
+	{
+		after = NULL;
+	}
+
+	// include the queued writes
+	bfs_file_queueDrain(self);
+
+	bfs_file_lockRead(self, tid);
+
+	// the page stops at limit names and the extra name
+	// determines if the listing is complete
+	char*         hi   = NULL;
+	bfs_conn_t*   conn = &self->conn[tid];
+	sqlite3_stmt* stmt = conn->stmt_blob_page;
+	int           idx_lo    = self->idx_blob_page_lo;
+	int           idx_hi    = self->idx_blob_page_hi;
+	int           idx_limit = self->idx_blob_page_limit;
+	if(after)
+	{
+		stmt      = conn->stmt_blob_next;
+		idx_lo    = self->idx_blob_next_lo;
+		idx_hi    = self->idx_blob_next_hi;
+		idx_limit = self->idx_blob_next_limit;
+	}
+
+	if(bfs_file_blobListRange(stmt, idx_lo, idx_hi,
+	                          prefix, strlen(prefix),
+	                          after, &hi) == 0)
+	{
+		bfs_file_unlockRead(self, tid);
+		return 0;
+	}
+
+	if(sqlite3_bind_int(stmt, idx_limit,
+	                    limit + 1) != SQLITE_OK)
+	{
+		LOGE("sqlite3_bind_int: limit=%i", limit);
+		sqlite3_reset(stmt);
+		FREE(hi);
+		bfs_file_unlockRead(self, tid);
+		return 0;
+	}
+
+	int ret  = 1;
+	int step = sqlite3_step(stmt);
+	while(step == SQLITE_ROW)
+	{
+		if(page->count == limit)
+		{
+			page->more = 1;
+			break;
+		}
+
+		size_t      size;
+		const char* name;
+		name = (const char*) sqlite3_column_text(stmt, 0);
+		size = (size_t) sqlite3_column_int64(stmt, 1);
+		if(bfs_blobPage_add(page, name, size) == 0)
+		{
+			ret = 0;
+			break;
+		}
+		step = sqlite3_step(stmt);
+	}
+
+	if((step != SQLITE_DONE) && (step != SQLITE_ROW))
+	{
+		LOGE("sqlite3_step: %s", sqlite3_errmsg(conn->db));
+		ret = 0;
+	}
+
+	if(sqlite3_reset(stmt) != SQLITE_OK)
+	{
+		LOGW("sqlite3_reset failed");
+	}
+	FREE(hi);
+
+	bfs_file_unlockRead(self, tid);
+
+	if(ret == 0)
+	{
+		page->count     = 0;
+		page->more      = 0;
+		page->names_len = 0;
+	}
+
+	return ret;
+}
+
+int bfs_file_blobListPage(bfs_file_t* self, int tid,
+                          const char* prefix,
+                          const char* after,
+                          int limit,
+                          bfs_blobPage_t* page)
+{
+	// prefix and after may be NULL
+	ASSERT(self);
+	ASSERT(page);
+
+	uint64_t t0  = bfs_file_statsTimestamp();
+	int      ret = bfs_file_blobListPageImpl(self, tid, prefix,
+	                                         after, limit, page);
+	bfs_file_statsAdd(self, tid, BFS_STATS_BLOB_LIST, t0,
+	                  ret, 0, 0);
+	return ret;
+}
+
+static int
+bfs_file_blobGetImpl(bfs_file_t* self, int tid,
+                     const char* name,
+                     size_t* _size, void** _data)
+{
+	// _data may be NULL
+	ASSERT(self);
+	ASSERT(name);
+	ASSERT(_size);
+
+	// allow return success with empty data
+	*_size = 0;
+
+	if(self->mode == BFS_MODE_STREAM)
+	{
+		LOGE("invalid mode");
+		return 0;
+	}
+	else if(self->cache)
+	{
+		// copy the cached buffer
+		bfs_buffer_t* buffer = NULL;
+		if(bfs_file_blobGetBuffer(self, tid, name,
+		                          &buffer) == 0)
+		{
+			return 0;
+		}
+
+		int ret = 1;
+		if(buffer)
+		{
+			size_t size = bfs_buffer_size(buffer);
+			if(_data)
+			{
+				ret = bfs_file_alloc(_data, size);
+				if(ret)
+				{
+					memcpy(*_data, bfs_buffer_data(buffer), size);
+				}
+			}
+
+			if(ret)
+			{
+				*_size = size;
+			}
+			bfs_buffer_unref(&buffer);
+		}
+		return ret;
+	}
+
+	// read queued writes
+	bfs_ticket_t* ticket;
+	ticket = bfs_file_queueFind(self, BFS_OP_BLOB_SET, name);
+	if(ticket)
+	{
+		int ret = bfs_file_queueCopy(ticket, _size, _data);
+		bfs_file_queueUnref(self, ticket);
+		return ret;
+	}
+
+	bfs_file_lockRead(self, tid);
+
+	int           idx  = self->idx_blob_get_name;
+	bfs_conn_t*   conn = &self->conn[tid];
+	sqlite3_stmt* stmt = conn->stmt_blob_get;
+	if(sqlite3_bind_text(stmt, idx, name, -1,
+	                     SQLITE_TRANSIENT) != SQLITE_OK)
+	{
+		LOGE("sqlite3_bind_text: name=%s", name);
+		bfs_file_unlockRead(self, tid);
+		return 0;
+	}
+
+	int ret = bfs_file_blobFetch(self, conn, stmt,
+	                             _size, _data);
+
+	bfs_file_unlockRead(self, tid);
+
+	return ret;
+}
+
+int bfs_file_blobGet(bfs_file_t* self, int tid,
+                     const char* name,
+                     size_t* _size, void** _data)
+{
+	// _data may be NULL
+	ASSERT(self);
+	ASSERT(name);
+	ASSERT(_size);
+
+	uint64_t t0  = bfs_file_statsBegin();
+	int      ret = bfs_file_blobGetImpl(self, tid, name,
+	                                    _size, _data);
+	return bfs_file_statsEnd(self, tid, BFS_STATS_BLOB_GET, t0,
+	                         ret, 0, ret ? *_size : 0);
+}
+
+static int
+bfs_file_blobGetBufferImpl(bfs_file_t* self, int tid,
+                           const char* name,
+                           bfs_buffer_t** _buffer)
+{
+	ASSERT(self);
+	ASSERT(name);
+	ASSERT(_buffer);
+
+	// allow return success with empty buffer
+	*_buffer = NULL;
+
+	if(self->mode == BFS_MODE_STREAM)
+	{
+		LOGE("invalid mode");
+		return 0;
+	}
+
+	// read queued writes which are not cached
+	bfs_ticket_t* ticket;
+	ticket = bfs_file_queueFind(self, BFS_OP_BLOB_SET, name);
+	if(ticket)
+	{
+		int ret = 1;
+		if(ticket->size)
+		{
+			void* data = NULL;
+			*_buffer = bfs_buffer_new(ticket->size, &data);
+			if(*_buffer)
+			{
+				memcpy(data, ticket->data, ticket->size);
+			}
+			else
+			{
+				ret = 0;
+			}
+		}
+		bfs_file_queueUnref(self, ticket);
+		return ret;
+	}
+
+	// the sequence number must be read before the blob
+	uint64_t seq = 0;
+	if(self->cache)
+	{
+		*_buffer = bfs_cache_find(self->cache, name, &seq);
+		if(*_buffer)
+		{
+			return 1;
+		}
+	}
+
+	if(bfs_file_blobLoad(self, tid, name, _buffer) == 0)
+	{
+		return 0;
+	}
+
+	if(self->cache && *_buffer)
+	{
+		bfs_cache_add(self->cache, name, seq, *_buffer);
+	}
+
+	return 1;
+}
+
+int bfs_file_blobGetBuffer(bfs_file_t* self, int tid,
+                           const char* name,
+                           bfs_buffer_t** _buffer)
+{
+	ASSERT(self);
+	ASSERT(name);
+	ASSERT(_buffer);
+
+	uint64_t t0  = bfs_file_statsBegin();
+	int      ret = bfs_file_blobGetBufferImpl(self, tid, name,
+	                                          _buffer);
+	return bfs_file_statsEnd(self, tid, BFS_STATS_BLOB_GET, t0,
+	                         ret, 0,
+	                         *_buffer ? bfs_buffer_size(*_buffer) : 0);
+}
+
+static int
+bfs_file_blobGetManyImpl(bfs_file_t* self, int tid,
+                         int count, const char** names,
+                         size_t* sizes, void** datas)
+{
+	// datas may be NULL
+	ASSERT(self);
+	ASSERT(names);
+	ASSERT(sizes);
+
+	// allow return success with empty data
+	int i;
+	for(i = 0; i < count; ++i)
+	{
+		sizes[i] = 0;
+	}
+
+	if(self->mode == BFS_MODE_STREAM)
+	{
+		LOGE("invalid mode");
+		return 0;
+	}
+	else if(count <= 0)
+	{
+		return 1;
+	}
+
+	bfs_fetch_t* fetch;
+	fetch = (bfs_fetch_t*)
+	        CALLOC(count, sizeof(bfs_fetch_t));
+	if(fetch == NULL)
+	{
+		LOGE("CALLOC failed");
+		return 0;
+	}
+
+	// read queued writes before the snapshot so that
+	// operations committed in the meantime are included
+	// in the snapshot
+	char* skip = NULL;
+	if(self->queue)
+	{
+		skip = (char*) CALLOC(count, sizeof(char));
+		if(skip == NULL)
+		{
+			LOGE("CALLOC failed");
+			goto fail_skip;
+		}
+
+		for(i = 0; i < count; ++i)
+		{
+			bfs_ticket_t* ticket;
+			ticket = bfs_file_queueFind(self, BFS_OP_BLOB_SET,
+			                            names[i]);
+			if(ticket == NULL)
+			{
+				continue;
+			}
+
+			int ret = bfs_file_queueCopy(ticket, &sizes[i],
+			                             datas ? &datas[i] : NULL);
+			bfs_file_queueUnref(self, ticket);
+			if(ret == 0)
+			{
+				goto fail_queue;
+			}
+			skip[i] = 1;
+		}
+	}
+
+	bfs_file_lockRead(self, tid);
+
+	// the names are resolved and the blobs are read from a
+	// single snapshot
+	bfs_conn_t* conn = &self->conn[tid];
+	if(bfs_conn_step(conn, conn->stmt_begin) == 0)
+	{
+		goto fail_begin;
+	}
+
+	int found = 0;
+	if(bfs_file_fetchResolve(self, conn, count, names,
+	                         skip, fetch, &found) == 0)
+	{
+		goto fail_resolve;
+	}
+
+	// visit the rows in table order for locality
+	qsort(fetch, found, sizeof(bfs_fetch_t),
+	      bfs_fetch_compare);
+
+	if(bfs_file_fetchRead(self, conn, found, fetch,
+	                      sizes, datas) == 0)
+	{
+		goto fail_read;
+	}
+
+	bfs_conn_step(conn, conn->stmt_end);
+	bfs_file_unlockRead(self, tid);
+	FREE(skip);
+	FREE(fetch);
+
+	// success
+	return 1;
+
+	// failure
+	fail_read:
+	fail_resolve:
+		bfs_conn_step(conn, conn->stmt_end);
+	fail_begin:
+		bfs_file_unlockRead(self, tid);
+	fail_queue:
+		FREE(skip);
+	fail_skip:
+		FREE(fetch);
+	return 0;
+}
+
+int bfs_file_blobGetMany(bfs_file_t* self, int tid,
+                         int count, const char** names,
+                         size_t* sizes, void** datas)
+{
+	// datas may be NULL
+	ASSERT(self);
+	ASSERT(names);
+	ASSERT(sizes);
+
+	uint64_t t0  = bfs_file_statsBegin();
+	int      ret = bfs_file_blobGetManyImpl(self, tid, count,
+	                                        names, sizes, datas);
+
+	size_t bytes = 0;
+	int    i;
+	for(i = 0; ret && (i < count); ++i)
+	{
+		bytes += sizes[i];
+	}
+
+	return bfs_file_statsEnd(self, tid, BFS_STATS_BLOB_GET_MANY,
+	                         t0, ret, 0, bytes);
+}
+
+static int
+bfs_file_blobGetFnImpl(bfs_file_t* self, int tid,
+                       const char* name, void* priv,
+                       bfs_data_fn data_fn)
+{
+	// priv may be NULL
+	ASSERT(self);
+	ASSERT(name);
+	ASSERT(data_fn);
+
+	if(self->mode == BFS_MODE_STREAM)
+	{
+		LOGE("invalid mode");
+		return 0;
+	}
+	else if(self->cache)
+	{
+		// the cached buffer remains valid for the callback
+		bfs_buffer_t* buffer = NULL;
+		if(bfs_file_blobGetBuffer(self, tid, name,
+		                          &buffer) == 0)
+		{
+			return 0;
+		}
+
+		int ret = 1;
+		if(buffer)
+		{
+			ret = (*data_fn)(priv, name,
+			                 bfs_buffer_size(buffer),
+			                 bfs_buffer_data(buffer));
+			bfs_buffer_unref(&buffer);
+		}
+		return ret;
+	}
+
+	// read queued writes
+	bfs_ticket_t* ticket;
+	ticket = bfs_file_queueFind(self, BFS_OP_BLOB_SET, name);
+	if(ticket)
+	{
+		int ret = 1;
+		if(ticket->size)
+		{
+			ret = (*data_fn)(priv, name, ticket->size,
+			                 ticket->data);
+		}
+		bfs_file_queueUnref(self, ticket);
+		return ret;
+	}
+
+	bfs_file_lockRead(self, tid);
+
+	// name is only referenced until the statement is reset
+	int           idx  = self->idx_blob_get_name;
+	bfs_conn_t*   conn = &self->conn[tid];
+	sqlite3_stmt* stmt = conn->stmt_blob_get;
+	if(sqlite3_bind_text(stmt, idx, name, -1,
+	                     SQLITE_STATIC) != SQLITE_OK)
+	{
+		LOGE("sqlite3_bind_text: name=%s", name);
+		bfs_file_unlockRead(self, tid);
+		return 0;
+	}
+
+	int ret  = 1;
+	int step = sqlite3_step(stmt);
+	if(step == SQLITE_ROW)
+	{
+		if(sqlite3_column_type(stmt, 1) == SQLITE_NULL)
+		{
+			// chunked blobs are assembled in a temporary
+			// buffer (see bfs_blobReader_t for large blobs)
+			sqlite3_int64 bid  = sqlite3_column_int64(stmt, 0);
+			size_t        size = 0;
+			void*         data = NULL;
+			ret = bfs_file_chunkSize(self, conn->db,
+			                         conn->stmt_chunk_size,
+			                         bid, &size);
+			if(ret && size)
+			{
+				ret = bfs_file_alloc(&data, size) &&
+				      bfs_file_chunkCopy(self, conn, bid,
+				                         size, data) &&
+				      bfs_file_checkCrc(bfs_file_columnCrc(stmt, 4),
+				                        size, data) &&
+				      (*data_fn)(priv, name, size, data);
+				FREE(data);
+			}
+		}
+		else if(sqlite3_column_int(stmt, 2))
+		{
+			// compressed blobs are decompressed into a
+			// temporary buffer
+			const void* blob  = sqlite3_column_blob(stmt, 1);
+			size_t      bytes = (size_t) sqlite3_column_bytes(stmt, 1);
+			int         codec = sqlite3_column_int(stmt, 2);
+			size_t      size  = (size_t) sqlite3_column_int64(stmt, 3);
+			void*       data  = NULL;
+			if(blob && size)
+			{
+				ret = bfs_file_alloc(&data, size) &&
+				      bfs_file_decode(codec, bytes, blob,
+				                      size, data) &&
+				      bfs_file_checkCrc(bfs_file_columnCrc(stmt, 4),
+				                        size, data) &&
+				      (*data_fn)(priv, name, size, data);
+				FREE(data);
+			}
+		}
+		else
+		{
+			// the blob is borrowed from the sqlite3 row buffer
+			// which remains valid until the statement is reset
+			const void* blob = sqlite3_column_blob(stmt, 1);
+			size_t      size = (size_t) sqlite3_column_bytes(stmt, 1);
+			if(blob && size)
+			{
+				ret = bfs_file_checkCrc(bfs_file_columnCrc(stmt, 4),
+				                        size, blob) &&
+				      (*data_fn)(priv, name, size, blob);
+			}
+		}
+	}
+	else if(step != SQLITE_DONE)
+	{
+		LOGE("sqlite3_step: name=%s, msg=%s",
+		     name, sqlite3_errmsg(conn->db));
+		ret = 0;
+	}
+
+	if(sqlite3_reset(stmt) != SQLITE_OK)
+	{
+		LOGW("sqlite3_reset failed");
+	}
+
+	bfs_file_unlockRead(self, tid);
+
+	return ret;
+}
+
+int bfs_file_blobGetFn(bfs_file_t* self, int tid,
+                       const char* name, void* priv,
+                       bfs_data_fn data_fn)
+{
+	// priv may be NULL
+	ASSERT(self);
+	ASSERT(name);
+	ASSERT(data_fn);
+
+	#if BFS_STATS
+	// count the bytes passed to data_fn
+	bfs_statsData_t sd =
+	{
+		.priv    = priv,
+		.data_fn = data_fn,
+	};
+
+	uint64_t t0  = bfs_file_statsBegin();
+	int      ret = bfs_file_blobGetFnImpl(self, tid, name,
+	                                      (void*) &sd,
+	                                      bfs_file_statsData);
+	return bfs_file_statsEnd(self, tid, BFS_STATS_BLOB_GET, t0,
+	                         ret, 0, sd.bytes);
+	#else
+	return bfs_file_blobGetFnImpl(self, tid, name, priv,
+	                              data_fn);
+	#endif
+}
+
+int bfs_file_blobLookup(bfs_file_t* self, int tid,
+                        const char* name,
+                        bfs_blobid_t* _id)
+{
+	ASSERT(self);
+	ASSERT(name);
+	ASSERT(_id);
+
+	// allow return success when the blob does not exist
+	*_id = 0;
+
+	if(self->mode == BFS_MODE_STREAM)
+	{
+		LOGE("invalid mode");
+		return 0;
+	}
+
+	// the rowid of a queued write is not known so wait
+	// until it is committed unless the caller owns the
+	// transaction which blocks the queue
+	bfs_ticket_t* ticket;
+	ticket = bfs_file_queueFind(self, BFS_OP_BLOB_SET, name);
+	if(ticket)
+	{
+		if(bfs_file_queueBypass(self))
+		{
+			bfs_file_queueUnref(self, ticket);
+		}
+		else
+		{
+			bfs_file_wait(self, &ticket);
+		}
+	}
+
+	bfs_file_lockRead(self, tid);
+
+	int           idx  = self->idx_blob_rowid_name;
+	bfs_conn_t*   conn = &self->conn[tid];
+	sqlite3_stmt* stmt = conn->stmt_blob_rowid;
+	if(sqlite3_bind_text(stmt, idx, name, -1,
+	                     SQLITE_STATIC) != SQLITE_OK)
+	{
+		LOGE("sqlite3_bind_text: name=%s", name);
+		bfs_file_unlockRead(self, tid);
+		return 0;
+	}
+
+	int ret  = 1;
+	int step = sqlite3_step(stmt);
+	if(step == SQLITE_ROW)
+	{
+		*_id = (bfs_blobid_t) sqlite3_column_int64(stmt, 0);
+	}
+	else if(step != SQLITE_DONE)
+	{
+		LOGE("sqlite3_step: name=%s, msg=%s",
+		     name, sqlite3_errmsg(conn->db));
+		ret = 0;
+	}
+
+	if(sqlite3_reset(stmt) != SQLITE_OK)
+	{
+		LOGW("sqlite3_reset failed");
+	}
+
+	bfs_file_unlockRead(self, tid);
+
+	return ret;
+}
+
+static int
+bfs_file_blobGetByIdImpl(bfs_file_t* self, int tid,
+                         bfs_blobid_t id,
+                         size_t* _size, void** _data)
+{
+	// _data may be NULL
+	ASSERT(self);
+	ASSERT(_size);
+
+	// allow return success with empty data
+	*_size = 0;
+
+	if(self->mode == BFS_MODE_STREAM)
+	{
+		LOGE("invalid mode");
+		return 0;
+	}
+
+	bfs_file_lockRead(self, tid);
+
+	// the rowid seek bypasses the name index, the blob
+	// cache and the write-behind queue
+	int           idx  = self->idx_blob_byid_bid;
+	bfs_conn_t*   conn = &self->conn[tid];
+	sqlite3_stmt* stmt = conn->stmt_blob_byid;
+	if(sqlite3_bind_int64(stmt, idx,
+	                      (sqlite3_int64) id) != SQLITE_OK)
+	{
+		LOGE("sqlite3_bind_int64: id=%" PRId64, (int64_t) id);
+		bfs_file_unlockRead(self, tid);
+		return 0;
+	}
+
+	int ret = bfs_file_blobFetch(self, conn, stmt,
+	                             _size, _data);
+
+	bfs_file_unlockRead(self, tid);
+
+	return ret;
+}
+
+int bfs_file_blobGetById(bfs_file_t* self, int tid,
+                         bfs_blobid_t id,
+                         size_t* _size, void** _data)
+{
+	// _data may be NULL
+	ASSERT(self);
+	ASSERT(_size);
+
+	uint64_t t0  = bfs_file_statsBegin();
+	int      ret = bfs_file_blobGetByIdImpl(self, tid, id,
+	                                        _size, _data);
+	return bfs_file_statsEnd(self, tid, BFS_STATS_BLOB_GET, t0,
+	                         ret, 0, ret ? *_size : 0);
+}
+
+static int
+bfs_file_blobSetImpl(bfs_file_t* self, const char* name,
+                     size_t size, const void* data)
+{
+	// data may be NULL
+	ASSERT(self);
+	ASSERT(name);
+
+	if((size == 0) || (data == NULL))
+	{
+		return bfs_file_blobClr(self, name);
+	}
+
+	if(bfs_file_queueBypass(self) == 0)
+	{
+		bfs_ticket_t* ticket = NULL;
+		if(bfs_file_queuePut(self, BFS_OP_BLOB_SET, name,
+		                     size, data, &ticket) == 0)
+		{
+			return 0;
+		}
+		return bfs_file_wait(self, &ticket);
+	}
+
+	// checksum, hash and compress the blob before the
+	// exclusive lock is acquired so that encoding does not
+	// block readers
+	int64_t crc = (int64_t) bfs_crc32c(0, data, size);
+	uint8_t hash[BFS_HASH128_SIZE];
+	int     dedup = self->dedup && (size >= DEDUP_MIN) &&
+	                (size <= self->chunk_size);
+	if(dedup)
+	{
+		bfs_hash128(data, size, hash);
+	}
+
+	int    codec = BFS_CODEC_NONE;
+	size_t bytes = size;
+	void*  enc   = NULL;
+	if(bfs_file_encode(self, size, data, &codec,
+	                   &bytes, &enc) == 0)
+	{
+		return 0;
+	}
+
+	bfs_file_lockExclusive(self);
+	bfs_file_cacheInvalidate(self, name);
+	if(bfs_file_beginTransaction(self, bytes) == 0)
+	{
+		bfs_file_unlockExclusive(self);
+		FREE(enc);
+		return 0;
+	}
+
+	// the blob, chunks and metadata are committed as a unit
+	// except that the stream mode adds the metadata of new
+	// blobs with the batch (see bfs_file_metaBatch) so the
+	// inline blobs are set by a single statement unless
+	// they are deduplicated
+	bfs_total_t save;
+	int         savepoint = (self->mode == BFS_MODE_RDWR) ||
+	                        (size > self->chunk_size) || dedup;
+	if(savepoint && (bfs_file_savepoint(self, &save) == 0))
+	{
+		bfs_file_unlockExclusive(self);
+		FREE(enc);
+		return 0;
+	}
+
+	sqlite3_int64 bid = 0;
+	if(size > self->chunk_size)
+	{
+		int ret = bfs_file_blobSetChunked(self, name, size,
+		                                  data, crc, &bid);
+		ret = bfs_file_release(self, &save, ret);
+		bfs_file_unlockExclusive(self);
+		return ret;
+	}
+
+	// deduplicated blobs store a NULL blob which references
+	// the content by the tbl_meta cid
+	sqlite3_int64 cid    = 0;
+	int           ccodec = BFS_CODEC_NONE;
+	if(dedup &&
+	   (bfs_file_contentSet(self, hash, size, data, codec,
+	                        bytes, enc, &cid, &ccodec) == 0))
+	{
+		FREE(enc);
+		bfs_file_release(self, &save, 0);
+		bfs_file_unlockExclusive(self);
+		return 0;
+	}
+
+	int           idx_name;
+	int           idx_blob;
+	sqlite3_stmt* stmt;
+	sqlite3_int64 last;
+	idx_name = self->idx_blob_set_name;
+	idx_blob = self->idx_blob_set_blob;
+	stmt     = self->stmt_blob_set;
+	last     = sqlite3_last_insert_rowid(self->db);
+	// the name and data are only referenced until the
+	// statement is reset so avoid the transient copies
+	int ret = 1;
+	if((sqlite3_bind_text(stmt, idx_name, name, -1,
+	                      SQLITE_STATIC) != SQLITE_OK) ||
+	   (cid &&
+	    ((sqlite3_bind_null(stmt, idx_blob) != SQLITE_OK) ||
+	     (bfs_file_bindContent(stmt, self->idx_blob_set_codec,
+	                           self->idx_blob_set_raw_size,
+	                           ccodec, size) == 0))) ||
+	   ((cid == 0) &&
+	    ((sqlite3_bind_blob64(stmt, idx_blob,
+	                          enc ? enc : data,
+	                          (sqlite3_uint64) bytes,
+	                          SQLITE_STATIC) != SQLITE_OK) ||
+	     (bfs_file_bindCodec(stmt, self->idx_blob_set_codec,
+	                         self->idx_blob_set_raw_size,
+	                         codec, size) == 0))) ||
+	   (bfs_file_bindCrc(stmt, self->idx_blob_set_crc,
+	                     crc) == 0))
+	{
+		LOGE("sqlite3_bind_text/sqlite3_bind_blob: name=%s, msg=%s",
+		     name, sqlite3_errmsg(self->db));
+		ret = 0;
+	}
+	else if(sqlite3_step(stmt) != SQLITE_DONE)
+	{
+		LOGE("sqlite3_step: name=%s, msg=%s",
+		     name, sqlite3_errmsg(self->db));
+		ret = 0;
+	}
+
+	if(sqlite3_reset(stmt) != SQLITE_OK)
+	{
+		LOGW("sqlite3_reset failed");
+	}
+	FREE(enc);
+
+	int created = 0;
+	if(ret &&
+	   ((bfs_file_blobRowid(self, name, last, &bid,
+	                        &created) == 0) ||
+	    (bfs_file_metaSet(self, bid, created, size,
+	                      cid) == 0)))
+	{
+		ret = 0;
+	}
+
+	if(savepoint)
+	{
+		ret = bfs_file_release(self, &save, ret);
+	}
+
+	bfs_file_unlockExclusive(self);
+
+	return ret;
+}
+
+int bfs_file_blobSet(bfs_file_t* self, const char* name,
+                     size_t size, const void* data)
+{
+	// data may be NULL
+	ASSERT(self);
+	ASSERT(name);
+
+	uint64_t t0  = bfs_file_statsBegin();
+	int      ret = bfs_file_blobSetImpl(self, name, size, data);
+	return bfs_file_statsEnd(self, -1, BFS_STATS_BLOB_SET, t0,
+	                         ret, data ? size : 0, 0);
+}
+
+static int
+bfs_file_blobClrImpl(bfs_file_t* self, const char* name)
+{
+	ASSERT(self);
+	ASSERT(name);
+
+	if(bfs_file_queueBypass(self) == 0)
+	{
+		bfs_ticket_t* ticket = NULL;
+		if(bfs_file_queuePut(self, BFS_OP_BLOB_CLR, name,
+		                     0, NULL, &ticket) == 0)
+		{
+			return 0;
+		}
+		return bfs_file_wait(self, &ticket);
+	}
+
+	bfs_file_lockExclusive(self);
+	bfs_file_cacheInvalidate(self, name);
+	if(bfs_file_beginTransaction(self, 0) == 0)
+	{
+		bfs_file_unlockExclusive(self);
+		return 0;
+	}
+
+	int           idx_name;
+	sqlite3_stmt* stmt;
+	idx_name = self->idx_blob_clr_name;
+	stmt     = self->stmt_blob_clr;
+	if(sqlite3_bind_text(stmt, idx_name, name, -1,
+	                     SQLITE_TRANSIENT) != SQLITE_OK)
+	{
+		LOGE("sqlite3_bind_text: name=%s, msg=%s",
+		     name, sqlite3_errmsg(self->db));
+		bfs_file_unlockExclusive(self);
+		return 0;
+	}
+
+	int ret = 1;
+	if(sqlite3_step(stmt) != SQLITE_DONE)
+	{
+		LOGE("sqlite3_step: name=%s, msg=%s",
+		     name, sqlite3_errmsg(self->db));
+		ret = 0;
+	}
+
+	if(sqlite3_reset(stmt) != SQLITE_OK)
+	{
+		LOGW("sqlite3_reset failed");
+	}
+
+	bfs_file_unlockExclusive(self);
+
+	return ret;
+}
+
+int bfs_file_blobClr(bfs_file_t* self, const char* name)
+{
+	ASSERT(self);
+	ASSERT(name);
+
+	uint64_t t0  = bfs_file_statsBegin();
+	int      ret = bfs_file_blobClrImpl(self, name);
+	return bfs_file_statsEnd(self, -1, BFS_STATS_BLOB_CLR, t0,
+	                         ret, 0, 0);
+}
+
+static int
+bfs_file_blobSetByIdImpl(bfs_file_t* self,
+                         bfs_blobid_t id,
+                         size_t size,
+                         const void* data)
+{
+	// data may be NULL
+	ASSERT(self);
+
+	if(self->mode != BFS_MODE_RDWR)
+	{
+		LOGE("invalid mode");
+		return 0;
 	}
 
-	self->nth  = nth;
-	self->mode = mode;
+	// the write is ordered after the queued writes
+	bfs_file_queueDrain(self);
 
-	// sqlite3 must be initialized externally
-	if(sqlite3_open_v2(fname, &self->db, flags,
-	                   NULL) != SQLITE_OK)
+	// see bfs_file_blobSet
+	int64_t crc = (int64_t) bfs_crc32c(0, data, data ? size : 0);
+	uint8_t hash[BFS_HASH128_SIZE];
+	int     dedup = self->dedup && data &&
+	                (size >= DEDUP_MIN) &&
+	                (size <= self->chunk_size);
+	if(dedup)
 	{
-		LOGE("sqlite3_open_v2 %s failed", fname);
-		goto fail_db_open;
+		bfs_hash128(data, size, hash);
 	}
 
-	if(flags & SQLITE_OPEN_CREATE)
+	int    codec = BFS_CODEC_NONE;
+	size_t bytes = size;
+	void*  enc   = NULL;
+	if(data && (bfs_file_encode(self, size, data, &codec,
+	                            &bytes, &enc) == 0))
 	{
-		if(bfs_file_createTables(self) == 0)
+		return 0;
+	}
+
+	bfs_file_lockExclusive(self);
+
+	// the cache is indexed by name
+	if(self->cache)
+	{
+		sqlite3_stmt* stmt = self->stmt_blob_name;
+		if(sqlite3_bind_int64(stmt, self->idx_blob_name_bid,
+		                      (sqlite3_int64) id) != SQLITE_OK)
 		{
-			goto fail_initialize;
+			LOGE("sqlite3_bind_int64: id=%" PRId64,
+			     (int64_t) id);
+			bfs_file_unlockExclusive(self);
+			FREE(enc);
+			return 0;
 		}
 
-		if(mode == BFS_MODE_STREAM)
+		int ret  = 1;
+		int step = sqlite3_step(stmt);
+		if(step == SQLITE_ROW)
 		{
-			// index creation is faster at close
+			const char* name;
+			name = (const char*) sqlite3_column_text(stmt, 0);
+			bfs_file_cacheInvalidate(self, name);
 		}
-		else if(bfs_file_createIndices(self) == 0)
+		else if(step == SQLITE_DONE)
 		{
-			goto fail_initialize;
+			LOGE("invalid id=%" PRId64, (int64_t) id);
+			ret = 0;
+		}
+		else
+		{
+			LOGE("sqlite3_step: id=%" PRId64 ", msg=%s",
+			     (int64_t) id, sqlite3_errmsg(self->db));
+			ret = 0;
+		}
+
+		if(sqlite3_reset(stmt) != SQLITE_OK)
+		{
+			LOGW("sqlite3_reset failed");
+		}
+
+		if(ret == 0)
+		{
+			bfs_file_unlockExclusive(self);
+			FREE(enc);
+			return 0;
 		}
 	}
 
-	const char* sql_begin = "BEGIN;";
-	if(sqlite3_prepare_v2(self->db, sql_begin, -1,
-	                      &self->stmt_begin,
-	                      NULL) != SQLITE_OK)
+	if(bfs_file_beginTransaction(self, bytes) == 0)
 	{
-		LOGE("sqlite3_prepare_v2: %s",
-		     sqlite3_errmsg(self->db));
-		goto fail_prepare_begin;
+		bfs_file_unlockExclusive(self);
+		FREE(enc);
+		return 0;
 	}
 
-	const char* sql_end = "END;";
-	if(sqlite3_prepare_v2(self->db, sql_end, -1,
-	                      &self->stmt_end,
-	                      NULL) != SQLITE_OK)
+	// the blob and chunks are modified as a unit
+	bfs_total_t save;
+	if(bfs_file_savepoint(self, &save) == 0)
 	{
-		LOGE("sqlite3_prepare_v2: %s",
-		     sqlite3_errmsg(self->db));
-		goto fail_prepare_end;
+		bfs_file_unlockExclusive(self);
+		FREE(enc);
+		return 0;
 	}
 
-	const char* sql_attr_list;
-	sql_attr_list = "SELECT key, val FROM tbl_attr;";
-	if(sqlite3_prepare_v2(self->db, sql_attr_list, -1,
-	                      &self->stmt_attr_list,
-	                      NULL) != SQLITE_OK)
-	if(self->stmt_attr_list == NULL)
+	// empty blobs are cleared (see bfs_file_blobSet) and
+	// updates remove the chunks of a chunked blob
+	sqlite3_stmt* stmt;
+	sqlite3_int64 cid    = 0;
+	int           ccodec = BFS_CODEC_NONE;
+	int           ret    = 1;
+	if(dedup &&
+	   (bfs_file_contentSet(self, hash, size, data, codec,
+	                        bytes, enc, &cid, &ccodec) == 0))
 	{
-		LOGE("sqlite3_prepare_v2: %s",
-		     sqlite3_errmsg(self->db));
-		goto fail_prepare_attr_list;
+		stmt = NULL;
+		ret  = 0;
 	}
-
-	self->stmt_attr_get = (sqlite3_stmt**)
-	                      CALLOC(nth, sizeof(sqlite3_stmt*));
-	if(self->stmt_attr_get == NULL)
+	else if((size == 0) || (data == NULL))
 	{
-		LOGE("CALLOC failed");
-		goto fail_alloc_attr_get;
+		stmt = self->stmt_blob_delete;
+		if(sqlite3_bind_int64(stmt, self->idx_blob_delete_bid,
+		                      (sqlite3_int64) id) != SQLITE_OK)
+		{
+			LOGE("sqlite3_bind_int64: id=%" PRId64,
+			     (int64_t) id);
+			ret = 0;
+		}
+	}
+	else
+	{
+		int bind;
+		stmt = self->stmt_blob_update;
+		if((size > self->chunk_size) || cid)
+		{
+			bind = sqlite3_bind_null(stmt,
+			                         self->idx_blob_update_blob);
+		}
+		else
+		{
+			bind = sqlite3_bind_blob64(stmt,
+			                           self->idx_blob_update_blob,
+			                           enc ? enc : data,
+			                           (sqlite3_uint64) bytes,
+			                           SQLITE_STATIC);
+		}
+
+		if((bind != SQLITE_OK) ||
+		   (sqlite3_bind_int64(stmt, self->idx_blob_update_bid,
+		                       (sqlite3_int64) id) != SQLITE_OK) ||
+		   (cid &&
+		    (bfs_file_bindContent(stmt, self->idx_blob_update_codec,
+		                          self->idx_blob_update_raw_size,
+		                          ccodec, size) == 0)) ||
+		   ((cid == 0) &&
+		    (bfs_file_bindCodec(stmt, self->idx_blob_update_codec,
+		                        self->idx_blob_update_raw_size,
+		                        codec, size) == 0)) ||
+		   (bfs_file_bindCrc(stmt, self->idx_blob_update_crc,
+		                     crc) == 0))
+		{
+			LOGE("sqlite3_bind: id=%" PRId64, (int64_t) id);
+			ret = 0;
+		}
 	}
 
-	int i;
-	for(i = 0; i < nth; ++i)
+	if(ret && bfs_file_step(self, stmt))
 	{
-		const char* sql_attr_get;
-		sql_attr_get = "SELECT val FROM tbl_attr"
-		               "   WHERE key=@arg_key;";
-		if(sqlite3_prepare_v2(self->db, sql_attr_get, -1,
-		                      &self->stmt_attr_get[i],
-		                      NULL) != SQLITE_OK)
+		if(sqlite3_changes(self->db) == 0)
 		{
-			LOGE("sqlite3_prepare_v2: %s",
-			     sqlite3_errmsg(self->db));
-			goto fail_prepare_attr_get;
+			LOGE("invalid id=%" PRId64, (int64_t) id);
+			ret = 0;
+		}
+		else if(data)
+		{
+			ret = bfs_file_metaSet(self, (sqlite3_int64) id,
+			                       0, size, cid);
+			if(ret && (size > self->chunk_size))
+			{
+				ret = bfs_file_chunkAppend(self,
+				                           (sqlite3_int64) id,
+				                           0, size, data);
+			}
 		}
 	}
+	else
+	{
+		ret = 0;
+	}
+	FREE(enc);
+	ret = bfs_file_release(self, &save, ret);
 
-	const char* sql_attr_set = "REPLACE INTO tbl_attr (key, val)"
-	                           "   VALUES (@arg_key, @arg_val);";
-	if(sqlite3_prepare_v2(self->db, sql_attr_set, -1,
-	                      &self->stmt_attr_set,
-	                      NULL) != SQLITE_OK)
+	bfs_file_unlockExclusive(self);
+
+	return ret;
+}
+
+int bfs_file_blobSetById(bfs_file_t* self,
+                         bfs_blobid_t id,
+                         size_t size,
+                         const void* data)
+{
+	// data may be NULL
+	ASSERT(self);
+
+	uint64_t t0  = bfs_file_statsBegin();
+	int      ret = bfs_file_blobSetByIdImpl(self, id, size, data);
+	return bfs_file_statsEnd(self, -1, BFS_STATS_BLOB_SET, t0,
+	                         ret, data ? size : 0, 0);
+}
+
+static int
+bfs_file_blobSetFdImpl(bfs_file_t* self,
+                       const char* name, int fd)
+{
+	ASSERT(self);
+	ASSERT(name);
+
+	struct stat st;
+	if(fstat(fd, &st) != 0)
 	{
-		LOGE("sqlite3_prepare_v2: %s",
-		     sqlite3_errmsg(self->db));
-		goto fail_prepare_attr_set;
+		LOGE("fstat failed");
+		return 0;
 	}
 
-	const char* sql_attr_clr;
-	sql_attr_clr = "DELETE FROM tbl_attr"
-	               "   WHERE key=@arg_key;";
-	if(sqlite3_prepare_v2(self->db, sql_attr_clr, -1,
-	                      &self->stmt_attr_clr,
-	                      NULL) != SQLITE_OK)
+	// the size must be known to reserve the blob
+	if(S_ISREG(st.st_mode) == 0)
 	{
-		LOGE("sqlite3_prepare_v2: %s",
-		     sqlite3_errmsg(self->db));
-		goto fail_prepare_attr_clr;
+		LOGE("invalid fd=%i", fd);
+		return 0;
 	}
 
-	const char* sql_blob_list;
-	sql_blob_list = "SELECT name, length(blob) FROM tbl_blob;";
-	if(sqlite3_prepare_v2(self->db, sql_blob_list, -1,
-	                      &self->stmt_blob_list,
-	                      NULL) != SQLITE_OK)
-	if(self->stmt_blob_list == NULL)
+	size_t size = (size_t) st.st_size;
+	if(size == 0)
 	{
-		LOGE("sqlite3_prepare_v2: %s",
-		     sqlite3_errmsg(self->db));
-		goto fail_prepare_blob_list;
+		return bfs_file_blobClr(self, name);
 	}
 
-	const char* sql_blob_like;
-	sql_blob_like = "SELECT name, length(blob) FROM tbl_blob WHERE name LIKE @arg_pat;";
-	if(sqlite3_prepare_v2(self->db, sql_blob_like, -1,
-	                      &self->stmt_blob_like,
-	                      NULL) != SQLITE_OK)
-	if(self->stmt_blob_like == NULL)
+	// inline blobs are read whole when compression or
+	// deduplication is enabled (see bfs_file_blobSet)
+	int    whole = (self->codec || self->dedup) &&
+	               (size <= self->chunk_size);
+	size_t chunk = (size < BLOB_CHUNK) ? size : BLOB_CHUNK;
+	if(whole)
 	{
-		LOGE("sqlite3_prepare_v2: %s",
-		     sqlite3_errmsg(self->db));
-		goto fail_prepare_blob_like;
+		chunk = size;
 	}
 
-	self->stmt_blob_get = (sqlite3_stmt**)
-	                      CALLOC(nth, sizeof(sqlite3_stmt*));
-	if(self->stmt_blob_get == NULL)
+	void* data = MALLOC(chunk);
+	if(data == NULL)
 	{
-		LOGE("CALLOC failed");
-		goto fail_alloc_blob_get;
+		LOGE("MALLOC failed");
+		return 0;
 	}
 
-	int j;
-	for(j = 0; j < nth; ++j)
+	if(whole)
 	{
-		const char* sql_blob_get;
-		sql_blob_get = "SELECT blob FROM tbl_blob"
-		               "   WHERE name=@arg_name;";
-		if(sqlite3_prepare_v2(self->db, sql_blob_get, -1,
-		                      &self->stmt_blob_get[j],
-		                      NULL) != SQLITE_OK)
+		size_t offset = 0;
+		while(offset < size)
 		{
-			LOGE("sqlite3_prepare_v2: %s",
-			     sqlite3_errmsg(self->db));
-			goto fail_prepare_blob_get;
+			ssize_t bytes;
+			bytes = read(fd, (char*) data + offset,
+			             size - offset);
+			if((bytes < 0) && (errno == EINTR))
+			{
+				continue;
+			}
+			else if(bytes <= 0)
+			{
+				LOGE("read failed");
+				FREE(data);
+				return 0;
+			}
+
+			offset += (size_t) bytes;
 		}
+
+		int ret = bfs_file_blobSet(self, name, size, data);
+		FREE(data);
+		return ret;
 	}
 
-	const char* sql_blob_set = "REPLACE INTO tbl_blob (name, blob)"
-	                           "   VALUES (@arg_name, @arg_blob);";
-	if(sqlite3_prepare_v2(self->db, sql_blob_set, -1,
-	                      &self->stmt_blob_set,
-	                      NULL) != SQLITE_OK)
+	bfs_blobWriter_t* writer;
+	writer = bfs_blobWriter_open(self, name, size);
+	if(writer == NULL)
 	{
-		LOGE("sqlite3_prepare_v2: %s",
-		     sqlite3_errmsg(self->db));
-		goto fail_prepare_blob_set;
+		goto fail_writer;
 	}
 
-	const char* sql_blob_clr;
-	sql_blob_clr = "DELETE FROM tbl_blob"
-	               "   WHERE name=@arg_name;";
-	if(sqlite3_prepare_v2(self->db, sql_blob_clr, -1,
-	                      &self->stmt_blob_clr,
-	                      NULL) != SQLITE_OK)
+	size_t offset = 0;
+	while(offset < size)
 	{
-		LOGE("sqlite3_prepare_v2: %s",
-		     sqlite3_errmsg(self->db));
-		goto fail_prepare_blob_clr;
+		size_t  count = size - offset;
+		ssize_t bytes;
+		if(count > chunk)
+		{
+			count = chunk;
+		}
+
+		bytes = read(fd, data, count);
+		if((bytes < 0) && (errno == EINTR))
+		{
+			continue;
+		}
+		else if(bytes <= 0)
+		{
+			LOGE("read failed");
+			goto fail_read;
+		}
+
+		if(bfs_blobWriter_write(writer, offset, (size_t) bytes,
+		                        data) == 0)
+		{
+			goto fail_write;
+		}
+
+		offset += (size_t) bytes;
 	}
 
-	self->idx_attr_get_key  = sqlite3_bind_parameter_index(self->stmt_attr_get[0],
-	                                                       "@arg_key");
-	self->idx_attr_set_key  = sqlite3_bind_parameter_index(self->stmt_attr_set,
-	                                                       "@arg_key");
-	self->idx_attr_set_val  = sqlite3_bind_parameter_index(self->stmt_attr_set,
-	                                                       "@arg_val");
-	self->idx_attr_clr_key  = sqlite3_bind_parameter_index(self->stmt_attr_clr,
-	                                                       "@arg_key");
-	self->idx_blob_like_pat = sqlite3_bind_parameter_index(self->stmt_blob_like,
-	                                                       "@arg_pat");
-	self->idx_blob_get_name = sqlite3_bind_parameter_index(self->stmt_blob_get[0],
-	                                                       "@arg_name");
-	self->idx_blob_set_name = sqlite3_bind_parameter_index(self->stmt_blob_set,
-	                                                       "@arg_name");
-	self->idx_blob_set_blob = sqlite3_bind_parameter_index(self->stmt_blob_set,
-	                                                       "@arg_blob");
-	self->idx_blob_clr_name = sqlite3_bind_parameter_index(self->stmt_blob_clr,
-	                                                       "@arg_name");
+	if(bfs_blobWriter_commit(writer) == 0)
+	{
+		goto fail_commit;
+	}
 
-	if(pthread_mutex_init(&self->mutex, NULL) != 0)
+	bfs_blobWriter_close(&writer);
+	FREE(data);
+
+	// success
+	return 1;
+
+	// failure
+	fail_commit:
+	fail_write:
+	fail_read:
+		bfs_blobWriter_close(&writer);
+	fail_writer:
+		FREE(data);
+	return 0;
+}
+
+int bfs_file_blobSetFd(bfs_file_t* self,
+                       const char* name, int fd)
+{
+	ASSERT(self);
+	ASSERT(name);
+
+	uint64_t t0    = bfs_file_statsBegin();
+	int      ret   = bfs_file_blobSetFdImpl(self, name, fd);
+	size_t   bytes = 0;
+	#if BFS_STATS
+	struct stat st;
+	if(ret && (fstat(fd, &st) == 0))
 	{
-		LOGE("pthread_mutex_init failed");
-		goto fail_mutex;
+		bytes = (size_t) st.st_size;
 	}
+	#endif
+	return bfs_file_statsEnd(self, -1, BFS_STATS_BLOB_SET, t0,
+	                         ret, bytes, 0);
+}
 
-	if(pthread_cond_init(&self->cond, NULL) != 0)
+int bfs_file_blobAppend(bfs_file_t* self,
+                        const char* name,
+                        size_t size, const void* data)
+{
+	// data may be NULL when size is zero
+	ASSERT(self);
+	ASSERT(name);
+
+	uint64_t t0  = bfs_file_statsBegin();
+	int      ret = bfs_file_blobModify(self, name, 1, 0,
+	                                   size, data);
+	return bfs_file_statsEnd(self, -1, BFS_STATS_BLOB_WRITE, t0,
+	                         ret, size, 0);
+}
+
+int bfs_file_blobWrite(bfs_file_t* self, const char* name,
+                       size_t offset, size_t size,
+                       const void* data)
+{
+	// data may be NULL when size is zero
+	ASSERT(self);
+	ASSERT(name);
+
+	uint64_t t0  = bfs_file_statsBegin();
+	int      ret = bfs_file_blobModify(self, name, 0, offset,
+	                                   size, data);
+	return bfs_file_statsEnd(self, -1, BFS_STATS_BLOB_WRITE, t0,
+	                         ret, size, 0);
+}
+
+int bfs_file_verify(bfs_file_t* self, void* priv,
+                    bfs_blob_fn corrupt_fn,
+                    bfs_verify_t* verify)
+{
+	// priv and corrupt_fn may be NULL
+	ASSERT(self);
+	ASSERT(verify);
+
+	memset(verify, 0, sizeof(bfs_verify_t));
+
+	if(self->mode == BFS_MODE_STREAM)
 	{
-		LOGE("pthread_cond_init failed");
-		goto fail_cond;
+		LOGE("invalid mode");
+		return 0;
+	}
+
+	// include the queued writes
+	bfs_file_queueDrain(self);
+
+	bfs_verifier_t verifier =
+	{
+		.file       = self,
+		.priv       = priv,
+		.corrupt_fn = corrupt_fn,
+		.next       = 1,
+	};
+
+	bfs_file_lockRead(self, 0);
+	int ret = bfs_file_blobLast(self->conn[0].db,
+	                            &verifier.last);
+	bfs_file_unlockRead(self, 0);
+	if(ret == 0)
+	{
+		return 0;
 	}
 
-	// success
-	return self;
+	if(pthread_mutex_init(&verifier.mutex, NULL) != 0)
+	{
+		LOGE("pthread_mutex_init failed");
+		return 0;
+	}
 
-	// failure
-	int t;
-	fail_cond:
-		pthread_mutex_destroy(&self->mutex);
-	fail_mutex:
-		sqlite3_finalize(self->stmt_blob_clr);
-	fail_prepare_blob_clr:
-		sqlite3_finalize(self->stmt_blob_set);
-	fail_prepare_blob_set:
-	fail_prepare_blob_get:
+	bfs_verifyTask_t* tasks;
+	tasks = (bfs_verifyTask_t*)
+	        CALLOC(self->nth, sizeof(bfs_verifyTask_t));
+	if(tasks == NULL)
 	{
-		for(t = 0; t < j; ++t)
-		{
-			sqlite3_finalize(self->stmt_blob_get[t]);
-		}
-		FREE(self->stmt_blob_get);
+		LOGE("CALLOC failed");
+		goto fail_tasks;
 	}
-	fail_alloc_blob_get:
-		sqlite3_finalize(self->stmt_blob_like);
-	fail_prepare_blob_like:
-		sqlite3_finalize(self->stmt_blob_list);
-	fail_prepare_blob_list:
-		sqlite3_finalize(self->stmt_attr_clr);
-	fail_prepare_attr_clr:
-		sqlite3_finalize(self->stmt_attr_set);
-	fail_prepare_attr_set:
-	fail_prepare_attr_get:
+
+	// each thread reads with the connection of its tid
+	int started = 0;
+	int tid;
+	for(tid = 0; tid < self->nth; ++tid)
 	{
-		for(t = 0; t < i; ++t)
+		bfs_verifyTask_t* task = &tasks[tid];
+		task->verifier = &verifier;
+		task->tid      = tid;
+		task->status   = 1;
+		if(pthread_create(&task->thread, NULL,
+		                  bfs_file_verifyThread,
+		                  (void*) task) != 0)
 		{
-			sqlite3_finalize(self->stmt_attr_get[t]);
+			LOGE("pthread_create failed");
+			__atomic_store_n(&verifier.stop, 1,
+			                 __ATOMIC_SEQ_CST);
+			ret = 0;
+			break;
 		}
-		FREE(self->stmt_attr_get);
+		++started;
 	}
-	fail_alloc_attr_get:
-		sqlite3_finalize(self->stmt_attr_list);
-	fail_prepare_attr_list:
-		sqlite3_finalize(self->stmt_end);
-	fail_prepare_end:
-		sqlite3_finalize(self->stmt_begin);
-	fail_prepare_begin:
-	fail_initialize:
-	fail_db_open:
+
+	for(tid = 0; tid < started; ++tid)
 	{
-		// sqlite3 must be shutdown externally
-		// close db even when open fails
-		if(sqlite3_close_v2(self->db) != SQLITE_OK)
+		bfs_verifyTask_t* task = &tasks[tid];
+		pthread_join(task->thread, NULL);
+
+		verify->count   += task->verify.count;
+		verify->bytes   += task->verify.bytes;
+		verify->skipped += task->verify.skipped;
+		verify->corrupt += task->verify.corrupt;
+		if(task->status == 0)
 		{
-			LOGW("sqlite3_close_v2 failed");
+			ret = 0;
 		}
-		FREE(self);
 	}
-	return NULL;
+
+	FREE(tasks);
+	pthread_mutex_destroy(&verifier.mutex);
+
+	// success
+	return ret;
+
+	// failure
+	fail_tasks:
+		pthread_mutex_destroy(&verifier.mutex);
+	return 0;
 }
 
-void bfs_file_close(bfs_file_t** _self)
+int bfs_file_queueAttrSet(bfs_file_t* self,
+                          const char* key,
+                          const char* val,
+                          bfs_ticket_t** _ticket)
 {
-	ASSERT(_self);
+	// val and _ticket may be NULL
+	ASSERT(self);
+	ASSERT(key);
 
-	bfs_file_t* self = *_self;
-	if(self)
+	if(val == NULL)
 	{
-		if(bfs_file_endTransaction(self) == 0)
-		{
-			// ignore
-		}
+		return bfs_file_queueAttrClr(self, key, _ticket);
+	}
 
-		if(self->mode == BFS_MODE_STREAM)
+	if(bfs_file_queueBypass(self))
+	{
+		if(_ticket)
 		{
-			bfs_file_createIndices(self);
+			*_ticket = NULL;
 		}
+		return bfs_file_attrSet(self, key, val);
+	}
 
-		pthread_cond_destroy(&self->cond);
-		pthread_mutex_destroy(&self->mutex);
-		sqlite3_finalize(self->stmt_blob_clr);
-		sqlite3_finalize(self->stmt_blob_set);
+	return bfs_file_queuePut(self, BFS_OP_ATTR_SET, key,
+	                         strlen(val) + 1, val, _ticket);
+}
 
-		int i;
-		for(i = 0; i < self->nth; ++i)
+int bfs_file_queueAttrClr(bfs_file_t* self,
+                          const char* key,
+                          bfs_ticket_t** _ticket)
+{
+	// _ticket may be NULL
+	ASSERT(self);
+	ASSERT(key);
+
+	if(bfs_file_queueBypass(self))
+	{
+		if(_ticket)
 		{
-			sqlite3_finalize(self->stmt_blob_get[i]);
+			*_ticket = NULL;
 		}
-		FREE(self->stmt_blob_get);
+		return bfs_file_attrClr(self, key);
+	}
 
-		sqlite3_finalize(self->stmt_blob_like);
-		sqlite3_finalize(self->stmt_blob_list);
-		sqlite3_finalize(self->stmt_attr_clr);
-		sqlite3_finalize(self->stmt_attr_set);
+	return bfs_file_queuePut(self, BFS_OP_ATTR_CLR, key,
+	                         0, NULL, _ticket);
+}
 
-		for(i = 0; i < self->nth; ++i)
-		{
-			sqlite3_finalize(self->stmt_attr_get[i]);
-		}
-		FREE(self->stmt_attr_get);
+int bfs_file_queueBlobSet(bfs_file_t* self,
+                          const char* name,
+                          size_t size,
+                          const void* data,
+                          bfs_ticket_t** _ticket)
+{
+	// data and _ticket may be NULL
+	ASSERT(self);
+	ASSERT(name);
 
-		sqlite3_finalize(self->stmt_attr_list);
-		sqlite3_finalize(self->stmt_end);
-		sqlite3_finalize(self->stmt_begin);
+	if((size == 0) || (data == NULL))
+	{
+		return bfs_file_queueBlobClr(self, name, _ticket);
+	}
 
-		// sqlite3 must be shutdown externally
-		if(sqlite3_close_v2(self->db) != SQLITE_OK)
+	if(bfs_file_queueBypass(self))
+	{
+		if(_ticket)
 		{
-			LOGW("sqlite3_close_v2 failed");
+			*_ticket = NULL;
 		}
-		FREE(self);
+		return bfs_file_blobSet(self, name, size, data);
 	}
+
+	return bfs_file_queuePut(self, BFS_OP_BLOB_SET, name,
+	                         size, data, _ticket);
 }
 
-int bfs_file_flush(bfs_file_t* self)
+int bfs_file_queueBlobClr(bfs_file_t* self,
+                          const char* name,
+                          bfs_ticket_t** _ticket)
 {
+	// _ticket may be NULL
 	ASSERT(self);
+	ASSERT(name);
 
-	return bfs_file_endTransaction(self);
+	if(bfs_file_queueBypass(self))
+	{
+		if(_ticket)
+		{
+			*_ticket = NULL;
+		}
+		return bfs_file_blobClr(self, name);
+	}
+
+	return bfs_file_queuePut(self, BFS_OP_BLOB_CLR, name,
+	                         0, NULL, _ticket);
 }
 
-int bfs_file_attrList(bfs_file_t* self, void* priv,
-                      bfs_attr_fn attr_fn)
+int bfs_file_wait(bfs_file_t* self, bfs_ticket_t** _ticket)
 {
-	// priv may be NULL
 	ASSERT(self);
-	ASSERT(attr_fn);
+	ASSERT(_ticket);
 
-	if(self->mode == BFS_MODE_STREAM)
+	bfs_ticket_t* ticket = *_ticket;
+	if(ticket == NULL)
 	{
-		LOGE("invalid mode");
-		return 0;
+		return 1;
 	}
 
-	bfs_file_lockExclusive(self);
+	pthread_mutex_lock(&self->queue_mutex);
 
-	const char*   key;
-	const char*   val;
-	int           ret  = 1;
-	sqlite3_stmt* stmt = self->stmt_attr_list;
-	int           step = sqlite3_step(stmt);
-	while(step == SQLITE_ROW)
+	// request the queue thread to commit the ticket
+	// without waiting for the group to fill
+	if(self->queue_flush < ticket->seq)
 	{
-		key  = (const char*) sqlite3_column_text(stmt, 0);
-		val  = (const char*) sqlite3_column_text(stmt, 1);
-		ret &= (*attr_fn)(priv, key, val);
-		step = sqlite3_step(stmt);
+		self->queue_flush = ticket->seq;
+		pthread_cond_signal(&self->queue_cond_put);
 	}
 
-	if(step != SQLITE_DONE)
+	while(ticket->done == 0)
 	{
-		LOGE("sqlite3_step: %s", sqlite3_errmsg(self->db));
-		ret = 0;
+		pthread_cond_wait(&self->queue_cond_done,
+		                  &self->queue_mutex);
 	}
 
-	if(sqlite3_reset(stmt) != SQLITE_OK)
-	{
-		LOGW("sqlite3_reset failed");
-	}
+	int ret = ticket->status;
+	bfs_file_queueRelease(self, ticket);
 
-	bfs_file_unlockExclusive(self);
+	pthread_mutex_unlock(&self->queue_mutex);
+
+	*_ticket = NULL;
 
 	return ret;
 }
 
-int bfs_file_attrGet(bfs_file_t* self, int tid,
-                     const char* key,
-                     size_t size, char* val)
+bfs_blobWriter_t*
+bfs_blobWriter_open(bfs_file_t* file, const char* name,
+                    size_t size)
 {
-	ASSERT(self);
-	ASSERT(key);
-	ASSERT(size > 0);
-	ASSERT(val);
-
-	// allow return success with empty data
-	val[0] = '\0';
+	ASSERT(file);
+	ASSERT(name);
 
-	if(self->mode == BFS_MODE_STREAM)
+	if(file->mode == BFS_MODE_RDONLY)
 	{
 		LOGE("invalid mode");
-		return 0;
+		return NULL;
+	}
+
+	bfs_blobWriter_t* self;
+	self = (bfs_blobWriter_t*)
+	       CALLOC(1, sizeof(bfs_blobWriter_t));
+	if(self == NULL)
+	{
+		LOGE("CALLOC failed");
+		return NULL;
 	}
 
-	bfs_file_lockRead(self);
+	self->file = file;
+	self->size = size;
 
-	int           idx  = self->idx_attr_get_key;
-	sqlite3_stmt* stmt = self->stmt_attr_get[tid];
-	if(sqlite3_bind_text(stmt, idx, key, -1,
-	                     SQLITE_TRANSIENT) != SQLITE_OK)
+	// the exclusive lock is held until the writer is
+	// committed or closed
+	bfs_file_lockExclusive(file);
+	bfs_file_cacheInvalidate(file, name);
+	if(bfs_file_beginTransaction(file, size) == 0)
 	{
-		LOGE("sqlite3_bind_text: key=%s", key);
-		bfs_file_unlockRead(self);
-		return 0;
+		goto fail_begin;
 	}
 
-	int ret  = 1;
-	int step = sqlite3_step(stmt);
-	if(step == SQLITE_ROW)
+	// the savepoint starts a transaction or nests inside
+	// the stream mode batch transaction
+	if(bfs_file_savepoint(file, &self->total) == 0)
 	{
-		const char* tmp;
-		tmp = (const char*) sqlite3_column_text(stmt, 0);
-		if(tmp)
+		goto fail_savepoint;
+	}
+
+	sqlite3_stmt* stmt;
+	sqlite3_int64 last = sqlite3_last_insert_rowid(file->db);
+	if(size > file->chunk_size)
+	{
+		// reserve the chunks (see bfs_file_blobSet)
+		if(bfs_file_blobSetChunked(file, name, size, NULL, -1,
+		                           &self->bid) == 0)
 		{
-			snprintf(val, size, "%s", tmp);
+			goto fail_step;
 		}
+		self->chunked = 1;
+		self->active  = 1;
+
+		// success
+		return self;
 	}
-	else if(step != SQLITE_DONE)
+	else if(size == 0)
 	{
-		LOGE("sqlite3_step: key=%s, msg=%s",
-		     key, sqlite3_errmsg(self->db));
-		ret = 0;
+		// empty blobs are cleared (see bfs_file_blobSet)
+		stmt = file->stmt_blob_clr;
+		if(sqlite3_bind_text(stmt, file->idx_blob_clr_name,
+		                     name, -1,
+		                     SQLITE_STATIC) != SQLITE_OK)
+		{
+			LOGE("sqlite3_bind_text: name=%s", name);
+			goto fail_bind;
+		}
+	}
+	else
+	{
+		stmt = file->stmt_blob_reserve;
+		if((sqlite3_bind_text(stmt, file->idx_blob_reserve_name,
+		                      name, -1,
+		                      SQLITE_STATIC) != SQLITE_OK) ||
+		   (sqlite3_bind_int64(stmt, file->idx_blob_reserve_size,
+		                       (sqlite3_int64) size) != SQLITE_OK))
+		{
+			LOGE("sqlite3_bind_text/sqlite3_bind_int64: name=%s",
+			     name);
+			goto fail_bind;
+		}
 	}
 
-	if(sqlite3_reset(stmt) != SQLITE_OK)
+	if(bfs_file_step(file, stmt) == 0)
 	{
-		LOGW("sqlite3_reset failed");
+		goto fail_step;
 	}
 
-	bfs_file_unlockRead(self);
+	if(size)
+	{
+		sqlite3_int64 rowid   = 0;
+		int           created = 0;
+		if((bfs_file_blobRowid(file, name, last, &rowid,
+		                       &created) == 0) ||
+		   (bfs_file_metaSet(file, rowid, created,
+		                     size, 0) == 0))
+		{
+			goto fail_step;
+		}
 
-	return ret;
+		if(sqlite3_blob_open(file->db, "main", "tbl_blob",
+		                     "blob", rowid, 1,
+		                     &self->blob) != SQLITE_OK)
+		{
+			LOGE("sqlite3_blob_open: name=%s, msg=%s",
+			     name, sqlite3_errmsg(file->db));
+			goto fail_blob_open;
+		}
+		self->bid = rowid;
+	}
+
+	self->active = 1;
+
+	// success
+	return self;
+
+	// failure
+	fail_blob_open:
+	{
+		// the blob handle may be allocated on error
+		sqlite3_blob_close(self->blob);
+	}
+	fail_step:
+	fail_bind:
+	{
+		bfs_file_release(file, &self->total, 0);
+	}
+	fail_savepoint:
+	fail_begin:
+	{
+		bfs_file_unlockExclusive(file);
+		FREE(self);
+	}
+	return NULL;
 }
 
-int bfs_file_attrSet(bfs_file_t* self, const char* key,
-                     const char* val)
+void bfs_blobWriter_close(bfs_blobWriter_t** _self)
 {
-	// val may be NULL
-	ASSERT(self);
-	ASSERT(key);
+	ASSERT(_self);
 
-	if(val == NULL)
+	bfs_blobWriter_t* self = *_self;
+	if(self)
 	{
-		return bfs_file_attrClr(self, key);
+		// discard uncommitted writes
+		if(self->active)
+		{
+			bfs_file_t* file = self->file;
+			if(self->blob)
+			{
+				sqlite3_blob_close(self->blob);
+			}
+			bfs_chunk_close(&self->chunk);
+			bfs_file_release(file, &self->total, 0);
+			bfs_file_unlockExclusive(file);
+		}
+		FREE(self);
+		*_self = NULL;
 	}
+}
 
-	bfs_file_lockExclusive(self);
-	if(bfs_file_beginTransaction(self) == 0)
+int bfs_blobWriter_write(bfs_blobWriter_t* self,
+                         size_t offset, size_t size,
+                         const void* data)
+{
+	ASSERT(self);
+	ASSERT(data);
+
+	if(self->active == 0)
 	{
-		bfs_file_unlockExclusive(self);
+		LOGE("invalid writer");
 		return 0;
 	}
-
-	int           idx_key;
-	int           idx_val;
-	sqlite3_stmt* stmt;
-	idx_key = self->idx_attr_set_key;
-	idx_val = self->idx_attr_set_val;
-	stmt    = self->stmt_attr_set;
-	if((sqlite3_bind_text(stmt, idx_key, key, -1,
-	                      SQLITE_TRANSIENT) != SQLITE_OK) ||
-	   (sqlite3_bind_text(stmt, idx_val, val, -1,
-	                      SQLITE_TRANSIENT) != SQLITE_OK))
+	else if((offset > self->size) ||
+	        (size > self->size - offset))
 	{
-		LOGE("sqlite3_bind_text: key=%s, val=%s", key, val);
-		bfs_file_unlockExclusive(self);
+		LOGE("invalid offset=%" PRIu64 ", size=%" PRIu64,
+		     (uint64_t) offset, (uint64_t) size);
 		return 0;
 	}
+	else if(size == 0)
+	{
+		return 1;
+	}
 
-	int ret = 1;
-	if(sqlite3_step(stmt) != SQLITE_DONE)
+	// extend the crc of sequential writes
+	if(offset == self->crc_size)
 	{
-		LOGE("sqlite3_step: key=%s, val=%s, msg=%s",
-		     key, val, sqlite3_errmsg(self->db));
-		ret = 0;
+		self->crc       = bfs_crc32c(self->crc, data, size);
+		self->crc_size += size;
+	}
+	else if(offset < self->crc_size)
+	{
+		self->crc_size = SIZE_MAX;
+	}
+
+	if(self->chunked)
+	{
+		return bfs_chunk_write(&self->chunk, self->file,
+		                       self->bid, offset, size, data);
 	}
 
-	if(sqlite3_reset(stmt) != SQLITE_OK)
+	// sqlite3 limits blobs to 2^31 - 1 bytes
+	if(sqlite3_blob_write(self->blob, data, (int) size,
+	                      (int) offset) != SQLITE_OK)
 	{
-		LOGW("sqlite3_reset failed");
+		LOGE("sqlite3_blob_write: offset=%" PRIu64
+		     ", size=%" PRIu64 ", msg=%s",
+		     (uint64_t) offset, (uint64_t) size,
+		     sqlite3_errmsg(self->file->db));
+		return 0;
 	}
 
-	bfs_file_unlockExclusive(self);
-
-	return ret;
+	return 1;
 }
 
-int bfs_file_attrClr(bfs_file_t* self, const char* key)
+int bfs_blobWriter_commit(bfs_blobWriter_t* self)
 {
 	ASSERT(self);
-	ASSERT(key);
 
-	bfs_file_lockExclusive(self);
-	if(bfs_file_beginTransaction(self) == 0)
-	{
-		bfs_file_unlockExclusive(self);
-		return 0;
-	}
+	bfs_file_t* file = self->file;
 
-	int idx_key;
-	sqlite3_stmt* stmt;
-	idx_key = self->idx_attr_clr_key;
-	stmt    = self->stmt_attr_clr;
-	if(sqlite3_bind_text(stmt, idx_key, key, -1,
-	                     SQLITE_TRANSIENT) != SQLITE_OK)
+	if(self->active == 0)
 	{
-		LOGE("sqlite3_bind_text: key=%s", key);
-		bfs_file_unlockExclusive(self);
+		LOGE("invalid writer");
 		return 0;
 	}
 
 	int ret = 1;
-	if(sqlite3_step(stmt) != SQLITE_DONE)
+	if(self->blob)
 	{
-		LOGE("sqlite3_step: key=%s, msg=%s",
-		     key, sqlite3_errmsg(self->db));
-		ret = 0;
+		if(sqlite3_blob_close(self->blob) != SQLITE_OK)
+		{
+			LOGE("sqlite3_blob_close: msg=%s",
+			     sqlite3_errmsg(file->db));
+			ret = 0;
+		}
+		self->blob = NULL;
 	}
+	bfs_chunk_close(&self->chunk);
 
-	if(sqlite3_reset(stmt) != SQLITE_OK)
+	// store the crc when the whole blob was written in order
+	if(ret && self->size && (self->crc_size == self->size))
 	{
-		LOGW("sqlite3_reset failed");
+		ret = bfs_file_blobCrc(file, self->bid,
+		                       (int64_t) self->crc);
 	}
 
-	bfs_file_unlockExclusive(self);
+	// commit or rollback the savepoint
+	ret = bfs_file_release(file, &self->total, ret);
+
+	self->active = 0;
+	bfs_file_unlockExclusive(file);
 
 	return ret;
 }
 
-int bfs_file_blobList(bfs_file_t* self, void* priv,
-                      bfs_blob_fn blob_fn,
-                      const char* pattern)
+bfs_blobPage_t* bfs_blobPage_new(void)
 {
-	// priv and pattern may be NULL
-	ASSERT(self);
-	ASSERT(blob_fn);
-
-	if(self->mode == BFS_MODE_STREAM)
+	bfs_blobPage_t* self;
+	self = (bfs_blobPage_t*)
+	       CALLOC(1, sizeof(bfs_blobPage_t));
+	if(self == NULL)
 	{
-		LOGE("invalid mode");
-		return 0;
+		LOGE("CALLOC failed");
+		return NULL;
 	}
 
-	bfs_file_lockExclusive(self);
+	return self;
+}
 
-	sqlite3_stmt* stmt = self->stmt_blob_list;
-	if(pattern)
+void bfs_blobPage_delete(bfs_blobPage_t** _self)
+{
+	ASSERT(_self);
+
+	bfs_blobPage_t* self = *_self;
+	if(self)
 	{
-		stmt = self->stmt_blob_like;
+		FREE(self->names);
+		FREE(self->offsets);
+		FREE(self->sizes);
+		FREE(self);
+		*_self = NULL;
+	}
+}
 
-		int idx = self->idx_blob_like_pat;
-		if(sqlite3_bind_text(stmt, idx, pattern, -1,
-		                     SQLITE_TRANSIENT) != SQLITE_OK)
-		{
-			LOGE("sqlite3_bind_text: pattern=%s",
-			     pattern);
-			bfs_file_unlockExclusive(self);
-			return 0;
-		}
+int bfs_blobPage_count(bfs_blobPage_t* self)
+{
+	ASSERT(self);
+
+	return self->count;
+}
+
+const char* bfs_blobPage_name(bfs_blobPage_t* self, int i)
+{
+	ASSERT(self);
+	ASSERT((i >= 0) && (i < self->count));
+
+	return self->names + self->offsets[i];
+}
+
+size_t bfs_blobPage_size(bfs_blobPage_t* self, int i)
+{
+	ASSERT(self);
+	ASSERT((i >= 0) && (i < self->count));
+
+	return self->sizes[i];
+}
+
+const char* bfs_blobPage_next(bfs_blobPage_t* self)
+{
+	ASSERT(self);
+
+	// the last name resumes the listing on the next page
+	if(self->more)
+	{
+		return bfs_blobPage_name(self, self->count - 1);
 	}
 
-	int ret  = 1;
-	int step = sqlite3_step(stmt);
-	while(step == SQLITE_ROW)
+	return NULL;
+}
+
+bfs_blobReader_t*
+bfs_blobReader_open(bfs_file_t* file, int tid,
+                    const char* name)
+{
+	ASSERT(file);
+	ASSERT(name);
+
+	if(file->mode == BFS_MODE_STREAM)
 	{
-		size_t      size;
-		const char* name;
-		name = (const char*) sqlite3_column_text(stmt, 0);
-		size = (size_t) sqlite3_column_int(stmt, 1);
-		ret &= (*blob_fn)(priv, name, size);
-		step = sqlite3_step(stmt);
+		LOGE("invalid mode");
+		return NULL;
 	}
 
-	if(step != SQLITE_DONE)
+	bfs_blobReader_t* self;
+	self = (bfs_blobReader_t*)
+	       CALLOC(1, sizeof(bfs_blobReader_t));
+	if(self == NULL)
 	{
-		LOGE("sqlite3_step: pattern=%s, msg=%s",
-		     pattern, sqlite3_errmsg(self->db));
-		ret = 0;
+		LOGE("CALLOC failed");
+		return NULL;
 	}
 
-	if(sqlite3_reset(stmt) != SQLITE_OK)
+	self->file = file;
+	self->tid  = tid;
+
+	if(bfs_blobReader_reopen(self, name) == 0)
 	{
-		LOGW("sqlite3_reset failed");
+		goto fail_reopen;
 	}
 
-	bfs_file_unlockExclusive(self);
+	// success
+	return self;
 
-	return ret;
+	// failure
+	fail_reopen:
+		FREE(self);
+	return NULL;
 }
 
-int bfs_file_blobGet(bfs_file_t* self, int tid,
-                     const char* name,
-                     size_t* _size, void** _data)
+void bfs_blobReader_close(bfs_blobReader_t** _self)
+{
+	ASSERT(_self);
+
+	bfs_blobReader_t* self = *_self;
+	if(self)
+	{
+		if(self->blob)
+		{
+			sqlite3_blob_close(self->blob);
+		}
+		bfs_chunk_close(&self->chunk);
+		FREE(self->data);
+		FREE(self);
+		*_self = NULL;
+	}
+}
+
+int bfs_blobReader_reopen(bfs_blobReader_t* self,
+                          const char* name)
 {
-	// _data may be NULL
 	ASSERT(self);
 	ASSERT(name);
-	ASSERT(_size);
 
-	// allow return success with empty data
-	*_size = 0;
+	bfs_file_t* file = self->file;
 
-	if(self->mode == BFS_MODE_STREAM)
+	// allow return success with empty data
+	self->size    = 0;
+	self->chunked = 0;
+	self->bid     = 0;
+	self->codec   = BFS_CODEC_NONE;
+
+	// queued writes must be committed before the blob
+	// may be read incrementally
+	bfs_ticket_t* ticket;
+	ticket = bfs_file_queueFind(file, BFS_OP_BLOB_SET, name);
+	if(ticket)
 	{
-		LOGE("invalid mode");
-		return 0;
+		bfs_file_wait(file, &ticket);
 	}
 
-	bfs_file_lockRead(self);
+	bfs_file_lockRead(file, self->tid);
 
-	int           idx  = self->idx_blob_get_name;
-	sqlite3_stmt* stmt = self->stmt_blob_get[tid];
+	int           idx  = file->idx_blob_rowid_name;
+	bfs_conn_t*   conn = &file->conn[self->tid];
+	sqlite3_stmt* stmt = conn->stmt_blob_rowid;
 	if(sqlite3_bind_text(stmt, idx, name, -1,
-	                     SQLITE_TRANSIENT) != SQLITE_OK)
+	                     SQLITE_STATIC) != SQLITE_OK)
 	{
 		LOGE("sqlite3_bind_text: name=%s", name);
-		bfs_file_unlockRead(self);
+		bfs_file_unlockRead(file, self->tid);
 		return 0;
 	}
 
-	int ret  = 1;
-	int step = sqlite3_step(stmt);
+	int           ret      = 1;
+	int           found    = 0;
+	sqlite3_int64 rowid    = 0;
+	sqlite3_int64 cid      = 0;
+	size_t        raw_size = 0;
+	int           step     = sqlite3_step(stmt);
 	if(step == SQLITE_ROW)
 	{
-		int size = sqlite3_column_bytes(stmt, 0);
-		if(_data)
-		{
-			// get the size and data
-			void*       data = *_data;
-			const void* blob = sqlite3_column_blob(stmt, 0);
-			if((size == 0) || (blob == NULL))
-			{
-				// empty data
-			}
-			else if(data == NULL)
-			{
-				// allocate data buffer
-				data = CALLOC(1, size);
-				if(data)
-				{
-					memcpy(data, blob, size);
-					*_size = size;
-					*_data = data;
-				}
-				else
-				{
-					LOGE("CALLOC failed");
-					ret = 0;
-				}
-			}
-			else if(MEMSIZEPTR(data) < size)
-			{
-				// grow data buffer
-				data = REALLOC(*_data, size);
-				if(data)
-				{
-					memcpy(data, blob, size);
-					*_size = size;
-					*_data = data;
-				}
-				else
-				{
-					LOGE("REALLOC failed");
-					ret = 0;
-				}
-			}
-			else
-			{
-				// reuse data buffer
-				memcpy(data, blob, size);
-				*_size = size;
-			}
-		}
-		else
-		{
-			// get the size or existance
-			*_size = size;
-		}
+		rowid    = sqlite3_column_int64(stmt, 0);
+		raw_size = (size_t) sqlite3_column_int64(stmt, 3);
+		cid      = sqlite3_column_int64(stmt, 4);
+		found    = 1;
+
+		self->chunked = sqlite3_column_int(stmt, 1);
+		self->codec   = sqlite3_column_int(stmt, 2);
+		self->bid     = rowid;
 	}
 	else if(step != SQLITE_DONE)
 	{
 		LOGE("sqlite3_step: name=%s, msg=%s",
-		     name, sqlite3_errmsg(self->db));
+		     name, sqlite3_errmsg(conn->db));
 		ret = 0;
 	}
 
@@ -1040,105 +9064,136 @@ int bfs_file_blobGet(bfs_file_t* self, int tid,
 		LOGW("sqlite3_reset failed");
 	}
 
-	bfs_file_unlockRead(self);
-
-	return ret;
-}
-
-int bfs_file_blobSet(bfs_file_t* self, const char* name,
-                     size_t size, const void* data)
-{
-	// data may be NULL
-	ASSERT(self);
-	ASSERT(name);
+	// chunk handles are opened on demand by read
+	bfs_chunk_close(&self->chunk);
 
-	if((size == 0) || (data == NULL))
+	if(found && self->chunked)
 	{
-		return bfs_file_blobClr(self, name);
-	}
+		// release the previous blob
+		if(self->blob)
+		{
+			sqlite3_blob_close(self->blob);
+			self->blob = NULL;
+		}
 
-	bfs_file_lockExclusive(self);
-	if(bfs_file_beginTransaction(self) == 0)
+		ret = bfs_file_chunkSize(file, conn->db,
+		                         conn->stmt_chunk_size,
+		                         rowid, &self->size);
+	}
+	else if(found == 0)
 	{
-		bfs_file_unlockExclusive(self);
-		return 0;
+		// release the previous blob
+		if(self->blob)
+		{
+			sqlite3_blob_close(self->blob);
+			self->blob = NULL;
+		}
 	}
-
-	int           idx_name;
-	int           idx_blob;
-	sqlite3_stmt* stmt;
-	idx_name = self->idx_blob_set_name;
-	idx_blob = self->idx_blob_set_blob;
-	stmt     = self->stmt_blob_set;
-	if((sqlite3_bind_text(stmt, idx_name, name, -1,
-	                      SQLITE_TRANSIENT) != SQLITE_OK) ||
-	   (sqlite3_bind_blob(stmt, idx_blob,
-	                      data, size,
-	                      SQLITE_TRANSIENT) != SQLITE_OK))
+	else
 	{
-		LOGE("sqlite3_bind_text/sqlite3_bind_blob: name=%s, msg=%s",
-		     name, sqlite3_errmsg(self->db));
-		bfs_file_unlockExclusive(self);
-		return 0;
+		// reuse the blob handle to move to the new row
+		// unless the blob is stored in another table
+		if(self->blob && (self->content != (cid != 0)))
+		{
+			sqlite3_blob_close(self->blob);
+			self->blob = NULL;
+		}
+
+		self->content = (cid != 0);
+		if(bfs_conn_blobOpen(conn, self->content,
+		                     cid ? cid : rowid,
+		                     &self->blob) == 0)
+		{
+			LOGE("invalid name=%s", name);
+			ret = 0;
+		}
 	}
 
-	int ret = 1;
-	if(sqlite3_step(stmt) != SQLITE_DONE)
+	if(self->blob && self->codec)
 	{
-		LOGE("sqlite3_step: name=%s, msg=%s",
-		     name, sqlite3_errmsg(self->db));
-		ret = 0;
+		// compressed blobs are decompressed by reopen since
+		// they may not be read incrementally
+		void* tmp = NULL;
+		ret = bfs_file_alloc(&self->data, raw_size) &&
+		      bfs_file_blobDecode(conn->db, self->blob,
+		                          self->codec, raw_size,
+		                          &tmp, self->data);
+		FREE(tmp);
+		if(ret)
+		{
+			self->size = raw_size;
+		}
 	}
-
-	if(sqlite3_reset(stmt) != SQLITE_OK)
+	else if(self->blob)
 	{
-		LOGW("sqlite3_reset failed");
+		self->size = (size_t) sqlite3_blob_bytes(self->blob);
 	}
 
-	bfs_file_unlockExclusive(self);
+	bfs_file_unlockRead(file, self->tid);
 
 	return ret;
 }
 
-int bfs_file_blobClr(bfs_file_t* self, const char* name)
+size_t bfs_blobReader_size(bfs_blobReader_t* self)
 {
 	ASSERT(self);
-	ASSERT(name);
 
-	bfs_file_lockExclusive(self);
-	if(bfs_file_beginTransaction(self) == 0)
+	return self->size;
+}
+
+int bfs_blobReader_read(bfs_blobReader_t* self,
+                        size_t offset, size_t size,
+                        void* data)
+{
+	ASSERT(self);
+	ASSERT(data);
+
+	if((offset > self->size) ||
+	   (size > self->size - offset))
 	{
-		bfs_file_unlockExclusive(self);
+		LOGE("invalid offset=%" PRIu64 ", size=%" PRIu64,
+		     (uint64_t) offset, (uint64_t) size);
 		return 0;
 	}
+	else if(size == 0)
+	{
+		return 1;
+	}
 
-	int           idx_name;
-	sqlite3_stmt* stmt;
-	idx_name = self->idx_blob_clr_name;
-	stmt     = self->stmt_blob_clr;
-	if(sqlite3_bind_text(stmt, idx_name, name, -1,
-	                     SQLITE_TRANSIENT) != SQLITE_OK)
+	bfs_file_t* file = self->file;
+
+	if(self->codec)
 	{
-		LOGE("sqlite3_bind_text: name=%s, msg=%s",
-		     name, sqlite3_errmsg(self->db));
-		bfs_file_unlockExclusive(self);
-		return 0;
+		memcpy(data, (const char*) self->data + offset, size);
+		return 1;
 	}
 
-	int ret = 1;
-	if(sqlite3_step(stmt) != SQLITE_DONE)
+	bfs_file_lockRead(file, self->tid);
+
+	if(self->chunked)
 	{
-		LOGE("sqlite3_step: name=%s, msg=%s",
-		     name, sqlite3_errmsg(self->db));
-		ret = 0;
+		bfs_conn_t* conn = &file->conn[self->tid];
+
+		int ret = bfs_chunk_read(&self->chunk, file, conn->db,
+		                         conn->stmt_chunk_find,
+		                         self->bid, offset, size, data);
+		bfs_file_unlockRead(file, self->tid);
+		return ret;
 	}
 
-	if(sqlite3_reset(stmt) != SQLITE_OK)
+	// sqlite3 limits blobs to 2^31 - 1 bytes
+	int ret = 1;
+	if(sqlite3_blob_read(self->blob, data, (int) size,
+	                     (int) offset) != SQLITE_OK)
 	{
-		LOGW("sqlite3_reset failed");
+		LOGE("sqlite3_blob_read: offset=%" PRIu64
+		     ", size=%" PRIu64 ", msg=%s",
+		     (uint64_t) offset, (uint64_t) size,
+		     sqlite3_errmsg(file->conn[self->tid].db));
+		ret = 0;
 	}
 
-	bfs_file_unlockExclusive(self);
+	bfs_file_unlockRead(file, self->tid);
 
 	return ret;
 }
@@ -24,6 +24,10 @@
 #ifndef bfs_file_H
 #define bfs_file_H
 
+#include "bfs_cache.h"
+#include "bfs_codec.h"
+#include "bfs_stats.h"
+
 /*
  * callback functions
  */
@@ -34,6 +38,36 @@ typedef int (*bfs_attr_fn)(void* priv,
 typedef int (*bfs_blob_fn)(void* priv,
                            const char* name,
                            size_t size);
+typedef int (*bfs_data_fn)(void* priv,
+                           const char* name,
+                           size_t size,
+                           const void* data);
+
+/*
+ * verify results
+ *
+ * count: blobs which matched their crc
+ * bytes: bytes which matched their crc
+ * skipped: blobs which do not have a crc
+ * corrupt: blobs which did not match their crc
+ */
+
+typedef struct
+{
+	uint64_t count;
+	uint64_t bytes;
+	uint64_t skipped;
+	uint64_t corrupt;
+} bfs_verify_t;
+
+/*
+ * blob handles
+ *
+ * the tbl_blob rowid which remains valid until the blob is
+ * cleared (see bfs_file_blobLookup)
+ */
+
+typedef int64_t bfs_blobid_t;
 
 /*
  * constants
@@ -46,11 +80,108 @@ typedef enum
 	BFS_MODE_STREAM = 2,
 } bfs_mode_e;
 
+typedef enum
+{
+	BFS_JOURNAL_DEFAULT  = 0,
+	BFS_JOURNAL_DELETE   = 1,
+	BFS_JOURNAL_TRUNCATE = 2,
+	BFS_JOURNAL_PERSIST  = 3,
+	BFS_JOURNAL_MEMORY   = 4,
+	BFS_JOURNAL_WAL      = 5,
+	BFS_JOURNAL_OFF      = 6,
+} bfs_journal_e;
+
+typedef enum
+{
+	BFS_SYNC_DEFAULT = 0,
+	BFS_SYNC_OFF     = 1,
+	BFS_SYNC_NORMAL  = 2,
+	BFS_SYNC_FULL    = 3,
+	BFS_SYNC_EXTRA   = 4,
+} bfs_sync_e;
+
+typedef enum
+{
+	BFS_TEMP_DEFAULT = 0,
+	BFS_TEMP_FILE    = 1,
+	BFS_TEMP_MEMORY  = 2,
+} bfs_temp_e;
+
+/*
+ * open options
+ *
+ * zero initialized fields select the default behavior
+ * page_size: bytes (only applied when creating a file)
+ * cache_size: pages or -KiB when negative (per connection)
+ * mmap_size: bytes (per connection)
+ * chunk_size: bytes (blobs larger than chunk_size are
+ *             stored as a sequence of chunks)
+ * queue_count: operations (enables the write-behind queue
+ *              in the read-write mode)
+ * queue_bytes: bytes (write-behind queue)
+ * queue_ms: milliseconds (write-behind queue)
+ * cache_bytes: bytes (enables the blob cache)
+ * attr_snapshot: nonzero loads the attributes into memory
+ *                at open (required by attrGetPtr)
+ * codec: codec id used to compress the inline blobs
+ *        (see bfs_codec.h)
+ * dedup: nonzero stores identical inline blobs once
+ * verify: nonzero verifies the crc of the blobs returned
+ *         by the get functions
+ * batch_count: operations (streaming mode batch)
+ * batch_bytes: bytes (streaming mode batch)
+ * batch_ms: milliseconds (streaming mode batch)
+ */
+
+typedef struct
+{
+	int           nth;
+	bfs_mode_e    mode;
+	bfs_journal_e journal_mode;
+	int           page_size;
+	int           cache_size;
+	size_t        mmap_size;
+	bfs_sync_e    synchronous;
+	bfs_temp_e    temp_store;
+	size_t        chunk_size;
+	int           queue_count;
+	size_t        queue_bytes;
+	int           queue_ms;
+	size_t        cache_bytes;
+	int           attr_snapshot;
+	int           codec;
+	int           dedup;
+	int           verify;
+	int           batch_count;
+	size_t        batch_bytes;
+	int           batch_ms;
+} bfs_options_t;
+
+/*
+ * streaming mode batch
+ *
+ * count/bytes/ms: size and age of the uncommitted batch
+ * level: fill level between 0.0 and 1.0 of the closest
+ *        batch limit
+ */
+
+typedef struct
+{
+	int    count;
+	size_t bytes;
+	int    ms;
+	double level;
+} bfs_batch_t;
+
 /*
  * opaque objects
  */
 
-typedef struct bfs_file_s bfs_file_t;
+typedef struct bfs_file_s       bfs_file_t;
+typedef struct bfs_blobPage_s   bfs_blobPage_t;
+typedef struct bfs_blobReader_s bfs_blobReader_t;
+typedef struct bfs_blobWriter_s bfs_blobWriter_t;
+typedef struct bfs_ticket_s     bfs_ticket_t;
 
 /*
  * file API
@@ -59,9 +190,21 @@ typedef struct bfs_file_s bfs_file_t;
 bfs_file_t* bfs_file_open(const char* fname,
                           int nth,
                           bfs_mode_e mode);
+bfs_file_t* bfs_file_openEx(const char* fname,
+                            const bfs_options_t* opts);
 void        bfs_file_close(bfs_file_t** _self);
 int         bfs_file_flush(bfs_file_t* self);
+void        bfs_file_batch(bfs_file_t* self,
+                           bfs_batch_t* batch);
+void        bfs_file_cacheStats(bfs_file_t* self,
+                                bfs_cacheStats_t* stats);
+int         bfs_file_stats(bfs_file_t* self,
+                           bfs_stats_t* stats);
+int         bfs_file_txnBegin(bfs_file_t* self);
+int         bfs_file_txnCommit(bfs_file_t* self);
+int         bfs_file_txnRollback(bfs_file_t* self);
 int         bfs_file_attrList(bfs_file_t* self,
+                              int tid,
                               void* priv,
                               bfs_attr_fn attr_fn);
 int         bfs_file_attrGet(bfs_file_t* self,
@@ -69,25 +212,162 @@ int         bfs_file_attrGet(bfs_file_t* self,
                              const char* key,
                              size_t size,
                              char* val);
+int         bfs_file_attrGetPtr(bfs_file_t* self,
+                                int tid,
+                                const char* key,
+                                const char** _val,
+                                size_t* _len);
 int         bfs_file_attrSet(bfs_file_t* self,
                              const char* key,
                              const char* val);
 int         bfs_file_attrClr(bfs_file_t* self,
                              const char* key);
+int         bfs_file_blobCount(bfs_file_t* self,
+                               int tid,
+                               uint64_t* _count);
+int         bfs_file_totalBytes(bfs_file_t* self,
+                                int tid,
+                                uint64_t* _bytes);
 int         bfs_file_blobList(bfs_file_t* self,
+                              int tid,
                               void* priv,
                               bfs_blob_fn blob_fn,
                               const char* pattern);
+int         bfs_file_blobListPrefix(bfs_file_t* self,
+                                    int tid,
+                                    void* priv,
+                                    bfs_blob_fn blob_fn,
+                                    const char* prefix);
+int         bfs_file_blobListGlob(bfs_file_t* self,
+                                  int tid,
+                                  void* priv,
+                                  bfs_blob_fn blob_fn,
+                                  const char* pattern);
+int         bfs_file_blobListPage(bfs_file_t* self,
+                                  int tid,
+                                  const char* prefix,
+                                  const char* after,
+                                  int limit,
+                                  bfs_blobPage_t* page);
 int         bfs_file_blobGet(bfs_file_t* self,
                              int tid,
                              const char* name,
                              size_t* _size,
                              void** _data);
+int         bfs_file_blobGetBuffer(bfs_file_t* self,
+                                   int tid,
+                                   const char* name,
+                                   bfs_buffer_t** _buffer);
+int         bfs_file_blobGetMany(bfs_file_t* self,
+                                 int tid,
+                                 int count,
+                                 const char** names,
+                                 size_t* sizes,
+                                 void** datas);
+int         bfs_file_blobGetFn(bfs_file_t* self,
+                               int tid,
+                               const char* name,
+                               void* priv,
+                               bfs_data_fn data_fn);
+int         bfs_file_blobLookup(bfs_file_t* self,
+                                int tid,
+                                const char* name,
+                                bfs_blobid_t* _id);
+int         bfs_file_blobGetById(bfs_file_t* self,
+                                 int tid,
+                                 bfs_blobid_t id,
+                                 size_t* _size,
+                                 void** _data);
 int         bfs_file_blobSet(bfs_file_t* self,
                              const char* name,
                              size_t size,
                              const void* data);
+int         bfs_file_blobSetById(bfs_file_t* self,
+                                 bfs_blobid_t id,
+                                 size_t size,
+                                 const void* data);
+int         bfs_file_blobSetFd(bfs_file_t* self,
+                               const char* name,
+                               int fd);
+int         bfs_file_blobAppend(bfs_file_t* self,
+                                const char* name,
+                                size_t size,
+                                const void* data);
+int         bfs_file_blobWrite(bfs_file_t* self,
+                               const char* name,
+                               size_t offset,
+                               size_t size,
+                               const void* data);
 int         bfs_file_blobClr(bfs_file_t* self,
                              const char* name);
+int         bfs_file_verify(bfs_file_t* self,
+                            void* priv,
+                            bfs_blob_fn corrupt_fn,
+                            bfs_verify_t* verify);
+
+/*
+ * write-behind queue API
+ */
+
+int bfs_file_queueAttrSet(bfs_file_t* self,
+                          const char* key,
+                          const char* val,
+                          bfs_ticket_t** _ticket);
+int bfs_file_queueAttrClr(bfs_file_t* self,
+                          const char* key,
+                          bfs_ticket_t** _ticket);
+int bfs_file_queueBlobSet(bfs_file_t* self,
+                          const char* name,
+                          size_t size,
+                          const void* data,
+                          bfs_ticket_t** _ticket);
+int bfs_file_queueBlobClr(bfs_file_t* self,
+                          const char* name,
+                          bfs_ticket_t** _ticket);
+int bfs_file_wait(bfs_file_t* self,
+                  bfs_ticket_t** _ticket);
+
+/*
+ * blob page API
+ */
+
+bfs_blobPage_t* bfs_blobPage_new(void);
+void            bfs_blobPage_delete(bfs_blobPage_t** _self);
+int             bfs_blobPage_count(bfs_blobPage_t* self);
+const char*     bfs_blobPage_name(bfs_blobPage_t* self,
+                                  int i);
+size_t          bfs_blobPage_size(bfs_blobPage_t* self,
+                                  int i);
+const char*     bfs_blobPage_next(bfs_blobPage_t* self);
+
+/*
+ * blob reader API
+ */
+
+bfs_blobReader_t* bfs_blobReader_open(bfs_file_t* file,
+                                      int tid,
+                                      const char* name);
+void              bfs_blobReader_close(bfs_blobReader_t** _self);
+int               bfs_blobReader_reopen(bfs_blobReader_t* self,
+                                        const char* name);
+size_t            bfs_blobReader_size(bfs_blobReader_t* self);
+int               bfs_blobReader_read(bfs_blobReader_t* self,
+                                      size_t offset,
+                                      size_t size,
+                                      void* data);
+
+/*
+ * blob writer API
+ */
+
+bfs_blobWriter_t* bfs_blobWriter_open(bfs_file_t* file,
+                                      const char* name,
+                                      size_t size);
+void              bfs_blobWriter_close(bfs_blobWriter_t** _self);
+int               bfs_blobWriter_write(bfs_blobWriter_t* self,
+                                       size_t offset,
+                                       size_t size,
+                                       const void* data);
+int               bfs_blobWriter_commit(bfs_blobWriter_t* self);
 
 #endif
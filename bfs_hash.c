@@ -0,0 +1,322 @@
+/*
+ * Copyright (c) 2026 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <nmmintrin.h>
+#define BFS_CRC32C_SSE42
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#define BFS_CRC32C_ARM
+#endif
+
+#define LOG_TAG "bfs"
+#include "../libcc/cc_log.h"
+#include "bfs_hash.h"
+
+#define HASH_C1 0x87c37b91114253d5ULL
+#define HASH_C2 0x4cf5ad432745937fULL
+
+// reflected CRC32C (Castagnoli) polynomial
+#define CRC32C_POLY 0x82f63b78
+
+typedef uint32_t (*bfs_crc32c_fn)(uint32_t crc,
+                                  const uint8_t* src,
+                                  size_t size);
+
+// the slicing-by-8 tables and the implementation are
+// selected once by bfs_crc32c_init
+static pthread_once_t bfs_crc32c_once = PTHREAD_ONCE_INIT;
+static uint32_t       bfs_crc32c_table[8][256];
+static bfs_crc32c_fn  bfs_crc32c_impl;
+
+/***********************************************************
+* private                                                  *
+***********************************************************/
+
+static uint64_t bfs_hash_read64(const uint8_t* p)
+{
+	ASSERT(p);
+
+	uint64_t v;
+	memcpy(&v, p, sizeof(uint64_t));
+	return v;
+}
+
+static uint64_t bfs_hash_rotl64(uint64_t v, int r)
+{
+	return (v << r) | (v >> (64 - r));
+}
+
+static uint64_t bfs_hash_fmix64(uint64_t k)
+{
+	k ^= k >> 33;
+	k *= 0xff51afd7ed558ccdULL;
+	k ^= k >> 33;
+	k *= 0xc4ceb9fe1a85ec53ULL;
+	k ^= k >> 33;
+	return k;
+}
+
+static uint32_t
+bfs_crc32c_scalar(uint32_t crc, const uint8_t* src,
+                  size_t size)
+{
+	// src may be NULL when size is zero
+
+	// slicing-by-8 processes 8 bytes per iteration
+	const uint32_t (*t)[256] = bfs_crc32c_table;
+	while(size >= 8)
+	{
+		uint32_t lo;
+		uint32_t hi;
+		memcpy(&lo, src, sizeof(uint32_t));
+		memcpy(&hi, src + 4, sizeof(uint32_t));
+		#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+		lo = __builtin_bswap32(lo);
+		hi = __builtin_bswap32(hi);
+		#endif
+		lo ^= crc;
+		crc = t[7][lo & 0xff] ^ t[6][(lo >> 8) & 0xff] ^
+		      t[5][(lo >> 16) & 0xff] ^ t[4][lo >> 24] ^
+		      t[3][hi & 0xff] ^ t[2][(hi >> 8) & 0xff] ^
+		      t[1][(hi >> 16) & 0xff] ^ t[0][hi >> 24];
+		src  += 8;
+		size -= 8;
+	}
+
+	while(size)
+	{
+		crc = t[0][(crc ^ *src) & 0xff] ^ (crc >> 8);
+		++src;
+		--size;
+	}
+
+	return crc;
+}
+
+#ifdef BFS_CRC32C_SSE42
+
+__attribute__((target("sse4.2")))
+static uint32_t
+bfs_crc32c_sse42(uint32_t crc, const uint8_t* src,
+                 size_t size)
+{
+	// src may be NULL when size is zero
+
+	uint64_t crc64 = crc;
+	while(size >= 8)
+	{
+		uint64_t v;
+		memcpy(&v, src, sizeof(uint64_t));
+		crc64 = _mm_crc32_u64(crc64, v);
+		src  += 8;
+		size -= 8;
+	}
+
+	crc = (uint32_t) crc64;
+	while(size)
+	{
+		crc = _mm_crc32_u8(crc, *src);
+		++src;
+		--size;
+	}
+
+	return crc;
+}
+
+#endif
+
+#ifdef BFS_CRC32C_ARM
+
+static uint32_t
+bfs_crc32c_arm(uint32_t crc, const uint8_t* src,
+               size_t size)
+{
+	// src may be NULL when size is zero
+
+	while(size >= 8)
+	{
+		uint64_t v;
+		memcpy(&v, src, sizeof(uint64_t));
+		crc   = __crc32cd(crc, v);
+		src  += 8;
+		size -= 8;
+	}
+
+	while(size)
+	{
+		crc = __crc32cb(crc, *src);
+		++src;
+		--size;
+	}
+
+	return crc;
+}
+
+#endif
+
+static void bfs_crc32c_init(void)
+{
+	uint32_t i;
+	uint32_t j;
+	for(i = 0; i < 256; ++i)
+	{
+		uint32_t crc = i;
+		for(j = 0; j < 8; ++j)
+		{
+			crc = (crc >> 1) ^ ((crc & 1) ? CRC32C_POLY : 0);
+		}
+		bfs_crc32c_table[0][i] = crc;
+	}
+
+	for(i = 0; i < 256; ++i)
+	{
+		uint32_t crc = bfs_crc32c_table[0][i];
+		for(j = 1; j < 8; ++j)
+		{
+			crc = bfs_crc32c_table[0][crc & 0xff] ^ (crc >> 8);
+			bfs_crc32c_table[j][i] = crc;
+		}
+	}
+
+	// the hardware instructions are selected when the
+	// CPU supports them at runtime (x86) or when they
+	// are enabled at compile time (ARM)
+	bfs_crc32c_impl = bfs_crc32c_scalar;
+	#if defined(BFS_CRC32C_SSE42)
+	__builtin_cpu_init();
+	if(__builtin_cpu_supports("sse4.2"))
+	{
+		bfs_crc32c_impl = bfs_crc32c_sse42;
+	}
+	#elif defined(BFS_CRC32C_ARM)
+	bfs_crc32c_impl = bfs_crc32c_arm;
+	#endif
+}
+
+/***********************************************************
+* public                                                   *
+***********************************************************/
+
+uint32_t bfs_crc32c(uint32_t crc, const void* data,
+                    size_t size)
+{
+	// data may be NULL when size is zero
+
+	pthread_once(&bfs_crc32c_once, bfs_crc32c_init);
+
+	return ~(*bfs_crc32c_impl)(~crc, (const uint8_t*) data,
+	                           size);
+}
+
+void bfs_hash128(const void* data, size_t size,
+                 uint8_t* hash)
+{
+	// data may be NULL when size is zero
+	ASSERT(hash);
+
+	const uint8_t* src = (const uint8_t*) data;
+	uint64_t       h1  = 0;
+	uint64_t       h2  = 0;
+	uint64_t       k1;
+	uint64_t       k2;
+
+	// body
+	size_t blocks = size/16;
+	size_t i;
+	for(i = 0; i < blocks; ++i)
+	{
+		k1 = bfs_hash_read64(src + 16*i);
+		k2 = bfs_hash_read64(src + 16*i + 8);
+
+		k1 *= HASH_C1;
+		k1  = bfs_hash_rotl64(k1, 31);
+		k1 *= HASH_C2;
+		h1 ^= k1;
+
+		h1  = bfs_hash_rotl64(h1, 27);
+		h1 += h2;
+		h1  = h1*5 + 0x52dce729;
+
+		k2 *= HASH_C2;
+		k2  = bfs_hash_rotl64(k2, 33);
+		k2 *= HASH_C1;
+		h2 ^= k2;
+
+		h2  = bfs_hash_rotl64(h2, 31);
+		h2 += h1;
+		h2  = h2*5 + 0x38495ab5;
+	}
+
+	// tail
+	const uint8_t* tail = src + 16*blocks;
+	size_t         rem  = size & 15;
+
+	k1 = 0;
+	k2 = 0;
+	for(i = rem; i > 8; --i)
+	{
+		k2 ^= ((uint64_t) tail[i - 1]) << (8*(i - 9));
+	}
+
+	if(rem > 8)
+	{
+		k2 *= HASH_C2;
+		k2  = bfs_hash_rotl64(k2, 33);
+		k2 *= HASH_C1;
+		h2 ^= k2;
+	}
+
+	for(i = (rem > 8) ? 8 : rem; i > 0; --i)
+	{
+		k1 ^= ((uint64_t) tail[i - 1]) << (8*(i - 1));
+	}
+
+	if(rem)
+	{
+		k1 *= HASH_C1;
+		k1  = bfs_hash_rotl64(k1, 31);
+		k1 *= HASH_C2;
+		h1 ^= k1;
+	}
+
+	// finalization
+	h1 ^= (uint64_t) size;
+	h2 ^= (uint64_t) size;
+
+	h1 += h2;
+	h2 += h1;
+
+	h1 = bfs_hash_fmix64(h1);
+	h2 = bfs_hash_fmix64(h2);
+
+	h1 += h2;
+	h2 += h1;
+
+	memcpy(hash, &h1, sizeof(uint64_t));
+	memcpy(hash + 8, &h2, sizeof(uint64_t));
+}
@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2026 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef bfs_hash_H
+#define bfs_hash_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * content hash
+ *
+ * the 128-bit MurmurHash3 (x64 variant) identifies the
+ * blob content for deduplication which is fast but not
+ * collision resistant so matching content must also be
+ * compared
+ */
+
+#define BFS_HASH128_SIZE 16
+
+void bfs_hash128(const void* data, size_t size,
+                 uint8_t* hash);
+
+/*
+ * checksum
+ *
+ * the CRC32C (Castagnoli) detects corrupted blobs and is
+ * computed with the SSE4.2 or ARMv8 CRC instructions when
+ * available (or a portable fallback otherwise)
+ *
+ * crc is 0 for the first call and the previous result to
+ * extend the checksum with the next block of data
+ */
+
+uint32_t bfs_crc32c(uint32_t crc, const void* data,
+                    size_t size);
+
+#endif
@@ -0,0 +1,231 @@
+/*
+ * Copyright (c) 2026 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define LOG_TAG "bfs"
+#include "../libcc/cc_log.h"
+#include "bfs_stats.h"
+
+/***********************************************************
+* private                                                  *
+***********************************************************/
+
+static int bfs_stats_bucket(uint64_t ns)
+{
+	if(ns < 8)
+	{
+		return (int) ns;
+	}
+
+	// the exponent selects the power of two and the next
+	// 3 bits select the linear sub-bucket
+	int e = 63 - __builtin_clzll(ns);
+	int b = 8*(e - 2) + (int) ((ns >> (e - 3)) & 7);
+	if(b >= BFS_STATS_BUCKETS)
+	{
+		b = BFS_STATS_BUCKETS - 1;
+	}
+
+	return b;
+}
+
+static uint64_t bfs_stats_bucketMin(int b)
+{
+	if(b < 8)
+	{
+		return (uint64_t) b;
+	}
+
+	int e = b/8 + 2;
+	return ((uint64_t) (8 + b%8)) << (e - 3);
+}
+
+/***********************************************************
+* public                                                   *
+***********************************************************/
+
+uint64_t bfs_stats_timestamp(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return 1000000000ULL*((uint64_t) ts.tv_sec) +
+	       (uint64_t) ts.tv_nsec;
+}
+
+void bfs_stats_add(bfs_stats_t* self, bfs_statsOp_e op,
+                   uint64_t ns, int ret, size_t bytes_in,
+                   size_t bytes_out)
+{
+	ASSERT(self);
+	ASSERT((op >= 0) && (op < BFS_STATS_COUNT));
+
+	bfs_statsOp_t* s = &self->op[op];
+
+	__atomic_fetch_add(&s->count, 1, __ATOMIC_RELAXED);
+	if(ret == 0)
+	{
+		__atomic_fetch_add(&s->errors, 1, __ATOMIC_RELAXED);
+	}
+	if(bytes_in)
+	{
+		__atomic_fetch_add(&s->bytes_in, (uint64_t) bytes_in,
+		                   __ATOMIC_RELAXED);
+	}
+	if(bytes_out)
+	{
+		__atomic_fetch_add(&s->bytes_out, (uint64_t) bytes_out,
+		                   __ATOMIC_RELAXED);
+	}
+	__atomic_fetch_add(&s->time_ns, ns, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&s->hist[bfs_stats_bucket(ns)], 1,
+	                   __ATOMIC_RELAXED);
+
+	uint64_t max_ns = __atomic_load_n(&s->max_ns,
+	                                  __ATOMIC_RELAXED);
+	while((ns > max_ns) &&
+	      (__atomic_compare_exchange_n(&s->max_ns, &max_ns, ns,
+	                                   1, __ATOMIC_RELAXED,
+	                                   __ATOMIC_RELAXED) == 0))
+	{
+		// max_ns was reloaded
+	}
+}
+
+void bfs_stats_merge(bfs_stats_t* self,
+                     const bfs_stats_t* src)
+{
+	ASSERT(self);
+	ASSERT(src);
+
+	int i;
+	int j;
+	for(i = 0; i < BFS_STATS_COUNT; ++i)
+	{
+		bfs_statsOp_t*       d = &self->op[i];
+		const bfs_statsOp_t* s = &src->op[i];
+
+		d->count     += __atomic_load_n(&s->count,     __ATOMIC_RELAXED);
+		d->errors    += __atomic_load_n(&s->errors,    __ATOMIC_RELAXED);
+		d->bytes_in  += __atomic_load_n(&s->bytes_in,  __ATOMIC_RELAXED);
+		d->bytes_out += __atomic_load_n(&s->bytes_out, __ATOMIC_RELAXED);
+		d->time_ns   += __atomic_load_n(&s->time_ns,   __ATOMIC_RELAXED);
+
+		uint64_t max_ns;
+		max_ns = __atomic_load_n(&s->max_ns, __ATOMIC_RELAXED);
+		if(max_ns > d->max_ns)
+		{
+			d->max_ns = max_ns;
+		}
+
+		for(j = 0; j < BFS_STATS_BUCKETS; ++j)
+		{
+			d->hist[j] += __atomic_load_n(&s->hist[j],
+			                              __ATOMIC_RELAXED);
+		}
+	}
+}
+
+uint64_t bfs_stats_percentile(const bfs_statsOp_t* op,
+                              double p)
+{
+	ASSERT(op);
+
+	uint64_t total = 0;
+
+	int b;
+	for(b = 0; b < BFS_STATS_BUCKETS; ++b)
+	{
+		total += op->hist[b];
+	}
+
+	if(total == 0)
+	{
+		return 0;
+	}
+
+	// find the bucket containing the rank where p is
+	// between 0.0 and 1.0 (e.g. 0.99)
+	double   r    = p*((double) total);
+	uint64_t rank = (uint64_t) r;
+	if((double) rank < r)
+	{
+		++rank;
+	}
+	if(rank < 1)
+	{
+		rank = 1;
+	}
+
+	uint64_t sum = 0;
+	for(b = 0; b < BFS_STATS_BUCKETS - 1; ++b)
+	{
+		sum += op->hist[b];
+		if(sum >= rank)
+		{
+			break;
+		}
+	}
+
+	// report the highest value in the bucket which is
+	// limited by the maximum
+	uint64_t ns = op->max_ns;
+	if(b < BFS_STATS_BUCKETS - 1)
+	{
+		uint64_t max = bfs_stats_bucketMin(b + 1) - 1;
+		if(max < ns)
+		{
+			ns = max;
+		}
+	}
+
+	return ns;
+}
+
+const char* bfs_stats_name(bfs_statsOp_e op)
+{
+	const char* names[BFS_STATS_COUNT] =
+	{
+		"attrGet",
+		"attrSet",
+		"attrClr",
+		"blobList",
+		"blobGet",
+		"blobGetMany",
+		"blobSet",
+		"blobClr",
+		"blobWrite",
+		"lockRead",
+		"lockExclusive",
+		"streamCommit",
+	};
+
+	if((op < 0) || (op >= BFS_STATS_COUNT))
+	{
+		return "invalid";
+	}
+
+	return names[op];
+}
@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2026 Jeff Boody
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef bfs_stats_H
+#define bfs_stats_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// compile with BFS_STATS=0 to remove the statistics
+#ifndef BFS_STATS
+#define BFS_STATS 1
+#endif
+
+/*
+ * constants
+ *
+ * the blob operations include the variants of each function
+ * (e.g. BFS_STATS_BLOB_GET includes bfs_file_blobGetFn())
+ * and the lock operations measure the time spent waiting
+ * for the lock
+ */
+
+typedef enum
+{
+	BFS_STATS_ATTR_GET       = 0,
+	BFS_STATS_ATTR_SET       = 1,
+	BFS_STATS_ATTR_CLR       = 2,
+	BFS_STATS_BLOB_LIST      = 3,
+	BFS_STATS_BLOB_GET       = 4,
+	BFS_STATS_BLOB_GET_MANY  = 5,
+	BFS_STATS_BLOB_SET       = 6,
+	BFS_STATS_BLOB_CLR       = 7,
+	BFS_STATS_BLOB_WRITE     = 8,
+	BFS_STATS_LOCK_READ      = 9,
+	BFS_STATS_LOCK_EXCLUSIVE = 10,
+	BFS_STATS_STREAM_COMMIT  = 11,
+	BFS_STATS_COUNT          = 12,
+} bfs_statsOp_e;
+
+// latencies are recorded in a log-linear histogram with
+// 8 buckets per power of two (12.5% resolution) from 1ns
+// to about 17s where the last bucket includes longer
+// latencies
+#define BFS_STATS_BUCKETS 256
+
+/*
+ * operation statistics
+ *
+ * count/errors: calls and failed calls
+ * bytes_in/bytes_out: bytes passed to or returned by calls
+ * time_ns/max_ns: total and maximum latency
+ * hist: latency histogram (see bfs_stats_percentile)
+ */
+
+typedef struct
+{
+	uint64_t count;
+	uint64_t errors;
+	uint64_t bytes_in;
+	uint64_t bytes_out;
+	uint64_t time_ns;
+	uint64_t max_ns;
+	uint64_t hist[BFS_STATS_BUCKETS];
+} bfs_statsOp_t;
+
+typedef struct
+{
+	bfs_statsOp_t op[BFS_STATS_COUNT];
+} bfs_stats_t;
+
+/*
+ * stats API
+ *
+ * the counters are updated with relaxed atomics so they
+ * may be read while they are updated but each thread
+ * should update a separate bfs_stats_t to avoid contention
+ */
+
+uint64_t    bfs_stats_timestamp(void);
+void        bfs_stats_add(bfs_stats_t* self,
+                          bfs_statsOp_e op,
+                          uint64_t ns, int ret,
+                          size_t bytes_in,
+                          size_t bytes_out);
+void        bfs_stats_merge(bfs_stats_t* self,
+                            const bfs_stats_t* src);
+uint64_t    bfs_stats_percentile(const bfs_statsOp_t* op,
+                                 double p);
+const char* bfs_stats_name(bfs_statsOp_e op);
+
+#endif